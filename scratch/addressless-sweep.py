@@ -0,0 +1,215 @@
+#!/usr/bin/env python
+## -*- Mode: python; py-indent-offset: 4; indent-tabs-mode: nil; coding: utf-8; -*-
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License version 2 as
+# published by the Free Software Foundation;
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+#
+"""Parameter sweep of the addressless simulations.
+
+Expands a grid of SimulationType, Protocol, NbClients, ClientInterval and
+RngRun, and runs every point as an independent process of
+build/scratch/addressless, on all the local cores. Each run streams its
+records to its own shard (--Output) and works in its own directory, so that
+the animation and pcap files of concurrent runs never collide. The shards are
+then converted by addressless_results.py into
+results/json/<SimulationType>_<Protocol>.json: one entry per ClientInterval,
+in ms, qualified by NbClients and RngRun when those vary.
+
+The seeding is deterministic: RngSeed is fixed and every point runs with the
+RngRun of the grid, so a point gives the same results whatever the number of
+jobs or the order of the runs. The shards already present are not run again:
+an interrupted sweep resumes where it stopped.
+
+Example, from the top directory, after ./waf build:
+
+    ./scratch/addressless-sweep.py --sim LISPRLOC,LISPFAST --protocol TCP \\
+        --clients 20,50 --interval 0,0.001 --runs 1-5
+
+Arguments after "--" are passed to every run (e.g. -- --NbMapServers=4).
+"""
+
+from __future__ import print_function
+
+import argparse
+import itertools
+import multiprocessing
+import os
+import shutil
+import subprocess
+import sys
+import threading
+import time
+from multiprocessing.pool import ThreadPool
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import addressless_results
+
+
+def parse_list(value):
+    return [v for v in value.split(",") if v]
+
+
+def parse_runs(value):
+    """'1-5' or '1,3,7' or '1-3,8'."""
+    runs = []
+    for item in parse_list(value):
+        if "-" in item:
+            first, last = item.split("-", 1)
+            runs.extend(range(int(first), int(last) + 1))
+        else:
+            runs.append(int(item))
+    return runs
+
+
+def shard_name(point):
+    return "%s_%s_n%d_i%s_r%d" % (point["SimulationType"], point["Protocol"],
+                                  point["NbClients"], point["ClientInterval"],
+                                  point["RngRun"])
+
+
+def expand(args):
+    points = []
+    for sim, proto, clients, interval, run in itertools.product(
+            parse_list(args.sim), parse_list(args.protocol),
+            [int(c) for c in parse_list(args.clients)],
+            parse_list(args.interval), parse_runs(args.runs)):
+        points.append({"SimulationType": sim, "Protocol": proto,
+                       "NbClients": clients, "ClientInterval": interval,
+                       "RngRun": run})
+    return points
+
+
+def run_point(point, args, lock):
+    name = shard_name(point)
+    shard = os.path.join(args.shards, name + ".jsonl")
+    if os.path.exists(shard):
+        return name, "cached", 0.0
+    work = os.path.join(args.shards, "work", name)
+    for sub in ("results", os.path.join("results", "json")):
+        if not os.path.isdir(os.path.join(work, sub)):
+            os.makedirs(os.path.join(work, sub))
+    cmd = [args.binary,
+           "--SimulationType=" + point["SimulationType"],
+           "--Protocol=" + point["Protocol"],
+           "--NbClients=%d" % point["NbClients"],
+           "--ClientInterval=" + point["ClientInterval"],
+           "--RngSeed=%d" % args.seed,
+           "--RngRun=%d" % point["RngRun"],
+           "--Output=" + shard + ".tmp"] + args.extra
+    env = dict(os.environ)
+    env["LD_LIBRARY_PATH"] = os.pathsep.join(
+        [args.libdir] + [p for p in [env.get("LD_LIBRARY_PATH")] if p])
+    start = time.time()
+    with open(os.path.join(work, "log.txt"), "w") as log:
+        status = subprocess.call(cmd, cwd=work, env=env, stdout=log,
+                                 stderr=subprocess.STDOUT)
+    elapsed = time.time() - start
+    # A shard only gets its name once complete: the runs in which some
+    # clients didn't complete their connections are run again next time.
+    runs = []
+    if os.path.exists(shard + ".tmp"):
+        runs = list(addressless_results.read_runs(shard + ".tmp"))
+    if status == 0 and len(runs) == 1 and runs[0][2] and runs[0][2]["Complete"]:
+        os.rename(shard + ".tmp", shard)
+        if not args.keep:
+            shutil.rmtree(work)
+        result = "done"
+    else:
+        # Kept for inspection: log.txt tells why the run failed or why not
+        # all the clients completed their connections.
+        if os.path.exists(shard + ".tmp"):
+            os.remove(shard + ".tmp")
+        result = "FAILED (%d, see %s)" % (status, work)
+    with lock:
+        print("%-50s %-30s %8.1f s" % (name, result, elapsed))
+        sys.stdout.flush()
+    return name, result, elapsed
+
+
+def merge(args):
+    """Converts all the shards of args.shards into args.results."""
+    shards = [os.path.join(args.shards, f) for f in sorted(os.listdir(args.shards))
+              if f.endswith(".jsonl")]
+    addressless_results.convert(shards, args.results)
+
+
+def main():
+    argv = sys.argv[1:]
+    extra = []
+    if "--" in argv:
+        extra = argv[argv.index("--") + 1:]
+        argv = argv[:argv.index("--")]
+
+    parser = argparse.ArgumentParser(
+        description="Parallel parameter sweep of scratch/addressless.",
+        epilog="Arguments after -- are passed to every run.")
+    parser.add_argument("--sim", default="LISPRLOC",
+                        help="comma-separated SimulationType values")
+    parser.add_argument("--protocol", default="TCP",
+                        help="comma-separated Protocol values")
+    parser.add_argument("--clients", default="20",
+                        help="comma-separated NbClients values")
+    parser.add_argument("--interval", default="0",
+                        help="comma-separated ClientInterval values (s)")
+    parser.add_argument("--runs", default="1",
+                        help="RngRun values, e.g. 1-10 or 1,4,7")
+    parser.add_argument("--seed", type=int, default=1,
+                        help="RngSeed shared by all the runs")
+    parser.add_argument("--jobs", "-j", type=int,
+                        default=multiprocessing.cpu_count(),
+                        help="number of concurrent runs (default: all cores)")
+    parser.add_argument("--binary", default=os.path.join("build", "scratch", "addressless"),
+                        help="the addressless program")
+    parser.add_argument("--shards", default=os.path.join("results", "shards"),
+                        help="directory of the shards of the runs")
+    parser.add_argument("--results", default=os.path.join("results", "json"),
+                        help="directory of the merged results")
+    parser.add_argument("--keep", action="store_true",
+                        help="keep the working directories of the runs that succeeded")
+    parser.add_argument("--no-merge", action="store_true",
+                        help="only run, e.g. to merge the shards of several machines later")
+    parser.add_argument("--merge-only", action="store_true",
+                        help="only merge the shards already present")
+    args = parser.parse_args(argv)
+    args.extra = extra
+    args.binary = os.path.abspath(args.binary)
+    args.libdir = os.path.dirname(os.path.dirname(args.binary))
+    args.shards = os.path.abspath(args.shards)
+    if not os.path.isdir(args.shards):
+        os.makedirs(args.shards)
+
+    failed = 0
+    if not args.merge_only:
+        if not os.path.exists(args.binary):
+            parser.error("%s not found, run ./waf build first" % args.binary)
+        points = expand(args)
+        print("%d runs on %d jobs" % (len(points), args.jobs))
+        lock = threading.Lock()
+        pool = ThreadPool(max(1, args.jobs))
+        results = pool.map(lambda p: run_point(p, args, lock), points)
+        pool.close()
+        pool.join()
+        failed = len([r for r in results if r[1].startswith("FAILED")])
+        work = os.path.join(args.shards, "work")
+        if os.path.isdir(work) and not os.listdir(work):
+            os.rmdir(work)
+        if failed:
+            print("%d of %d runs failed" % (failed, len(points)))
+
+    if not args.no_merge:
+        merge(args)
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -28,21 +28,65 @@ int main(int argc, char *argv[])
   std::string protocol;
   double delay = 0;
   int nbrClients = 1;
+  int nbrMapServers = 1;
+  int nbrMapResolvers = 1;
+  std::string scenario;
+  std::string mapTables = "ns3::SimpleMapTables";
+  uint32_t cacheCapacity = 0;
+  std::string output;
+  uint32_t resultsBuffer = ResultsSink::DEFAULT_BUFFER_SIZE;
+  bool headless = false;
+  bool aggregateAddresses = false;
+  std::string traceClients;
+  int traceOneIn = 0;
 
   // Defining user-supplied arguments
   cmd.AddValue("SimulationType", "Define which Simulation to execute.", simuChoice);
   cmd.AddValue("NbClients", "Number of clients", nbrClients);
+  cmd.AddValue("NbMapServers", "Number of Map-Servers sharing the EID space", nbrMapServers);
+  cmd.AddValue("NbMapResolvers", "Number of map resolvers, the xTRs are spread among them", nbrMapResolvers);
+  cmd.AddValue("Scenario", "Json file describing the topology (see Simulation::LoadScenario), instead of the star of NbClients clients", scenario);
   cmd.AddValue("Protocol", "Transport layer Protocol to be used: TCP or UDP", protocol);
   cmd.AddValue("ClientInterval", "Interval between subsequent clients connections", delay);
+  cmd.AddValue("MapTables", "MapTables implementation of the xTRs: ns3::SimpleMapTables or ns3::TrieMapTables", mapTables);
+  cmd.AddValue("CacheCapacity", "Maximum number of entries in the map-cache of the xTRs (0: no limit)", cacheCapacity);
+  cmd.AddValue("AggregateAddresses", "/31 core links and one EID block per site instead of a /24 per link (see AddressPlan)", aggregateAddresses);
+  cmd.AddValue("Output", "Json Lines file the records of the run are appended to (default: results/json/<SimulationType>_<Protocol>.jsonl), see scratch/addressless_results.py", output);
+  cmd.AddValue("ResultsBuffer", "Bytes of records buffered before being written to the Output file", resultsBuffer);
+  cmd.AddValue("Headless", "No animation nor packet metadata, for the runs with many clients", headless);
+  cmd.AddValue("TraceClients", "Comma-separated ids of the clients whose packets are captured to results/*.pcap", traceClients);
+  cmd.AddValue("TraceOneIn", "Also capture the packets of one client out of TraceOneIn (0: none)", traceOneIn);
   cmd.Parse(argc, argv);
 
   Simulation simu;
   simu.m_nbrclients = nbrClients;
+  simu.m_nbrMapServers = nbrMapServers;
+  simu.m_nbrMapResolvers = nbrMapResolvers;
   simu.m_timeBtwClients = delay;
+  simu.m_headless = headless;
+  simu.m_traceOneIn = traceOneIn;
+  simu.m_topology->m_addressPlan.SetAggregated(aggregateAddresses);
+  std::stringstream traced(traceClients);
+  for (std::string id; std::getline(traced, id, ',');)
+  {
+    simu.m_tracedClients.insert(std::stoi(id));
+  }
+  if (!scenario.empty())
+  {
+    // The command line chooses the simulation and the protocol, if it sets them
+    simu.LoadScenario(scenario);
+    simuChoice = simuChoice.empty() ? simu.m_scenarioSimulation : simuChoice;
+    protocol = protocol.empty() ? simu.m_scenarioProtocol : protocol;
+  }
+  simu.m_topology->m_lispHelper.SetMapTablesType(mapTables);
+  simu.m_topology->m_lispHelper.SetMapTablesAttribute("CacheCapacity", UintegerValue(cacheCapacity));
 
-  // Enabling metadata information
-  PacketMetadata::Enable();
-  Packet::EnablePrinting();
+  // Enabling metadata information, for the animation and the logs
+  if (!headless)
+  {
+    PacketMetadata::Enable();
+    Packet::EnablePrinting();
+  }
 
   for (std::string str : parseArgs(simuChoice))
   {
@@ -86,35 +130,35 @@ int main(int argc, char *argv[])
 
   simu.m_topology->m_protocol = (protocol == "TCP") ? "ns3::TcpSocketFactory" : "ns3::UdpSocketFactory";
   simu.Setup();
-  
-  Simulator::Run();
-  Simulator::Destroy();
 
-  // After simulation ran, log results to files.
-  std::ofstream out;
-  if (IPTopology::m_connectionTimes.size() < (size_t)nbrClients)
+  // The measurements are streamed to the records file during the run, after a
+  // header with the parameters of the run. Runs with the same simulation and
+  // protocol are appended to the same file by default.
+  if (output.empty())
   {
-    std::cerr << "All the clients didn't manage to complete their connections. Clients done: " << IPTopology::m_connectionTimes.size() << "< Total clients:" << (size_t)nbrClients << std::endl;
+    output = "results/json/" + simuChoice + "_" + protocol + ".jsonl";
   }
-  else
+  IPTopology::m_results.Open(output, resultsBuffer);
+  json header = {{"SimulationType", simuChoice}, {"Protocol", protocol}, {"NbClients", simu.m_nbrclients},
+                 {"ClientInterval", simu.m_timeBtwClients}, {"RngRun", RngSeedManager::GetRun()}};
+  if (!scenario.empty())
   {
-    // Saving json data to file
-    std::string filename = "results/json/" + simuChoice + "_" + protocol + ".json";
-    json j;
-    std::ifstream file(filename);
-    file.ignore(std::numeric_limits<std::streamsize>::max());
-    std::streamsize length = file.gcount();
-    file.clear(); //  Since ignore will have set eof.
-    file.seekg(0, std::ios_base::beg);
-    if(length > 10)
-    {
-      file >> j;
-    }
-    file.close();
-    j[std::to_string((double)(simu.m_timeBtwClients * 1000))] = IPTopology::m_data;
-    std::ofstream o(filename, std::ofstream::trunc);
-    o << std::setw(1) << j << std::endl;
+    header["Scenario"] = scenario;
+  }
+  IPTopology::m_results.Write(header);
+
+  Simulator::Run();
+  Simulator::Destroy();
+
+  // The trailer tells whether the run is complete: the records of the runs in
+  // which some clients didn't complete their connections are not converted.
+  bool complete = IPTopology::m_connectionTimes.size() >= (size_t)simu.m_nbrclients;
+  if (!complete)
+  {
+    std::cerr << "All the clients didn't manage to complete their connections. Clients done: " << IPTopology::m_connectionTimes.size() << "< Total clients:" << (size_t)simu.m_nbrclients << std::endl;
   }
+  IPTopology::m_results.Write({{"Complete", complete}, {"ClientsDone", IPTopology::m_connectionTimes.size()}});
+  IPTopology::m_results.Close();
 
   return 0;
 }
@@ -0,0 +1,159 @@
+#!/usr/bin/env python
+## -*- Mode: python; py-indent-offset: 4; indent-tabs-mode: nil; coding: utf-8; -*-
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License version 2 as
+# published by the Free Software Foundation;
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+#
+"""Conversion of the records of the addressless simulations.
+
+A run of scratch/addressless streams its measurements to a Json Lines file
+(--Output, results/json/<SimulationType>_<Protocol>.jsonl by default): a
+header record with the parameters of the run, one record per measurement,
+then a trailer record telling whether all the clients completed their
+connections. Several runs can follow each other in the same file.
+
+This converts the complete runs into the json trees read by the plotting
+scripts, results/json/<SimulationType>_<Protocol>.json: one entry per
+ClientInterval, in ms, holding
+
+    {"Clients": [{"ConnectionDelay": d, "MapDelay": [d, ...]}, ...],
+     "Sites": {"<server>": {"Clients": [{"ConnectionDelay": d}, ...]}}}
+
+with the client ids as indexes. When the converted runs of a file span
+several NbClients or RngRun values, the entries are named
+"<interval>/<clients>c/run<n>" instead. The entries already present in the
+results are kept, unless a run replaces them.
+
+Example, after two runs of LISPRLOC over TCP:
+
+    ./scratch/addressless_results.py results/json/LISPRLOC_TCP.jsonl
+"""
+
+from __future__ import print_function
+
+import argparse
+import json
+import os
+import sys
+
+
+def read_runs(filename):
+    """Yields the runs of a records file, as (header, records, trailer).
+    The trailer is None if the run was interrupted."""
+    header, records = None, []
+    with open(filename) as f:
+        for line in f:
+            if not line.strip():
+                continue
+            record = json.loads(line)
+            if "SimulationType" in record:
+                if header is not None:
+                    yield header, records, None
+                header, records = record, []
+            elif "Complete" in record:
+                yield header, records, record
+                header, records = None, []
+            else:
+                records.append(record)
+    if header is not None:
+        yield header, records, None
+
+
+def client(clients, index):
+    while len(clients) <= index:
+        clients.append(None)
+    if clients[index] is None:
+        clients[index] = {}
+    return clients[index]
+
+
+def to_tree(records):
+    """The json tree of the measurements of a run."""
+    tree = None
+    for record in records:
+        if tree is None:
+            tree = {}
+        if "Site" in record:
+            sites = tree.setdefault("Sites", {})
+            clients = sites.setdefault(record["Site"], {}).setdefault("Clients", [])
+        else:
+            clients = tree.setdefault("Clients", [])
+        entry = client(clients, record["Client"])
+        if "ConnectionDelay" in record:
+            entry["ConnectionDelay"] = record["ConnectionDelay"]
+        if "MapDelay" in record:
+            entry.setdefault("MapDelay", []).append(record["MapDelay"])
+    return tree
+
+
+def interval_key(interval):
+    """The key of a ClientInterval (s): std::to_string of the interval in
+    ms, as in the results written before the records."""
+    return "%f" % (float(interval) * 1000)
+
+
+def convert(filenames, results):
+    """Converts the complete runs of the records files into the trees of the
+    results directory. Returns the number of incomplete runs skipped."""
+    runs = {}
+    skipped = 0
+    for filename in filenames:
+        for header, records, trailer in read_runs(filename):
+            if header is None or trailer is None or not trailer["Complete"]:
+                skipped += 1
+                continue
+            key = (header["SimulationType"], header["Protocol"])
+            runs.setdefault(key, []).append((header, records))
+
+    if not os.path.isdir(results):
+        os.makedirs(results)
+    for (sim, proto), group in sorted(runs.items()):
+        # The entries only get qualified by the dimensions that vary
+        several_clients = len(set(h["NbClients"] for h, r in group)) > 1
+        several_runs = len(set(h["RngRun"] for h, r in group)) > 1
+        filename = os.path.join(results, "%s_%s.json" % (sim, proto))
+        merged = {}
+        if os.path.exists(filename) and os.path.getsize(filename) > 10:
+            with open(filename) as f:
+                merged = json.load(f)
+        for header, records in group:
+            key = interval_key(header["ClientInterval"])
+            if several_clients:
+                key += "/%dc" % header["NbClients"]
+            if several_runs:
+                key += "/run%d" % header["RngRun"]
+            merged[key] = to_tree(records)
+        tmp = filename + ".tmp"
+        with open(tmp, "w") as f:
+            json.dump(merged, f, indent=1, sort_keys=True)
+            f.write("\n")
+        os.rename(tmp, filename)
+        print("converted %d runs into %s" % (len(group), filename))
+    return skipped
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Converts addressless records into the json results.")
+    parser.add_argument("records", nargs="+", help="Json Lines records files")
+    parser.add_argument("--results", default=os.path.join("results", "json"),
+                        help="directory of the json results")
+    args = parser.parse_args()
+    skipped = convert(args.records, args.results)
+    if skipped:
+        print("skipped %d incomplete runs" % skipped)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -20,6 +20,7 @@
 #include "ns3/pointer.h"
 #include "ns3/redirect-application-entrance.h"
 #include "redirect-header.h"
+#include "ns3/address-pool.h"
 
 namespace ns3
 {
@@ -53,6 +54,12 @@ namespace ns3
                                 StringValue("ns3::ConstantRandomVariable[Constant=0.00004]"),
                                 MakePointerAccessor(&RedirectApplicationEntrance::m_hashTime),
                                 MakePointerChecker<RandomVariableStream>())
+                            .AddAttribute("ProcessingQueue",
+                                          "The queue in which the hashes are computed, each taking "
+                                          "HashVariable. A default one is created if not set.",
+                                          PointerValue(),
+                                          MakePointerAccessor(&RedirectApplicationEntrance::m_processingQueue),
+                                          MakePointerChecker<ProcessingQueue>())
                             .AddAttribute("Protocol",
                                           "The type id of the protocol to use for the rx socket.",
                                           TypeIdValue(UdpSocketFactory::GetTypeId()),
@@ -68,8 +75,7 @@ namespace ns3
       : m_listenSocket(0),
         m_connected(false),
         m_residualBits(0),
-        m_totBytes(0),
-        m_clients_waiting(0)
+        m_totBytes(0)
   {
     NS_LOG_FUNCTION(this);
   }
@@ -92,6 +98,11 @@ namespace ns3
     NS_LOG_FUNCTION(this);
 
     m_listenSocket = 0;
+    if (m_processingQueue != 0)
+    {
+      m_processingQueue->Dispose();
+      m_processingQueue = 0;
+    }
     // chain up
     Application::DoDispose();
   }
@@ -100,6 +111,10 @@ namespace ns3
   void RedirectApplicationEntrance::StartApplication() // Called at time specified by Start
   {
     NS_LOG_FUNCTION(this);
+    if (m_processingQueue == 0)
+    {
+      m_processingQueue = CreateObject<ProcessingQueue>();
+    }
 
     // Create the socket if not already
     if (!m_listenSocket)
@@ -152,17 +167,8 @@ namespace ns3
   }
   Ipv4Address RedirectApplicationEntrance::GenerateAddress(Address peer)
   {
-    Hasher hs;
-
-    std::ostringstream ss;
-    InetSocketAddress iaddr = InetSocketAddress(10);
-
-    iaddr = InetSocketAddress::ConvertFrom(peer);
-    iaddr.GetIpv4().Print(ss);
-
-    int index = hs.GetHash32(ss.str()) % (m_serverInterface->GetNAddresses());
-    Ipv4Address addr = m_serverInterface->GetAddress(index).GetLocal();
-    return addr;
+    InetSocketAddress iaddr = InetSocketAddress::ConvertFrom(peer);
+    return AddressPool::GetPool(m_serverInterface)->Select(iaddr.GetIpv4());
   }
   void RedirectApplicationEntrance::SendPacket(Ptr<Socket> coSocket, Address peer)
   {
@@ -181,7 +187,6 @@ namespace ns3
     }
     m_totBytes += m_pktSize;
     m_residualBits = 0;
-    m_clients_waiting = m_clients_waiting - 1;
   }
   /*******************************/
   //==        CALBACKS         ==//
@@ -192,10 +197,11 @@ namespace ns3
     NS_LOG_FUNCTION(this << coSocket);
     Address from;
     Ptr<Packet> packet;
-    m_clients_waiting = m_clients_waiting +1;
     while ((packet = coSocket->RecvFrom(from)))
-    { 
-      Simulator::Schedule(m_clients_waiting*Seconds(m_hashTime->GetValue()), &RedirectApplicationEntrance::SendPacket, this, coSocket, from);
+    {
+      // One hash per packet received
+      m_processingQueue->Submit(MakeEvent(&RedirectApplicationEntrance::SendPacket, this, coSocket, from),
+                                Seconds(m_hashTime->GetValue()));
     }
   }
 
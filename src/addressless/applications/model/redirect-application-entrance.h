@@ -9,6 +9,7 @@
 #include "ns3/traced-callback.h"
 #include "ns3/network-module.h"
 #include "ns3/internet-module.h"
+#include "ns3/processing-queue.h"
 
 namespace ns3
 {
@@ -67,7 +68,7 @@ namespace ns3
     void ConnectionFailed(Ptr<Socket> coSocket);
     Ptr<RandomVariableStream> m_hashTime;
     TypeId m_tid; //!< Protocol TypeId
-    int m_clients_waiting;
+    Ptr<ProcessingQueue> m_processingQueue;
   };
 
 } // namespace ns3
@@ -13,6 +13,7 @@
 #include "redirect-header.h"
 #include "ns3/udp-socket-factory.h"
 #include "redirect-application-server.h"
+#include "ns3/address-pool.h"
 
 namespace ns3
 {
@@ -48,6 +49,12 @@ namespace ns3
                                 StringValue("ns3::ConstantRandomVariable[Constant=0.00004]"),
                                 MakePointerAccessor(&RedirectApplicationServer::m_hashTime),
                                 MakePointerChecker<RandomVariableStream>())
+                            .AddAttribute("ProcessingQueue",
+                                          "The queue in which the hashes are computed, each taking "
+                                          "HashVariable. A default one is created if not set.",
+                                          PointerValue(),
+                                          MakePointerAccessor(&RedirectApplicationServer::m_processingQueue),
+                                          MakePointerChecker<ProcessingQueue>())
                             .AddTraceSource("Rx",
                                             "A packet has been received",
                                             MakeTraceSourceAccessor(&RedirectApplicationServer::m_rxTrace),
@@ -63,7 +70,6 @@ namespace ns3
   {
     NS_LOG_FUNCTION(this);
     m_totalRx = 0;
-    m_clients_waiting = 0;
   }
 
   RedirectApplicationServer::~RedirectApplicationServer()
@@ -96,6 +102,11 @@ namespace ns3
     NS_LOG_FUNCTION(this);
     m_listeningSockets.clear();
     m_socketList.clear();
+    if (m_processingQueue != 0)
+    {
+      m_processingQueue->Dispose();
+      m_processingQueue = 0;
+    }
 
     // chain up
     Application::DoDispose();
@@ -105,14 +116,19 @@ namespace ns3
   void RedirectApplicationServer::StartApplication() // Called at time specified by Start
   {
     NS_LOG_FUNCTION(this);
+    if (m_processingQueue == 0)
+    {
+      m_processingQueue = CreateObject<ProcessingQueue>();
+    }
     Ptr<Socket> socket;
-    NS_LOG_DEBUG("RedirectApplicationServer::Number of Addresses available: " << m_interface->GetNAddresses());
+    Ptr<AddressPool> pool = AddressPool::GetPool(m_interface);
+    NS_LOG_DEBUG("RedirectApplicationServer::Number of Addresses available: " << pool->GetNAddresses());
 
-    for (size_t i = 0; i < m_interface->GetNAddresses(); i++)
+    for (size_t i = 0; i < pool->GetNAddresses(); i++)
     {
       socket = Socket::CreateSocket(GetNode(), m_tid);
-      InetSocketAddress addr = InetSocketAddress(m_interface->GetAddress(i).GetLocal(), 50000);
-      NS_LOG_DEBUG("RedirectApplicationServer::Socket created on address: " << m_interface->GetAddress(i).GetLocal());
+      InetSocketAddress addr = InetSocketAddress(pool->GetAddress(i), 50000);
+      NS_LOG_DEBUG("RedirectApplicationServer::Socket created on address: " << pool->GetAddress(i));
       if (socket->Bind(addr) == -1)
       {
         NS_FATAL_ERROR("Failed to bind socket");
@@ -178,19 +194,14 @@ namespace ns3
 
   bool RedirectApplicationServer::CheckAddress(Ptr<Socket> s, const Address &from)
   {
-    Hasher hs;
-    std::ostringstream ss;
-
     Address addre;
     InetSocketAddress socketAddress = InetSocketAddress(10);
     s->GetSockName(addre);
     socketAddress = InetSocketAddress::ConvertFrom(addre);
 
     InetSocketAddress peerAddress = InetSocketAddress::ConvertFrom(from);
-    peerAddress.GetIpv4().Print(ss);
 
-    int index = hs.GetHash32(ss.str()) % (m_interface->GetNAddresses());
-    bool reject = m_interface->GetAddress(index).GetLocal().Get() == socketAddress.GetIpv4().Get();
+    bool reject = AddressPool::GetPool(m_interface)->Select(peerAddress.GetIpv4()) == socketAddress.GetIpv4();
     if (!reject)
     {
       std::cout << "Server::Check Address didn't match..." << std::endl;
@@ -210,13 +221,20 @@ namespace ns3
     NS_LOG_FUNCTION(this << s << from);
     s->SetRecvCallback(MakeCallback(&RedirectApplicationServer::HandleRead, this));
     m_socketList.push_back(s);
-    m_clients_waiting = m_clients_waiting + 1;
-    Simulator::Schedule(m_check ? m_clients_waiting * Seconds(m_hashTime->GetValue()) : Seconds(0), &RedirectApplicationServer::HandleClientConnectionTimer, this, m_socketList.size());
+    if (m_check)
+    {
+      // The connection is established once its address is checked
+      m_processingQueue->Submit(MakeEvent(&RedirectApplicationServer::HandleClientConnectionTimer, this, (int)m_socketList.size()),
+                                Seconds(m_hashTime->GetValue()));
+    }
+    else
+    {
+      Simulator::ScheduleNow(&RedirectApplicationServer::HandleClientConnectionTimer, this, (int)m_socketList.size());
+    }
   }
 
   void RedirectApplicationServer::HandleClientConnectionTimer(int id){
     m_connectionEstablished(id);
-    m_clients_waiting = m_clients_waiting - 1;
   }
 
 } // Namespace ns3
@@ -9,6 +9,7 @@
 #include "ns3/traced-callback.h"
 #include "ns3/network-module.h"
 #include "ns3/internet-module.h"
+#include "ns3/processing-queue.h"
 
 namespace ns3
 {
@@ -126,7 +127,7 @@ namespace ns3
     TracedCallback<int32_t> m_connectionEstablished;
       Ptr<RandomVariableStream> m_hashTime;
 
-    int m_clients_waiting;
+    Ptr<ProcessingQueue> m_processingQueue;
 
   };
 
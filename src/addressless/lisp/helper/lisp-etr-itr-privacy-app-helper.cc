@@ -55,6 +55,7 @@ namespace ns3
         NS_LOG_DEBUG("xTR address set to simple map table:" << lisp->GetMapTablesV4()->GetxTRApp() << " It should be:" << app);
         lisp->GetMapTablesV6()->SetxTRApp(app);
         app->SetMapServerAddresses(m_mapServerAddresses);
+        app->SetMapServerShards(m_mapServerShards);
         node->AddApplication(app);
         return app;
     }
@@ -63,9 +64,19 @@ namespace ns3
         m_mapServerAddresses.push_front(mapServerAddress);
     }
 
+    void LispEtrItrPrivacyAppHelper::SetMapServerShards(Ptr<MapServerShards> mapServerShards)
+    {
+        m_mapServerShards = mapServerShards;
+    }
+
     void LispEtrItrPrivacyAppHelper::AddMapResolverRlocs(Ptr<Locator> locator)
     {
         m_mapResolverRlocs.push_back(locator);
     }
 
+    void LispEtrItrPrivacyAppHelper::SetMapResolverRlocs(std::list<Ptr<Locator>> locators)
+    {
+        m_mapResolverRlocs = locators;
+    }
+
 }
\ No newline at end of file
@@ -30,6 +30,7 @@ public:
   ApplicationContainer Install (Ptr<Node> node) const;
 
   void AddMapServerAddress (Address mapServerAddress);
+  void SetMapServerShards (Ptr<MapServerShards> mapServerShards);
   void AddMapResolverRlocs (Ptr<Locator> locator);
   void SetMapResolverRlocs (std::list<Ptr<Locator> > locator);
 
@@ -39,6 +40,7 @@ public:
   std::list<Ptr<Locator> > m_mapResolverRlocs;
   Address m_eidServer;
   std::list<Address> m_mapServerAddresses;
+  Ptr<MapServerShards> m_mapServerShards;
   ObjectFactory m_factory; //!<Object factory
 
 };
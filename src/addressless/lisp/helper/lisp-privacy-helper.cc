@@ -98,8 +98,8 @@ namespace ns3
      * which will lead to segmentation fault for packet copy-forwarding.
      * We make sure once lispOverIpv4 is created, mapTables are always accessible.
      */
-    Ptr<MapTables> mapTablesv4 = Create<SimpleMapTables>();
-    Ptr<MapTables> mapTablesv6 = Create<SimpleMapTables>();
+    Ptr<MapTables> mapTablesv4 = CreateMapTables();
+    Ptr<MapTables> mapTablesv6 = CreateMapTables();
     lisp->SetMapTablesIpv4(mapTablesv4);
     lisp->SetMapTablesIpv6(mapTablesv6);
     /**
@@ -54,6 +54,7 @@ Ptr<Application> MapResolverPrivacyDdtHelper::InstallPriv (Ptr<Node> node) const
   NS_ASSERT_MSG(lisp!=0, "a MR must have one LispOverIp object! It is a lisp-speaking device!");
   Ptr<MapResolverPrivacyDdt> app = m_factory.Create<MapResolverPrivacyDdt> ();
   app->SetMapServerAddress (m_mapServerAddress);
+  app->SetMapServerShards (m_mapServerShards);
   node->AddApplication (app);
   return app;
 }
@@ -73,4 +74,9 @@ void MapResolverPrivacyDdtHelper::SetMapServerAddress (Address mapServerAddress)
   m_mapServerAddress = mapServerAddress;
 }
 
+void MapResolverPrivacyDdtHelper::SetMapServerShards (Ptr<MapServerShards> mapServerShards)
+{
+  m_mapServerShards = mapServerShards;
+}
+
 } /* namespace ns3 */
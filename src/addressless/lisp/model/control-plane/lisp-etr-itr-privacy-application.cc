@@ -1,6 +1,7 @@
 
 #include "ns3/lisp-etr-itr-privacy-application.h"
 #include "ns3/redirect-header.h"
+#include "ns3/address-pool.h"
 namespace ns3
 {
 	NS_LOG_COMPONENT_DEFINE("LispEtrItrPrivacyApplication");
@@ -57,6 +58,31 @@ namespace ns3
 									StringValue("ns3::ConstantRandomVariable[Constant=0]"),
 									MakePointerAccessor(&LispEtrItrPrivacyApplication::m_rttVariable),
 									MakePointerChecker<RandomVariableStream>())
+								.AddAttribute("MapRegisterRecords",
+											  "The maximum number of EID records packed in a Map-Register.",
+											  UintegerValue(16),
+											  MakeUintegerAccessor(&LispEtrItrPrivacyApplication::m_mapRegisterRecords),
+											  MakeUintegerChecker<uint8_t>(1))
+								.AddAttribute("MapRegisterInterval",
+											  "The time between two Map-Register refreshes, which send the "
+											  "database entries that changed. 0 registers only when the "
+											  "database is updated.",
+											  TimeValue(Seconds(0)),
+											  MakeTimeAccessor(&LispEtrItrPrivacyApplication::m_mapRegisterInterval),
+											  MakeTimeChecker())
+								.AddAttribute("MapRegisterRefresh",
+											  "The age at which an unchanged database entry is registered "
+											  "again. 0 never registers it again.",
+											  TimeValue(Seconds(0)),
+											  MakeTimeAccessor(&LispEtrItrPrivacyApplication::m_mapRegisterRefresh),
+											  MakeTimeChecker())
+								.AddAttribute("MapRegisterJitter",
+											  "The first registration and each refresh are delayed by a "
+											  "random time up to this value, so that the xTRs do not "
+											  "register all at once.",
+											  TimeValue(Seconds(0)),
+											  MakeTimeAccessor(&LispEtrItrPrivacyApplication::m_mapRegisterJitter),
+											  MakeTimeChecker())
 								.AddAttribute(
 									"ProxyMapReply",
 									"",
@@ -69,6 +95,13 @@ namespace ns3
 									StringValue("ns3::ConstantRandomVariable[Constant=0.00004]"),
 									MakePointerAccessor(&LispEtrItrPrivacyApplication::m_hashTime),
 									MakePointerChecker<RandomVariableStream>())
+								.AddAttribute("ProcessingQueue",
+											  "The queue in which the hashes of the privacy features are "
+											  "computed, each taking HashVariable. A default one is "
+											  "created if not set.",
+											  PointerValue(),
+											  MakePointerAccessor(&LispEtrItrPrivacyApplication::m_processingQueue),
+											  MakePointerChecker<ProcessingQueue>())
 								.AddTraceSource("MapRegisterTx", "A MapRegister is sent by the LISP device",
 												MakeTraceSourceAccessor(&LispEtrItrPrivacyApplication::m_mapRegisterTxTrace),
 												"ns3::Packet::TracedCallback")
@@ -89,24 +122,38 @@ namespace ns3
 
 	LispEtrItrPrivacyApplication::~LispEtrItrPrivacyApplication() {}
 
+	void LispEtrItrPrivacyApplication::DoDispose(void)
+	{
+		NS_LOG_FUNCTION(this);
+		if (m_processingQueue != 0)
+		{
+			m_processingQueue->Dispose();
+			m_processingQueue = 0;
+		}
+		LispEtrItrApplication::DoDispose();
+	}
+
+	Ptr<ProcessingQueue> LispEtrItrPrivacyApplication::GetProcessingQueue(void)
+	{
+		if (m_processingQueue == 0)
+		{
+			m_processingQueue = CreateObject<ProcessingQueue>();
+		}
+		return m_processingQueue;
+	}
+
 	Ipv4Address LispEtrItrPrivacyApplication::GenerateAddress(Ipv4Address source)
 	{
-		Hasher hs;
-		std::ostringstream ss;
-		source.CombineMask(Ipv4Mask("/24")).Print(ss);
-		int index = hs.GetHash32(ss.str()) % (m_rlocInterface->GetNAddresses());
-		NS_LOG_DEBUG("* RLOCREDIR::Address generated: " << m_rlocInterface->GetAddress(index).GetLocal());
-		return m_rlocInterface->GetAddress(index).GetLocal();
+		// Same choice as the data plane check (LispOverIpv4ImplRedir::CheckRloc)
+		Ipv4Address addr = AddressPool::GetPool(m_rlocInterface)->SelectConsistent(source.CombineMask(Ipv4Mask("/24")));
+		NS_LOG_DEBUG("* RLOCREDIR::Address generated: " << addr);
+		return addr;
 	}
 
 	void LispEtrItrPrivacyApplication::FastRedir(Ptr<MapRequestMsg> requestMsg)
 	{
-		Hasher hs;
-		std::ostringstream ss;
 		// ns3-privacy addition
-		Ipv4Address::ConvertFrom(requestMsg->GetSourceEidAddr()).Print(ss);
-		int index = hs.GetHash32(ss.str()) % (m_serverInterface->GetNAddresses());
-		Ipv4Address addr = m_serverInterface->GetAddress(index).GetLocal();
+		Ipv4Address addr = AddressPool::GetPool(m_serverInterface)->Select(Ipv4Address::ConvertFrom(requestMsg->GetSourceEidAddr()));
 		NS_LOG_DEBUG("* FASTREDIR::Address generated: " << addr);
 
 		Address serverAddress = Address(addr);
@@ -145,7 +192,6 @@ namespace ns3
 		route->SetOutputDevice(GetNode()->GetDevice(0));
 		route->SetSource(ipv4->GetInterface(1)->GetAddress(0).GetLocal());
 		ipv4->Send(packet, ipv4->GetInterface(1)->GetAddress(0).GetLocal(), Ipv4Address::ConvertFrom(requestMsg->GetSourceEidAddr()), m_protocol == "ns3::TcpSocketFactory" ? 6 : 17, route);
-		m_clientswaiting -= 1;
 	}
 
 	Ptr<MapReplyMsg>
@@ -202,8 +248,8 @@ namespace ns3
 
 			if (m_fastRedir)
 			{
-				m_clientswaiting += 1;
-				Simulator::Schedule(m_clientswaiting * Seconds(m_hashTime->GetValue()), &LispEtrItrPrivacyApplication::FastRedir, this, requestMsg);
+				GetProcessingQueue()->Submit(MakeEvent(&LispEtrItrPrivacyApplication::FastRedir, this, requestMsg),
+											 Seconds(m_hashTime->GetValue()));
 				replyRecord->SetLocators(entry->GetLocators());
 			}
 			else if (m_rlocRedir)
@@ -214,7 +260,6 @@ namespace ns3
 				uint32_t ip = Ipv4Address::ConvertFrom(requestMsg->GetSourceEidAddr()).Get();
 				if (m_privacyDone.find(ip) == m_privacyDone.end())
 				{
-					m_clientswaiting += 1;
 					m_privacyDone[ip] = true;
 					m_hashDone += 1;
 				}
@@ -256,15 +301,9 @@ namespace ns3
 			 *
 			 */
 
-			if (requestMsg->GetItrRlocAddrIp() != static_cast<Address>(Ipv4Address()))
-				MapResolver::ConnectToPeerAddress(
-					requestMsg->GetItrRlocAddrIp(), m_peerPort, m_socket);
-			else if ((requestMsg->GetItrRlocAddrIpv6() != static_cast<Address>(Ipv6Address())))
-				MapResolver::ConnectToPeerAddress(
-					requestMsg->GetItrRlocAddrIpv6(), m_peerPort, m_socket);
-			else
+			if (requestMsg->GetItrRlocAddrIp() == static_cast<Address>(Ipv4Address()))
 				NS_LOG_ERROR(
-					"NO valid ITR address (neither ipv4 nor ipv6) to send back Map Message!!!");
+					"NO valid ITR address (ipv4) to send back Map Message!!!");
 
 			if (requestMsg->GetS() == 0)
 			{
@@ -276,7 +315,6 @@ namespace ns3
 
 				if (!lisp->IsNated())
 				{
-					uint8_t newBuf[256];
 					Ptr<MapReplyMsg> mapReply = this->GenerateMapReply(requestMsg);
 					/**
 					 * Update, 02-02-2018, Yue
@@ -285,9 +323,17 @@ namespace ns3
 					 */
 					if (mapReply != 0)
 					{
-						mapReply->Serialize(newBuf);
-						reactedPacket = Create<Packet>(newBuf, 256);
-						Simulator::Schedule(m_hashDone * m_clientswaiting * Seconds(m_hashTime->GetValue()), &LispEtrItrPrivacyApplication::SendTo, this, reactedPacket, requestMsg->GetItrRlocAddrIp());
+						reactedPacket = mapReply->ToPacket();
+						// The first Map-Reply to a client waits for its hash
+						if (m_hashDone)
+						{
+							GetProcessingQueue()->Submit(MakeEvent(&LispEtrItrPrivacyApplication::SendTo, this, reactedPacket, requestMsg->GetItrRlocAddrIp()),
+														 Seconds(m_hashTime->GetValue()));
+						}
+						else
+						{
+							Simulator::ScheduleNow(&LispEtrItrPrivacyApplication::SendTo, this, reactedPacket, requestMsg->GetItrRlocAddrIp());
+						}
 				
 						// TODO: we should add check for the return value of Send method.
 						//  Since it is possible that map reply has not been sent due to cache miss...
@@ -360,7 +406,6 @@ namespace ns3
 				m_recvIvkSmr = true;
 				// Given reception of SMR-invoked map request, remove the scheduled event.
 				Simulator::Remove(m_resendSmrEvent);
-				uint8_t newBuf[256];
 
 				// Instead of response the queried EID-prefix, maReply conveys the content of database!
 				// Ptr<MapReplyMsg> mapReply = LispEtrItrApplication::GenerateMapReply4ChangedMapping(requestMsg);
@@ -370,8 +415,7 @@ namespace ns3
 				Ptr<MapReplyMsg> mapReply = this->GenerateMapReply(requestMsg);
 				if (mapReply != 0)
 				{
-					mapReply->Serialize(newBuf);
-					reactedPacket = Create<Packet>(newBuf, 256);
+					reactedPacket = mapReply->ToPacket();
 
 					/* --- Artificial delay for SMR procedure --- */
 					Simulator::Schedule(Seconds((m_rttVariable->GetValue() / 2)), &LispEtrItrPrivacyApplication::SendTo, this, reactedPacket, requestMsg->GetItrRlocAddrIp());
@@ -410,22 +454,11 @@ namespace ns3
 			NS_LOG_DEBUG("Mapping socket message created");
 			NS_ASSERT_MSG(mapSockMsg != 0,
 						  "Cannot create map socket message body !!! Please check why.");
-			uint8_t buf[256];
-			mapSockMsg->Serialize(buf);
-			/**
-			 * In my opinion, it is not necessary to create a packet with 256 bytes as payload.
-			 * In fact, we just need to ensure that length of buffer is more than the length of mapSockMsg.
-			 * Since this is just an exchange between LispOverIp(data plan) and LispEtrItrApplication(control plan)
-			 * Both data plan and control plan are on the same node.
-			 * It is like a socket communication between user and kernel space.
-			 */
-			Ptr<Packet> packet = Create<Packet>(buf, 256);
-			packet->AddHeader(mapSockHeader);
 			// Send to lispOverIp object so that it can insert the mapping entry in Cache.
 			// ATTENTION: with SMR, before inserting one map entry, should first check its presence in Cache.
 			// Now we apply a replacement strategy: if the EID-prefix already in Cache, replace it with the new
 			// One.
-			SendToLisp(packet);
+			SendToLisp(mapSockHeader, mapSockMsg);
 			// Don't forget to remove Eid in pending list...
 			DeleteFromMapReqList(mapSockMsg->GetEndPointId());
 			/**
@@ -467,11 +500,7 @@ namespace ns3
 			// MAPA_EID used to say that LISP device is registered.
 			// MAPA_EIDMASK is used to say that LISP device is NOT registered.
 
-			uint8_t buf[256];
-			mapSockMsg->Serialize(buf);
-			Ptr<Packet> packet = Create<Packet>(buf, 256);
-			packet->AddHeader(mapSockHeader);
-			SendToLisp(packet);
+			SendToLisp(mapSockHeader, mapSockMsg);
 
 			/* The SMR procedure is now implemented on the RemoteItr Cache, instead of on the LISP Cache */
 			if (!m_remoteItrCache.empty())
@@ -495,17 +524,7 @@ namespace ns3
 
 	void LispEtrItrPrivacyApplication::SendTo(Ptr<Packet> packet, Address to)
 	{
-
-		if (m_rlocRedir && m_clientswaiting > 1)
-		{
-			m_clientswaiting -= 1;
-		}
-		MapResolver::ConnectToPeerAddress(to, m_peerPort, m_socket);
-		NS_LOG_FUNCTION(this);
-
-		NS_ASSERT(m_event.IsExpired());
-		m_socket->Send(packet);
-		++m_sent;
+		Send(packet, to, m_peerPort);
 	}
 
 	Ptr<MapRegisterMsg> LispEtrItrPrivacyApplication::GenerateMapRegister(
@@ -556,14 +575,8 @@ namespace ns3
 			return;
 		}
 		m_mapReqSent[prefix] = Simulator::Now();
-		// TODO: whehter here 64 bytes here is good...
-		uint8_t bufMapReq[64];
-		mapReqMsg->Serialize(bufMapReq);
-		Ptr<Packet> packetMapReqMsg;
-		packetMapReqMsg = Create<Packet>(bufMapReq, 64);
-		MapResolver::ConnectToPeerAddress(
-			m_mapResolverRlocs.front()->GetRlocAddress(),
-			LispOverIp::LISP_SIG_PORT, m_socket);
-		Send(packetMapReqMsg);
+		Ptr<Packet> packetMapReqMsg = mapReqMsg->ToPacket();
+		Send(packetMapReqMsg, m_mapResolverRlocs.front()->GetRlocAddress(),
+			 LispOverIp::LISP_SIG_PORT);
 	}
 }
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include "ns3/network-module.h"
 #include "ns3/internet-module.h"
 #include "ns3/uinteger.h"
+#include "ns3/processing-queue.h"
 namespace ns3
 {
     class LispEtrItrPrivacyApplication : public LispEtrItrApplication
@@ -22,7 +23,12 @@ namespace ns3
         Ptr<MapRegisterMsg> GenerateMapRegister(Ptr<MapEntry> mapEntry, bool rtr);
 
     protected:
+        virtual void DoDispose(void);
         void SendMapRequest(Ptr<MapRequestMsg> mapReqMsg);
+        /**
+         * @return The queue of the hash computations, created on first use.
+         */
+        Ptr<ProcessingQueue> GetProcessingQueue(void);
 
         void SendTo(Ptr<Packet> packet, Address to);
         void FastRedir(Ptr<MapRequestMsg> requestMsg);
@@ -37,7 +43,7 @@ namespace ns3
         std::string m_protocol;
         TracedCallback<int, double> m_mapDelay;
         uint16_t m_id;
-        int m_clientswaiting = 0;
+        Ptr<ProcessingQueue> m_processingQueue;
         std::map<uint32_t, bool> m_privacyDone;
         bool m_proxy;
         std::map<uint32_t, Time> m_mapReqSent;
@@ -18,7 +18,6 @@
  * Author: Lionel Agbodjan <lionel.agbodjan@gmail.com>
  */
 #include "map-resolver-privacy-ddt.h"
-#include "algorithm"
 #include "ns3/log.h"
 #include "ns3/nstime.h"
 #include "ns3/socket.h"
@@ -26,8 +25,13 @@
 #include "ns3/socket-factory.h"
 #include "ns3/packet.h"
 #include "ns3/uinteger.h"
+#include "ns3/boolean.h"
 #include "ns3/trace-source-accessor.h"
 #include "ns3/map-request-msg.h"
+#include "ns3/ipv4.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/ipv4-route.h"
+#include "ns3/ipv4-routing-protocol.h"
 
 namespace ns3
 {
@@ -35,16 +39,24 @@ namespace ns3
 
   NS_OBJECT_ENSURE_REGISTERED(MapResolverPrivacyDdt);
 
+  /// Key of the (source EID, EID-Prefix) pairs in m_alreadyAsked.
+  static uint64_t
+  AskedKey(uint32_t source, uint32_t prefix)
+  {
+    return (static_cast<uint64_t>(source) << 32) | prefix;
+  }
+
   MapResolverPrivacyDdt::MapResolverPrivacyDdt()
+      : m_nextNonce(1)
   {
     NS_LOG_DEBUG("MapResolverPrivacyDdt Application created");
+    m_answerCache = Create<MapReferralCache>();
   }
 
   MapResolverPrivacyDdt::~MapResolverPrivacyDdt()
   {
     m_socket = 0;
     m_mrClientSocket = 0;
-    m_requestWaiting = 0;
   }
 
   TypeId MapResolverPrivacyDdt::GetTypeId(void)
@@ -52,7 +64,19 @@ namespace ns3
     static TypeId tid = TypeId("ns3::MapResolverPrivacyDdt")
                             .SetParent<MapResolver>()
                             .SetGroupName("Lisp")
-                            .AddConstructor<MapResolverPrivacyDdt>();
+                            .AddConstructor<MapResolverPrivacyDdt>()
+                            .AddAttribute("AnswerCache",
+                                          "Whether the MR caches the Map-Replies and answers the next Map-Requests itself. "
+                                          "Disable it when the answer of the ETR depends on the requester.",
+                                          BooleanValue(true),
+                                          MakeBooleanAccessor(&MapResolverPrivacyDdt::m_answerCacheEnabled),
+                                          MakeBooleanChecker())
+                            .AddAttribute("ReplyTimeout",
+                                          "The time to wait for the Map-Reply of a forwarded Map-Request before "
+                                          "forwarding the Map-Requests waiting for it to the Map-Server as they are.",
+                                          TimeValue(Seconds(2.0)),
+                                          MakeTimeAccessor(&MapResolverPrivacyDdt::m_replyTimeout),
+                                          MakeTimeChecker());
     return tid;
   }
 
@@ -109,42 +133,175 @@ namespace ns3
       uint8_t buf[packet->GetSize()];
       packet->CopyData(buf, packet->GetSize());
       uint8_t msg_type = buf[0] >> 4;
-      // m_mapServerAddress
-      //
       if (msg_type == static_cast<uint8_t>(MapRequestMsg::GetMsgType()))
       {
-        NS_LOG_DEBUG("------- GET map request on map resolver and Forward it to Map Server!");
+        NS_LOG_DEBUG("------- GET map request on map resolver");
         Ptr<MapRequestMsg> mapReqMsg = MapRequestMsg::Deserialize(buf);
         Ptr<MapRequestRecord> record = mapReqMsg->GetMapRequestRecord();
         uint32_t prefix = Ipv4Address::ConvertFrom(record->GetEidPrefix()).CombineMask("/24").Get();
-        uint32_t source = Ipv4Address::ConvertFrom(mapReqMsg->GetSourceEidAddr()).Get(); 
-        auto it = std::find(m_alreadyAsked[source].begin(), m_alreadyAsked[source].end(), prefix) ;
-        
-        if(it != m_alreadyAsked[source].end())
-          return;
-
-        m_alreadyAsked[source].push_back(prefix);
-        
-        if (m_cachedMapping.find(prefix) == m_cachedMapping.end())
-        {
-          m_cachedMapping[prefix] = false;
-          m_timeMapping[prefix] = Simulator::Now();
-          Simulator::Schedule(Seconds(m_searchTimeVariable->GetValue()), &MapResolverPrivacyDdt::SendMapRequest, this, mapReqMsg);
-        }
-        else if (m_cachedMapping[prefix] == false)
+        uint32_t source = Ipv4Address::ConvertFrom(mapReqMsg->GetSourceEidAddr()).Get();
+        if (!m_alreadyAsked.insert(AskedKey(source, prefix)).second)
         {
-          Time t = Seconds(m_searchTimeVariable->GetValue() - (Simulator::Now() - m_timeMapping[prefix]).GetSeconds()) + Seconds(0.000000001) * m_requestWaiting;
-          Simulator::Schedule(t, &MapResolverPrivacyDdt::SendMapRequest, this, mapReqMsg);
+          continue;
         }
-        else
+        ResolveMapRequest(mapReqMsg);
+      }
+      else if (msg_type == static_cast<uint8_t>(MapReplyMsg::GetMsgType()))
+      {
+        // The answer to a Map-Request forwarded with our ITR-RLOC
+        HandleMapReply(MapReplyMsg::Deserialize(buf));
+      }
+    }
+  }
+
+  void MapResolverPrivacyDdt::ResolveMapRequest(Ptr<MapRequestMsg> mapRequestMsg)
+  {
+    Ptr<MapRequestRecord> record = mapRequestMsg->GetMapRequestRecord();
+    uint32_t prefix = Ipv4Address::ConvertFrom(record->GetEidPrefix()).CombineMask("/24").Get();
+    if (m_answerCacheEnabled)
+    {
+      Ptr<MapReplyRecord> answer = LookupAnswer(record->GetEidPrefix());
+      if (answer != 0)
+      {
+        NS_LOG_DEBUG("Answer Map-Request from the cache");
+        SendMapReply(mapRequestMsg, answer);
+        return;
+      }
+    }
+    else if (m_searchedPrefixes.count(prefix))
+    {
+      SendMapRequest(mapRequestMsg);
+      return;
+    }
+
+    std::list<Ptr<MapRequestMsg> > &waiting = m_waitingRequests[prefix];
+    waiting.push_back(mapRequestMsg);
+    if (waiting.size() == 1)
+    {
+      // Only the first request for an EID-Prefix searches the mapping system
+      Simulator::Schedule(Seconds(m_searchTimeVariable->GetValue()), &MapResolverPrivacyDdt::SearchDone, this, prefix);
+    }
+  }
+
+  void MapResolverPrivacyDdt::SearchDone(uint32_t prefix)
+  {
+    std::list<Ptr<MapRequestMsg> > &waiting = m_waitingRequests[prefix];
+    if (m_answerCacheEnabled)
+    {
+      // The others wait for the answer
+      SendMapRequest(waiting.front());
+      return;
+    }
+    m_searchedPrefixes.insert(prefix);
+    for (std::list<Ptr<MapRequestMsg> >::const_iterator it = waiting.begin(); it != waiting.end(); ++it)
+    {
+      SendMapRequest(*it);
+    }
+    m_waitingRequests.erase(prefix);
+  }
+
+  void MapResolverPrivacyDdt::HandleMapReply(Ptr<MapReplyMsg> mapReplyMsg)
+  {
+    std::map<uint64_t, ForwardedRequest>::iterator forwarded = m_forwardedRequests.find(mapReplyMsg->GetNonce());
+    if (forwarded == m_forwardedRequests.end())
+    {
+      NS_LOG_DEBUG("Map-Reply for no forwarded Map-Request");
+      return;
+    }
+    uint32_t prefix = forwarded->second.prefix;
+    forwarded->second.timeout.Cancel();
+    m_forwardedRequests.erase(forwarded);
+
+    for (uint8_t i = 0; i < mapReplyMsg->GetNRecords(); i++)
+    {
+      m_answerCache->Insert(mapReplyMsg->GetRecord(i));
+    }
+    std::list<Ptr<MapRequestMsg> > waiting;
+    waiting.swap(m_waitingRequests[prefix]);
+    m_waitingRequests.erase(prefix);
+    for (std::list<Ptr<MapRequestMsg> >::const_iterator it = waiting.begin(); it != waiting.end(); ++it)
+    {
+      Ptr<MapReplyRecord> answer = LookupAnswer((*it)->GetMapRequestRecord()->GetEidPrefix());
+      if (answer != 0)
+      {
+        SendMapReply(*it, answer);
+      }
+      else
+      {
+        // Not covered by the answer (or uncachable): ask for it on its own
+        m_waitingRequests[prefix].push_back(*it);
+        if (m_waitingRequests[prefix].size() == 1)
         {
-          Simulator::Schedule(Seconds(0), &MapResolverPrivacyDdt::SendMapRequest, this, mapReqMsg);
+          SendMapRequest(*it);
         }
-        m_requestWaiting += 1;
       }
     }
   }
 
+  void MapResolverPrivacyDdt::ReplyTimeout(uint64_t nonce)
+  {
+    std::map<uint64_t, ForwardedRequest>::iterator forwarded = m_forwardedRequests.find(nonce);
+    uint32_t prefix = forwarded->second.prefix;
+    m_forwardedRequests.erase(forwarded);
+    NS_LOG_WARN("No Map-Reply for forwarded Map-Request " << nonce << ", forward the waiting Map-Requests as they are");
+
+    std::list<Ptr<MapRequestMsg> > waiting;
+    waiting.swap(m_waitingRequests[prefix]);
+    m_waitingRequests.erase(prefix);
+    for (std::list<Ptr<MapRequestMsg> >::const_iterator it = waiting.begin(); it != waiting.end(); ++it)
+    {
+      SendToMapServer(*it);
+    }
+  }
+
+  Ptr<MapReplyRecord> MapResolverPrivacyDdt::LookupAnswer(Address eid)
+  {
+    Ptr<MapRefCacheEntry> entry = m_answerCache->Lookup(eid);
+    if (entry == 0)
+    {
+      return 0;
+    }
+    // The ITR must not keep the mapping longer than we do
+    uint32_t ttl = entry->GetRemainingTtl();
+    if (ttl == 0)
+    {
+      return 0;
+    }
+    Ptr<MapReplyRecord> answer = Create<MapReplyRecord>(*entry->GetRecord());
+    answer->SetRecordTtl(ttl);
+    return answer;
+  }
+
+  void MapResolverPrivacyDdt::SendMapReply(Ptr<MapRequestMsg> mapRequestMsg, Ptr<MapReplyRecord> record)
+  {
+    Ptr<MapReplyMsg> mapReply = Create<MapReplyMsg>();
+    mapReply->SetNonce(mapRequestMsg->GetNonce());
+    mapReply->AddRecord(record);
+    NS_LOG_DEBUG("Send Map-Reply to " << Ipv4Address::ConvertFrom(mapRequestMsg->GetItrRlocAddrIp()));
+    m_socket->SendTo(mapReply->ToPacket(), 0,
+                     InetSocketAddress(Ipv4Address::ConvertFrom(mapRequestMsg->GetItrRlocAddrIp()), m_peerPort));
+  }
+
+  Address MapResolverPrivacyDdt::GetMapServer(Address eid) const
+  {
+    if (m_mapServerShards != 0 && m_mapServerShards->GetNMapServers() > 0)
+    {
+      return m_mapServerShards->GetMapServer(eid);
+    }
+    return m_mapServerAddress;
+  }
+
+  Address MapResolverPrivacyDdt::GetLocalRloc(Address mapServer) const
+  {
+    Ptr<Ipv4> ipv4 = GetNode()->GetObject<Ipv4>();
+    Ipv4Header header;
+    header.SetDestination(Ipv4Address::ConvertFrom(mapServer));
+    Socket::SocketErrno errno_;
+    Ptr<Ipv4Route> route = ipv4->GetRoutingProtocol()->RouteOutput(Create<Packet>(), header, 0, errno_);
+    NS_ASSERT_MSG(route != 0, "No route from the MR to the Map-Server");
+    return route->GetSource();
+  }
+
   void MapResolverPrivacyDdt::StopApplication(void)
   {
     NS_LOG_FUNCTION(this);
@@ -170,23 +327,51 @@ namespace ns3
       m_mrClientSocket6 = 0;
     }
 
+    m_waitingRequests.clear();
+    for (std::map<uint64_t, ForwardedRequest>::iterator it = m_forwardedRequests.begin(); it != m_forwardedRequests.end(); ++it)
+    {
+      it->second.timeout.Cancel();
+    }
+    m_forwardedRequests.clear();
+    m_searchedPrefixes.clear();
     Simulator::Cancel(m_event);
   }
 
   void MapResolverPrivacyDdt::SendMapRequest(Ptr<MapRequestMsg> mapRequestMsg)
   {
+    NS_LOG_FUNCTION(this);
+    if (!m_answerCacheEnabled)
+    {
+      SendToMapServer(mapRequestMsg);
+      return;
+    }
     Ptr<MapRequestRecord> record = mapRequestMsg->GetMapRequestRecord();
+    Address mapServer = GetMapServer(record->GetEidPrefix());
     uint32_t prefix = Ipv4Address::ConvertFrom(record->GetEidPrefix()).CombineMask("/24").Get();
-    m_cachedMapping[prefix] = true;
-
-    NS_LOG_FUNCTION(this);
-    NS_ASSERT(m_event.IsExpired());
 
-    uint8_t buf[64];
+    /*
+     * The Map-Server (or the ETR) answers the ITR-RLOC: forward a copy with
+     * our own RLOC and nonce, so that the Map-Reply comes back to be cached.
+     */
+    uint8_t buf[mapRequestMsg->GetSerializedSize()];
     mapRequestMsg->Serialize(buf);
-    ConnectToPeerAddress(m_mapServerAddress, m_peerPort, m_socket);
-    Ptr<Packet> p = Create<Packet>(buf, 64);
-    m_socket->Send(p);
+    Ptr<MapRequestMsg> forwarded = MapRequestMsg::Deserialize(buf);
+    forwarded->SetItrRlocAddrIp(GetLocalRloc(mapServer));
+    forwarded->SetNonce(m_nextNonce++);
+    ForwardedRequest &pending = m_forwardedRequests[forwarded->GetNonce()];
+    pending.prefix = prefix;
+    // A lost (or never sent) Map-Reply must not hold the waiting requests forever
+    pending.timeout = Simulator::Schedule(m_replyTimeout, &MapResolverPrivacyDdt::ReplyTimeout, this, forwarded->GetNonce());
+
+    m_socket->SendTo(forwarded->ToPacket(), 0,
+                     InetSocketAddress(Ipv4Address::ConvertFrom(mapServer), m_peerPort));
+  }
+
+  void MapResolverPrivacyDdt::SendToMapServer(Ptr<MapRequestMsg> mapRequestMsg)
+  {
+    Address mapServer = GetMapServer(mapRequestMsg->GetMapRequestRecord()->GetEidPrefix());
+    m_socket->SendTo(mapRequestMsg->ToPacket(), 0,
+                     InetSocketAddress(Ipv4Address::ConvertFrom(mapServer), m_peerPort));
   }
 
   void MapResolverPrivacyDdt::HandleRead(Ptr<Socket> socket)
@@ -200,4 +385,9 @@ namespace ns3
     m_mapServerAddress = mapServer;
   }
 
+  void MapResolverPrivacyDdt::SetMapServerShards(Ptr<MapServerShards> mapServerShards)
+  {
+    m_mapServerShards = mapServerShards;
+  }
+
 } /* namespace ns3 */
@@ -8,6 +8,12 @@
 #include "ns3/lisp-over-ip.h"
 #include "ns3/map-referral-msg.h"
 #include "ns3/map-request-msg.h"
+#include "ns3/map-reply-msg.h"
+#include "ns3/map-server-shards.h"
+
+#include <list>
+#include <map>
+#include <unordered_set>
 
 
 namespace ns3
@@ -24,8 +30,19 @@ public:
   GetTypeId (void);
 
   void SetMapServerAddress (Address mapServer);
+  /**
+   * \brief Forward the Map-Requests to the Map-Server of the shard of their
+   * EID rather than to the Map-Server address.
+   */
+  void SetMapServerShards (Ptr<MapServerShards> mapServerShards);
 
 private:
+  /// A Map-Request forwarded to the Map-Server with our RLOC and nonce.
+  struct ForwardedRequest
+  {
+    uint32_t prefix; //!< The /24 EID-Prefix of the Map-Request
+    EventId timeout;
+  };
 
   virtual void StartApplication (void);
 
@@ -37,16 +54,65 @@ private:
 
   virtual void HandleReadFromClient (Ptr<Socket> socket);
 
+  /**
+   * \brief Answer the Map-Request from the answer cache, or queue it until
+   * the Map-Server answers the first request for the same EID-Prefix.
+   */
+  void ResolveMapRequest (Ptr<MapRequestMsg> mapRequestMsg);
+  /**
+   * \brief The mapping system has been searched for an EID-Prefix: forward
+   * the Map-Requests waiting for it.
+   */
+  void SearchDone (uint32_t prefix);
+  /**
+   * \brief Cache the records of a Map-Reply and answer the Map-Requests
+   * waiting for them.
+   */
+  void HandleMapReply (Ptr<MapReplyMsg> mapReplyMsg);
+  /**
+   * \brief No Map-Reply came back for a forwarded Map-Request: forward the
+   * Map-Requests waiting for its EID-Prefix as they are, so that the
+   * Map-Server answers their ITRs directly.
+   */
+  void ReplyTimeout (uint64_t nonce);
+  /**
+   * \brief Send a Map-Request unchanged to the Map-Server of its EID.
+   */
+  void SendToMapServer (Ptr<MapRequestMsg> mapRequestMsg);
+  /**
+   * \return A copy of the cached record for an EID, its TTL set to the time
+   * the cache entry has left; 0 if there is none or less than a minute is left.
+   */
+  Ptr<MapReplyRecord> LookupAnswer (Address eid);
+  void SendMapReply (Ptr<MapRequestMsg> mapRequestMsg, Ptr<MapReplyRecord> record);
+  /**
+   * \return The Map-Server to forward the Map-Requests for an EID to.
+   */
+  Address GetMapServer (Address eid) const;
+  /**
+   * \return The address of this node towards a Map-Server, set as ITR-RLOC
+   * of the forwarded Map-Requests so that the Map-Replies come back here.
+   */
+  Address GetLocalRloc (Address mapServer) const;
+
   // when ddt is used
   Ptr<Locators> rootDdtNodeRlocs;
   //
   Address m_mapServerAddress;
-  Ptr<MapReferralCache> m_mapRefCache;
-  Ptr<PendingRequestList> m_pendingReqList;
-  std::map<uint32_t, bool> m_cachedMapping;
-  std::map<uint32_t, Time> m_timeMapping;
-  std::map<uint32_t, std::vector<uint32_t>> m_alreadyAsked;
-  int m_requestWaiting;
+  Ptr<MapServerShards> m_mapServerShards;
+  /// The Map-Reply records received, by EID-Prefix, until their TTL expires.
+  Ptr<MapReferralCache> m_answerCache;
+  bool m_answerCacheEnabled;
+  /// Without answer cache, the /24 EID-Prefixes whose requests are forwarded at once.
+  std::unordered_set<uint32_t> m_searchedPrefixes;
+  /// The Map-Requests waiting for the answer of the Map-Server, by /24 EID-Prefix.
+  std::map<uint32_t, std::list<Ptr<MapRequestMsg> > > m_waitingRequests;
+  /// The Map-Requests forwarded to the Map-Server, by nonce.
+  std::map<uint64_t, ForwardedRequest> m_forwardedRequests;
+  Time m_replyTimeout;
+  /// The (source EID, /24 EID-Prefix) pairs already asked, see AskedKey ().
+  std::unordered_set<uint64_t> m_alreadyAsked;
+  uint64_t m_nextNonce;
 
 };
 
@@ -96,7 +96,6 @@ namespace ns3
 		{
 			TypeId tid = TypeId::LookupByName("ns3::UdpSocketFactory");
 			m_socket = Socket::CreateSocket(GetNode(), tid);
-			// ConnectToPeerAddress (m_peerAddress, m_peerPort);
 		}
 		m_socket->SetRecvCallback(MakeCallback(&MapServerPrivacyDdt::HandleRead, this));
 		if (m_msClientSocket == 0)
@@ -157,21 +156,25 @@ namespace ns3
 	{
 		// TODO implement map notification message here
 		Ptr<MapNotifyMsg> mapNotify = Create<MapNotifyMsg>();
-		mapNotify->SetRecordCount(msg->GetRecordCount());
 		mapNotify->SetNonce(msg->GetNonce());
 		mapNotify->SetAuthDataLen(msg->GetAuthDataLen());
 		mapNotify->setAuthData(msg->getAuthData());
 		mapNotify->setKeyId(msg->getKeyId());
-		mapNotify->SetRecord(msg->GetRecord());
+		// The records registered are all acknowledged
+		for (uint8_t i = 0; i < msg->GetNRecords(); i++)
+		{
+			mapNotify->AddRecord(msg->GetRecord(i));
+		}
 		return mapNotify;
 	}
 
 	void
-	MapServerPrivacyDdt::Send(Ptr<Packet> p)
+	MapServerPrivacyDdt::Send(Address peerAddress, Ptr<Packet> p)
 	{
 		NS_LOG_FUNCTION(this);
 		NS_ASSERT(m_event.IsExpired());
-		m_socket->Send(p);
+		// The peer travels with the packet: many replies may be scheduled at once
+		MapResolver::SendToPeer(m_socket, p, peerAddress, m_peerPort);
 	}
 
 	void
@@ -187,50 +190,54 @@ namespace ns3
 		// For multihoming case, combine RLOC for the same RLOC
 		// For LISP-MN, replace them
 		NS_LOG_DEBUG("Get a Map Register Message! Try to decode it...");
-		std::stringstream ss;
-		Ptr<MapReplyRecord> record = msg->GetRecord();
-		Ptr<EndpointId> eid;
-		Ptr<Locators> locators = record->GetLocators();
-		if (record->GetEidAfi() == LispControlMsg::IP)
+		// A Map-Register may carry several records
+		for (uint8_t i = 0; i < msg->GetNRecords(); i++)
 		{
-			ss << "/" << unsigned(record->GetEidMaskLength());
-			Ipv4Mask mask = Ipv4Mask(ss.str().c_str());
-			NS_LOG_DEBUG(
-				"Decoded EID prefix length: /" << unsigned(record->GetEidMaskLength()));
-			eid = Create<EndpointId>(record->GetEidPrefix(), mask);
-			Ptr<MapEntryImpl> mapEntry = Create<MapEntryImpl>();
-			mapEntry->SetLocators(locators);
-			mapEntry->SetEidPrefix(eid);
-			mapEntry->SetProxyReply(msg->GetP());
-			/**
-			 * IMPORTANT: For map server, when it receives a map register message, it
-			 * populates the database and cache at the same time. Why we should populate
-			 * cache also? Because in LISP-MN, map-server is risking to forward map request
-			 * to a LISP-MN, whose RLOC is not globally routable. The aforementioned map request
-			 * message need to be encapsulated to be delivered to LISP-MN. In other hand, map
-			 * server need to do cache lookup when calling LispOutput(in LispOverIpv4Impl).
-			 */
-			m_mapTablesv4->SetEntry(record->GetEidPrefix(), mask, mapEntry,
-									MapTables::IN_DATABASE);
-			m_mapTablesv4->SetEntry(record->GetEidPrefix(), mask, mapEntry,
-									MapTables::IN_CACHE);
-			NS_LOG_DEBUG("MS's Map Table Content:" << *m_mapTablesv4);
-		}
-		else if (record->GetEidAfi() == LispControlMsg::IPV6)
-		{
-			ss << "/" << unsigned(record->GetEidMaskLength());
-
-			eid = Create<EndpointId>(record->GetEidPrefix(),
-									 Ipv6Prefix(ss.str().c_str()));
-			Ipv6Prefix prefix = Ipv6Prefix(ss.str().c_str());
-			eid = Create<EndpointId>(record->GetEidPrefix(), prefix);
-			Ptr<MapEntryImpl> mapEntry = Create<MapEntryImpl>();
-			mapEntry->SetLocators(locators);
-			mapEntry->SetEidPrefix(eid);
-			m_mapTablesv6->SetEntry(record->GetEidPrefix(), prefix, mapEntry,
-									MapTables::IN_DATABASE);
-			m_mapTablesv6->SetEntry(record->GetEidPrefix(), prefix, mapEntry,
-									MapTables::IN_CACHE);
+			std::stringstream ss;
+			Ptr<MapReplyRecord> record = msg->GetRecord(i);
+			Ptr<EndpointId> eid;
+			Ptr<Locators> locators = record->GetLocators();
+			if (record->GetEidAfi() == LispControlMsg::IP)
+			{
+				ss << "/" << unsigned(record->GetEidMaskLength());
+				Ipv4Mask mask = Ipv4Mask(ss.str().c_str());
+				NS_LOG_DEBUG(
+					"Decoded EID prefix length: /" << unsigned(record->GetEidMaskLength()));
+				eid = Create<EndpointId>(record->GetEidPrefix(), mask);
+				Ptr<MapEntryImpl> mapEntry = Create<MapEntryImpl>();
+				mapEntry->SetLocators(locators);
+				mapEntry->SetEidPrefix(eid);
+				mapEntry->SetProxyReply(msg->GetP());
+				/**
+				 * IMPORTANT: For map server, when it receives a map register message, it
+				 * populates the database and cache at the same time. Why we should populate
+				 * cache also? Because in LISP-MN, map-server is risking to forward map request
+				 * to a LISP-MN, whose RLOC is not globally routable. The aforementioned map request
+				 * message need to be encapsulated to be delivered to LISP-MN. In other hand, map
+				 * server need to do cache lookup when calling LispOutput(in LispOverIpv4Impl).
+				 */
+				m_mapTablesv4->SetEntry(record->GetEidPrefix(), mask, mapEntry,
+										MapTables::IN_DATABASE);
+				m_mapTablesv4->SetEntry(record->GetEidPrefix(), mask, mapEntry,
+										MapTables::IN_CACHE);
+				NS_LOG_DEBUG("MS's Map Table Content:" << *m_mapTablesv4);
+			}
+			else if (record->GetEidAfi() == LispControlMsg::IPV6)
+			{
+				ss << "/" << unsigned(record->GetEidMaskLength());
+
+				eid = Create<EndpointId>(record->GetEidPrefix(),
+										 Ipv6Prefix(ss.str().c_str()));
+				Ipv6Prefix prefix = Ipv6Prefix(ss.str().c_str());
+				eid = Create<EndpointId>(record->GetEidPrefix(), prefix);
+				Ptr<MapEntryImpl> mapEntry = Create<MapEntryImpl>();
+				mapEntry->SetLocators(locators);
+				mapEntry->SetEidPrefix(eid);
+				m_mapTablesv6->SetEntry(record->GetEidPrefix(), prefix, mapEntry,
+										MapTables::IN_DATABASE);
+				m_mapTablesv6->SetEntry(record->GetEidPrefix(), prefix, mapEntry,
+										MapTables::IN_CACHE);
+			}
 		}
 	}
 
@@ -278,18 +285,8 @@ namespace ns3
 						entry->GetLocators()->SelectFirsValidRloc();
 					NS_LOG_DEBUG(
 						"Send Map Notify message to ETR " << Ipv4Address::ConvertFrom(locator->GetRlocAddress()));
-					MapResolver::ConnectToPeerAddress(locator->GetRlocAddress(),
-													  m_peerPort, m_socket);
-					Ptr<Packet> reqPacket = Create<Packet>(buf,
-														   packet->GetSize());
-
-					MapResolver::ConnectToPeerAddress(locator->GetRlocAddress(),
-													  m_peerPort, m_socket);
-					uint8_t buf[256];
-					mapNotifyMsg->Serialize(buf);
-					Ptr<Packet> packet = Create<Packet>(buf, 256);
-					// Don't forget to make socket connect to the xTR which send map register message.
-					Send(packet);
+					Ptr<Packet> packet = mapNotifyMsg->ToPacket();
+					Send(locator->GetRlocAddress(), packet);
 					NS_LOG_DEBUG(
 						"Map Register message M bit is 1=> A Map notify message has been sent back");
 				}
@@ -311,14 +308,9 @@ namespace ns3
 				if (entry == 0)
 				{
 					NS_LOG_DEBUG("Send Negative Map-Reply");
-					MapResolver::ConnectToPeerAddress(
-						requestMsg->GetItrRlocAddrIp(), m_peerPort, m_socket);
-
-					Ptr<MapReplyMsg> mapReply = GenerateNegMapReply(requestMsg);
-					uint8_t newBuf[256];
-					mapReply->Serialize(newBuf);
-					Ptr<Packet> reactedPacket = Create<Packet>(newBuf, 256);
-					Simulator::Schedule(Seconds(m_searchTimeVariable->GetValue()), &MapServerPrivacyDdt::Send, this, reactedPacket);
+
+					Ptr<Packet> reactedPacket = GenerateNegMapReply(requestMsg)->ToPacket();
+					Simulator::Schedule(Seconds(m_searchTimeVariable->GetValue()), &MapServerPrivacyDdt::Send, this, requestMsg->GetItrRlocAddrIp(), reactedPacket);
 				}
 				else
 				{
@@ -351,16 +343,12 @@ namespace ns3
 
 						replyRecord->SetLocators(entry->GetLocators());
 						mapReply->SetRecord(replyRecord);
-						uint8_t newBuf[256];
-						Ptr<Packet> reactedPacket;
-
-						mapReply->Serialize(newBuf);
-						reactedPacket = Create<Packet>(newBuf, 256);
-						Simulator::Schedule(Seconds(m_searchTimeVariable->GetValue()), &MapServerPrivacyDdt::ForwardRequest, this, requestMsg->GetItrRlocAddrIp(), reactedPacket);
+						Ptr<Packet> reactedPacket = mapReply->ToPacket();
+						Simulator::Schedule(Seconds(m_searchTimeVariable->GetValue()), &MapServerPrivacyDdt::Send, this, requestMsg->GetItrRlocAddrIp(), reactedPacket);
 					}
 					else
 					{
-						Simulator::Schedule(Seconds(m_searchTimeVariable->GetValue()), &MapServerPrivacyDdt::ForwardRequest, this, locator->GetRlocAddress(), reqPacket);
+						Simulator::Schedule(Seconds(m_searchTimeVariable->GetValue()), &MapServerPrivacyDdt::Send, this, locator->GetRlocAddress(), reqPacket);
 					}
 				}
 			}
@@ -396,10 +384,7 @@ namespace ns3
 				Ptr<InfoRequestMsg> msg = InfoRequestMsg::Deserialize(buf);
 				Ptr<InfoRequestMsg> infoReply = GenerateInfoReplyMsg(msg, iaddr.GetPort(), iaddr.GetIpv4(), maddr);
 
-				uint8_t BUF_SIZE = 16 + infoReply->GetAuthDataLen() + 20 + infoReply->GetNatLcaf()->GetLength();
-				uint8_t *newBuf = new uint8_t[BUF_SIZE];
-				infoReply->Serialize(newBuf);
-				Ptr<Packet> reactedPacket = Create<Packet>(newBuf, BUF_SIZE);
+				Ptr<Packet> reactedPacket = infoReply->ToPacket();
 				socket->SendTo(reactedPacket, 0, from);
 			}
 			else
@@ -410,15 +395,6 @@ namespace ns3
 		}
 	}
 
-	void
-	MapServerPrivacyDdt::ForwardRequest(Address peerAddress, Ptr<Packet> p)
-	{
-
-		MapResolver::ConnectToPeerAddress(peerAddress,
-										  m_peerPort, m_socket);
-		Send(p);
-	}
-
 	Ptr<MapReplyMsg>
 	MapServerPrivacyDdt::GenerateNegMapReply(Ptr<MapRequestMsg> requestMsg)
 	{
@@ -42,13 +42,12 @@ private:
 
   virtual void StopApplication (void);
 
-  void ForwardRequest(Address peerAddress, Ptr<Packet> p);
-
   virtual Ptr<MapNotifyMsg> GenerateMapNotifyMsg (Ptr<MapRegisterMsg> msg);
 
   Ipv4Address SelectDstRlocAddress(Ptr<LispControlMsg> msg);
 
-  virtual void Send (Ptr<Packet> p);
+  // Send a control message to a peer (xTR) on m_socket
+  void Send (Address peerAddress, Ptr<Packet> p);
 
   // Read responses on m_socket
   virtual void HandleRead (Ptr<Socket> socket);
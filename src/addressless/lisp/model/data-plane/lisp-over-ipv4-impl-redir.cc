@@ -16,6 +16,7 @@
 #include "ns3/lisp-over-ip.h"
 #include "ns3/lisp-mapping-socket.h"
 #include "ns3/boolean.h"
+#include "ns3/address-pool.h"
 
 namespace ns3
 {
@@ -73,6 +74,12 @@ namespace ns3
                                 StringValue("ns3::ConstantRandomVariable[Constant=0.00004]"),
                                 MakePointerAccessor(&LispOverIpv4ImplRedir::m_hashTime),
                                 MakePointerChecker<RandomVariableStream>())
+                            .AddAttribute("ProcessingQueue",
+                                          "The queue in which the address checks are done, each "
+                                          "taking HashVariable. A default one is created if not set.",
+                                          PointerValue(),
+                                          MakePointerAccessor(&LispOverIpv4ImplRedir::m_processingQueue),
+                                          MakePointerChecker<ProcessingQueue>())
                             // TODO: use this to have united data plen
                             .AddConstructor<LispOverIpv4ImplRedir>();
     return tid;
@@ -89,15 +96,29 @@ namespace ns3
     NS_LOG_FUNCTION(this);
   }
 
-  bool LispOverIpv4ImplRedir::CheckEid(Ipv4Address source, Ipv4Address destination)
+  void LispOverIpv4ImplRedir::DoDispose(void)
   {
-    Hasher hs;
-    std::ostringstream ss;
+    NS_LOG_FUNCTION(this);
+    if (m_processingQueue != 0)
+    {
+      m_processingQueue->Dispose();
+      m_processingQueue = 0;
+    }
+    LispOverIpv4Impl::DoDispose();
+  }
 
-    source.Print(ss);
+  Ptr<ProcessingQueue> LispOverIpv4ImplRedir::GetProcessingQueue(void)
+  {
+    if (m_processingQueue == 0)
+    {
+      m_processingQueue = CreateObject<ProcessingQueue>();
+    }
+    return m_processingQueue;
+  }
 
-    int index = hs.GetHash32(ss.str()) % (m_srvInterface->GetNAddresses());
-    bool reject = m_srvInterface->GetAddress(index).GetLocal().Get() == destination.Get();
+  bool LispOverIpv4ImplRedir::CheckEid(Ipv4Address source, Ipv4Address destination)
+  {
+    bool reject = AddressPool::GetPool(m_srvInterface)->Select(source) == destination;
     if (!reject)
     {
       std::cout << "xtrs::Check Eid didn't match..." << std::endl;
@@ -110,7 +131,7 @@ namespace ns3
     if (rloc.Get() == Ipv4Address("10.1.1.1").Get())
       return true;
 
-    Ipv4Address addr = GenerateAddress(source.CombineMask(Ipv4Mask("/24")), m_rlocInterface);
+    Ipv4Address addr = AddressPool::GetPool(m_rlocInterface)->SelectConsistent(source.CombineMask(Ipv4Mask("/24")));
     if (addr.Get() != rloc.Get())
     {
       std::cout << "* RLOCREDIR: Dest Address received: " << rloc << std::endl;
@@ -123,26 +144,12 @@ namespace ns3
 
   Ipv4Address LispOverIpv4ImplRedir::GenerateAddress(Address peer, Ptr<Ipv4Interface> iface)
   {
-    Hasher hs;
-    std::ostringstream ss;
-    Ipv4Address::ConvertFrom(peer).Print(ss);
-
-    int index = hs.GetHash32(ss.str()) % (iface->GetNAddresses());
-    Ipv4Address addr = iface->GetAddress(index).GetLocal();
-    return addr;
+    return AddressPool::GetPool(iface)->Select(Ipv4Address::ConvertFrom(peer));
   }
 
   int LispOverIpv4ImplRedir::FindAddress(Ipv4Address addr)
   {
-    for (size_t i = 0; i < m_srvInterface->GetNAddresses(); i++)
-    {
-
-      if (addr.Get() == m_srvInterface->GetAddress(i).GetLocal().Get())
-      {
-        return i;
-      }
-    }
-    return -1;
+    return AddressPool::GetPool(m_srvInterface)->Find(addr);
   }
 
   void LispOverIpv4ImplRedir::LispOutput(Ptr<Packet> packet, Ipv4Header const &innerHeader,
@@ -210,7 +217,7 @@ namespace ns3
     }
     else
     {
-      destLocator = SelectDestinationRloc(remoteMapping);
+      destLocator = SelectDestinationRloc(remoteMapping, GetFlowHash(packet, innerHeader));
       NS_LOG_DEBUG("Destination RLOC address: " << Ipv4Address::ConvertFrom(destLocator->GetRlocAddress()));
     }
 
@@ -346,7 +353,8 @@ namespace ns3
       else
       {
         // compute src port based on inner header(Follow algo get_lisp_srcport)
-        udpSrcPort = LispOverIp::GetLispSrcPort(packet);
+        // A NATed xTR keeps the port of the NAT state set up by its Map-Register
+        udpSrcPort = IsNated() ? LispOverIp::LISP_DATA_PORT : LispOverIp::GetLispSrcPort(packet);
         udpDstPort = LispOverIp::LISP_DATA_PORT;
       }
 
@@ -380,7 +388,7 @@ namespace ns3
       outerHeader.SetSource(Ipv4Address::ConvertFrom(srcLocator->GetRlocAddress()));
       if (m_rlocRedir)
       {
-        outerHeader.SetSource(GenerateAddress(innerHeader.GetDestination(), m_rlocInterface));
+        outerHeader.SetSource(AddressPool::GetPool(m_rlocInterface)->SelectConsistent(innerHeader.GetDestination()));
       }
       outerHeader.SetDestination(Ipv4Address::ConvertFrom(destLocator->GetRlocAddress()));
       outerHeader.SetProtocol(UdpL4Protocol::PROT_NUMBER); // set udp protocol
@@ -456,9 +464,12 @@ namespace ns3
 
     NS_LOG_LOGIC("Lisp header removed: " << lispHeader);
 
-    packet->EnableChecking();
-    PacketMetadata::Item item;
-    PacketMetadata::ItemIterator metadataIterator = packet->BeginItem();
+    // The inner header follows the LISP header: its version gives its
+    // address family, which does not need the packet metadata (disabled in
+    // the headless runs).
+    uint8_t version = 0;
+    packet->CopyData(&version, 1);
+    version >>= 4;
     /*
      * We know that the first header is an ip header
      * check the mappings for the src and dest EIDs
@@ -468,166 +479,169 @@ namespace ns3
      * of maq request. Lionel's implementation has not considered that the inner header
      * is a lisp data plan message?
      */
-    while (metadataIterator.HasNext())
+    if (version == 4)
     {
-      item = metadataIterator.Next();
-      if (!(item.tid.GetName().compare(Ipv4Header::GetTypeId().GetName())))
-      {
-        NS_LOG_DEBUG("Before checking metadata");
+      NS_LOG_DEBUG("Before checking metadata");
 
-        if (GetPetr() || IsRtr()) // PETR or RTR case -> No need to check (decapsulate everything)
-          isMappingForPacket = true;
-        else
-        {
-          NS_LOG_DEBUG("Classic xTR");
-          isMappingForPacket = LispOverIp::m_mapTablesIpv4->IsMapForReceivedPacket(
-              packet,
-              lispHeader,
-              static_cast<Address>(outerHeader.GetSource()),
-              static_cast<Address>(outerHeader.GetDestination()));
-        }
+      if (GetPetr() || IsRtr()) // PETR or RTR case -> No need to check (decapsulate everything)
+        isMappingForPacket = true;
+      else
+      {
+        NS_LOG_DEBUG("Classic xTR");
+        isMappingForPacket = LispOverIp::m_mapTablesIpv4->IsMapForReceivedPacket(
+            packet,
+            lispHeader,
+            static_cast<Address>(outerHeader.GetSource()),
+            static_cast<Address>(outerHeader.GetDestination()));
+      }
 
-        NS_LOG_DEBUG("Check passed");
-        bool isControlPlanMsg = false;
-        // if inner UDP of innerIpv4header is at port 4342. we should
-        // use ipv4->Receive() to send this packet to itself.
-        // that's why whether isMappingForPacket is true, we also retrieve @ip and port
-        Ptr<Node> node = GetNode();
-        packet->RemoveHeader(innerIpv4Header);
+      NS_LOG_DEBUG("Check passed");
+      bool isControlPlanMsg = false;
+      // if inner UDP of innerIpv4header is at port 4342. we should
+      // use ipv4->Receive() to send this packet to itself.
+      // that's why whether isMappingForPacket is true, we also retrieve @ip and port
+      Ptr<Node> node = GetNode();
+      packet->RemoveHeader(innerIpv4Header);
 
-        if (innerIpv4Header.GetProtocol() == UdpL4Protocol::PROT_NUMBER)
+      if (innerIpv4Header.GetProtocol() == UdpL4Protocol::PROT_NUMBER)
+      {
+        NS_LOG_DEBUG("Next Header of Inner IP is still UDP, let's see the port");
+        packet->RemoveHeader(udpHeader);
+        if (udpHeader.GetDestinationPort() == LispOverIp::LISP_SIG_PORT)
         {
-          NS_LOG_DEBUG("Next Header of Inner IP is still UDP, let's see the port");
-          packet->RemoveHeader(udpHeader);
-          if (udpHeader.GetDestinationPort() == LispOverIp::LISP_SIG_PORT)
-          {
-            NS_LOG_DEBUG("UDP on port:" << unsigned(udpHeader.GetDestinationPort()) << "->LISP Control Plan Message!");
-            isControlPlanMsg = true;
-          }
-          // Add UDP&IP header to the packet
-          packet->AddHeader(udpHeader);
+          NS_LOG_DEBUG("UDP on port:" << unsigned(udpHeader.GetDestinationPort()) << "->LISP Control Plan Message!");
+          isControlPlanMsg = true;
         }
-        innerIpv4Header.SetTtl(outerHeader.GetTtl());
-        Address from = static_cast<Address>(innerIpv4Header.GetSource());
-        Address to = static_cast<Address>(innerIpv4Header.GetDestination());
-        innerIpv4Header.EnableChecksum();
+        // Add UDP&IP header to the packet
+        packet->AddHeader(udpHeader);
+      }
+      innerIpv4Header.SetTtl(outerHeader.GetTtl());
+      Address from = static_cast<Address>(innerIpv4Header.GetSource());
+      Address to = static_cast<Address>(innerIpv4Header.GetDestination());
+      innerIpv4Header.EnableChecksum();
 
-        packet->AddHeader(innerIpv4Header);
+      packet->AddHeader(innerIpv4Header);
 
-        // Either find mapping for inner ip header or find the inner message is control message
-        // use ip receive procedure to forward packet
-        if (isControlPlanMsg)
-        {
-          Ptr<Ipv4L3Protocol> ipv4 = (node->GetObject<Ipv4L3Protocol>());
-          // put it back in ip Receive ()
-          // Attention: it's the method LispOverIpv4::RecordReceiveParams that
-          // retrieve m_currentDevice values!!! This method is called in
-          // Ipv4L3Protocol::Received() method!
-
-          ipv4->Receive(m_currentDevice, packet, m_ipProtocol, from, to, m_currentPacketType);
-          NS_LOG_DEBUG("Re-inject the packet in receive to forward it to: " << innerIpv4Header.GetDestination());
-        }
-        else if (isMappingForPacket)
-        {
-          int checks_done = 0;
+      // Either find mapping for inner ip header or find the inner message is control message
+      // use ip receive procedure to forward packet
+      if (isControlPlanMsg)
+      {
+        Ptr<Ipv4L3Protocol> ipv4 = (node->GetObject<Ipv4L3Protocol>());
+        // put it back in ip Receive ()
+        // Attention: it's the method LispOverIpv4::RecordReceiveParams that
+        // retrieve m_currentDevice values!!! This method is called in
+        // Ipv4L3Protocol::Received() method!
+
+        ipv4->Receive(m_currentDevice, packet, m_ipProtocol, from, to, m_currentPacketType);
+        NS_LOG_DEBUG("Re-inject the packet in receive to forward it to: " << innerIpv4Header.GetDestination());
+      }
+      else if (isMappingForPacket)
+      {
+        int checks_done = 0;
 
-          // ns3 privacy addition
-          if (m_eidCheck)
+        // ns3 privacy addition
+        if (m_eidCheck)
+        {
+          // We eidcheck only the addresses that are destined to one of the address of the server.
+          // Thus no check if destined to the xtr.
+          if (!(innerIpv4Header.GetDestination().Get() == GetNode()->GetObject<Ipv4>()->GetObject<Ipv4L3Protocol>()->GetInterface(2)->GetAddress(0).GetLocal().Get()))
           {
-            // We eidcheck only the addresses that are destined to one of the address of the server.
-            // Thus no check if destined to the xtr.
-            if (!(innerIpv4Header.GetDestination().Get() == GetNode()->GetObject<Ipv4>()->GetObject<Ipv4L3Protocol>()->GetInterface(2)->GetAddress(0).GetLocal().Get()))
-            {
-              int index = FindAddress(innerIpv4Header.GetDestination());
+            int index = FindAddress(innerIpv4Header.GetDestination());
 
-              // Thus no check if not destined to server.
-              if (index != -1)
+            // Thus no check if not destined to server.
+            if (index != -1)
+            {
+              if (!CheckEid(innerIpv4Header.GetSource(), innerIpv4Header.GetDestination()))
               {
-                if (!CheckEid(innerIpv4Header.GetSource(), innerIpv4Header.GetDestination()))
-                {
-                  std::cout << "XTR::Failed eid address check in the xtr." << std::endl;
-                  return;
-                }
-                // checks_done += 1;
+                std::cout << "XTR::Failed eid address check in the xtr." << std::endl;
+                return;
               }
+              // checks_done += 1;
             }
           }
-          else if (m_passive)
+        }
+        else if (m_passive)
+        {
+          if (Ipv4Address::ConvertFrom(to) == m_srvAddr)
           {
-            if (Ipv4Address::ConvertFrom(to) == m_srvAddr)
-            {
-              uint32_t ip = Ipv4Address::ConvertFrom(from).Get();
-              to = static_cast<Address>(GenerateAddress(from, m_srvInterface));
-              packet->RemoveHeader(innerIpv4Header);
-              innerIpv4Header.SetDestination(Ipv4Address::ConvertFrom(to));
-              packet->AddHeader(innerIpv4Header);
+            uint32_t ip = Ipv4Address::ConvertFrom(from).Get();
+            to = static_cast<Address>(GenerateAddress(from, m_srvInterface));
+            packet->RemoveHeader(innerIpv4Header);
+            innerIpv4Header.SetDestination(Ipv4Address::ConvertFrom(to));
+            packet->AddHeader(innerIpv4Header);
 
-              if(m_privacyDone.find(ip) == m_privacyDone.end()){
-                m_privacyDone[ip] = true;
-                checks_done += 1;
+            if(m_privacyDone.find(ip) == m_privacyDone.end()){
+              m_privacyDone[ip] = true;
+              checks_done += 1;
 
-              }
-            }
-            else if (FindAddress(Ipv4Address::ConvertFrom(to)) != -1)
-            {
-              // if a packet uses one of the server prefix address as destination address directly
-              // drop;
-              return;
             }
           }
-          else if (m_natting)
+          else if (FindAddress(Ipv4Address::ConvertFrom(to)) != -1)
           {
-            std::cout << m_srvAddr << std::endl;
+            // if a packet uses one of the server prefix address as destination address directly
+            // drop;
+            return;
           }
-          if (m_rlocCheck)
+        }
+        else if (m_natting)
+        {
+          std::cout << m_srvAddr << std::endl;
+        }
+        if (m_rlocCheck)
+        {
+          if (!CheckRloc(outerHeader.GetDestination(), innerIpv4Header.GetSource()))
           {
-            if (!CheckRloc(outerHeader.GetDestination(), innerIpv4Header.GetSource()))
-            {
-              std::cout << "XTR::Failed rloc address check in the xtr." << std::endl;
-              return;
-            }
-            // checks_done += 1;
+            std::cout << "XTR::Failed rloc address check in the xtr." << std::endl;
+            return;
           }
+          // checks_done += 1;
+        }
 
-          m_clientswaiting +=1;
-
-          Simulator::Schedule((Seconds(m_hashTime->GetValue() * checks_done)*m_clientswaiting), &LispOverIpv4ImplRedir::DelayedReceive, this, m_currentDevice, packet, m_ipProtocol, from, to, m_currentPacketType);
-
-          //*****
-          NS_LOG_DEBUG("Re-inject the packet in receive to forward it to: " << innerIpv4Header.GetDestination());
+        // Only the packets that needed a hash wait for the queue
+        if (checks_done > 0)
+        {
+          GetProcessingQueue()->Submit(MakeEvent(&LispOverIpv4ImplRedir::DelayedReceive, this, m_currentDevice, packet, m_ipProtocol, from, to, m_currentPacketType),
+                                       Seconds(m_hashTime->GetValue() * checks_done));
         }
         else
         {
-          this->m_mapTablesIpv4->Print(std::cout);
-          // TODO drop and log
-          NS_LOG_ERROR("Mapping check failed during local deliver! Attention if this is cause by double encapsulation!");
+          Simulator::ScheduleNow(&LispOverIpv4ImplRedir::DelayedReceive, this, m_currentDevice, packet, m_ipProtocol, from, to, m_currentPacketType);
         }
-        return;
+
+        //*****
+        NS_LOG_DEBUG("Re-inject the packet in receive to forward it to: " << innerIpv4Header.GetDestination());
       }
-      // if inner header is ipv6
-      else if (!(item.tid.GetName().compare(Ipv6Header::GetTypeId().GetName())))
+      else
       {
-        m_statisticsForIpv6->IncInputDifAfPackets();
-        isMappingForPacket = LispOverIp::m_mapTablesIpv6->IsMapForReceivedPacket(packet, lispHeader, static_cast<Address>(outerHeader.GetSource()), static_cast<Address>(outerHeader.GetDestination()));
-        if (isMappingForPacket)
-        {
-          // remove inner ipheader
-          // TODO do the same for Ipv6
-        }
-        else
-        {
-          // TODO drop and log
-        }
-        return;
+        this->m_mapTablesIpv4->Print(std::cout);
+        // TODO drop and log
+        NS_LOG_ERROR("Mapping check failed during local deliver! Attention if this is cause by double encapsulation!");
+      }
+      return;
+    }
+    // if inner header is ipv6
+    else if (version == 6)
+    {
+      m_statisticsForIpv6->IncInputDifAfPackets();
+      isMappingForPacket = LispOverIp::m_mapTablesIpv6->IsMapForReceivedPacket(packet, lispHeader, static_cast<Address>(outerHeader.GetSource()), static_cast<Address>(outerHeader.GetDestination()));
+      if (isMappingForPacket)
+      {
+        // remove inner ipheader
+        // TODO do the same for Ipv6
       }
       else
       {
-        // should not happen -- report error
-        NS_LOG_ERROR("[LISP_INPUT] Drop! Unrecognized inner AF");
-
-        m_statisticsForIpv4->IncBadSizePackets();
-        return;
+        // TODO drop and log
       }
+      return;
+    }
+    else
+    {
+      // should not happen -- report error
+      NS_LOG_ERROR("[LISP_INPUT] Drop! Unrecognized inner AF");
+
+      m_statisticsForIpv4->IncBadSizePackets();
+      return;
     }
   }
 
@@ -635,6 +649,5 @@ namespace ns3
   {
     Ptr<Ipv4L3Protocol> ipv4 = (GetNode()->GetObject<Ipv4L3Protocol>());
     ipv4->Receive(device, p, protocol, from, to, packetType);
-    m_clientswaiting -=1;
   }
 } /* namespace ns3 */
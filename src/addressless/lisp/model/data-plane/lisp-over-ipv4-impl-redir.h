@@ -9,6 +9,7 @@
 #include "ns3/map-tables.h"
 #include "ns3/ipv4-interface.h"
 #include "ns3/map-notify-msg.h"
+#include "ns3/processing-queue.h"
 
 namespace ns3
 {
@@ -31,8 +32,15 @@ namespace ns3
                     Ptr<Ipv4Route> lispRoute,
                     LispOverIp::EcmEncapsulation ecm);
 
+  protected:
+    virtual void DoDispose(void);
+
   private:
     int FindAddress(Ipv4Address addr);
+    /**
+     * @return The queue of the address checks, created on first use.
+     */
+    Ptr<ProcessingQueue> GetProcessingQueue(void);
 
     /**
      * @brief Perform a check of the destination rloc.
@@ -68,7 +76,7 @@ namespace ns3
     Ipv4Address m_srvAddr;              // service public address.
     Ptr<Ipv4Interface> m_srvInterface;  // server interface.
     Ptr<Ipv4Interface> m_rlocInterface; // server interface.
-    int m_clientswaiting = 0;
+    Ptr<ProcessingQueue> m_processingQueue;
 
     bool m_eidCheck;  // should destination eid of the server be checked?
     bool m_rlocCheck; // should destination rloc be checked?
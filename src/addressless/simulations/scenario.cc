@@ -0,0 +1,116 @@
+#include "simulation.hpp"
+#include <fstream>
+#include <set>
+
+namespace ns3
+{
+    NS_LOG_COMPONENT_DEFINE("Scenario");
+
+    // Aborts on a key the scenario does not know, a typo would otherwise be silently ignored.
+    static void CheckKeys(const json &object, std::set<std::string> keys, std::string what)
+    {
+        if (!object.is_object())
+            NS_FATAL_ERROR("Scenario: " << what << " must be an object");
+        for (json::const_iterator it = object.begin(); it != object.end(); ++it)
+        {
+            if (keys.find(it.key()) == keys.end())
+                NS_FATAL_ERROR("Scenario: unknown key \"" << it.key() << "\" in " << what);
+        }
+    }
+
+    void Simulation::LoadScenario(std::string filename)
+    {
+        std::ifstream file(filename);
+        if (!file)
+            NS_FATAL_ERROR("Scenario: cannot open " << filename);
+
+        try
+        {
+            json scenario;
+            file >> scenario;
+            CheckKeys(scenario, {"simulation", "protocol", "mapServers", "mapResolvers", "aggregateAddresses", "links", "sites", "clients"}, filename);
+
+            m_scenarioSimulation = scenario.value("simulation", "");
+            m_scenarioProtocol = scenario.value("protocol", "");
+            m_nbrMapServers = scenario.value("mapServers", m_nbrMapServers);
+            m_nbrMapResolvers = scenario.value("mapResolvers", m_nbrMapResolvers);
+            NS_ABORT_MSG_IF(m_nbrMapServers < 1 || m_nbrMapResolvers < 1, "Scenario: at least one Map-Server and one map resolver are needed");
+            if (scenario.value("aggregateAddresses", false))
+                m_topology->m_addressPlan.SetAggregated(true);
+            // Without aggregation, every link is a /24
+            int maxAddresses = m_topology->m_addressPlan.IsAggregated() ? 65535 : 255;
+
+            // A link of a list, or the fallback for its missing parameters
+            auto link = [](const json &links, std::string type, Link fallback) {
+                if (links.find(type) == links.end())
+                    return fallback;
+                const json &l = links[type];
+                CheckKeys(l, {"rate", "delay"}, type + " link");
+                return Link{l.value("rate", fallback.rate), l.value("delay", fallback.delay)};
+            };
+            const json &links = scenario.value("links", json::object());
+            CheckKeys(links, {"access", "edge", "core", "site"}, "links");
+            m_coreLink = link(links, "core", Link());
+            Link siteLink = link(links, "site", Link());
+            Link accessLink = link(links, "access", Link());
+            Link edgeLink = link(links, "edge", Link());
+
+            std::map<std::string, size_t> sites;
+            for (const json &s : scenario.value("sites", json::array()))
+            {
+                CheckKeys(s, {"name", "rlocs", "eids", "links"}, "site");
+                Site site;
+                site.name = s.value("name", "site" + std::to_string(m_sites.size()));
+                site.rlocs = s.value("rlocs", -1);
+                site.eids = s.value("eids", -1);
+                NS_ABORT_MSG_IF(site.rlocs == 0 || site.rlocs > maxAddresses || site.eids == 0 || site.eids > maxAddresses,
+                                "Scenario: site " << site.name << " needs 1 to " << maxAddresses << " rlocs and eids");
+                const json &l = s.value("links", json::object());
+                CheckKeys(l, {"core", "site"}, "links of site " + site.name);
+                site.core = link(l, "core", m_coreLink);
+                site.site = link(l, "site", siteLink);
+                NS_ABORT_MSG_IF(sites.count(site.name), "Scenario: two sites are named " << site.name);
+                sites[site.name] = m_sites.size();
+                m_sites.push_back(site);
+            }
+
+            std::set<std::string> groups;
+            for (const json &c : scenario.value("clients", json::array()))
+            {
+                CheckKeys(c, {"name", "count", "site", "xtrPerClient", "start", "interval", "links"}, "clients");
+                ClientGroup group;
+                group.name = c.value("name", "clients" + std::to_string(m_clientGroups.size()));
+                group.count = c.value("count", 1);
+                NS_ABORT_MSG_IF(group.count < 1, "Scenario: the group " << group.name << " has no client");
+                NS_ABORT_MSG_IF(!groups.insert(group.name).second, "Scenario: two client groups are named " << group.name);
+                group.site = 0;
+                if (c.find("site") != c.end())
+                {
+                    std::map<std::string, size_t>::iterator site = sites.find(c["site"].get<std::string>());
+                    if (site == sites.end())
+                        NS_FATAL_ERROR("Scenario: the group " << group.name << " connects to an unknown site");
+                    group.site = site->second;
+                }
+                group.xtrPerClient = c.value("xtrPerClient", true);
+                group.start = c.value("start", 0.0);
+                group.interval = c.value("interval", m_timeBtwClients);
+                const json &l = c.value("links", json::object());
+                CheckKeys(l, {"access", "edge"}, "links of group " + group.name);
+                group.access = link(l, "access", accessLink);
+                group.edge = link(l, "edge", edgeLink);
+                m_clientGroups.push_back(group);
+            }
+
+            // The global links also apply to the topology of the command line parameters
+            if (m_sites.empty())
+                m_sites.push_back(Site{"", -1, -1, m_coreLink, siteLink});
+            if (m_clientGroups.empty())
+                m_clientGroups.push_back(ClientGroup{"", m_nbrclients, 0, m_xtrperclient, 0, m_timeBtwClients, accessLink, edgeLink});
+        }
+        catch (json::exception &e)
+        {
+            NS_FATAL_ERROR("Scenario: invalid " << filename << ": " << e.what());
+        }
+        NS_LOG_INFO("Scenario " << filename << ": " << m_sites.size() << " sites, " << m_clientGroups.size() << " client groups");
+    }
+}
@@ -8,6 +8,7 @@ namespace ns3
     }
     void Simulation::Setup()
     {
+        ExpandScenario();
         BuildBaseTopology();
         // Lisp context
         if (m_eidPriv || m_rlocPriv)
@@ -18,14 +19,70 @@ namespace ns3
         }
 
         Ipv4GlobalRoutingHelper::PopulateRoutingTables();
-        m_topology->SetupAnim();
+        if (!m_headless)
+        {
+            m_topology->SetupAnim();
+        }
+        SetupTracing();
         InstallApplications();
     }
+    void Simulation::SetupTracing()
+    {
+        for (int i = 0; i < m_nbrclients; i++)
+        {
+            if (m_tracedClients.count(i) == 0 && (m_traceOneIn <= 0 || i % m_traceOneIn != 0))
+            {
+                continue;
+            }
+            m_topology->EnablePcap("Client" + std::to_string(i));
+            if (m_clientGroups[m_clientGroupOf[i]].xtrPerClient)
+            {
+                m_topology->EnablePcap(m_clientXtrs[i]);
+            }
+        }
+    }
+    void Simulation::ExpandScenario()
+    {
+        if (m_sites.empty())
+        {
+            m_sites.push_back(Site{"", -1, -1, m_coreLink, Link()});
+        }
+        if (m_clientGroups.empty())
+        {
+            m_clientGroups.push_back(ClientGroup{"", m_nbrclients, 0, m_xtrperclient, 0, m_timeBtwClients, Link(), Link()});
+        }
+        for (Site &site : m_sites)
+        {
+            site.rlocs = site.rlocs < 0 ? m_xTRsAddr : site.rlocs;
+            site.eids = site.eids < 0 ? m_srvAddr : site.eids;
+        }
+
+        m_nbrclients = 0;
+        for (size_t g = 0; g < m_clientGroups.size(); g++)
+        {
+            ClientGroup &group = m_clientGroups[g];
+            // The redirections depend on the client, the map-cache of a shared xTR would mix them
+            NS_ABORT_MSG_IF(!group.xtrPerClient && (m_rlocRedir || m_fastRedir),
+                            "The clients of " << group.name << " share an xTR, which the RLOC and fast redirections do not support");
+            for (int i = 0; i < group.count; i++)
+            {
+                std::string str = std::to_string(m_nbrclients);
+                if (group.xtrPerClient)
+                    m_clientXtrs.push_back("xTRc" + str);
+                else
+                    m_clientXtrs.push_back(group.name.empty() ? "xTRc" : "xTRc-" + group.name);
+                m_clientGroupOf.push_back(g);
+                m_clientStarts.push_back(group.start + group.interval * i);
+                m_nbrclients++;
+            }
+        }
+    }
     void Simulation::BuildBaseTopology()
     {
         m_topology->m_clients = m_nbrclients;
         m_totaly = (m_nbrclients)*5;
         m_middle = m_totaly / 2;
+        // The nodes of the first site come first, the results identify the xTRs by node id
         m_topology->AddRouter("xTRs", m_totaly + 5, m_middle);
         m_topology->AddHost("Server", m_totaly + 10, m_middle);
         m_topology->AddRouter("router", m_totaly, m_middle);
@@ -37,79 +94,148 @@ namespace ns3
 
         ConnectClients();
 
-        m_topology->Connect("xTRs", "Server", 1, m_srvAddr);
-        m_topology->Connect("router", "xTRs", 1, m_xTRsAddr);
-
-        if (m_entrance == "Entrance")
+        for (size_t s = 0; s < m_sites.size(); s++)
         {
-            m_topology->AddHost(m_entrance, m_totaly + 10, m_middle - 10);
-            m_topology->Connect("xTRs", m_entrance);
+            double y = m_middle - 30 * s;
+            if (s > 0)
+            {
+                m_topology->AddRouter(SiteNode("xTRs", s), m_totaly + 5, y);
+                m_topology->AddHost(SiteNode("Server", s), m_totaly + 10, y);
+            }
+            // The server and the entrance form the site of the xTR, in the order of their links
+            std::vector<uint32_t> linkSizes(1, AddressPlan::GetLinkSize(1 + m_sites[s].eids));
+            if (m_entrance == "Entrance")
+            {
+                linkSizes.push_back(AddressPlan::GetLinkSize(2));
+            }
+            m_topology->m_addressPlan.AddSite(SiteNode("xTRs", s), AddressPlan::GetBlockSize(linkSizes));
+            m_topology->SetLink(m_sites[s].site.rate, m_sites[s].site.delay);
+            m_topology->SetLinkSite(SiteNode("xTRs", s));
+            m_topology->Connect(SiteNode("xTRs", s), SiteNode("Server", s), 1, m_sites[s].eids);
+            m_topology->SetLink(m_sites[s].core.rate, m_sites[s].core.delay);
+            m_topology->SetLinkSite("");
+            m_topology->Connect("router", SiteNode("xTRs", s), 1, m_sites[s].rlocs);
+
+            if (m_entrance == "Entrance")
+            {
+                m_topology->AddHost(SiteNode(m_entrance, s), m_totaly + 10, y - 10);
+                m_topology->SetLink(m_sites[s].site.rate, m_sites[s].site.delay);
+                m_topology->SetLinkSite(SiteNode("xTRs", s));
+                m_topology->Connect(SiteNode("xTRs", s), SiteNode(m_entrance, s));
+                m_topology->SetLinkSite("");
+            }
         }
+        m_topology->SetLink("", "");
     }
     void Simulation::ConnectClients()
     {
-        if (m_xtrperclient)
+        // The xTRs of the clients, in order, with their group
+        std::vector<std::pair<std::string, size_t>> xtrs;
+        for (int i = 0; i < m_nbrclients; i++)
         {
-            for (int i = 0; i < m_nbrclients; i++)
-            {
-                std::string str = std::to_string(i);
-                m_topology->AddRouter("xTRc" + str, m_totaly / 2, m_middle + (m_totaly / 2) - (i * 5));
-                m_topology->Connect("Client" + str, "xTRc" + str, 1, 1);
-            }
-            for (int i = 0; i < m_nbrclients; i++)
+            if (xtrs.empty() || xtrs.back().first != m_clientXtrs[i])
             {
-                std::string str = std::to_string(i);
-                m_topology->Connect("router", "xTRc" + str, 1, 1);
+                xtrs.push_back(std::make_pair(m_clientXtrs[i], m_clientGroupOf[i]));
+                m_topology->AddRouter(m_clientXtrs[i], m_totaly / 2, m_middle + (m_totaly / 2) - (i * 5));
             }
         }
-        else
+        // The clients of an xTR form its site, in the order of their links
+        std::map<std::string, std::vector<uint32_t>> linkSizes;
+        for (int i = 0; i < m_nbrclients; i++)
         {
-            m_topology->AddRouter("xTRc", m_totaly / 2, m_middle);
-            for (int i = 0; i < m_nbrclients; i++)
-            {
-                m_topology->Connect("Client" + std::to_string(i), "xTRc", 1, m_bidirectionnel ? m_srvAddr : 1);
-            }
-            m_topology->Connect("router", "xTRc", 1, 1);
+            ClientGroup &group = m_clientGroups[m_clientGroupOf[i]];
+            linkSizes[m_clientXtrs[i]].push_back(AddressPlan::GetLinkSize(1 + (!group.xtrPerClient && m_bidirectionnel ? m_srvAddr : 1)));
+        }
+        for (size_t i = 0; i < xtrs.size(); i++)
+        {
+            m_topology->m_addressPlan.AddSite(xtrs[i].first, AddressPlan::GetBlockSize(linkSizes[xtrs[i].first]));
         }
+        for (int i = 0; i < m_nbrclients; i++)
+        {
+            ClientGroup &group = m_clientGroups[m_clientGroupOf[i]];
+            m_topology->SetLink(group.access.rate, group.access.delay);
+            m_topology->SetLinkSite(m_clientXtrs[i]);
+            m_topology->Connect("Client" + std::to_string(i), m_clientXtrs[i], 1, !group.xtrPerClient && m_bidirectionnel ? m_srvAddr : 1);
+        }
+        m_topology->SetLinkSite("");
+        for (size_t i = 0; i < xtrs.size(); i++)
+        {
+            ClientGroup &group = m_clientGroups[xtrs[i].second];
+            m_topology->SetLink(group.edge.rate, group.edge.delay);
+            m_topology->Connect("router", xtrs[i].first, 1, 1);
+        }
+        m_topology->SetLink("", "");
     }
     void Simulation::BuildLispTopology()
     {
-        m_topology->AddHost("map_resolver", m_totaly, m_middle + 10);
-        m_topology->AddHost("map_server", m_totaly, m_middle - 10);
-        m_topology->Connect("router", "map_resolver");
-        m_topology->Connect("router", "map_server", 1, 1);
+        m_topology->SetLink(m_coreLink.rate, m_coreLink.delay);
+        for (int i = 0; i < m_nbrMapResolvers; i++)
+        {
+            m_topology->AddHost(MapResolverName(i), m_totaly + 5 * i, m_middle + 10);
+            m_topology->Connect("router", MapResolverName(i));
+        }
+        for (int i = 0; i < m_nbrMapServers; i++)
+        {
+            m_topology->AddHost(MapServerName(i), m_totaly + 5 * i, m_middle - 10);
+            m_topology->Connect("router", MapServerName(i), 1, 1);
+        }
+        m_topology->SetLink("", "");
 
         for (int i = 0; i < m_nbrclients; i++)
         {
-            m_topology->AddRlocs("xTRc" + std::to_string(i), "router");
+            if (i == 0 || m_clientXtrs[i] != m_clientXtrs[i - 1])
+                m_topology->AddRlocs(m_clientXtrs[i], "router");
         }
 
-        m_topology->AddRlocs("xTRs", "router");
-        m_topology->AddRlocs("map_resolver", "router");
-        m_topology->AddRlocs("map_server", "router");
+        for (size_t s = 0; s < m_sites.size(); s++)
+        {
+            m_topology->AddRlocs(SiteNode("xTRs", s), "router");
+        }
+        for (int i = 0; i < m_nbrMapResolvers; i++)
+        {
+            m_topology->AddRlocs(MapResolverName(i), "router");
+        }
+        for (int i = 0; i < m_nbrMapServers; i++)
+        {
+            m_topology->AddRlocs(MapServerName(i), "router");
+        }
     }
     void Simulation::SetLispPlane()
     {
-        m_topology->SetMapServer("map_server");
-        m_topology->SetMapResolver("map_resolver");
+        for (int i = 0; i < m_nbrMapServers; i++)
+        {
+            m_topology->SetMapServer(MapServerName(i));
+        }
+        // With redirection, the ETR answers each client differently
+        m_topology->SetMapResolverAnswerCache(!m_fastRedir && !m_rlocRedir);
+        for (int i = 0; i < m_nbrMapResolvers; i++)
+        {
+            m_topology->SetMapResolver(MapResolverName(i));
+        }
 
         SetClientXtr();
-        SetServerXtr();
+        for (size_t s = 0; s < m_sites.size(); s++)
+        {
+            SetServerXtr(s);
+        }
     }
     void Simulation::SetClientXtr()
     {
         for (int i = 0; i < m_nbrclients; i++)
         {
-            m_topology->SetXtr("xTRc" + std::to_string(i));
+            if (i == 0 || m_clientXtrs[i] != m_clientXtrs[i - 1])
+                m_topology->SetXtr(m_clientXtrs[i]);
         }
     }
-    void Simulation::SetServerXtr()
+    void Simulation::SetServerXtr(size_t site)
     {
-        m_topology->m_lispPrivacyXtrHelper.SetServer(m_topology->GetNode("Server")->GetInterface("xTRs"));
-        m_topology->m_lispPrivacyXtrHelper.SetInterface(m_topology->GetNode("xTRs")->GetInterface("router"));
-        m_topology->m_lispHelper.SetServiceAddr(m_topology->GetNode("Server")->GetAddress("xTRs"));
-        m_topology->m_lispHelper.SetServiceInterface(m_topology->GetNode("Server")->GetInterface("xTRs"));
-        m_topology->m_lispHelper.SetRlocInterface(m_topology->GetNode("xTRs")->GetInterface("router"));
+        std::string xtr = SiteNode("xTRs", site);
+        std::string server = SiteNode("Server", site);
+        m_topology->m_lispPrivacyXtrHelper.SetServer(m_topology->GetNode(server)->GetInterface(xtr));
+        m_topology->m_lispPrivacyXtrHelper.SetInterface(m_topology->GetNode(xtr)->GetInterface("router"));
+        m_topology->m_lispHelper.SetServiceAddr(m_topology->GetNode(server)->GetAddress(xtr));
+        m_topology->m_lispHelper.SetServiceInterface(m_topology->GetNode(server)->GetInterface(xtr));
+        m_topology->m_lispHelper.SetRlocInterface(m_topology->GetNode(xtr)->GetInterface("router"));
         m_topology->m_lispPrivacyXtrHelper.SetRlocRedir(m_rlocRedir);
         m_topology->m_lispPrivacyXtrHelper.SetFastRedir(m_fastRedir);
 
@@ -119,23 +245,41 @@ namespace ns3
         m_topology->m_lispHelper.SetEidCheck(m_xtrEidCheck);
         m_topology->m_lispPrivacyXtrHelper.SetAttribute("Protocol", StringValue(m_topology->m_protocol));
 
-        m_topology->SetXtr("xTRs");
+        m_topology->SetXtr(xtr);
     }
     void Simulation::InstallApplications()
     {
         if (m_natting)
             m_topology->InstallNating(m_natted.first, m_natted.second);
 
-        m_topology->InstallServerModule("Server", m_srvCheck);
+        for (size_t s = 0; s < m_sites.size(); s++)
+        {
+            m_topology->InstallServerModule(SiteNode("Server", s), m_srvCheck, SiteNode("xTRs", s));
 
-        if (m_entrance != "")
-            m_topology->InstallEntranceModule(m_entrance, "Server");
+            if (m_entrance != "")
+                m_topology->InstallEntranceModule(SiteNode(m_entrance, s), SiteNode("Server", s), SiteNode("xTRs", s));
+        }
 
         for (int i = 0; i < m_nbrclients; i++)
         {
-            m_topology->InstallTcpSender("Client" + std::to_string(i), m_topology->GetNode("Client" + std::to_string(i))->GetAddress("xTRc" + std::to_string(i)),m_topology->GetNode(m_destination.first)->GetAddress(m_destination.second), m_timeBtwClients*(i));
+            std::string client = "Client" + std::to_string(i);
+            size_t site = m_clientGroups[m_clientGroupOf[i]].site;
+            Ipv4Address destination = m_topology->GetNode(SiteNode(m_destination.first, site))->GetAddress(SiteNode(m_destination.second, site));
+            m_topology->InstallTcpSender(client, m_topology->GetNode(client)->GetAddress(m_clientXtrs[i]), destination, m_clientStarts[i]);
         }
     }
+    std::string Simulation::MapServerName(int i)
+    {
+        return i == 0 ? "map_server" : "map_server" + std::to_string(i);
+    }
+    std::string Simulation::MapResolverName(int i)
+    {
+        return i == 0 ? "map_resolver" : "map_resolver" + std::to_string(i);
+    }
+    std::string Simulation::SiteNode(std::string role, size_t site)
+    {
+        return (site == 0 || role == "router") ? role : role + std::to_string(site);
+    }
     bool Simulation::SetBool(bool input)
     {
         NS_ASSERT_MSG(!input, "You cannot choose multiple Eid/rloc privacy at the same time.");
@@ -2,6 +2,7 @@
 #define ADDRESSLESS_SIMULATION_H
 #include "ns3/topology.hpp"
 #include "ns3/simulator.h"
+#include <set>
 namespace ns3
 {
     class Simulation : public Object
@@ -57,6 +58,44 @@ namespace ns3
          */
         void IPBase();
         void IPNat();
+        /**
+         * @brief Describe the topology with a scenario file instead of the star of the
+         * command line parameters.
+         *
+         * The scenario is a json object; every key is optional:
+         *
+         *   {
+         *     "simulation": "LISPRLOC",            // default variant, as --SimulationType
+         *     "protocol": "TCP",                   // default protocol, as --Protocol
+         *     "mapServers": 4,                     // Map-Servers sharing the EID space
+         *     "mapResolvers": 2,                   // the xTRs are spread among them
+         *     "aggregateAddresses": true,          // see AddressPlan, as --AggregateAddresses
+         *     "links": { "core": {"rate": "10Gbps", "delay": "2ms"} },
+         *     "sites": [
+         *       { "name": "eu", "rlocs": 10, "eids": 10,
+         *         "links": { "core": {...}, "site": {...} } }
+         *     ],
+         *     "clients": [
+         *       { "name": "home", "count": 500, "site": "eu", "xtrPerClient": true,
+         *         "start": 0.0, "interval": 0.002,
+         *         "links": { "access": {...}, "edge": {...} } }
+         *     ]
+         *   }
+         *
+         * The links are, from the clients: "access" (client - xTRc), "edge" (xTRc - router),
+         * "core" (router - site xTR, Map-Servers and map resolvers) and "site" (site xTR - server
+         * and entrance). A link without rate or delay keeps the default (1000Mbps, 5ms), the
+         * links of a site or of a client group override the global ones.
+         * The first site keeps the names of the command line topology (xTRs, Server, Entrance),
+         * the others append their index to them (xTRs1, Server1, ...). "rlocs" and "eids" default to the addresses chosen
+         * by the variant, at most 255 without "aggregateAddresses". The clients of a group connect to its site, by default the first one,
+         * one every "interval" seconds from "start".
+         * Each client has its own xTRc unless "xtrPerClient" is false: the group then shares
+         * the xTRc-<group name> router, which the RLOC and fast redirections do not support.
+         *
+         * \param filename The path of the scenario.
+         */
+        void LoadScenario(std::string filename);
         /**
          * @brief Establish the appropriate simulation environnement.
          *
@@ -86,7 +125,7 @@ namespace ns3
          *                                 /
          *        host <---> xTRc <----> router <-----> xTRs <----> Main service Module (+ Entrance module)
          *                                /
-         *                               MS
+         *                               MS (x m_nbrMapServers, sharing the EID space)
          * \returns Nothing.
          */
         void BuildLispTopology();
@@ -107,8 +146,60 @@ namespace ns3
          * \returns The boolean.
          */
         bool SetBool(bool input);
+        /**
+         * \returns The name of the i-th Map-Server of the pool.
+         */
+        std::string MapServerName(int i);
+        std::string MapResolverName(int i);
+        /**
+         * \returns The name of a node of a site: role for the first site, role followed by its index for the others.
+         * "router" is shared by all the sites.
+         */
+        std::string SiteNode(std::string role, size_t site);
         void SetClientXtr();
-        void SetServerXtr();
+        void SetServerXtr(size_t site);
+
+        struct Link
+        {
+            std::string rate;  // Empty: default
+            std::string delay; // Empty: default
+        };
+        struct Site
+        {
+            std::string name;
+            int rlocs; // Addresses of the xTR to the router, -1: m_xTRsAddr
+            int eids;  // Addresses of the server, -1: m_srvAddr
+            Link core;
+            Link site;
+        };
+        struct ClientGroup
+        {
+            std::string name;
+            int count;
+            size_t site;
+            bool xtrPerClient;
+            double start;
+            double interval;
+            Link access;
+            Link edge;
+        };
+        /**
+         * @brief Lists the clients of the groups, after the variant is chosen. Without scenario,
+         * a site and a group of clients follow the command line parameters.
+         */
+        void ExpandScenario();
+        /**
+         * @brief Captures the packets of the sampled clients (see m_tracedClients and m_traceOneIn),
+         * and of their xTRs when they don't share them, to results/<node>-*.pcap.
+         */
+        void SetupTracing();
+
+        std::vector<Site> m_sites;
+        std::vector<ClientGroup> m_clientGroups;
+        Link m_coreLink;                       // Link of the Map-Servers and map resolvers
+        std::vector<std::string> m_clientXtrs; // The xTR of each client
+        std::vector<size_t> m_clientGroupOf;   // The group of each client
+        std::vector<double> m_clientStarts;    // The start time of each client
 
         std::string m_entrance = "Entrance"; // Name of the node handling the entrance module work.
 
@@ -143,7 +234,14 @@ namespace ns3
         // SIMULATION PARAMETERS
         Ptr<LISPTopology> m_topology;
         int m_nbrclients = 1;
+        int m_nbrMapServers = 1;
+        int m_nbrMapResolvers = 1;
         double m_timeBtwClients = 0;
+        std::string m_scenarioSimulation; // Variant of the scenario, if any
+        std::string m_scenarioProtocol;   // Protocol of the scenario, if any
+        bool m_headless = false;          // No animation: the caller doesn't enable the packet metadata either
+        std::set<int> m_tracedClients;    // Ids of the clients whose packets are captured
+        int m_traceOneIn = 0;             // Also capture one client out of m_traceOneIn (0: none)
     };
     NS_OBJECT_ENSURE_REGISTERED(Simulation);
 }
@@ -0,0 +1,226 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/address-plan.h"
+
+#include "ns3/test.h"
+
+using namespace ns3;
+
+static uint32_t
+GetSize (AddressPlan::Subnet subnet)
+{
+  return ~subnet.mask.Get () + 1;
+}
+
+// ================================================================================================
+
+class AddressPlanLinkTestCase : public TestCase
+{
+public:
+  AddressPlanLinkTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+AddressPlanLinkTestCase::AddressPlanLinkTestCase ()
+  : TestCase ("Without aggregation, every link gets the next 256 addresses")
+{
+}
+
+void
+AddressPlanLinkTestCase::DoRun (void)
+{
+  AddressPlan plan;
+  plan.AddSite ("xTR", 1000);
+  NS_TEST_ASSERT_MSG_EQ (plan.HasSite ("xTR"), false, "no site block");
+
+  AddressPlan::Subnet subnet = plan.AllocateLink (2);
+  NS_TEST_ASSERT_MSG_EQ (subnet.network, Ipv4Address ("10.1.1.0"), "first link");
+  NS_TEST_ASSERT_MSG_EQ (subnet.mask, Ipv4Mask ("/24"), "a /24 whatever its size");
+  subnet = plan.AllocateLink (100, "xTR");
+  NS_TEST_ASSERT_MSG_EQ (subnet.network, Ipv4Address ("10.1.2.0"), "the next /24, whatever its site");
+  NS_TEST_ASSERT_MSG_EQ (subnet.mask, Ipv4Mask ("/24"), "a /24 whatever its size");
+}
+
+// ================================================================================================
+
+class AddressPlanCoreTestCase : public TestCase
+{
+public:
+  AddressPlanCoreTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+AddressPlanCoreTestCase::AddressPlanCoreTestCase ()
+  : TestCase ("The core links take the smallest aligned subnet, two addresses for a point-to-point link")
+{
+}
+
+void
+AddressPlanCoreTestCase::DoRun (void)
+{
+  NS_TEST_ASSERT_MSG_EQ (AddressPlan::GetLinkSize (2), 2u, "a /31");
+  NS_TEST_ASSERT_MSG_EQ (AddressPlan::GetLinkSize (3), 8u, "with the network and broadcast addresses");
+  NS_TEST_ASSERT_MSG_EQ (AddressPlan::GetLinkSize (6), 8u, "a full /29");
+
+  AddressPlan plan;
+  plan.SetAggregated (true);
+  AddressPlan::Subnet subnet = plan.AllocateLink (2);
+  NS_TEST_ASSERT_MSG_EQ (subnet.network, Ipv4Address ("10.0.0.0"), "first core link");
+  NS_TEST_ASSERT_MSG_EQ (subnet.mask, Ipv4Mask ("/31"), "point-to-point core link");
+  subnet = plan.AllocateLink (2);
+  NS_TEST_ASSERT_MSG_EQ (subnet.network, Ipv4Address ("10.0.0.2"), "the next /31");
+  subnet = plan.AllocateLink (3);
+  NS_TEST_ASSERT_MSG_EQ (subnet.network, Ipv4Address ("10.0.0.8"), "aligned on its size");
+  NS_TEST_ASSERT_MSG_EQ (subnet.mask, Ipv4Mask ("/29"), "three hosts");
+  subnet = plan.AllocateLink (2);
+  NS_TEST_ASSERT_MSG_EQ (subnet.network, Ipv4Address ("10.0.0.16"), "after the previous link");
+  NS_TEST_ASSERT_MSG_EQ (plan.GetNSites (), 0u, "the core links belong to no site");
+}
+
+// ================================================================================================
+
+class AddressPlanSiteTestCase : public TestCase
+{
+public:
+  AddressPlanSiteTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+AddressPlanSiteTestCase::AddressPlanSiteTestCase ()
+  : TestCase ("The block of a site holds its links of mixed sizes with their alignment")
+{
+}
+
+void
+AddressPlanSiteTestCase::DoRun (void)
+{
+  std::vector<uint32_t> linkSizes;
+  linkSizes.push_back (2);
+  linkSizes.push_back (8);
+  linkSizes.push_back (4);
+  NS_TEST_ASSERT_MSG_EQ (AddressPlan::GetBlockSize (linkSizes), 20u, "2 at 0, 8 at 8, 4 at 16");
+  std::vector<uint32_t> decreasing (linkSizes);
+  std::sort (decreasing.rbegin (), decreasing.rend ());
+  NS_TEST_ASSERT_MSG_EQ (AddressPlan::GetBlockSize (decreasing), 14u, "no alignment lost in decreasing order");
+
+  // Larger than a /24: the sum of the link sizes, 386, fits in a /23, but
+  // not the links once aligned
+  linkSizes.clear ();
+  linkSizes.push_back (AddressPlan::GetLinkSize (2));
+  linkSizes.push_back (AddressPlan::GetLinkSize (254));
+  linkSizes.push_back (AddressPlan::GetLinkSize (126));
+  NS_TEST_ASSERT_MSG_EQ (AddressPlan::GetBlockSize (linkSizes), 640u, "2 at 0, 256 at 256, 128 at 512");
+
+  AddressPlan plan;
+  plan.SetAggregated (true);
+  plan.AddSite ("xTR", AddressPlan::GetBlockSize (linkSizes));
+  AddressPlan::Subnet block = plan.GetSite ("xTR");
+  NS_TEST_ASSERT_MSG_EQ (block.network, Ipv4Address ("10.128.0.0"), "first site block");
+  NS_TEST_ASSERT_MSG_EQ (block.mask, Ipv4Mask ("/22"), "the aligned links fit");
+
+  const uint32_t nAddresses[] = { 2, 254, 126 };
+  uint32_t next = block.network.Get ();
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (plan.CanAllocateLink (nAddresses[i], "xTR"), true, "link " << i << " fits");
+      AddressPlan::Subnet subnet = plan.AllocateLink (nAddresses[i], "xTR");
+      NS_TEST_ASSERT_MSG_EQ (GetSize (subnet), linkSizes[i], "link " << i << " size");
+      NS_TEST_ASSERT_MSG_EQ (subnet.network.Get () % linkSizes[i], 0u, "link " << i << " aligned");
+      NS_TEST_ASSERT_MSG_GT_OR_EQ (subnet.network.Get (), next, "link " << i << " after the previous one");
+      NS_TEST_ASSERT_MSG_EQ (block.mask.IsMatch (subnet.network, block.network), true, "link " << i << " in the block");
+      next = subnet.network.Get () + GetSize (subnet);
+    }
+  NS_TEST_ASSERT_MSG_LT_OR_EQ (next, block.network.Get () + GetSize (block), "the last link in the block");
+
+  // The block of the sum of the link sizes overflows
+  plan.AddSite ("small", 386);
+  NS_TEST_ASSERT_MSG_EQ (plan.GetSite ("small").mask, Ipv4Mask ("/23"), "the sum rounded up");
+  plan.AllocateLink (2, "small");
+  plan.AllocateLink (254, "small");
+  NS_TEST_ASSERT_MSG_EQ (plan.CanAllocateLink (126, "small"), false, "no room left for the aligned /25");
+}
+
+// ================================================================================================
+
+class AddressPlanExhaustedTestCase : public TestCase
+{
+public:
+  AddressPlanExhaustedTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+AddressPlanExhaustedTestCase::AddressPlanExhaustedTestCase ()
+  : TestCase ("A full block refuses the links it cannot hold")
+{
+}
+
+void
+AddressPlanExhaustedTestCase::DoRun (void)
+{
+  AddressPlan plan;
+  plan.SetAggregated (true);
+
+  // A site not reserved gets a /24
+  NS_TEST_ASSERT_MSG_EQ (plan.CanAllocateLink (254, "xTR"), true, "a new site");
+  AddressPlan::Subnet subnet = plan.AllocateLink (254, "xTR");
+  NS_TEST_ASSERT_MSG_EQ (subnet.mask, Ipv4Mask ("/24"), "the whole block");
+  NS_TEST_ASSERT_MSG_EQ (plan.GetSite ("xTR").network, subnet.network, "the block of the site");
+  NS_TEST_ASSERT_MSG_EQ (plan.CanAllocateLink (2, "xTR"), false, "the site is full");
+  NS_TEST_ASSERT_MSG_EQ (plan.CanAllocateLink (2, "other"), true, "the other sites are not");
+
+  // The core half, 10.0.0.0/9, holds two /10
+  const uint32_t quarter = (1U << 22) - 2;
+  NS_TEST_ASSERT_MSG_EQ (plan.CanAllocateLink (2), true, "empty core");
+  plan.AllocateLink (quarter);
+  NS_TEST_ASSERT_MSG_EQ (plan.CanAllocateLink (quarter), true, "half of the core left");
+  subnet = plan.AllocateLink (quarter);
+  NS_TEST_ASSERT_MSG_EQ (subnet.network, Ipv4Address ("10.64.0.0"), "the second /10");
+  NS_TEST_ASSERT_MSG_EQ (plan.CanAllocateLink (2), false, "the core is full");
+  NS_TEST_ASSERT_MSG_EQ (plan.CanAllocateLink (2, "xTR"), false, "the site is still full");
+  NS_TEST_ASSERT_MSG_EQ (plan.CanAllocateLink (2, "other"), true, "the EID half is separate");
+}
+
+// ================================================================================================
+
+class AddressPlanTestSuite : public TestSuite
+{
+public:
+  AddressPlanTestSuite ();
+};
+
+AddressPlanTestSuite::AddressPlanTestSuite ()
+  : TestSuite ("addressless-address-plan", UNIT)
+{
+  AddTestCase (new AddressPlanLinkTestCase, TestCase::QUICK);
+  AddTestCase (new AddressPlanCoreTestCase, TestCase::QUICK);
+  AddTestCase (new AddressPlanSiteTestCase, TestCase::QUICK);
+  AddTestCase (new AddressPlanExhaustedTestCase, TestCase::QUICK);
+}
+
+static AddressPlanTestSuite addressPlanTestSuite;
@@ -0,0 +1,92 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/address-pool.h"
+
+#include "ns3/test.h"
+
+using namespace ns3;
+
+// ================================================================================================
+
+class AddressPoolSwapTestCase : public TestCase
+{
+public:
+  AddressPoolSwapTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+AddressPoolSwapTestCase::AddressPoolSwapTestCase ()
+  : TestCase ("The pool of an interface follows an address replaced by another")
+{
+}
+
+void
+AddressPoolSwapTestCase::DoRun (void)
+{
+  NodeContainer nodes;
+  nodes.Create (2);
+  InternetStackHelper internet;
+  internet.Install (nodes);
+  PointToPointHelper p2p;
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase ("192.168.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer interfaces = ipv4.Assign (p2p.Install (nodes));
+
+  Ptr<Ipv4L3Protocol> l3 = nodes.Get (0)->GetObject<Ipv4L3Protocol> ();
+  uint32_t index = interfaces.Get (0).second;
+  l3->AddAddress (index, Ipv4InterfaceAddress (Ipv4Address ("10.0.0.1"), Ipv4Mask ("/32")));
+  Ptr<AddressPool> pool = AddressPool::GetPool (l3->GetInterface (index));
+  NS_TEST_ASSERT_MSG_EQ (pool->Contains (Ipv4Address ("10.0.0.1")), true, "the added address");
+  pool->SelectConsistent (Ipv4Address ("11.0.0.1"));
+
+  // Same number of addresses, but not the same addresses
+  l3->RemoveAddress (index, Ipv4Address ("10.0.0.1"));
+  l3->AddAddress (index, Ipv4InterfaceAddress (Ipv4Address ("10.0.0.2"), Ipv4Mask ("/32")));
+  pool = AddressPool::GetPool (l3->GetInterface (index));
+  NS_TEST_ASSERT_MSG_EQ (pool->GetNAddresses (), 2u, "the address of the link and the new one");
+  NS_TEST_ASSERT_MSG_EQ (pool->Contains (Ipv4Address ("10.0.0.1")), false, "the removed address left the pool");
+  NS_TEST_ASSERT_MSG_EQ (pool->Contains (Ipv4Address ("10.0.0.2")), true, "the new address joined the pool");
+  NS_TEST_ASSERT_MSG_EQ (pool->Find (Ipv4Address ("10.0.0.2")), 1, "in the order of the interface");
+  for (uint32_t i = 0; i < 16; i++)
+    {
+      NS_TEST_ASSERT_MSG_NE (pool->SelectConsistent (Ipv4Address (0x0b000001 + i)), Ipv4Address ("10.0.0.1"),
+                             "no peer is redirected to the removed address");
+    }
+  Simulator::Destroy ();
+}
+
+// ================================================================================================
+
+class AddressPoolTestSuite : public TestSuite
+{
+public:
+  AddressPoolTestSuite ();
+};
+
+AddressPoolTestSuite::AddressPoolTestSuite ()
+  : TestSuite ("addressless-address-pool", UNIT)
+{
+  AddTestCase (new AddressPoolSwapTestCase, TestCase::QUICK);
+}
+
+static AddressPoolTestSuite addressPoolTestSuite;
@@ -0,0 +1,271 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/map-request-msg.h"
+#include "ns3/map-reply-msg.h"
+#include "ns3/map-resolver-privacy-ddt.h"
+#include "../../internet/test/lisp-test/lisp-test-utils.h"
+
+#include "ns3/test.h"
+
+using namespace ns3;
+
+// ================================================================================================
+
+/**
+ * Topology:  ITR (n0..) --- R --- MR
+ *                           |
+ *                           MS
+ *
+ * The MS is a plain socket that answers the Map-Requests for 10.9.9.0/24 to
+ * their ITR-RLOC, after dropping the first ones.
+ */
+class MapResolverPrivacyTestCase : public TestCase
+{
+public:
+  MapResolverPrivacyTestCase (std::string name);
+
+protected:
+  void CreateTopology (uint32_t nItrs);
+  /// Send a Map-Request for 10.9.9.1 from an ITR to the MR.
+  void ScheduleRequest (Time at, uint32_t itr, Ipv4Address source, uint64_t nonce);
+
+  uint32_t m_nDroppedMapRequests; //!< The number of Map-Requests the MS drops first
+  uint32_t m_recordTtl;           //!< The TTL of the records the MS answers
+  uint32_t m_nMapRequests;        //!< The Map-Requests the MS received
+  std::vector<std::vector<uint64_t> > m_nonces; //!< The nonces of the Map-Replies, by ITR
+  std::vector<Ptr<Socket> > m_itrs;
+  std::vector<Ipv4Address> m_addresses;
+  Ptr<MapResolverPrivacyDdt> m_mr;
+
+private:
+  void HandleMapRequest (Ptr<Socket> socket);
+};
+
+MapResolverPrivacyTestCase::MapResolverPrivacyTestCase (std::string name)
+  : TestCase (name),
+    m_nDroppedMapRequests (0),
+    m_recordTtl (MapReplyRecord::m_defaultRecordTtl),
+    m_nMapRequests (0)
+{
+}
+
+void
+MapResolverPrivacyTestCase::HandleMapRequest (Ptr<Socket> socket)
+{
+  Ptr<Packet> packet;
+  while ((packet = socket->Recv ()))
+    {
+      uint8_t buf[packet->GetSize ()];
+      packet->CopyData (buf, packet->GetSize ());
+      Ptr<MapRequestMsg> request = MapRequestMsg::Deserialize (buf);
+      if (m_nMapRequests++ < m_nDroppedMapRequests)
+        {
+          continue;
+        }
+      Ptr<MapReplyRecord> record = Create<MapReplyRecord> ();
+      record->SetRecordTtl (m_recordTtl);
+      record->SetEidPrefix (Ipv4Address ("10.9.9.0"));
+      record->SetEidMaskLength (24);
+      Ptr<Locators> locators = Create<LocatorsImpl> ();
+      Ptr<Locator> locator = Create<Locator> (Ipv4Address ("192.168.100.1"));
+      locator->SetRlocMetrics (Create<RlocMetrics> (1, 100, true));
+      locators->InsertLocator (locator);
+      record->SetLocators (locators);
+      Ptr<MapReplyMsg> reply = Create<MapReplyMsg> ();
+      reply->SetNonce (request->GetNonce ());
+      reply->AddRecord (record);
+      socket->SendTo (reply->ToPacket (), 0,
+                      InetSocketAddress (Ipv4Address::ConvertFrom (request->GetItrRlocAddrIp ()),
+                                         LispOverIp::LISP_SIG_PORT));
+    }
+}
+
+void
+MapResolverPrivacyTestCase::CreateTopology (uint32_t nItrs)
+{
+  NodeContainer nodes;
+  nodes.Create (nItrs + 3);
+  InternetStackHelper internet;
+  internet.Install (nodes);
+  m_addresses = InstallStarTopology (nodes, nodes.Get (nItrs));
+
+  m_mr = CreateObject<MapResolverPrivacyDdt> ();
+  m_mr->SetAttribute ("ReplyTimeout", TimeValue (Seconds (1.0)));
+  m_mr->SetMapServerAddress (m_addresses[nItrs + 2]);
+  nodes.Get (nItrs + 1)->AddApplication (m_mr);
+  m_mr->SetStartTime (Seconds (0.0));
+
+  Ptr<Socket> ms = Socket::CreateSocket (nodes.Get (nItrs + 2), UdpSocketFactory::GetTypeId ());
+  ms->Bind (InetSocketAddress (Ipv4Address::GetAny (), LispOverIp::LISP_SIG_PORT));
+  ms->SetRecvCallback (MakeCallback (&MapResolverPrivacyTestCase::HandleMapRequest, this));
+
+  m_nonces.assign (nItrs, std::vector<uint64_t> ());
+  m_itrs.clear ();
+  for (uint32_t i = 0; i < nItrs; i++)
+    {
+      Ptr<Socket> socket = Socket::CreateSocket (nodes.Get (i), UdpSocketFactory::GetTypeId ());
+      socket->Bind (InetSocketAddress (Ipv4Address::GetAny (), LispOverIp::LISP_SIG_PORT));
+      socket->SetRecvCallback (MakeBoundCallback (&ReceiveMapReplyNonce, &m_nonces[i]));
+      m_itrs.push_back (socket);
+    }
+}
+
+void
+MapResolverPrivacyTestCase::ScheduleRequest (Time at, uint32_t itr, Ipv4Address source, uint64_t nonce)
+{
+  uint32_t mr = m_itrs.size () + 1;
+  Simulator::Schedule (at, &SendEidMapRequest, m_itrs[itr], m_addresses[mr], m_addresses[itr], source, nonce);
+}
+
+// ================================================================================================
+
+class LostMapReplyTestCase : public MapResolverPrivacyTestCase
+{
+public:
+  LostMapReplyTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+LostMapReplyTestCase::LostMapReplyTestCase ()
+  : MapResolverPrivacyTestCase ("The Map-Requests waiting for a lost Map-Reply are forwarded after the reply timeout")
+{
+}
+
+void
+LostMapReplyTestCase::DoRun (void)
+{
+  /* Both ITRs ask for the same /24 while the MR searches for it. The
+     Map-Reply to the Map-Request the MR forwards is lost: both must still be
+     answered, and a later Map-Request must search the prefix again.
+  */
+  const uint32_t nItrs = 2;
+  m_nDroppedMapRequests = 1;
+  CreateTopology (nItrs);
+  for (uint32_t i = 0; i < nItrs; i++)
+    {
+      ScheduleRequest (Seconds (1.0) + MilliSeconds (100 * i), i, Ipv4Address (0x0aff0001 + i), i + 1);
+    }
+  // Once the MR has given up on the lost Map-Reply
+  ScheduleRequest (Seconds (5.0), 0, Ipv4Address ("10.255.1.1"), 10);
+
+  Simulator::Stop (Seconds (10.0));
+  Simulator::Run ();
+
+  for (uint32_t i = 0; i < nItrs; i++)
+    {
+      NS_TEST_ASSERT_MSG_GT (m_nonces[i].size (), 0u, "ITR " << i << " is answered despite the lost Map-Reply");
+      NS_TEST_ASSERT_MSG_EQ (m_nonces[i].front (), i + 1, "ITR " << i << " receives its own Map-Reply");
+    }
+  NS_TEST_ASSERT_MSG_EQ (m_nonces[0].size (), 2u, "the prefix is searched again after the timeout");
+  NS_TEST_ASSERT_MSG_EQ (m_nonces[0].back (), 10u, "the later Map-Request is answered");
+  NS_TEST_ASSERT_MSG_EQ (m_nMapRequests, 4u, "the lost one, the two waiting ones, then a new search");
+  Simulator::Destroy ();
+}
+
+// ================================================================================================
+
+class AnswerCacheTestCase : public MapResolverPrivacyTestCase
+{
+public:
+  AnswerCacheTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /// Record the TTL of the Map-Replies to the second ITR.
+  void ReceiveReply (Ptr<Socket> socket);
+
+  std::vector<uint32_t> m_ttls;
+};
+
+AnswerCacheTestCase::AnswerCacheTestCase ()
+  : MapResolverPrivacyTestCase ("The MR answers from its cache with the TTL left until the cached records expire")
+{
+}
+
+void
+AnswerCacheTestCase::ReceiveReply (Ptr<Socket> socket)
+{
+  Ptr<Packet> packet;
+  while ((packet = socket->Recv ()))
+    {
+      uint8_t buf[packet->GetSize ()];
+      packet->CopyData (buf, packet->GetSize ());
+      Ptr<MapReplyMsg> reply = MapReplyMsg::Deserialize (buf);
+      m_nonces[1].push_back (reply->GetNonce ());
+      m_ttls.push_back (reply->GetRecord (0)->GetRecordTtl ());
+    }
+}
+
+void
+AnswerCacheTestCase::DoRun (void)
+{
+  /* The first ITR asks for the /24: the MR forwards its Map-Request and
+     caches the 2-minute answer. The second ITR is answered from the cache,
+     with the TTL left, until the answer expires.
+  */
+  const uint32_t nItrs = 2;
+  m_recordTtl = 2;
+  CreateTopology (nItrs);
+  m_itrs[1]->SetRecvCallback (MakeCallback (&AnswerCacheTestCase::ReceiveReply, this));
+  ScheduleRequest (Seconds (1.0), 0, Ipv4Address ("10.255.0.1"), 1);
+  ScheduleRequest (Seconds (2.0), 1, Ipv4Address ("10.255.0.2"), 2);
+  // The answer has expired
+  ScheduleRequest (Seconds (130.0), 1, Ipv4Address ("10.255.0.3"), 3);
+
+  Simulator::Stop (Seconds (10.0));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_nonces[0].size (), 1u, "the first ITR is answered");
+  NS_TEST_ASSERT_MSG_EQ (m_nonces[1].size (), 1u, "the second ITR is answered from the cache");
+  NS_TEST_ASSERT_MSG_EQ (m_nonces[1].front (), 2u, "with its own nonce");
+  NS_TEST_ASSERT_MSG_EQ (m_ttls.front (), 1u, "with the whole minutes left in the cache");
+  NS_TEST_ASSERT_MSG_EQ (m_nMapRequests, 1u, "the MS is asked once");
+
+  Simulator::Stop (Seconds (135.0));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_nMapRequests, 2u, "the MS is asked again once the answer expired");
+  NS_TEST_ASSERT_MSG_EQ (m_nonces[1].size (), 2u, "the second ITR is answered again");
+  NS_TEST_ASSERT_MSG_EQ (m_ttls.back (), 2u, "with the TTL of the new answer");
+  Simulator::Destroy ();
+}
+
+// ================================================================================================
+
+class MapResolverPrivacyDdtTestSuite : public TestSuite
+{
+public:
+  MapResolverPrivacyDdtTestSuite ();
+};
+
+MapResolverPrivacyDdtTestSuite::MapResolverPrivacyDdtTestSuite ()
+  : TestSuite ("addressless-map-resolver-privacy", UNIT)
+{
+  AddTestCase (new LostMapReplyTestCase, TestCase::QUICK);
+  AddTestCase (new AnswerCacheTestCase, TestCase::QUICK);
+}
+
+static MapResolverPrivacyDdtTestSuite mapResolverPrivacyDdtTestSuite;
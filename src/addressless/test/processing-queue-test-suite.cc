@@ -0,0 +1,142 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/processing-queue.h"
+
+#include "ns3/test.h"
+
+using namespace ns3;
+
+// ================================================================================================
+
+class ProcessingQueueTestCase : public TestCase
+{
+public:
+  ProcessingQueueTestCase (uint32_t workers);
+
+private:
+  virtual void DoRun (void);
+
+  static std::string Name (uint32_t workers);
+
+  void JobDone (uint32_t job);
+  void BusyWorkers (uint32_t oldValue, uint32_t newValue);
+  void JobStarted (Time waiting, Time service);
+
+  uint32_t m_workers;
+  uint32_t m_maxBusy;
+  std::vector<uint32_t> m_done;   //!< The jobs, in completion order
+  std::vector<Time> m_starts;     //!< The start of the services, in start order
+  std::vector<Time> m_completion; //!< The completion time, by job
+};
+
+ProcessingQueueTestCase::ProcessingQueueTestCase (uint32_t workers)
+  : TestCase (Name (workers)),
+    m_workers (workers),
+    m_maxBusy (0)
+{
+}
+
+std::string
+ProcessingQueueTestCase::Name (uint32_t workers)
+{
+  std::ostringstream oss;
+  oss << "The jobs start in arrival order and complete after their service time with " << workers << " worker(s)";
+  return oss.str ();
+}
+
+void
+ProcessingQueueTestCase::JobDone (uint32_t job)
+{
+  m_done.push_back (job);
+  m_completion[job] = Simulator::Now ();
+}
+
+void
+ProcessingQueueTestCase::BusyWorkers (uint32_t oldValue, uint32_t newValue)
+{
+  m_maxBusy = std::max (m_maxBusy, newValue);
+}
+
+void
+ProcessingQueueTestCase::JobStarted (Time waiting, Time service)
+{
+  m_starts.push_back (Simulator::Now ());
+}
+
+void
+ProcessingQueueTestCase::DoRun (void)
+{
+  // A burst at 0, then a late job that finds a free worker
+  const uint32_t services[] = { 30, 10, 20, 50, 10, 40, 20 };
+  const uint32_t nJobs = sizeof (services) / sizeof (services[0]);
+  const Time late = MilliSeconds (1000);
+
+  Ptr<ProcessingQueue> queue = CreateObject<ProcessingQueue> ();
+  queue->SetAttribute ("Workers", UintegerValue (m_workers));
+  queue->TraceConnectWithoutContext ("BusyWorkers", MakeCallback (&ProcessingQueueTestCase::BusyWorkers, this));
+  queue->TraceConnectWithoutContext ("WaitingTime", MakeCallback (&ProcessingQueueTestCase::JobStarted, this));
+
+  m_completion.assign (nJobs + 1, Time ());
+  for (uint32_t i = 0; i < nJobs; i++)
+    {
+      queue->Submit (MakeEvent (&ProcessingQueueTestCase::JobDone, this, i), MilliSeconds (services[i]));
+    }
+  void (ProcessingQueue::*submit)(EventImpl *, Time) = &ProcessingQueue::Submit;
+  Simulator::Schedule (late, submit, queue,
+                       MakeEvent (&ProcessingQueueTestCase::JobDone, this, nJobs), MilliSeconds (5));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_done.size (), nJobs + 1, "every job completes");
+  NS_TEST_ASSERT_MSG_EQ (m_starts.size (), nJobs + 1, "every job starts");
+  NS_TEST_ASSERT_MSG_EQ (m_maxBusy, m_workers, "at most one job in service per worker");
+
+  // The FIFO queue: each job starts on the first worker to be free
+  std::vector<Time> freeAt (m_workers, Time ());
+  for (uint32_t i = 0; i < nJobs; i++)
+    {
+      std::vector<Time>::iterator worker = std::min_element (freeAt.begin (), freeAt.end ());
+      NS_TEST_ASSERT_MSG_EQ (m_starts[i], *worker, "job " << i << " is the next one to start");
+      *worker += MilliSeconds (services[i]);
+      NS_TEST_ASSERT_MSG_EQ (m_completion[i], *worker, "job " << i << " completes its service time after its start");
+    }
+  NS_TEST_ASSERT_MSG_EQ (m_completion[nJobs], late + MilliSeconds (5), "a job that does not wait completes after its service time");
+  NS_TEST_ASSERT_MSG_EQ (queue->GetNBusy (), 0u, "no job left in service");
+  NS_TEST_ASSERT_MSG_EQ (queue->GetNWaiting (), 0u, "no job left waiting");
+  Simulator::Destroy ();
+}
+
+// ================================================================================================
+
+class ProcessingQueueTestSuite : public TestSuite
+{
+public:
+  ProcessingQueueTestSuite ();
+};
+
+ProcessingQueueTestSuite::ProcessingQueueTestSuite ()
+  : TestSuite ("addressless-processing-queue", UNIT)
+{
+  AddTestCase (new ProcessingQueueTestCase (1), TestCase::QUICK);
+  AddTestCase (new ProcessingQueueTestCase (3), TestCase::QUICK);
+}
+
+static ProcessingQueueTestSuite processingQueueTestSuite;
@@ -32,7 +32,8 @@ namespace ns3
   }
   void IPNode::AddAddress(std::string neighbor, Ipv4Address addr)
   {
-    GetInterface(neighbor)->AddAddress(Ipv4InterfaceAddress(addr, Ipv4Mask("/24")));
+    Ptr<Ipv4Interface> iface = GetInterface(neighbor);
+    iface->AddAddress(Ipv4InterfaceAddress(addr, iface->GetAddress(0).GetMask()));
   }
 
 }
\ No newline at end of file
@@ -12,8 +12,16 @@ namespace ns3
 
     LISPNode::~LISPNode() {}
 
-    void LISPNode::SetMapTables()
+    void LISPNode::SetMapTables(std::string site)
     {
+        bool hasSite = m_topo->m_addressPlan.HasSite(site);
+        AddressPlan::Subnet block;
+        if (hasSite)
+        {
+            // One EID-Prefix for all the links of the site
+            block = m_topo->m_addressPlan.GetSite(site);
+            this->AddEntryToMapTables(block.network, block.mask);
+        }
         for (auto iter : m_linkByNeighbor)
         {
             /* TODO
@@ -22,7 +30,13 @@ namespace ns3
             }
             */
             // have to add router otherwise map server ends up with an empty map table and it crashes.
-            this->AddEntryToMapTables(this->GetAddress(iter.first));
+            // The router link is out of the site block: some simulations use it as destination.
+            Ipv4InterfaceAddress address = this->GetInterface(iter.first)->GetAddress(0);
+            if (hasSite && block.mask.IsMatch(address.GetLocal(), block.network))
+            {
+                continue;
+            }
+            this->AddEntryToMapTables(address.GetLocal(), address.GetMask());
         }
 
             m_topo->m_lispHelper.SetMapTablesForEtr(Address(m_rlocs->GetAddress(0).GetLocal()), m_ipv4MapTables, m_ipv6MapTables);
@@ -31,23 +45,23 @@ namespace ns3
     {
         m_rlocs = rlocs;
     }
-    void LISPNode::AddEntryToMapTables(Ipv4Address eidAddress)
+    void LISPNode::AddEntryToMapTables(Ipv4Address eidAddress, Ipv4Mask eidMask)
     {
         this->InitializeMapTables();
 
-        Ipv4Mask eidMask = Ipv4Mask("255.255.255.0");
         auto location = MapTables::IN_DATABASE;
 
-        uint8_t priority = 200;
-        uint8_t weight = 30;
+        uint8_t priority = m_topo->m_locatorPriority;
+        uint8_t weight = m_topo->m_locatorWeight;
         bool reachability = true;
         if (Ipv4Address::IsMatchingType(eidAddress))
         {
             if (m_rlocs != nullptr)
             {
-                for (size_t i = 0; i < m_rlocs->GetNAddresses(); i++)
+                Ptr<AddressPool> rlocs = AddressPool::GetPool(m_rlocs);
+                for (size_t i = 0; i < rlocs->GetNAddresses(); i++)
                 {
-                    m_ipv4MapTables->InsertLocator(eidAddress, eidMask, m_rlocs->GetAddress(i).GetLocal(), priority, weight,
+                    m_ipv4MapTables->InsertLocator(eidAddress, eidMask, rlocs->GetAddress(i), priority, weight,
                                                    location, reachability);
                 }
             }
@@ -61,11 +75,11 @@ namespace ns3
     {
         if (m_ipv4MapTables == nullptr)
         {
-            m_ipv4MapTables = Create<SimpleMapTables>();
+            m_ipv4MapTables = m_topo->m_lispHelper.CreateMapTables();
         }
         if (m_ipv6MapTables == nullptr)
         {
-            m_ipv6MapTables = Create<SimpleMapTables>();
+            m_ipv6MapTables = m_topo->m_lispHelper.CreateMapTables();
         }
     }
 
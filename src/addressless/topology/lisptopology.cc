@@ -5,10 +5,16 @@ namespace ns3
 {
   NS_LOG_COMPONENT_DEFINE("LISPTopology");
   NS_OBJECT_ENSURE_REGISTERED(LISPTopology);
-  json IPTopology::m_data;
+  ResultsSink IPTopology::m_results;
 
   LISPTopology::LISPTopology(/* args */) : IPTopology()
   {
+    m_nbrXtrs = 0;
+    m_locatorPriority = 200;
+    m_locatorWeight = 30;
+    m_mapServerShards = Create<MapServerShards>();
+    m_lispPrivacyXtrHelper.SetMapServerShards(m_mapServerShards);
+    m_mapResolverHelper.SetMapServerShards(m_mapServerShards);
   }
 
   LISPTopology::~LISPTopology() {}
@@ -39,6 +45,7 @@ namespace ns3
     this->SetLispCapable(node);
     m_lispPrivacyXtrHelper.AddMapServerAddress(node->GetAddress("router"));
     m_mapResolverHelper.SetMapServerAddress(node->GetAddress("router"));
+    m_mapServerShards->AddMapServer(node->GetAddress("router"));
     ApplicationContainer application = m_mapServerHelper.Install(node);
     application.Start(Seconds(0.0));
     application.Stop(Seconds(200.0));
@@ -49,20 +56,26 @@ namespace ns3
     SetLispCapable(node);
 
     Ptr<Locator> rloc = Create<Locator>(node->GetAddress("router"));
-    m_lispPrivacyXtrHelper.AddMapResolverRlocs(rloc);
+    m_mapResolverRlocs.push_back(rloc);
 
     ApplicationContainer application = m_mapResolverHelper.Install(node);
     application.Start(Seconds(0.0));
     application.Stop(Seconds(200.0));
   }
 
+  void LISPTopology::SetMapResolverAnswerCache(bool enabled)
+  {
+    m_mapResolverHelper.SetAttribute("AnswerCache", BooleanValue(enabled));
+  }
+
   void LISPTopology::AddRlocs(std::string lispNode, std::string destNode)
   {
     Ptr<IPNode> lispn = this->GetNode(lispNode);
     Ptr<Ipv4Interface> toInterface = lispn->GetInterface(destNode);
-    for (size_t i = 0; i < toInterface->GetNAddresses(); i++)
+    Ptr<AddressPool> rlocs = AddressPool::GetPool(toInterface);
+    for (size_t i = 0; i < rlocs->GetNAddresses(); i++)
     {
-      m_lispHelper.AddRlocToSet(toInterface->GetAddress(i).GetLocal());
+      m_lispHelper.AddRlocToSet(rlocs->GetAddress(i));
     }
     DynamicCast<LISPNode, IPNode>(lispn)->SetRlocInterface(toInterface);
   }
@@ -75,16 +88,24 @@ namespace ns3
   void LISPTopology::ReportMapDelay(int id, double time)
   {
     int x = (id - m_clients) - 2 >= 0 ? (id - m_clients) - 2 : 0;
-    m_data["Clients"][x]["MapDelay"].push_back(time);
+    m_results.Write({{"Client", x}, {"MapDelay", time}});
   }
 
   void LISPTopology::SetXtr(std::string name)
   {
     Ptr<LISPNode> node = DynamicCast<LISPNode, IPNode>(this->GetNode(name));
-    node->SetMapTables();
+    node->SetMapTables(name);
     SetLispCapable(node);
 
     ApplicationContainer application;
+    // The xTR uses the first map resolver of its list, the others follow in turn
+    std::list<Ptr<Locator>> mapResolvers;
+    for (size_t i = 0; i < m_mapResolverRlocs.size(); i++)
+    {
+      mapResolvers.push_back(m_mapResolverRlocs[(m_nbrXtrs + i) % m_mapResolverRlocs.size()]);
+    }
+    m_nbrXtrs++;
+    m_lispPrivacyXtrHelper.SetMapResolverRlocs(mapResolvers);
     m_lispPrivacyXtrHelper.SetAttribute("xTRId", UintegerValue(node->GetId()));
     application = m_lispPrivacyXtrHelper.Install(node);
     Callback<void, int, double> c = MakeCallback(&LISPTopology::ReportMapDelay, this);
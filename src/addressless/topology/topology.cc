@@ -5,13 +5,12 @@ namespace ns3
   NS_LOG_COMPONENT_DEFINE("IPTopology");
   NS_OBJECT_ENSURE_REGISTERED(IPTopology);
   std::vector<double> IPTopology::m_connectionTimes;
+  static const std::string DEFAULT_DATA_RATE = "1000Mbps";
+  static const std::string DEFAULT_DELAY = "5ms";
   IPTopology::IPTopology()
   {
-    this->linkHelper.SetDeviceAttribute("DataRate", StringValue("1000Mbps"));
-    this->linkHelper.SetChannelAttribute("Delay", StringValue("5ms"));
+    SetLink("", "");
     m_port = 50000;
-    m_ipv4.SetBase("10.1.1.0", "255.255.255.0");
-    
   }
 
   IPTopology::~IPTopology()
@@ -36,6 +35,10 @@ namespace ns3
 
     // Optional
   }
+  void IPTopology::EnablePcap(std::string name)
+  {
+    this->linkHelper.EnablePcap("results/" + name, NodeContainer(this->GetNode(name)));
+  }
   void IPTopology::AddHost(std::string name, double x, double y)
   {
     this->hostNames.push_back(name);
@@ -68,6 +71,17 @@ namespace ns3
     return this->nodesByName[name];
   }
 
+  void IPTopology::SetLink(std::string dataRate, std::string delay)
+  {
+    this->linkHelper.SetDeviceAttribute("DataRate", StringValue(dataRate.empty() ? DEFAULT_DATA_RATE : dataRate));
+    this->linkHelper.SetChannelAttribute("Delay", StringValue(delay.empty() ? DEFAULT_DELAY : delay));
+  }
+
+  void IPTopology::SetLinkSite(std::string site)
+  {
+    m_linkSite = site;
+  }
+
   void IPTopology::Connect(std::string nodeA, std::string nodeB, uint8_t nbAdrNodeA, uint8_t nbAdrNodeB, bool pcap)
   {
     NS_LOG_DEBUG("Connecting " << nodeA << " and " << nodeB);
@@ -80,6 +94,9 @@ namespace ns3
     if (pcap)
       this->linkHelper.EnablePcap("results/"+nodeA, NodeContainer(A));
 
+    // Both addresses of a /31 are hosts, the others start after the network address
+    AddressPlan::Subnet subnet = m_addressPlan.AllocateLink(nbAdrNodeA + nbAdrNodeB, m_linkSite);
+    m_ipv4.SetBase(subnet.network, subnet.mask, subnet.mask.GetPrefixLength() == 31 ? "0.0.0.0" : "0.0.0.1");
     Ipv4InterfaceContainer interfaces = m_ipv4.Assign(networkDevices);
 
     B->AddInterface(interfaces.Get(0).second, nodeA);
@@ -93,8 +110,6 @@ namespace ns3
     {
       A->AddAddress(nodeB, m_ipv4.NewAddress());
     }
-
-    m_ipv4.NewNetwork();
   }
   void IPTopology::InstallNating(std::string routerN, std::string nodeN)
   {
@@ -114,32 +129,35 @@ namespace ns3
     // Ipv4DynamicNatRule rule(Ipv4Address("10.1.2.0"), Ipv4Mask("255.255.255.0"));
     // nat->AddDynamicRule(rule);
   }
-  Ipv4Address IPTopology::GetTopAddress(Ptr<IPNode> node)
+  Ipv4Address IPTopology::GetTopAddress(Ptr<IPNode> node, std::string xtr)
   {
-    return node->GetAddress("xTRs") == "127.0.0.1" ? node->GetAddress("router") : node->GetAddress("xTRs");
+    return node->GetAddress(xtr) == "127.0.0.1" ? node->GetAddress("router") : node->GetAddress(xtr);
   }
-  void IPTopology::ReportConnection(int32_t id)
+  void IPTopology::ReportConnection(std::string server, int32_t id)
   {
     double time = Simulator::Now().GetMicroSeconds();
-    m_data["Clients"][id]["ConnectionDelay"] = time - 1000000;
+    json record = {{"Client", id}, {"ConnectionDelay", time - 1000000}};
+    if (server != "Server")
+      record["Site"] = server;
+    m_results.Write(record);
     m_connectionTimes.push_back(time - 1000000);
   }
 
-  void IPTopology::InstallServerModule(std::string server, bool check)
+  void IPTopology::InstallServerModule(std::string server, bool check, std::string xtr)
   {
-    RedirectApplicationServerHelper serverHelper(GetNode(server)->GetInterface("xTRs"));
+    RedirectApplicationServerHelper serverHelper(GetNode(server)->GetInterface(xtr));
     if (check)
       serverHelper.SetChecking();
     
     serverHelper.SetAttribute("Protocol", StringValue (m_protocol));
     ApplicationContainer serverApp = serverHelper.Install(GetNode(server));
-    serverApp.Get(0)->TraceConnectWithoutContext("ConnectionEstablished", MakeCallback(&IPTopology::ReportConnection, this));
+    serverApp.Get(0)->TraceConnect("ConnectionEstablished", server, MakeCallback(&IPTopology::ReportConnection, this));
     serverApp.Start(Seconds(1.0));
     serverApp.Stop(Seconds(200.0));
   }
-  void IPTopology::InstallEntranceModule(std::string entrance, std::string server)
+  void IPTopology::InstallEntranceModule(std::string entrance, std::string server, std::string xtr)
   {
-    RedirectApplicationEntranceHelper receiver_helper(InetSocketAddress(GetTopAddress(GetNode(entrance)), m_port), GetNode(server)->GetInterface("xTRs"));
+    RedirectApplicationEntranceHelper receiver_helper(InetSocketAddress(GetTopAddress(GetNode(entrance), xtr), m_port), GetNode(server)->GetInterface(xtr));
     receiver_helper.SetAttribute("Protocol", StringValue (m_protocol));
     ApplicationContainer recv_app = receiver_helper.Install(GetNode(entrance));
     recv_app.Start(Seconds(1.0));
@@ -13,6 +13,9 @@
 #include "ns3/map-server-privacy-helper.h"
 #include "ns3/map-resolver-privacy-helper.h"
 #include "ns3/json.hpp"
+#include "ns3/address-pool.h"
+#include "ns3/results-sink.h"
+#include "ns3/address-plan.h"
 using json = nlohmann::json;
 namespace ns3
 {
@@ -58,20 +61,22 @@ namespace ns3
     std::map<std::string, Ptr<IPNode>> nodesByName; // Keep tracks of all nodes in the topology
     PointToPointHelper linkHelper;                  // Helper that set up all the link layer
     InternetStackHelper stack;                      // Helper that sets up all the ip network layer
-    Ipv4AddressHelper m_ipv4;                       // Helper that sets up all the addressing
+    Ipv4AddressHelper m_ipv4;                       // Helper that sets up all the addressing, in the subnets of m_addressPlan
+    std::string m_linkSite;                         // Site of the links created by the next calls to Connect
     Ipv4NatHelper m_natHelper;
     AnimationInterface *anim; // Helper that takes care of all the animation output of the simulation.
     std::vector<std::string> hostNames;
     std::vector<std::string> routerNames;
-    void ReportConnection(int32_t id);
+    void ReportConnection(std::string server, int32_t id);
 
     uint16_t m_port; // Port used by the redirection protocol.
 
   public:
     int m_clients;
     std::string m_protocol;
+    AddressPlan m_addressPlan; // Allocates the subnet of every link
     static std::vector<double> m_connectionTimes;
-    static json m_data;
+    static ResultsSink m_results; // The measurements, written as they are made.
 
     IPTopology();
     ~IPTopology();
@@ -99,14 +104,33 @@ namespace ns3
      * \returns Nothing.
      **/
     void SetupAnim();
+    /**
+     *  Captures the packets of all the interfaces of a node, to results/<name>-*.pcap.
+     **/
+    void EnablePcap(std::string name);
 
     Ptr<IPNode> GetNode(std::string name);
-    Ipv4Address GetTopAddress(Ptr<IPNode> node);
+    Ipv4Address GetTopAddress(Ptr<IPNode> node, std::string xtr = "xTRs");
 
+    /**
+     * Sets the data rate and the delay of the links created by the next calls to Connect.
+     * An empty string restores the default (1000Mbps, 5ms).
+     **/
+    void SetLink(std::string dataRate, std::string delay);
+    /**
+     * Sets the site of the links created by the next calls to Connect: their subnets are
+     * allocated from the block of the site, see AddressPlan. An empty string: core links.
+     **/
+    void SetLinkSite(std::string site);
     void Connect(std::string nodeA, std::string nodeB, uint8_t nbAdrNodeA = 1, uint8_t nbAdrNodeB = 1, bool pcap = false);
     void InstallNating(std::string routerN, std::string nodeN);
-    void InstallServerModule(std::string node, bool check);
-    void InstallEntranceModule(std::string node, std::string mainServer);
+    /**
+     * Installs the server module on a node, listening on its interface to its xTR.
+     * The connections are reported to m_results, with the name of the server if it is
+     * not "Server".
+     **/
+    void InstallServerModule(std::string node, bool check, std::string xtr = "xTRs");
+    void InstallEntranceModule(std::string node, std::string mainServer, std::string xtr = "xTRs");
     void InstallTcpSender(std::string node, Ipv4Address source, Ipv4Address destination, double startTime);
 
   protected:
@@ -119,7 +143,12 @@ namespace ns3
     // COntrol plane server & resolver
     MapServerPrivacyDdtHelper m_mapServerHelper;
     MapResolverPrivacyDdtHelper m_mapResolverHelper;
+    // The Map-Servers sharing the EID space
+    Ptr<MapServerShards> m_mapServerShards;
     std::map<std::string, std::vector<Ipv4Address>> m_nodesRlocs;
+    // The map resolvers, the xTRs are spread among them
+    std::vector<Ptr<Locator>> m_mapResolverRlocs;
+    uint32_t m_nbrXtrs;
 
   public:
     // Control plane
@@ -127,18 +156,32 @@ namespace ns3
 
     // dataplane
     LispPrivacyHelper m_lispHelper;
+    // Priority and weight of the RLOCs of the EID-Prefixes registered by the xTRs
+    uint8_t m_locatorPriority;
+    uint8_t m_locatorWeight;
     LISPTopology(/* args */);
     ~LISPTopology();
     void AddRlocs(std::string lispNode, std::string destNode);
     /**
      * Setup a node as an Xtr, installing its lisp stack and the itr-etr control plane application.
+     * The xTRs send their Map-Requests to the map resolvers in turn.
      *
      * \param name The node on which to create the Application.     *
      * \returns Nothing.
      */
     void SetXtr(std::string name);
+    /**
+     * Setup a node as a Map-Server. Each call adds a Map-Server to the pool sharing
+     * the EID space (see MapServerShards): the xTRs register each EID-Prefix with,
+     * and the map resolver forwards the requests to, the Map-Server of its shard.
+     */
     void SetMapServer(std::string name, unsigned int interfaceIndex = 0);
     void SetMapResolver(std::string name, unsigned int interfaceIndex = 0);
+    /**
+     * Whether the map resolver answers the Map-Requests from the Map-Replies it
+     * cached, see MapResolverPrivacyDdt. To be called before SetMapResolver.
+     */
+    void SetMapResolverAnswerCache(bool enabled);
 
     void AddEntryToMapTables(Ipv4Address eidAddress);
     void SetTiming();
@@ -170,15 +213,19 @@ namespace ns3
     Ptr<Ipv4Interface> m_rlocs;
 
     LISPTopology *m_topo;
-    Ptr<SimpleMapTables> m_ipv4MapTables;
-    Ptr<SimpleMapTables> m_ipv6MapTables;
+    Ptr<MapTables> m_ipv4MapTables;
+    Ptr<MapTables> m_ipv6MapTables;
 
   public:
     LISPNode(LISPTopology *_topology);
     ~LISPNode();
-    void SetMapTables();
+    /**
+     * Fills the database of the node: the block of its site if the address plan has one,
+     * or else the subnets of all its links.
+     **/
+    void SetMapTables(std::string site = "");
     void SetRlocInterface(Ptr<Ipv4Interface> rlocs);
-    void AddEntryToMapTables(Ipv4Address eidAddress);
+    void AddEntryToMapTables(Ipv4Address eidAddress, Ipv4Mask eidMask);
     void InitializeMapTables();
   };
 
@@ -0,0 +1,125 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "address-hash.h"
+
+#include "ns3/assert.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/inet6-socket-address.h"
+
+namespace ns3 {
+
+// Any fixed key: the simulations are reproducible
+uint64_t AddressHash::s_k0 = 0x0706050403020100ULL;
+uint64_t AddressHash::s_k1 = 0x0f0e0d0c0b0a0908ULL;
+
+#define ROTL(x, b) (uint64_t) (((x) << (b)) | ((x) >> (64 - (b))))
+
+#define SIPROUND                                                        \
+  do                                                                    \
+    {                                                                   \
+      v0 += v1; v1 = ROTL (v1, 13); v1 ^= v0; v0 = ROTL (v0, 32);       \
+      v2 += v3; v3 = ROTL (v3, 16); v3 ^= v2;                           \
+      v0 += v3; v3 = ROTL (v3, 21); v3 ^= v0;                           \
+      v2 += v1; v1 = ROTL (v1, 17); v1 ^= v2; v2 = ROTL (v2, 32);       \
+    }                                                                   \
+  while (0)
+
+void
+AddressHash::SetKey (uint64_t k0, uint64_t k1)
+{
+  s_k0 = k0;
+  s_k1 = k1;
+}
+
+uint64_t
+AddressHash::SipHash (uint64_t k0, uint64_t k1, const uint8_t *data, uint32_t len)
+{
+  uint64_t v0 = k0 ^ 0x736f6d6570736575ULL;
+  uint64_t v1 = k1 ^ 0x646f72616e646f6dULL;
+  uint64_t v2 = k0 ^ 0x6c7967656e657261ULL;
+  uint64_t v3 = k1 ^ 0x7465646279746573ULL;
+
+  // The 8-byte words are read little-endian
+  const uint8_t *end = data + len - (len % 8);
+  for (; data != end; data += 8)
+    {
+      uint64_t m = 0;
+      for (int i = 7; i >= 0; i--)
+        {
+          m = (m << 8) | data[i];
+        }
+      v3 ^= m;
+      SIPROUND;
+      SIPROUND;
+      v0 ^= m;
+    }
+
+  uint64_t b = ((uint64_t) len) << 56;
+  for (int i = (len % 8) - 1; i >= 0; i--)
+    {
+      b |= ((uint64_t) data[i]) << (8 * i);
+    }
+  v3 ^= b;
+  SIPROUND;
+  SIPROUND;
+  v0 ^= b;
+
+  v2 ^= 0xff;
+  SIPROUND;
+  SIPROUND;
+  SIPROUND;
+  SIPROUND;
+  return v0 ^ v1 ^ v2 ^ v3;
+}
+
+uint32_t
+AddressHash::Hash32 (Ipv4Address address)
+{
+  uint32_t a = address.Get ();
+  uint8_t buf[4] = { (uint8_t) (a >> 24), (uint8_t) (a >> 16), (uint8_t) (a >> 8), (uint8_t) a };
+  uint64_t h = SipHash (s_k0, s_k1, buf, 4);
+  return (uint32_t) (h ^ (h >> 32));
+}
+
+uint32_t
+AddressHash::Hash32 (const Ipv6Address &address)
+{
+  uint8_t buf[16];
+  address.GetBytes (buf);
+  uint64_t h = SipHash (s_k0, s_k1, buf, 16);
+  return (uint32_t) (h ^ (h >> 32));
+}
+
+uint32_t
+AddressHash::Hash32 (const Address &address)
+{
+  if (Ipv4Address::IsMatchingType (address))
+    {
+      return Hash32 (Ipv4Address::ConvertFrom (address));
+    }
+  if (InetSocketAddress::IsMatchingType (address))
+    {
+      return Hash32 (InetSocketAddress::ConvertFrom (address).GetIpv4 ());
+    }
+  if (Ipv6Address::IsMatchingType (address))
+    {
+      return Hash32 (Ipv6Address::ConvertFrom (address));
+    }
+  NS_ASSERT_MSG (Inet6SocketAddress::IsMatchingType (address), "Not an IP address: " << address);
+  return Hash32 (Inet6SocketAddress::ConvertFrom (address).GetIpv6 ());
+}
+
+} // namespace ns3
@@ -0,0 +1,66 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef ADDRESS_HASH_H
+#define ADDRESS_HASH_H
+
+#include <stdint.h>
+
+#include "ns3/address.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv6-address.h"
+
+namespace ns3 {
+
+/**
+ * \brief Keyed hash of an address, from which the privacy components derive
+ * the redirection address of a peer.
+ *
+ * The xTRs, the data plane checks and the redirection applications must map
+ * a peer to the same address: they all hash with this class, and share its
+ * key. The hash is SipHash-2-4 on the address bytes in network order,
+ * folded to 32 bits. It works on the integer address, without allocation,
+ * as a router would.
+ */
+class AddressHash
+{
+public:
+  /**
+   * \brief Set the key shared by all the components (a default key is used
+   * otherwise).
+   */
+  static void SetKey (uint64_t k0, uint64_t k1);
+
+  static uint32_t Hash32 (Ipv4Address address);
+  static uint32_t Hash32 (const Ipv6Address &address);
+  /**
+   * \param address An Ipv4Address, Ipv6Address, InetSocketAddress or
+   * Inet6SocketAddress (the port is not hashed).
+   */
+  static uint32_t Hash32 (const Address &address);
+
+  /**
+   * \return SipHash-2-4 of 'len' bytes with the key k0, k1.
+   */
+  static uint64_t SipHash (uint64_t k0, uint64_t k1, const uint8_t *data, uint32_t len);
+
+private:
+  static uint64_t s_k0;
+  static uint64_t s_k1;
+};
+
+} // namespace ns3
+
+#endif /* ADDRESS_HASH_H */
@@ -0,0 +1,196 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "address-plan.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("AddressPlan");
+
+static const uint32_t LINK_BASE = 0x0a010100;  // 10.1.1.0
+static const uint32_t CORE_BASE = 0x0a000000;  // 10.0.0.0/9
+static const uint32_t EID_BASE = 0x0a800000;   // 10.128.0.0/9
+static const uint32_t HALF_SIZE = 1U << 23;
+
+AddressPlan::AddressPlan ()
+  : m_aggregated (false),
+    m_nextLink (LINK_BASE)
+{
+  m_core.next = CORE_BASE;
+  m_core.end = CORE_BASE + HALF_SIZE;
+  m_eids.next = EID_BASE;
+  m_eids.end = EID_BASE + HALF_SIZE;
+}
+
+void
+AddressPlan::SetAggregated (bool aggregated)
+{
+  m_aggregated = aggregated;
+}
+
+bool
+AddressPlan::IsAggregated (void) const
+{
+  return m_aggregated;
+}
+
+uint32_t
+AddressPlan::GetLinkSize (uint32_t nAddresses)
+{
+  if (nAddresses <= 2)
+    {
+      return 2;
+    }
+  uint32_t size = 4;
+  while (size < nAddresses + 2)
+    {
+      size <<= 1;
+    }
+  return size;
+}
+
+uint32_t
+AddressPlan::GetBlockSize (const std::vector<uint32_t> &linkSizes)
+{
+  uint32_t next = 0;
+  for (std::vector<uint32_t>::const_iterator it = linkSizes.begin (); it != linkSizes.end (); ++it)
+    {
+      next = Align (next, *it) + *it;
+    }
+  return next;
+}
+
+uint32_t
+AddressPlan::Align (uint32_t next, uint32_t size)
+{
+  return (next + size - 1) & ~(size - 1);
+}
+
+bool
+AddressPlan::Fits (uint32_t next, uint32_t end, uint32_t size)
+{
+  uint32_t network = Align (next, size);
+  return network >= next && network + size <= end && network + size >= network;
+}
+
+AddressPlan::Subnet
+AddressPlan::Allocate (uint32_t &next, uint32_t end, uint32_t size)
+{
+  NS_ABORT_MSG_IF (!Fits (next, end, size), "Address plan exhausted, cannot allocate " << size << " addresses");
+  uint32_t network = Align (next, size);
+  next = network + size;
+  Subnet subnet;
+  subnet.network = Ipv4Address (network);
+  subnet.mask = Ipv4Mask (~(size - 1));
+  return subnet;
+}
+
+void
+AddressPlan::AddSite (std::string site, uint32_t nAddresses)
+{
+  NS_LOG_FUNCTION (this << site << nAddresses);
+  if (!m_aggregated)
+    {
+      return;
+    }
+  NS_ABORT_MSG_IF (m_sites.count (site), "Site " << site << " already has a block");
+  uint32_t size = GetSiteSize (nAddresses);
+  Block block;
+  block.subnet = Allocate (m_eids.next, m_eids.end, size);
+  block.next = block.subnet.network.Get ();
+  block.end = block.next + size;
+  m_sites[site] = block;
+}
+
+uint32_t
+AddressPlan::GetSiteSize (uint32_t nAddresses)
+{
+  uint32_t size = 1U << (32 - SITE_PREFIX_LENGTH);
+  while (size < nAddresses)
+    {
+      size <<= 1;
+    }
+  return size;
+}
+
+bool
+AddressPlan::HasSite (std::string site) const
+{
+  return m_sites.count (site) != 0;
+}
+
+AddressPlan::Subnet
+AddressPlan::GetSite (std::string site) const
+{
+  std::map<std::string, Block>::const_iterator it = m_sites.find (site);
+  NS_ABORT_MSG_IF (it == m_sites.end (), "Unknown site " << site);
+  return it->second.subnet;
+}
+
+uint32_t
+AddressPlan::GetNSites (void) const
+{
+  return m_sites.size ();
+}
+
+AddressPlan::Subnet
+AddressPlan::AllocateLink (uint32_t nAddresses, std::string site)
+{
+  NS_LOG_FUNCTION (this << nAddresses << site);
+  if (!m_aggregated)
+    {
+      Subnet subnet;
+      subnet.network = Ipv4Address (m_nextLink);
+      subnet.mask = Ipv4Mask ("/24");
+      m_nextLink += 256;
+      return subnet;
+    }
+  uint32_t size = GetLinkSize (nAddresses);
+  if (site.empty ())
+    {
+      return Allocate (m_core.next, m_core.end, size);
+    }
+  if (!m_sites.count (site))
+    {
+      AddSite (site, size);
+    }
+  Block &block = m_sites[site];
+  return Allocate (block.next, block.end, size);
+}
+
+bool
+AddressPlan::CanAllocateLink (uint32_t nAddresses, std::string site) const
+{
+  if (!m_aggregated)
+    {
+      return true;
+    }
+  uint32_t size = GetLinkSize (nAddresses);
+  if (site.empty ())
+    {
+      return Fits (m_core.next, m_core.end, size);
+    }
+  std::map<std::string, Block>::const_iterator it = m_sites.find (site);
+  if (it == m_sites.end ())
+    {
+      return Fits (m_eids.next, m_eids.end, GetSiteSize (size));
+    }
+  return Fits (it->second.next, it->second.end, size);
+}
+
+} // namespace ns3
@@ -0,0 +1,129 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef ADDRESS_PLAN_H
+#define ADDRESS_PLAN_H
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ns3/ipv4-address.h"
+
+namespace ns3 {
+
+/**
+ * \brief Allocation of the subnets of the links of a topology.
+ *
+ * Without aggregation, every link gets the next /24 from 10.1.1.0, as the
+ * topologies always did: a LISP site registers one /24 per link of its
+ * xTR.
+ *
+ * With aggregation, the space is split in two halves:
+ * - the core links (between routers, to the Map-Servers...) take the
+ *   smallest subnet holding their addresses from 10.0.0.0/9: a /31 for a
+ *   link of two addresses (RFC 3021), /30, /29... for more;
+ * - the EID links of a site (between its xTR and its hosts) are carved,
+ *   with the same sizes, from one block of the site in 10.128.0.0/9. The
+ *   site registers this block, whatever the number of its links, plus its
+ *   core link(s) to the router.
+ *
+ * A site block is at least a /24: the control plane identifies the
+ * EID-Prefixes by their /24 (MapServerShards, the map resolver and the
+ * RLOC redirection), so that two sites never share one. It is larger when
+ * declared with more addresses, see AddSite.
+ */
+class AddressPlan
+{
+public:
+  struct Subnet
+  {
+    Ipv4Address network;
+    Ipv4Mask mask;
+  };
+
+  /// Smallest prefix length of a site block.
+  static const uint8_t SITE_PREFIX_LENGTH = 24;
+
+  AddressPlan ();
+
+  void SetAggregated (bool aggregated);
+  bool IsAggregated (void) const;
+
+  /**
+   * \return The number of addresses of the subnet of a link of nAddresses
+   * (2 for a /31, a power of 2 otherwise, with the network and broadcast
+   * addresses).
+   */
+  static uint32_t GetLinkSize (uint32_t nAddresses);
+
+  /**
+   * \return The number of addresses that links of linkSizes (see
+   * GetLinkSize) take when allocated in this order: each link is aligned on
+   * its size, so that 2, 8 and 4 take 20 addresses rather than 14.
+   */
+  static uint32_t GetBlockSize (const std::vector<uint32_t> &linkSizes);
+
+  /**
+   * \brief Reserves the block of a site, for nAddresses at least: the
+   * GetBlockSize of its EID links, in the order they are allocated. Without
+   * aggregation, does nothing.
+   */
+  void AddSite (std::string site, uint32_t nAddresses);
+  bool HasSite (std::string site) const;
+  /// \return The block of a site, which it registers as its EID-Prefix.
+  Subnet GetSite (std::string site) const;
+  uint32_t GetNSites (void) const;
+
+  /**
+   * \return The subnet of a new link of nAddresses.
+   * \param site The site of an EID link, empty for a core link. A site not
+   * reserved with AddSite gets a /24.
+   */
+  Subnet AllocateLink (uint32_t nAddresses, std::string site = "");
+  /**
+   * \return Whether AllocateLink can allocate a link of nAddresses, rather
+   * than abort as the address plan is exhausted.
+   */
+  bool CanAllocateLink (uint32_t nAddresses, std::string site = "") const;
+
+private:
+  struct Block
+  {
+    Subnet subnet;
+    uint32_t next; ///< The first address not allocated yet.
+    uint32_t end;  ///< The address following the block.
+  };
+
+  /// \return The first address aligned on size from next.
+  static uint32_t Align (uint32_t next, uint32_t size);
+  /// \return Whether [next, end) holds size addresses aligned on size.
+  static bool Fits (uint32_t next, uint32_t end, uint32_t size);
+  /// Allocates size addresses, aligned on size, from [next, end).
+  static Subnet Allocate (uint32_t &next, uint32_t end, uint32_t size);
+  /// \return The size of the block of a site of nAddresses.
+  static uint32_t GetSiteSize (uint32_t nAddresses);
+
+  bool m_aggregated;
+  uint32_t m_nextLink; ///< The next /24, without aggregation
+  Block m_core;
+  Block m_eids;
+  std::map<std::string, Block> m_sites;
+};
+
+} // namespace ns3
+
+#endif /* ADDRESS_PLAN_H */
@@ -0,0 +1,176 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "address-pool.h"
+
+#include "ns3/assert.h"
+#include "ns3/ipv4-interface-address.h"
+#include "ns3/log.h"
+#include "address-hash.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("AddressPool");
+
+NS_OBJECT_ENSURE_REGISTERED (AddressPool);
+
+TypeId
+AddressPool::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::AddressPool")
+    .SetParent<Object> ()
+    .SetGroupName ("Addressless")
+    .AddConstructor<AddressPool> ()
+  ;
+  return tid;
+}
+
+AddressPool::AddressPool ()
+  : m_generation (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+AddressPool::~AddressPool ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+Ptr<AddressPool>
+AddressPool::GetPool (Ptr<Ipv4Interface> iface)
+{
+  NS_ASSERT (iface != 0);
+  Ptr<AddressPool> pool = iface->GetObject<AddressPool> ();
+  if (pool == 0)
+    {
+      pool = CreateObject<AddressPool> ();
+      iface->AggregateObject (pool);
+      pool->Build (iface);
+    }
+  else if (pool->m_generation != iface->GetAddressGeneration ())
+    {
+      pool->Build (iface);
+    }
+  return pool;
+}
+
+void
+AddressPool::Build (Ptr<Ipv4Interface> iface)
+{
+  NS_LOG_FUNCTION (this << iface->GetNAddresses ());
+  m_addresses.clear ();
+  m_index.clear ();
+  m_rendezvous.clear ();
+  m_generation = iface->GetAddressGeneration ();
+  std::vector<Ipv4InterfaceAddress> addresses = iface->GetAddresses ();
+  m_addresses.reserve (addresses.size ());
+  m_index.reserve (addresses.size ());
+  for (uint32_t i = 0; i < addresses.size (); i++)
+    {
+      m_addresses.push_back (addresses[i].GetLocal ());
+    }
+  for (uint32_t i = 0; i < m_addresses.size (); i++)
+    {
+      // The first position wins, as in a linear search
+      m_index.insert (std::make_pair (m_addresses[i].Get (), i));
+    }
+}
+
+uint32_t
+AddressPool::GetNAddresses (void) const
+{
+  return m_addresses.size ();
+}
+
+Ipv4Address
+AddressPool::GetAddress (uint32_t i) const
+{
+  NS_ASSERT (i < m_addresses.size ());
+  return m_addresses[i];
+}
+
+int32_t
+AddressPool::Find (Ipv4Address address) const
+{
+  std::unordered_map<uint32_t, uint32_t>::const_iterator it = m_index.find (address.Get ());
+  return it == m_index.end () ? -1 : (int32_t) it->second;
+}
+
+bool
+AddressPool::Contains (Ipv4Address address) const
+{
+  return m_index.find (address.Get ()) != m_index.end ();
+}
+
+Ipv4Address
+AddressPool::Select (Ipv4Address peer) const
+{
+  NS_ASSERT_MSG (!m_addresses.empty (), "Empty address pool");
+  return m_addresses[AddressHash::Hash32 (peer) % m_addresses.size ()];
+}
+
+Ipv4Address
+AddressPool::SelectConsistent (Ipv4Address peer)
+{
+  NS_ASSERT_MSG (!m_addresses.empty (), "Empty address pool");
+  if (m_rendezvous.empty ())
+    {
+      BuildRendezvous ();
+    }
+  return m_addresses[m_rendezvous[AddressHash::Hash32 (peer) & (RENDEZVOUS_BUCKETS - 1)]];
+}
+
+// Finalizer of MurmurHash3: the weight of an address for a bucket
+static inline uint64_t
+Mix64 (uint64_t k)
+{
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ULL;
+  k ^= k >> 33;
+  return k;
+}
+
+void
+AddressPool::BuildRendezvous (void)
+{
+  NS_LOG_FUNCTION (this << m_addresses.size ());
+  // The weights only depend on the addresses, not on their positions
+  std::vector<uint64_t> seeds;
+  seeds.reserve (m_addresses.size ());
+  for (uint32_t i = 0; i < m_addresses.size (); i++)
+    {
+      seeds.push_back ((uint64_t) AddressHash::Hash32 (m_addresses[i]) << 32);
+    }
+  m_rendezvous.assign (RENDEZVOUS_BUCKETS, 0);
+  for (uint32_t b = 0; b < RENDEZVOUS_BUCKETS; b++)
+    {
+      uint64_t best = 0;
+      for (uint32_t i = 0; i < m_addresses.size (); i++)
+        {
+          uint64_t weight = Mix64 (seeds[i] | b);
+          // Equal weights go to the highest address
+          if (i == 0 || weight > best
+              || (weight == best && m_addresses[m_rendezvous[b]] < m_addresses[i]))
+            {
+              best = weight;
+              m_rendezvous[b] = i;
+            }
+        }
+    }
+}
+
+} // namespace ns3
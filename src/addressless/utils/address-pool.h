@@ -0,0 +1,115 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef ADDRESS_POOL_H
+#define ADDRESS_POOL_H
+
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+
+#include "ns3/object.h"
+#include "ns3/ptr.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv4-interface.h"
+
+namespace ns3 {
+
+/**
+ * \brief Indexed copy of the addresses of an Ipv4Interface.
+ *
+ * Ipv4Interface keeps its addresses in a list: GetAddress (i) walks i
+ * elements, and finding an address walks them all. A server owning
+ * thousands of addresses is checked on every packet, so the privacy
+ * components read the addresses of an interface through its pool, which
+ * keeps them in a vector, in the order of the interface, with a hash
+ * index from address to position.
+ *
+ * The pool of an interface is aggregated to it, and shared by all the
+ * components using the interface (see GetPool). It is rebuilt when an
+ * address is added to or removed from the interface (see
+ * Ipv4Interface::GetAddressGeneration).
+ *
+ * Select maps a peer to the address at its hash modulo the size of the
+ * pool: when an address joins or leaves, almost every peer moves.
+ * SelectConsistent maps the peers by rendezvous hashing instead: the peers
+ * are spread on RENDEZVOUS_BUCKETS buckets, and a bucket goes to the
+ * address with the highest weight for it. An address joining a pool of N
+ * only takes about 1/(N+1) of the buckets, and an address leaving only
+ * gives away its own. The owner of each bucket is kept in a table, built
+ * on first use after each change of the pool. It is meant for the RLOC
+ * pools: a pool larger than the table leaves some addresses unused.
+ */
+class AddressPool : public Object
+{
+public:
+  /// Number of buckets of the rendezvous table (a power of 2).
+  static const uint32_t RENDEZVOUS_BUCKETS = 4096;
+
+  static TypeId GetTypeId (void);
+
+  AddressPool ();
+  virtual ~AddressPool ();
+
+  /**
+   * \return The pool of an interface, created and aggregated to it on first
+   * use.
+   */
+  static Ptr<AddressPool> GetPool (Ptr<Ipv4Interface> iface);
+
+  /**
+   * \brief Copy the addresses of an interface.
+   */
+  void Build (Ptr<Ipv4Interface> iface);
+
+  uint32_t GetNAddresses (void) const;
+  /**
+   * \return The address at a position, as Ipv4Interface::GetAddress
+   * (i).GetLocal ().
+   */
+  Ipv4Address GetAddress (uint32_t i) const;
+  /**
+   * \return The position of an address, or -1 if it is not in the pool.
+   */
+  int32_t Find (Ipv4Address address) const;
+  bool Contains (Ipv4Address address) const;
+
+  /**
+   * \return The address a peer is redirected to: the address at the
+   * position given by the hash of the peer (see AddressHash). The pool
+   * must not be empty.
+   */
+  Ipv4Address Select (Ipv4Address peer) const;
+  /**
+   * \return The address a peer is redirected to by rendezvous hashing: it
+   * only depends on the peer and the set of addresses of the pool, which
+   * must not be empty.
+   */
+  Ipv4Address SelectConsistent (Ipv4Address peer);
+
+private:
+  void BuildRendezvous (void);
+
+  std::vector<Ipv4Address> m_addresses;
+  /// The address generation of the interface when the pool was built.
+  uint32_t m_generation;
+  std::unordered_map<uint32_t, uint32_t> m_index;
+  /// Position of the owner of each bucket, empty until SelectConsistent.
+  std::vector<uint32_t> m_rendezvous;
+};
+
+} // namespace ns3
+
+#endif /* ADDRESS_POOL_H */
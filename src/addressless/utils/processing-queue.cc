@@ -0,0 +1,178 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "processing-queue.h"
+
+#include "ns3/assert.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+#include "ns3/pointer.h"
+#include "ns3/string.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("ProcessingQueue");
+
+NS_OBJECT_ENSURE_REGISTERED (ProcessingQueue);
+
+TypeId
+ProcessingQueue::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ProcessingQueue")
+    .SetParent<Object> ()
+    .SetGroupName ("Addressless")
+    .AddConstructor<ProcessingQueue> ()
+    .AddAttribute ("Workers",
+                   "Number of jobs served at a time (cores of the device).",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&ProcessingQueue::SetWorkers,
+                                         &ProcessingQueue::GetWorkers),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("ServiceTime",
+                   "Service time of the jobs submitted without one (s).",
+                   StringValue ("ns3::ConstantRandomVariable[Constant=0.00004]"),
+                   MakePointerAccessor (&ProcessingQueue::m_serviceTime),
+                   MakePointerChecker<RandomVariableStream> ())
+    .AddTraceSource ("QueueLength",
+                     "Number of jobs waiting for a worker.",
+                     MakeTraceSourceAccessor (&ProcessingQueue::m_nWaiting),
+                     "ns3::TracedValueCallback::Uint32")
+    .AddTraceSource ("BusyWorkers",
+                     "Number of jobs being served.",
+                     MakeTraceSourceAccessor (&ProcessingQueue::m_nBusy),
+                     "ns3::TracedValueCallback::Uint32")
+    .AddTraceSource ("WaitingTime",
+                     "A job starts its service, after waiting for a worker.",
+                     MakeTraceSourceAccessor (&ProcessingQueue::m_waitingTrace),
+                     "ns3::ProcessingQueue::WaitingTimeCallback")
+  ;
+  return tid;
+}
+
+ProcessingQueue::ProcessingQueue ()
+  : m_workers (1),
+    m_nextId (0),
+    m_nWaiting (0),
+    m_nBusy (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+ProcessingQueue::~ProcessingQueue ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+ProcessingQueue::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  for (std::map<uint64_t, EventId>::iterator it = m_inService.begin (); it != m_inService.end (); ++it)
+    {
+      it->second.Cancel ();
+    }
+  m_inService.clear ();
+  m_waiting.clear ();
+  m_serviceTime = 0;
+  Object::DoDispose ();
+}
+
+uint32_t
+ProcessingQueue::GetWorkers (void) const
+{
+  return m_workers;
+}
+
+void
+ProcessingQueue::SetWorkers (uint32_t workers)
+{
+  NS_LOG_FUNCTION (this << workers);
+  NS_ASSERT (workers > 0);
+  m_workers = workers;
+  // New workers take the waiting jobs at once
+  while (m_nBusy < m_workers && !m_waiting.empty ())
+    {
+      Job job = m_waiting.front ();
+      m_waiting.pop_front ();
+      m_nWaiting = m_waiting.size ();
+      Serve (job);
+    }
+}
+
+uint32_t
+ProcessingQueue::GetNWaiting (void) const
+{
+  return m_nWaiting;
+}
+
+uint32_t
+ProcessingQueue::GetNBusy (void) const
+{
+  return m_nBusy;
+}
+
+void
+ProcessingQueue::Submit (EventImpl *job)
+{
+  Submit (job, Seconds (m_serviceTime->GetValue ()));
+}
+
+void
+ProcessingQueue::Submit (EventImpl *job, Time service)
+{
+  NS_LOG_FUNCTION (this << service);
+  Job j;
+  j.event = Ptr<EventImpl> (job, false);
+  j.service = service;
+  j.arrival = Simulator::Now ();
+  if (m_nBusy < m_workers)
+    {
+      Serve (j);
+    }
+  else
+    {
+      m_waiting.push_back (j);
+      m_nWaiting = m_waiting.size ();
+    }
+}
+
+void
+ProcessingQueue::Serve (Job job)
+{
+  m_nBusy = m_nBusy + 1;
+  m_waitingTrace (Simulator::Now () - job.arrival, job.service);
+  uint64_t id = m_nextId++;
+  m_inService[id] = Simulator::Schedule (job.service, &ProcessingQueue::Done, this, job.event, id);
+}
+
+void
+ProcessingQueue::Done (Ptr<EventImpl> event, uint64_t id)
+{
+  NS_LOG_FUNCTION (this);
+  m_inService.erase (id);
+  m_nBusy = m_nBusy - 1;
+  // The worker is free before the job's event runs, which may submit again
+  if (!m_waiting.empty () && m_nBusy < m_workers)
+    {
+      Job next = m_waiting.front ();
+      m_waiting.pop_front ();
+      m_nWaiting = m_waiting.size ();
+      Serve (next);
+    }
+  event->Invoke ();
+}
+
+} // namespace ns3
@@ -0,0 +1,109 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef PROCESSING_QUEUE_H
+#define PROCESSING_QUEUE_H
+
+#include <stdint.h>
+#include <deque>
+#include <map>
+
+#include "ns3/object.h"
+#include "ns3/ptr.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/event-impl.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/traced-value.h"
+#include "ns3/traced-callback.h"
+
+namespace ns3 {
+
+/**
+ * \brief FIFO queue of jobs served by a pool of workers: the processing
+ * delay of a device (hashing, address checks) under load.
+ *
+ * A job is an event (see MakeEvent) with a service time, drawn from the
+ * ServiceTime attribute unless given with the job. When a worker is free,
+ * it serves the oldest waiting job, and the event runs when its service
+ * ends. With one worker, a job waits for all the jobs submitted before it;
+ * with k workers, k jobs are served at a time.
+ *
+ * The queue traces the number of waiting jobs, the number of busy workers
+ * and the waiting time of each job, from which the number of workers a
+ * device needs for a given load can be found.
+ */
+class ProcessingQueue : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  ProcessingQueue ();
+  virtual ~ProcessingQueue ();
+
+  /**
+   * \brief Submit a job whose service time is drawn from ServiceTime.
+   * \param job The event run at the end of the service; the queue takes
+   * ownership of it, as Simulator::Schedule does.
+   */
+  void Submit (EventImpl *job);
+  /**
+   * \brief Submit a job with its own service time.
+   */
+  void Submit (EventImpl *job, Time service);
+
+  uint32_t GetWorkers (void) const;
+  void SetWorkers (uint32_t workers);
+  /// \return The number of jobs waiting for a worker.
+  uint32_t GetNWaiting (void) const;
+  /// \return The number of jobs being served.
+  uint32_t GetNBusy (void) const;
+
+  /**
+   * TracedCallback signature for the waiting time of a job.
+   * \param [in] waiting The time the job waited for a worker.
+   * \param [in] service The service time of the job.
+   */
+  typedef void (* WaitingTimeCallback)(Time waiting, Time service);
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  struct Job
+  {
+    Ptr<EventImpl> event;
+    Time service;
+    Time arrival;
+  };
+
+  void Serve (Job job);
+  void Done (Ptr<EventImpl> event, uint64_t id);
+
+  uint32_t m_workers;
+  Ptr<RandomVariableStream> m_serviceTime;
+  std::deque<Job> m_waiting;
+  /// Completion events of the jobs in service, to cancel them on dispose.
+  std::map<uint64_t, EventId> m_inService;
+  uint64_t m_nextId;
+
+  TracedValue<uint32_t> m_nWaiting;
+  TracedValue<uint32_t> m_nBusy;
+  TracedCallback<Time, Time> m_waitingTrace;
+};
+
+} // namespace ns3
+
+#endif /* PROCESSING_QUEUE_H */
@@ -0,0 +1,91 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "results-sink.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("ResultsSink");
+
+ResultsSink::ResultsSink ()
+  : m_bufferSize (DEFAULT_BUFFER_SIZE)
+{
+}
+
+ResultsSink::~ResultsSink ()
+{
+  Close ();
+}
+
+void
+ResultsSink::Open (std::string filename, uint32_t bufferSize)
+{
+  NS_LOG_FUNCTION (this << filename << bufferSize);
+  Close ();
+  m_file.open (filename.c_str (), std::ofstream::out | std::ofstream::app);
+  NS_ABORT_MSG_IF (!m_file, "Cannot open " << filename);
+  m_filename = filename;
+  m_bufferSize = bufferSize;
+  m_buffer.reserve (bufferSize);
+}
+
+void
+ResultsSink::Close (void)
+{
+  if (m_file.is_open ())
+    {
+      NS_LOG_FUNCTION (this);
+      Flush ();
+      m_file.close ();
+    }
+}
+
+bool
+ResultsSink::IsOpen (void) const
+{
+  return m_file.is_open ();
+}
+
+void
+ResultsSink::Write (const nlohmann::json &record)
+{
+  if (!m_file.is_open ())
+    {
+      return;
+    }
+  m_buffer += record.dump ();
+  m_buffer += '\n';
+  if (m_buffer.size () >= m_bufferSize)
+    {
+      Flush ();
+    }
+}
+
+void
+ResultsSink::Flush (void)
+{
+  if (!m_buffer.empty ())
+    {
+      m_file.write (m_buffer.data (), m_buffer.size ());
+      m_file.flush ();
+      NS_ABORT_MSG_IF (!m_file, "Cannot write " << m_filename);
+      m_buffer.clear ();
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,75 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef RESULTS_SINK_H
+#define RESULTS_SINK_H
+
+#include <stdint.h>
+#include <fstream>
+#include <string>
+
+#include "ns3/json.hpp"
+
+namespace ns3 {
+
+/**
+ * \brief Append-only file of the measurements of a simulation, in JSON
+ * Lines: one json object per line.
+ *
+ * The measurements are written as they are made, through a buffer of at
+ * most BufferSize bytes, instead of being kept in memory until the end of
+ * the run. A run is a header record, with the parameters of the run, the
+ * measurement records, then a trailer record telling whether all the
+ * clients completed their connections. Several runs can be appended to the
+ * same file; scratch/addressless_results.py converts the runs into the
+ * json trees read by the plotting scripts.
+ *
+ * A record is written only if the sink is open: without a file, the
+ * measurements are dropped.
+ */
+class ResultsSink
+{
+public:
+  /// Default size of the buffer, in bytes.
+  static const uint32_t DEFAULT_BUFFER_SIZE = 64 * 1024;
+
+  ResultsSink ();
+  ~ResultsSink ();
+
+  /**
+   * \brief Opens a file, appended to if it exists.
+   * \param bufferSize The records are written to the file when the buffer
+   * holds at least this number of bytes (0: every record).
+   */
+  void Open (std::string filename, uint32_t bufferSize = DEFAULT_BUFFER_SIZE);
+  /// Writes the buffer and closes the file.
+  void Close (void);
+  bool IsOpen (void) const;
+
+  /// Writes a record, a json object, on its own line.
+  void Write (const nlohmann::json &record);
+  /// Writes the buffer to the file.
+  void Flush (void);
+
+private:
+  std::ofstream m_file;
+  std::string m_filename;
+  std::string m_buffer;
+  uint32_t m_bufferSize;
+};
+
+} // namespace ns3
+
+#endif /* RESULTS_SINK_H */
@@ -83,6 +83,11 @@ Ipv4AddressHelper::SetBase (
 //
   m_shift = NumAddressBits (m_mask);
   m_max = (1 << m_shift) - 2;
+  if (m_shift == 1)
+    {
+      // Both addresses of a /31 are hosts (RFC 3021)
+      m_max = 1;
+    }
 
   NS_ASSERT_MSG (m_shift <= 32,
                  "Ipv4AddressHelper::SetBase(): Unreasonable address length");
@@ -18,19 +18,55 @@
  * Author: Lionel Agbodjan <lionel.agbodjan@gmail.com>
  */
 #include "ddt-node-helper.h"
+#include "ns3/ddt-node.h"
+#include "ns3/names.h"
 
 namespace ns3
 {
 
-  DdtNodeHelper::DdtNodeHelper ()
-  {
-    // TODO Auto-generated constructor stub
+DdtNodeHelper::DdtNodeHelper ()
+{
+  m_factory.SetTypeId (DdtNode::GetTypeId ());
+}
+
+DdtNodeHelper::~DdtNodeHelper ()
+{
+}
 
-  }
+void DdtNodeHelper::SetAttribute (std::string name, const AttributeValue &value)
+{
+  m_factory.Set (name, value);
+}
+
+ApplicationContainer
+DdtNodeHelper::Install (Ptr<Node> node) const
+{
+  return ApplicationContainer (InstallPriv (node));
+}
 
-  DdtNodeHelper::~DdtNodeHelper ()
-  {
-    // TODO Auto-generated destructor stub
-  }
+ApplicationContainer
+DdtNodeHelper::Install (std::string nodeName) const
+{
+  Ptr<Node> node = Names::Find<Node> (nodeName);
+  return ApplicationContainer (InstallPriv (node));
+}
+
+ApplicationContainer
+DdtNodeHelper::Install (NodeContainer c) const
+{
+  ApplicationContainer apps;
+  for (NodeContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+    {
+      apps.Add (InstallPriv (*i));
+    }
+  return apps;
+}
+
+Ptr<Application> DdtNodeHelper::InstallPriv (Ptr<Node> node) const
+{
+  Ptr<DdtNode> app = m_factory.Create<DdtNode> ();
+  node->AddApplication (app);
+  return app;
+}
 
 } /* namespace ns3 */
@@ -20,16 +20,73 @@
 #ifndef SRC_INTERNET_HELPER_LISP_HELPER_DDT_NODE_HELPER_H_
 #define SRC_INTERNET_HELPER_LISP_HELPER_DDT_NODE_HELPER_H_
 
+#include "ns3/application-container.h"
+#include "ns3/node-container.h"
+#include "ns3/object-factory.h"
+
 namespace ns3
 {
 
-  class DdtNodeHelper
-  {
-  public:
-    DdtNodeHelper ();
-    virtual
-    ~DdtNodeHelper ();
-  };
+/**
+ * \brief Install DdtNode applications.
+ *
+ * The delegations of each DDT node are configured on the application
+ * returned by Install (), see DdtNode::AddNodeDelegation () and
+ * DdtNode::AddMapServerDelegation ().
+ */
+class DdtNodeHelper
+{
+public:
+  DdtNodeHelper ();
+  virtual
+  ~DdtNodeHelper ();
+
+  /**
+   * Record an attribute to be set in each Application after it is is created.
+   *
+   * \param name the name of the attribute to set
+   * \param value the value of the attribute to set
+   */
+  void
+  SetAttribute (std::string name, const AttributeValue &value);
+
+  /**
+   * Create a DdtNode on the specified Node.
+   *
+   * \param node The node on which to create the Application.
+   *
+   * \returns An ApplicationContainer holding the Application created.
+   */
+  ApplicationContainer
+  Install (Ptr<Node> node) const;
+
+  /**
+   * Create a DdtNode on the specified Node.
+   *
+   * \param nodeName The node on which to create the application.  The node
+   *                 is specified by a node name previously registered with
+   *                 the Object Name Service.
+   *
+   * \returns An ApplicationContainer holding the Application created.
+   */
+  ApplicationContainer
+  Install (std::string nodeName) const;
+
+  /**
+   * Create one DdtNode on each of the Nodes in the NodeContainer.
+   *
+   * \param c The nodes on which to create the Applications.
+   *
+   * \returns The applications created, one Application per Node in the
+   *          NodeContainer.
+   */
+  ApplicationContainer
+  Install (NodeContainer c) const;
+
+private:
+  Ptr<Application> InstallPriv (Ptr<Node> node) const;
+  ObjectFactory m_factory; //!<Object factory
+};
 
 } /* namespace ns3 */
 
@@ -89,6 +89,7 @@ Ptr<Application> LispEtrItrAppHelper::InstallPriv (Ptr<Node> node) const
   NS_LOG_DEBUG("xTR address set to simple map table:"<<lisp->GetMapTablesV4()->GetxTRApp()<<" It should be:"<<app);
   lisp->GetMapTablesV6()->SetxTRApp(app);
   app->SetMapServerAddresses (m_mapServerAddresses);
+  app->SetMapServerShards (m_mapServerShards);
   node->AddApplication (app);
   return app;
 }
@@ -98,6 +99,11 @@ void LispEtrItrAppHelper::AddMapServerAddress (Address mapServerAddress)
   m_mapServerAddresses.push_front (mapServerAddress);
 }
 
+void LispEtrItrAppHelper::SetMapServerShards (Ptr<MapServerShards> mapServerShards)
+{
+  m_mapServerShards = mapServerShards;
+}
+
 void LispEtrItrAppHelper::AddMapResolverRlocs (Ptr<Locator> locator)
 {
   m_mapResolverRlocs.push_back (locator);
@@ -84,6 +84,11 @@ public:
     Install (NodeContainer c) const;
 
     void AddMapServerAddress (Address mapServerAddress);
+    /**
+     * \brief Register the EID-Prefixes with the Map-Servers of a pool,
+     * see MapServerShards.
+     */
+    void SetMapServerShards (Ptr<MapServerShards> mapServerShards);
 
     void AddMapResolverRlocs (Ptr<Locator> locator);
     void SetMapResolverRlocs (std::list<Ptr<Locator> > locator);
@@ -100,6 +105,7 @@ public:
   std::list<Ptr<Locator> > m_mapResolverRlocs;
   Address m_eidServer;
   std::list<Address> m_mapServerAddresses;
+  Ptr<MapServerShards> m_mapServerShards;
   ObjectFactory m_factory; //!<Object factory
 };
 
@@ -37,6 +37,7 @@ namespace ns3
 
   LispHelper::LispHelper(void)
   {
+    m_mapTablesFactory.SetTypeId("ns3::SimpleMapTables");
   }
 
   LispHelper::~LispHelper()
@@ -106,8 +107,8 @@ namespace ns3
      * which will lead to segmentation fault for packet copy-forwarding.
      * We make sure once lispOverIpv4 is created, mapTables are always accessible.
      */
-    Ptr<MapTables> mapTablesv4 = Create<SimpleMapTables>();
-    Ptr<MapTables> mapTablesv6 = Create<SimpleMapTables>();
+    Ptr<MapTables> mapTablesv4 = CreateMapTables();
+    Ptr<MapTables> mapTablesv6 = CreateMapTables();
     lisp->SetMapTablesIpv4(mapTablesv4);
     lisp->SetMapTablesIpv6(mapTablesv6);
     /**
@@ -339,8 +340,8 @@ namespace ns3
       }
 
       // Create MapTables
-      Ptr<SimpleMapTables> ipv4MapTables = Create<SimpleMapTables>();
-      Ptr<SimpleMapTables> ipv6MapTables = Create<SimpleMapTables>();
+      Ptr<MapTables> ipv4MapTables = CreateMapTables();
+      Ptr<MapTables> ipv6MapTables = CreateMapTables();
       int eidIpv4Rlocs = 0;
       int eidIpv6Rlocs = 0;
       // insert ipv4 eid map entries
@@ -575,8 +576,8 @@ namespace ns3
                 vect[1].c_str()));
           }
           // creating mapTables
-          Ptr<SimpleMapTables> ipv4MapTables = Create<SimpleMapTables>();
-          Ptr<SimpleMapTables> ipv6MapTables = Create<SimpleMapTables>();
+          Ptr<MapTables> ipv4MapTables = CreateMapTables();
+          Ptr<MapTables> ipv6MapTables = CreateMapTables();
           // start encoding one ENTRY
           while (std::getline(configFile, str))
           {
@@ -683,6 +684,21 @@ namespace ns3
     }
   }
 
+  void LispHelper::SetMapTablesType(std::string typeId)
+  {
+    m_mapTablesFactory.SetTypeId(typeId);
+  }
+
+  void LispHelper::SetMapTablesAttribute(std::string name, const AttributeValue &value)
+  {
+    m_mapTablesFactory.Set(name, value);
+  }
+
+  Ptr<MapTables> LispHelper::CreateMapTables(void) const
+  {
+    return m_mapTablesFactory.Create<MapTables>();
+  }
+
   void LispHelper::SetMapTablesForEtr(Address etrRloc, Ptr<MapTables> ipv4MapTables, Ptr<MapTables> ipv6MapTables)
   {
     m_mapTablesIpv4.insert(std::pair<Address, Ptr<MapTables>>(etrRloc, ipv4MapTables));
@@ -15,6 +15,7 @@
 #include "ns3/node-container.h"
 #include "ns3/ptr.h"
 #include "ns3/internet-stack-helper.h"
+#include "ns3/object-factory.h"
 #include "ns3/map-tables.h"
 #include "ns3/lisp-protocol.h"
 #include <set>
@@ -43,6 +44,22 @@ public:
   void Install (Ptr<Node> node) const;
   void Install (NodeContainer c) const;
   void InstallAll (void) const;
+  /**
+   * \brief Set the MapTables implementation used for the database and the
+   * cache of the xTRs built by this helper.
+   * \param typeId The TypeId of a MapTables subclass, e.g.
+   * "ns3::SimpleMapTables" (default) or "ns3::TrieMapTables".
+   */
+  void SetMapTablesType (std::string typeId);
+  /**
+   * \brief Set an attribute of the MapTables created by this helper, e.g.
+   * "CacheCapacity".
+   */
+  void SetMapTablesAttribute (std::string name, const AttributeValue &value);
+  /**
+   * \return A new, empty MapTables of the type chosen with SetMapTablesType.
+   */
+  Ptr<MapTables> CreateMapTables (void) const;
 
 protected:
   void CreateAndAggregateLispVersion (Ptr<Node> node, const std::string typeId) const;
@@ -57,6 +74,7 @@ protected:
   std::vector<uint32_t> m_pitrs; //!< Vector containing identifier of all PETRs nodes
   std::vector<uint32_t> m_petrs; //!< Vector containing identifier of all PITRs nodes
   std::vector<uint32_t> m_rtrs; //!< Vector containing identifier of all RTRs nodes
+  ObjectFactory m_mapTablesFactory; //!< Creates the MapTables of the xTRs
 
 };
 
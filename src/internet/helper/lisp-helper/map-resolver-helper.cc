@@ -73,6 +73,11 @@ Ptr<Application> MapResolverDdtHelper::InstallPriv (Ptr<Node> node) const
   NS_ASSERT_MSG(lisp!=0, "a MR must have one LispOverIp object! It is a lisp-speaking device!");
   Ptr<MapResolverDdt> app = m_factory.Create<MapResolverDdt> ();
   app->SetMapServerAddress (m_mapServerAddress);
+  app->SetMapServerShards (m_mapServerShards);
+  if (!m_ddtRootRlocs.empty ())
+    {
+      app->SetDdtRootRlocs (m_ddtRootRlocs);
+    }
   node->AddApplication (app);
   return app;
 }
@@ -92,4 +97,9 @@ void MapResolverDdtHelper::SetMapServerAddress (Address mapServerAddress)
   m_mapServerAddress = mapServerAddress;
 }
 
+void MapResolverDdtHelper::SetMapServerShards (Ptr<MapServerShards> mapServerShards)
+{
+  m_mapServerShards = mapServerShards;
+}
+
 } /* namespace ns3 */
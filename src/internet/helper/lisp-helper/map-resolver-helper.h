@@ -25,6 +25,7 @@
 #include "ns3/node-container.h"
 #include "ns3/object-factory.h"
 #include "ns3/lisp-protocol.h"
+#include "ns3/map-server-shards.h"
 
 namespace ns3
 {
@@ -85,6 +86,11 @@ public:
     void SetDdtRootRlocs (std::list<Ptr<Locator> > locators);
 
     void SetMapServerAddress (Address mapServerAddress);
+    /**
+     * \brief Forward the Map-Requests to the Map-Servers of a pool, see
+     * MapServerShards.
+     */
+    void SetMapServerShards (Ptr<MapServerShards> mapServerShards);
 
 private:
   /**
@@ -96,6 +102,7 @@ private:
    */
   Ptr<Application> InstallPriv (Ptr<Node> node) const;
   Address m_mapServerAddress;
+  Ptr<MapServerShards> m_mapServerShards;
   std::list<Ptr<Locator> > m_ddtRootRlocs;
   ObjectFactory m_factory; //!<Object factory
 };
@@ -0,0 +1,49 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "flow-hash.h"
+
+#include "ns3/packet.h"
+#include "ipv4-header.h"
+
+namespace ns3 {
+
+uint32_t
+FlowHash::ReadPorts (Ptr<const Packet> packet, uint32_t offset, uint8_t protocol, bool fragment)
+{
+  uint8_t buf[64 + 4];
+  if (packet == 0 || fragment || (protocol != 6 && protocol != 17)
+      || offset + 4 > sizeof (buf) || packet->GetSize () < offset + 4)
+    {
+      return 0;
+    }
+  packet->CopyData (buf, offset + 4);
+  return (buf[offset] << 24) | (buf[offset + 1] << 16) | (buf[offset + 2] << 8) | buf[offset + 3];
+}
+
+uint32_t
+FlowHash::HashIpv4 (uint32_t seed, Ptr<const Packet> packet, uint32_t offset, const Ipv4Header &header)
+{
+  uint8_t protocol = header.GetProtocol ();
+  bool fragment = header.GetFragmentOffset () != 0 || !header.IsLastFragment ();
+  uint32_t hash = seed;
+  hash = Mix (hash, header.GetSource ().Get ());
+  hash = Mix (hash, header.GetDestination ().Get ());
+  hash = Mix (hash, protocol);
+  hash = Mix (hash, ReadPorts (packet, offset, protocol, fragment));
+  return hash;
+}
+
+} // namespace ns3
@@ -0,0 +1,83 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef FLOW_HASH_H
+#define FLOW_HASH_H
+
+#include <stdint.h>
+
+#include "ns3/ptr.h"
+
+namespace ns3 {
+
+class Packet;
+class Ipv4Header;
+
+/**
+ * \ingroup internet
+ * \brief Hash of the 5-tuple of a flow.
+ *
+ * Shared by the flow ECMP of Ipv4GlobalRouting and by the LISP data plane
+ * (outer UDP source port, RLOC selection), so that they all see the same
+ * flows. Each user salts the hash with its own seed.
+ */
+class FlowHash
+{
+public:
+  /**
+   * \brief Mix a 32-bit word in a hash, with the Murmur3 finalizer: every
+   * input bit spreads to all the output bits (flow hashes are used modulo
+   * small table sizes).
+   */
+  static uint32_t Mix (uint32_t hash, uint32_t word)
+  {
+    hash ^= word;
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35;
+    hash ^= hash >> 16;
+    return hash;
+  }
+
+  /**
+   * \brief Read the ports of a TCP or UDP segment.
+   *
+   * TCP and UDP both start with the source and destination ports. The ports
+   * are not read from fragments, so that all the fragments of a packet hash
+   * the same.
+   *
+   * \param packet the packet (may be 0)
+   * \param offset the offset of the transport header in packet (up to 64)
+   * \param protocol the IP protocol number of the transport header
+   * \param fragment whether the packet is an IP fragment
+   * \return the source and destination ports, 0 if there are none
+   */
+  static uint32_t ReadPorts (Ptr<const Packet> packet, uint32_t offset, uint8_t protocol, bool fragment);
+
+  /**
+   * \brief Hash the 5-tuple of an IPv4 packet.
+   * \param seed the salt of the hash
+   * \param packet the packet (may be 0)
+   * \param offset the offset of the transport header in packet
+   * \param header the IPv4 header of the packet
+   * \return the flow hash
+   */
+  static uint32_t HashIpv4 (uint32_t seed, Ptr<const Packet> packet, uint32_t offset, const Ipv4Header &header);
+};
+
+} // namespace ns3
+
+#endif /* FLOW_HASH_H */
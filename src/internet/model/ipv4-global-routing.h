@@ -234,6 +234,8 @@ protected:
 private:
   /// Set to true if packets are randomly routed among ECMP; set to false for using only one route consistently
   bool m_randomEcmpRouting;
+  /// Set to true if packets are routed among ECMP according to the hash of their 5-tuple
+  bool m_flowEcmpRouting;
   /// Set to true if this interface should respond to interface events by globallly recomputing routes 
   bool m_respondToInterfaceEvents;
   /// A uniform random number generator for randomly routing packets among ECMP 
@@ -263,10 +265,23 @@ private:
   /**
    * \brief Lookup in the forwarding table for destination.
    * \param dest destination address
+   * \param flowHash hash of the flow of the packet, used by flow ECMP
    * \param oif output interface if any (put 0 otherwise)
    * \return Ipv4Route to route the packet to reach dest address
    */
-  Ptr<Ipv4Route> LookupGlobal (Ipv4Address dest, Ptr<NetDevice> oif = 0);
+  Ptr<Ipv4Route> LookupGlobal (Ipv4Address dest, uint32_t flowHash, Ptr<NetDevice> oif = 0);
+
+  /**
+   * \brief Hash the 5-tuple of a packet for flow ECMP.
+   *
+   * The hash is salted with the node id, so that consecutive ECMP routers
+   * do not all split the flows the same way.
+   *
+   * \param p the packet, without its IP header (may be 0)
+   * \param header the IP header of the packet
+   * \return the flow hash
+   */
+  uint32_t GetFlowHash (Ptr<const Packet> p, const Ipv4Header &header) const;
 
   HostRoutes m_hostRoutes;             //!< Routes to hosts
   NetworkRoutes m_networkRoutes;       //!< Routes to networks
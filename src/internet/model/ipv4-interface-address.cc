@@ -41,6 +41,11 @@ Ipv4InterfaceAddress::Ipv4InterfaceAddress (Ipv4Address local, Ipv4Mask mask)
   m_local = local;
   m_mask = mask;
   m_broadcast = Ipv4Address (local.Get () | (~mask.Get ()));
+  if (mask.GetPrefixLength () == 31)
+    {
+      // A /31 has no subnet directed broadcast (RFC 3021)
+      m_broadcast = Ipv4Address::GetBroadcast ();
+    }
 }
 
 Ipv4InterfaceAddress::Ipv4InterfaceAddress (const Ipv4InterfaceAddress &o)
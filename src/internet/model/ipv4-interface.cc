@@ -64,6 +64,7 @@ Ipv4Interface::Ipv4Interface ()
   : m_ifup (false),
     m_forwarding (true),
     m_metric (1),
+    m_addressGeneration (0),
     m_node (0), 
     m_device (0),
     m_tc (0),
@@ -305,11 +306,26 @@ Ipv4Interface::GetNAddresses (void) const
   return m_ifaddrs.size ();
 }
 
+std::vector<Ipv4InterfaceAddress>
+Ipv4Interface::GetAddresses (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return std::vector<Ipv4InterfaceAddress> (m_ifaddrs.begin (), m_ifaddrs.end ());
+}
+
+uint32_t
+Ipv4Interface::GetAddressGeneration (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_addressGeneration;
+}
+
 bool
 Ipv4Interface::AddAddress (Ipv4InterfaceAddress addr)
 {
   NS_LOG_FUNCTION (this << addr);
   m_ifaddrs.push_back (addr);
+  ++m_addressGeneration;
   return true;
 }
 
@@ -353,6 +369,7 @@ Ipv4Interface::RemoveAddress (uint32_t index)
         {
           Ipv4InterfaceAddress addr = *i;
           m_ifaddrs.erase (i);
+          ++m_addressGeneration;
           return addr;
         }
       ++tmp;
@@ -380,6 +397,7 @@ Ipv4Interface::RemoveAddress(Ipv4Address address)
         {
           Ipv4InterfaceAddress ifAddr = *it;
           m_ifaddrs.erase(it);
+          ++m_addressGeneration;
           return ifAddr;
         }
     }
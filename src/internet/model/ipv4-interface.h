@@ -23,6 +23,7 @@
 #define IPV4_INTERFACE_H
 
 #include <list>
+#include <vector>
 #include "ns3/ptr.h"
 #include "ns3/object.h"
 
@@ -173,6 +174,18 @@ public:
    */
   uint32_t GetNAddresses (void) const;
 
+  /**
+   * \returns All the Ipv4InterfaceAddress of this interface, in the order of
+   * their index (walking the addresses with GetAddress is quadratic)
+   */
+  std::vector<Ipv4InterfaceAddress> GetAddresses (void) const;
+
+  /**
+   * \returns A counter incremented each time an address is added or
+   * removed: copies of the addresses are stale when it changes
+   */
+  uint32_t GetAddressGeneration (void) const;
+
   /**
    * \param index Index of Ipv4InterfaceAddress to remove
    * \returns The Ipv4InterfaceAddress address whose index is index 
@@ -235,6 +248,7 @@ private:
   bool m_forwarding;  //!< Forwarding state.
   uint16_t m_metric;  //!< Interface metric
   Ipv4InterfaceAddressList m_ifaddrs; //!< Address list
+  uint32_t m_addressGeneration; //!< Changes of the address list
   Ptr<Node> m_node; //!< The associated node
   Ptr<NetDevice> m_device; //!< The associated NetDevice
   Ptr<TrafficControlLayer> m_tc; //!< The associated TrafficControlLayer
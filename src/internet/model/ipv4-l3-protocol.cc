@@ -42,6 +42,7 @@
 #include "ipv4-interface.h"
 #include "ipv4-raw-socket-impl.h"
 #include "ipv4-netfilter.h"
+#include "udp-l4-protocol.h"
 
 #include "ns3/simple-map-tables.h" //to support LISP&LISP-MN
 #include "ns3/lisp-over-ipv4.h"    //to support LISP&LISP-MN
@@ -56,6 +57,25 @@ namespace ns3
 
   NS_OBJECT_ENSURE_REGISTERED(Ipv4L3Protocol);
 
+  /*
+   * The LISP data plane remembers the source RLOC selected for each
+   * destination RLOC: it depends on the outgoing interface, so it must be
+   * selected again after interface and address events.
+   */
+  static void
+  InvalidateLispSourceRlocs(Ptr<Node> node)
+  {
+    if (node == 0)
+    {
+      return;
+    }
+    Ptr<LispOverIpv4> lisp = node->GetObject<LispOverIpv4>();
+    if (lisp != 0)
+    {
+      lisp->InvalidateSourceRlocs();
+    }
+  }
+
   TypeId
   Ipv4L3Protocol::GetTypeId(void)
   {
@@ -277,6 +297,7 @@ namespace ns3
     NS_LOG_FUNCTION(this << routingProtocol);
     m_routingProtocol = routingProtocol;
     m_routingProtocol->SetIpv4(this);
+    InvalidateLispSourceRlocs(m_node);
   }
 
   Ptr<Ipv4RoutingProtocol>
@@ -912,14 +933,13 @@ namespace ns3
          *    Own MapRegister messages musn't be encapsulated.
          */
 
-        /* Check if this is a MapRegister message */
-        Ptr<Packet> packetCopy = packet->Copy();
-        UdpHeader udpHeader;
-        packetCopy->RemoveHeader(udpHeader);
-
-        uint8_t buf[packetCopy->GetSize()];
-        packetCopy->CopyData(buf, packetCopy->GetSize());
-        uint8_t msg_type = (buf[0] >> 4);
+        /* Check if this is a MapRegister message (data packets are not
+           on the LISP control port and skip the classification) */
+        uint8_t msg_type = 0;
+        if (protocol == UdpL4Protocol::PROT_NUMBER)
+        {
+          msg_type = LispOverIp::PeekControlMsgType(packet);
+        }
         if (msg_type == static_cast<uint8_t>(MapRegisterMsg::GetMsgType()))
         {
           if (lispOverIpv4->IsNated())
@@ -1660,7 +1680,7 @@ namespace ns3
         NS_LOG_DEBUG("LISP devices receives an ECM encapsulated control message");
 
         /* Differenciation between MapRegister and SMR */
-        if (lisp->IsMapRegister(p->Copy()))
+        if (lisp->IsMapRegister(p))
         {
           NS_LOG_DEBUG("ECM encapsulated message is MapRegister");
           /* If device is RTR, set new entry in cache and in database to
@@ -1691,7 +1711,6 @@ namespace ns3
          * Therefore, MS will send a classic MapNotify to RTR, and RTR will detect
          * HERE, and encapsulate it in a DataMapNotify to send back to NATed device.
          */
-        Ptr<Packet> lispPacket = p->Copy();
         Ptr<MapEntry> mapEntry;
         if (lisp->IsRtr() && lisp->IsMapNotifyForNatedXtr(p, ip, mapEntry))
         {
@@ -1720,6 +1739,7 @@ namespace ns3
           NS_LOG_DEBUG("This is a MapRequest msg for NATed device");
 
           ipHeader.SetDestination(Ipv4Address::ConvertFrom(mapEntry->GetXtrLloc()->GetRlocAddress()));
+          Ptr<Packet> lispPacket = p->Copy();
           lispPacket->AddHeader(ipHeader); // lispHeader is a copy of the the packet
 
           Receive(lisp->m_currentDevice,
@@ -1803,6 +1823,7 @@ namespace ns3
     {
       m_routingProtocol->NotifyAddAddress(i, address);
     }
+    InvalidateLispSourceRlocs(m_node);
     return retVal;
   }
 
@@ -1834,6 +1855,7 @@ namespace ns3
       {
         m_routingProtocol->NotifyRemoveAddress(i, address);
       }
+      InvalidateLispSourceRlocs(m_node);
       return true;
     }
     return false;
@@ -1856,6 +1878,7 @@ namespace ns3
       {
         m_routingProtocol->NotifyRemoveAddress(i, ifAddr);
       }
+      InvalidateLispSourceRlocs(m_node);
       return true;
     }
     return false;
@@ -1998,6 +2021,7 @@ namespace ns3
       {
         m_routingProtocol->NotifyInterfaceUp(i);
       }
+      InvalidateLispSourceRlocs(m_node);
     }
     else
     {
@@ -2016,6 +2040,7 @@ namespace ns3
     {
       m_routingProtocol->NotifyInterfaceDown(ifaceIndex);
     }
+    InvalidateLispSourceRlocs(m_node);
   }
 
   bool
@@ -19,6 +19,8 @@
  */
 #include "ns3/log.h"
 #include "ns3/uinteger.h"
+#include "ns3/nstime.h"
+#include "ns3/simulator.h"
 #include "ipv4-netfilter.h"
 
 #include "ip-conntrack-info.h"
@@ -42,31 +44,46 @@ NS_LOG_COMPONENT_DEFINE("Ipv4Nat");
 namespace ns3
 {
 
-  Ipv4NetfilterHook natCallback1;
-  Ipv4NetfilterHook natCallback2;
-
   NS_OBJECT_ENSURE_REGISTERED(Ipv4Nat);
 
   TypeId
   Ipv4Nat::GetTypeId(void)
   {
     static TypeId tId = TypeId("ns3::Ipv4Nat")
-                            .SetParent<Object>();
+                            .SetParent<Object>()
+                            .AddAttribute("TcpIdleTimeout",
+                                          "Time after which an unused TCP translation expires (0: never).",
+                                          TimeValue(Seconds(7440)),
+                                          MakeTimeAccessor(&Ipv4Nat::m_tcpIdleTimeout),
+                                          MakeTimeChecker())
+                            .AddAttribute("UdpIdleTimeout",
+                                          "Time after which an unused UDP translation expires (0: never).",
+                                          TimeValue(Seconds(120)),
+                                          MakeTimeAccessor(&Ipv4Nat::m_udpIdleTimeout),
+                                          MakeTimeChecker());
 
     return tId;
   }
 
   Ipv4Nat::Ipv4Nat()
       : m_insideInterface(-1),
-        m_outsideInterface(-1)
+        m_outsideInterface(-1),
+        m_startport(0),
+        m_endport(0)
   {
     NS_LOG_FUNCTION(this);
+    m_nextPort[0] = m_nextPort[1] = 0;
 
     NetfilterHookCallback doNatPreRouting = MakeCallback(&Ipv4Nat::DoNatPreRouting, this);
     NetfilterHookCallback doNatPostRouting = MakeCallback(&Ipv4Nat::DoNatPostRouting, this);
 
-    natCallback1 = Ipv4NetfilterHook(1, NF_INET_POST_ROUTING, NF_IP_PRI_NAT_SRC, doNatPostRouting);
-    natCallback2 = Ipv4NetfilterHook(1, NF_INET_PRE_ROUTING, NF_IP_PRI_NAT_DST, doNatPreRouting);
+    m_postRoutingHook = Ipv4NetfilterHook(1, NF_INET_POST_ROUTING, NF_IP_PRI_NAT_SRC, doNatPostRouting);
+    m_preRoutingHook = Ipv4NetfilterHook(1, NF_INET_PRE_ROUTING, NF_IP_PRI_NAT_DST, doNatPreRouting);
+  }
+
+  Ipv4Nat::~Ipv4Nat()
+  {
+    NS_LOG_FUNCTION(this);
   }
 
   /*
@@ -93,14 +110,32 @@ namespace ns3
           m_ipv4 = ipv4;
           // Set callbacks on netfilter pointer
 
-          netfilter->RegisterHook(natCallback1);
-          netfilter->RegisterHook(natCallback2);
+          netfilter->RegisterHook(m_postRoutingHook);
+          netfilter->RegisterHook(m_preRoutingHook);
         }
       }
     }
     Object::NotifyNewAggregate();
   }
 
+  uint64_t
+  Ipv4Nat::StaticKey(Ipv4Address address, uint8_t protocol, uint16_t port)
+  {
+    return ((uint64_t)address.Get() << 32) | ((uint64_t)protocol << 16) | port;
+  }
+
+  uint64_t
+  Ipv4Nat::LocalKey(Ipv4Address address, uint8_t protocol, uint16_t port)
+  {
+    return StaticKey(address, protocol, port);
+  }
+
+  uint32_t
+  Ipv4Nat::GlobalKey(uint8_t protocol, uint16_t port)
+  {
+    return ((uint32_t)protocol << 16) | port;
+  }
+
   uint32_t
   Ipv4Nat::GetNStaticRules(void) const
   {
@@ -112,56 +147,32 @@ namespace ns3
   Ipv4Nat::GetStaticRule(uint32_t index) const
   {
     NS_LOG_FUNCTION(this << index);
-    uint32_t tmp = 0;
-    for (StaticNatRules::const_iterator i = m_statictable.begin();
-         i != m_statictable.end();
-         i++)
-    {
-      if (tmp == index)
-      {
-        return *i;
-      }
-      tmp++;
-    }
-    NS_ASSERT(false);
-
-    return Ipv4StaticNatRule(Ipv4Address(), Ipv4Address());
+    NS_ASSERT(index < m_statictable.size());
+    return m_statictable[m_statictable.size() - 1 - index];
   }
 
   Ipv4DynamicNatRule
   Ipv4Nat::GetDynamicRule(uint32_t index) const
   {
     NS_LOG_FUNCTION(this << index);
-    uint32_t tmp = 0;
-    for (DynamicNatRules::const_iterator i = m_dynamictable.begin();
-         i != m_dynamictable.end();
-         i++)
-    {
-      if (tmp == index)
-      {
-        return *i;
-      }
-      tmp++;
-    }
-    NS_ASSERT(false);
-
-    return Ipv4DynamicNatRule(Ipv4Address(), Ipv4Mask());
+    NS_ASSERT(index < m_dynamictable.size());
+    return m_dynamictable[m_dynamictable.size() - 1 - index];
   }
 
   Ipv4DynamicNatTuple
   Ipv4Nat::GetDynamicTuple(uint32_t index) const
   {
     NS_LOG_FUNCTION(this << index);
-    uint32_t tmp = 0;
-    for (DynamicNatTuple::const_iterator i = m_dynatuple.begin();
-         i != m_dynatuple.end();
-         i++)
+    const TupleList *lists[2] = {&m_tcpTuples, &m_udpTuples};
+    for (uint32_t l = 0; l < 2; l++)
     {
-      if (tmp == index)
+      if (index < lists[l]->size())
       {
-        return *i;
+        TupleList::const_iterator i = lists[l]->begin();
+        std::advance(i, index);
+        return i->tuple;
       }
-      tmp++;
+      index -= lists[l]->size();
     }
     NS_ASSERT(false);
 
@@ -179,7 +190,7 @@ namespace ns3
   Ipv4Nat::GetNDynamicTuples(void) const
   {
     NS_LOG_FUNCTION(this);
-    return m_dynatuple.size();
+    return m_tuplesByLocal.size();
   }
 
   void
@@ -187,36 +198,103 @@ namespace ns3
   {
 
     NS_LOG_FUNCTION(this << index);
-    NS_ASSERT(index < m_statictable.size());
-    uint32_t tmp = 0;
-    for (StaticNatRules::iterator i = m_statictable.begin();
-         i != m_statictable.end(); i++, tmp++)
+    NS_ASSERT_MSG(index < m_statictable.size(), "Rule Not Found");
+    m_statictable.erase(m_statictable.begin() + (m_statictable.size() - 1 - index));
+    IndexStaticRules();
+  }
+
+  void
+  Ipv4Nat::RemoveDynamicRule(uint32_t index)
+  {
+    NS_LOG_FUNCTION(this << index);
+    NS_ASSERT_MSG(index < m_dynamictable.size(), "Rule Not Found");
+    m_dynamictable.erase(m_dynamictable.begin() + (m_dynamictable.size() - 1 - index));
+  }
+
+  void
+  Ipv4Nat::IndexStaticRules()
+  {
+    m_staticIn.clear();
+    m_staticOut.clear();
+    for (uint32_t i = 0; i < m_statictable.size(); i++)
+    {
+      IndexStaticRule(i);
+    }
+  }
+
+  void
+  Ipv4Nat::IndexStaticRule(uint32_t position)
+  {
+    // A later rule hides the earlier ones with the same keys
+    const Ipv4StaticNatRule &rule = m_statictable[position];
+    m_staticOut[rule.GetLocalIp().Get()] = position;
+    if (rule.GetGlobalPort() == 0)
+    {
+      m_staticIn[StaticKey(rule.GetGlobalIp(), 0, 0)] = position;
+    }
+    else
     {
-      if (tmp == index)
+      if (rule.GetProtocol() == 0 || rule.GetProtocol() == MY_IPPROTO_TCP)
+      {
+        m_staticIn[StaticKey(rule.GetGlobalIp(), MY_IPPROTO_TCP, rule.GetGlobalPort())] = position;
+      }
+      if (rule.GetProtocol() == 0 || rule.GetProtocol() == MY_IPPROTO_UDP)
       {
-        m_statictable.erase(i);
-        return;
+        m_staticIn[StaticKey(rule.GetGlobalIp(), MY_IPPROTO_UDP, rule.GetGlobalPort())] = position;
       }
     }
-    NS_ASSERT_MSG(false, "Rule Not Found");
+  }
+
+  Ipv4Nat::TupleList &
+  Ipv4Nat::GetTupleList(uint8_t protocol)
+  {
+    return protocol == MY_IPPROTO_TCP ? m_tcpTuples : m_udpTuples;
+  }
+
+  Time
+  Ipv4Nat::GetIdleTimeout(uint8_t protocol) const
+  {
+    return protocol == MY_IPPROTO_TCP ? m_tcpIdleTimeout : m_udpIdleTimeout;
   }
 
   void
-  Ipv4Nat::RemoveDynamicRule(uint32_t index)
+  Ipv4Nat::RefreshTuple(TupleList::iterator it)
   {
-    NS_LOG_FUNCTION(this << index);
-    NS_ASSERT(index < m_dynamictable.size());
-    uint32_t tmp = 0;
-    for (DynamicNatRules::iterator i = m_dynamictable.begin();
-         i != m_dynamictable.end(); i++, tmp++)
+    TupleList &list = GetTupleList(it->tuple.GetProtocol());
+    it->expires = Simulator::Now() + GetIdleTimeout(it->tuple.GetProtocol());
+    // Iterators stay valid through splice, so the indexes do not change
+    list.splice(list.begin(), list, it);
+  }
+
+  void
+  Ipv4Nat::ExpireTuples()
+  {
+    TupleList *lists[2] = {&m_tcpTuples, &m_udpTuples};
+    Time timeouts[2] = {m_tcpIdleTimeout, m_udpIdleTimeout};
+    for (uint32_t l = 0; l < 2; l++)
     {
-      if (tmp == index)
+      if (timeouts[l].IsZero())
       {
-        m_dynamictable.erase(i);
-        return;
+        continue;
+      }
+      // The least recently used tuples are at the back
+      while (!lists[l]->empty() && lists[l]->back().expires <= Simulator::Now())
+      {
+        NS_LOG_DEBUG("Translation of " << lists[l]->back().tuple.GetLocalAddress() << ":"
+                                       << lists[l]->back().tuple.GetLocalPort() << " expired");
+        RemoveTuple(--lists[l]->end());
       }
     }
-    NS_ASSERT_MSG(false, "Rule Not Found");
+  }
+
+  void
+  Ipv4Nat::RemoveTuple(TupleList::iterator it)
+  {
+    const Ipv4DynamicNatTuple &tuple = it->tuple;
+    m_tuplesByLocal.erase(LocalKey(tuple.GetLocalAddress(), tuple.GetProtocol(), tuple.GetLocalPort()));
+    m_tuplesByGlobal.erase(GlobalKey(tuple.GetProtocol(), tuple.GetGlobalPort()));
+    ReleasePort(tuple.GetProtocol(), tuple.GetGlobalPort());
+    GetTupleList(tuple.GetProtocol()).erase(it);
   }
 
   /**
@@ -293,24 +371,28 @@ namespace ns3
       *os << std::endl;
       *os << "       Current Dynamic Translations" << std::endl;
       *os << "Local IP             Global IP           Local port            Global Port" << std::endl;
-      for (uint32_t i = 0; i < GetNDynamicTuples(); i++)
+      const TupleList *lists[2] = {&m_tcpTuples, &m_udpTuples};
+      for (uint32_t l = 0; l < 2; l++)
       {
-        std::ostringstream locip, gloip, locprt, gloprt;
-        Ipv4DynamicNatTuple tup = GetDynamicTuple(i);
+        for (TupleList::const_iterator i = lists[l]->begin(); i != lists[l]->end(); i++)
+        {
+          std::ostringstream locip, gloip, locprt, gloprt;
+          const Ipv4DynamicNatTuple &tup = i->tuple;
 
-        locip << tup.GetLocalAddress();
-        *os << std::setiosflags(std::ios::left) << std::setw(16) << locip.str();
+          locip << tup.GetLocalAddress();
+          *os << std::setiosflags(std::ios::left) << std::setw(16) << locip.str();
 
-        gloip << tup.GetGlobalAddress();
-        *os << std::setiosflags(std::ios::left) << std::setw(16) << gloip.str();
+          gloip << tup.GetGlobalAddress();
+          *os << std::setiosflags(std::ios::left) << std::setw(16) << gloip.str();
 
-        locprt << tup.GetLocalPort();
-        *os << std::setiosflags(std::ios::left) << std::setw(16) << locprt.str();
+          locprt << tup.GetLocalPort();
+          *os << std::setiosflags(std::ios::left) << std::setw(16) << locprt.str();
 
-        gloprt << tup.GetGlobalPort();
-        *os << std::setiosflags(std::ios::left) << std::setw(16) << gloprt.str();
+          gloprt << tup.GetGlobalPort();
+          *os << std::setiosflags(std::ios::left) << std::setw(16) << gloprt.str();
 
-        *os << std::endl;
+          *os << std::endl;
+        }
       }
 
       *os << std::endl;
@@ -333,110 +415,110 @@ namespace ns3
     NS_LOG_DEBUG("Input device " << m_ipv4->GetInterfaceForDevice(in) << " inside interface " << m_insideInterface);
     NS_LOG_DEBUG("Output device " << m_ipv4->GetInterfaceForDevice(out) << " outside interface " << m_outsideInterface);
     p->RemoveHeader(ipHeader);
-    
+
     if (m_ipv4->GetInterfaceForDevice(in) == m_outsideInterface)
     {
       // outside interface is the input interface, we NAT the destination addr
       // so that the NAT does not try to locally deliver the packet
       NS_LOG_DEBUG("PREROUTING: evaluating packet with src " << ipHeader.GetSource() << " dst " << ipHeader.GetDestination());
       Ipv4Address destAddress = ipHeader.GetDestination();
+      uint8_t protocol = ipHeader.GetProtocol();
+      bool hasPorts = protocol == MY_IPPROTO_TCP || protocol == MY_IPPROTO_UDP;
+      uint16_t destPort = 0;
+      if (protocol == MY_IPPROTO_TCP)
+      {
+        TcpHeader tcpHeader;
+        p->PeekHeader(tcpHeader);
+        destPort = tcpHeader.GetDestinationPort();
+      }
+      else if (protocol == MY_IPPROTO_UDP)
+      {
+        UdpHeader udpHeader;
+        p->PeekHeader(udpHeader);
+        destPort = udpHeader.GetDestinationPort();
+      }
+      ExpireTuples();
 
       /*----------------------------------
         Checking for Static NAT Rules
         ----------------------------------*/
 
-      for (StaticNatRules::const_iterator i = m_statictable.begin();
-           i != m_statictable.end(); i++)
+      // The last rule added among the non-port-specific rule of the
+      // address and the port-specific rule of the port
+      int64_t position = -1;
+      std::unordered_map<uint64_t, uint32_t>::const_iterator i = m_staticIn.find(StaticKey(destAddress, 0, 0));
+      if (i != m_staticIn.end())
       {
-        NS_LOG_DEBUG("Static NAT rule");
-        if (destAddress != (*i).GetGlobalIp())
+        position = i->second;
+      }
+      if (hasPorts)
+      {
+        i = m_staticIn.find(StaticKey(destAddress, protocol, destPort));
+        if (i != m_staticIn.end() && (int64_t)i->second > position)
         {
-          NS_LOG_DEBUG("Skipping rule with global IP " << (*i).GetGlobalIp());
-          continue;
+          position = i->second;
         }
-        if ((*i).GetGlobalPort() == 0)
+      }
+      if (position >= 0)
+      {
+        const Ipv4StaticNatRule &rule = m_statictable[position];
+        if (rule.GetGlobalPort() == 0)
         {
           NS_LOG_DEBUG("Rule match with a non-port-specific rule");
           // TODO: Make something fancier here???
-          ipHeader.SetDestination((*i).GetLocalIp());
+          ipHeader.SetDestination(rule.GetLocalIp());
           p->AddHeader(ipHeader);
           return NF_ACCEPT;
         }
+        NS_LOG_DEBUG("Rule match with local port " << rule.GetLocalPort() << " global port " << rule.GetGlobalPort());
+        if (protocol == MY_IPPROTO_TCP)
+        {
+          TcpHeader tcpHeader;
+          p->RemoveHeader(tcpHeader);
+          tcpHeader.SetDestinationPort(rule.GetLocalPort());
+          p->AddHeader(tcpHeader);
+        }
         else
         {
-          NS_LOG_DEBUG("evaluating rule with local port " << (*i).GetLocalPort() << " global port " << (*i).GetGlobalPort());
-
-          if (ipHeader.GetProtocol() == MY_IPPROTO_TCP && (((*i).GetProtocol() == MY_IPPROTO_TCP) || (*i).GetProtocol() == 0))
-          {
-            TcpHeader tcpHeader;
-            p->RemoveHeader(tcpHeader);
-            if (tcpHeader.GetDestinationPort() == (*i).GetGlobalPort())
-            {
-              tcpHeader.SetDestinationPort((*i).GetLocalPort());
-              p->AddHeader(tcpHeader);
-              ipHeader.SetDestination((*i).GetLocalIp());
-              p->AddHeader(ipHeader);
-              return NF_ACCEPT;
-            }
-            p->AddHeader(tcpHeader);
-          }
-          else if (ipHeader.GetProtocol() == MY_IPPROTO_UDP && (((*i).GetProtocol() == MY_IPPROTO_UDP) || (*i).GetProtocol() == 0))
-          {
-            UdpHeader udpHeader;
-            p->RemoveHeader(udpHeader);
-            if (udpHeader.GetDestinationPort() == (*i).GetGlobalPort())
-            {
-              udpHeader.SetDestinationPort((*i).GetLocalPort());
-              p->AddHeader(udpHeader);
-              ipHeader.SetDestination((*i).GetLocalIp());
-              p->AddHeader(ipHeader);
-              return NF_ACCEPT;
-            }
-            p->AddHeader(udpHeader);
-          }
+          UdpHeader udpHeader;
+          p->RemoveHeader(udpHeader);
+          udpHeader.SetDestinationPort(rule.GetLocalPort());
+          p->AddHeader(udpHeader);
         }
+        ipHeader.SetDestination(rule.GetLocalIp());
+        p->AddHeader(ipHeader);
+        return NF_ACCEPT;
       }
 
       /*----------------------------------
         Checking for Dynamix NAT Rules
         ----------------------------------*/
-      if (destAddress == GetAddressPoolIp())
+      if (destAddress == GetAddressPoolIp() && hasPorts)
       {
-        NS_LOG_DEBUG("Packet targeted for NATed prefix");
+        NS_LOG_DEBUG("Packet targeted for NATed prefix, port " << destPort);
         // Checking if ongoing connection
-        for (DynamicNatTuple::const_iterator i = m_dynatuple.begin();
-             i != m_dynatuple.end(); i++)
+        std::unordered_map<uint32_t, TupleList::iterator>::iterator t = m_tuplesByGlobal.find(GlobalKey(protocol, destPort));
+        if (t != m_tuplesByGlobal.end())
         {
-          NS_LOG_DEBUG("Global port of rule: " << (*i).GetGlobalPort());
-          if (ipHeader.GetProtocol() == MY_IPPROTO_TCP)
+          const Ipv4DynamicNatTuple &tuple = t->second->tuple;
+          ipHeader.SetDestination(tuple.GetLocalAddress());
+          if (protocol == MY_IPPROTO_TCP)
           {
             TcpHeader tcpHeader;
             p->RemoveHeader(tcpHeader);
-            if (tcpHeader.GetDestinationPort() == (*i).GetGlobalPort()) // Rule MATCH
-            {
-              ipHeader.SetDestination((*i).GetLocalAddress());
-              tcpHeader.SetDestinationPort((*i).GetLocalPort());
-              p->AddHeader(tcpHeader);
-              p->AddHeader(ipHeader);
-              return NF_ACCEPT;
-            }
+            tcpHeader.SetDestinationPort(tuple.GetLocalPort());
             p->AddHeader(tcpHeader);
           }
-          if (ipHeader.GetProtocol() == MY_IPPROTO_UDP)
+          else
           {
             UdpHeader udpHeader;
             p->RemoveHeader(udpHeader);
-            NS_LOG_DEBUG("Port in udp header: " << udpHeader.GetDestinationPort());
-            if (udpHeader.GetDestinationPort() == (*i).GetGlobalPort()) // Rule MATCH
-            {
-              ipHeader.SetDestination((*i).GetLocalAddress());
-              udpHeader.SetDestinationPort((*i).GetLocalPort());
-              p->AddHeader(udpHeader);
-              p->AddHeader(ipHeader);
-              return NF_ACCEPT;
-            }
+            udpHeader.SetDestinationPort(tuple.GetLocalPort());
             p->AddHeader(udpHeader);
           }
+          p->AddHeader(ipHeader);
+          RefreshTuple(t->second);
+          return NF_ACCEPT;
         }
       }
 
@@ -475,140 +557,132 @@ namespace ns3
       // address and port
       NS_LOG_DEBUG("POSTROUTING: evaluating packet with src " << ipHeader.GetSource() << " dst " << ipHeader.GetDestination());
       Ipv4Address srcAddress = ipHeader.GetSource();
+      uint8_t protocol = ipHeader.GetProtocol();
+      bool hasPorts = protocol == MY_IPPROTO_TCP || protocol == MY_IPPROTO_UDP;
       // Checking for Static NAT Rules
-      for (StaticNatRules::const_iterator i = m_statictable.begin();
-           i != m_statictable.end(); i++)
+      std::unordered_map<uint32_t, uint32_t>::const_iterator i = m_staticOut.find(srcAddress.Get());
+      if (i != m_staticOut.end())
       {
-        
-        if (srcAddress != (*i).GetLocalIp())
-        {
-          NS_LOG_DEBUG("Skipping rule with local IP " << (*i).GetLocalIp());
-          continue;
-        }
-        if ((*i).GetLocalPort() == 0)
+        const Ipv4StaticNatRule &rule = m_statictable[i->second];
+        if (rule.GetLocalPort() == 0)
         {
           NS_LOG_DEBUG("Rule match with a non-port-specific rule");
-          ipHeader.SetSource((*i).GetGlobalIp());
+          ipHeader.SetSource(rule.GetGlobalIp());
           p->AddHeader(ipHeader);
           return NF_ACCEPT;
         }
-        else
+        NS_LOG_DEBUG("Evaluating rule with local port " << rule.GetLocalPort() << " global port " << rule.GetGlobalPort());
+        if (protocol == MY_IPPROTO_TCP && (rule.GetProtocol() == MY_IPPROTO_TCP || rule.GetProtocol() == 0))
         {
-          NS_LOG_DEBUG("Evaluating rule with local port " << (*i).GetLocalPort() << " global port " << (*i).GetGlobalPort());
-          if (ipHeader.GetProtocol() == MY_IPPROTO_TCP && (((*i).GetProtocol() == MY_IPPROTO_TCP) || (*i).GetProtocol() == 0))
+          TcpHeader tcpHeader;
+          p->RemoveHeader(tcpHeader);
+          if (tcpHeader.GetSourcePort() == rule.GetLocalPort())
           {
-            TcpHeader tcpHeader;
-            p->RemoveHeader(tcpHeader);
-            if (tcpHeader.GetSourcePort() == (*i).GetLocalPort())
-            {
-              tcpHeader.SetSourcePort((*i).GetGlobalPort());
-            }
-            p->AddHeader(tcpHeader);
+            tcpHeader.SetSourcePort(rule.GetGlobalPort());
           }
-          else if (ipHeader.GetProtocol() == MY_IPPROTO_UDP && (((*i).GetProtocol() == MY_IPPROTO_UDP) || (*i).GetProtocol() == 0))
+          p->AddHeader(tcpHeader);
+        }
+        else if (protocol == MY_IPPROTO_UDP && (rule.GetProtocol() == MY_IPPROTO_UDP || rule.GetProtocol() == 0))
+        {
+          UdpHeader udpHeader;
+          p->RemoveHeader(udpHeader);
+          if (udpHeader.GetSourcePort() == rule.GetLocalPort())
           {
-            UdpHeader udpHeader;
-            p->RemoveHeader(udpHeader);
-            if (udpHeader.GetSourcePort() == (*i).GetLocalPort())
-            {
-              udpHeader.SetSourcePort((*i).GetGlobalPort());
-            }
-            p->AddHeader(udpHeader);
+            udpHeader.SetSourcePort(rule.GetGlobalPort());
           }
-          NS_LOG_DEBUG("Rule match with a port-specific rule");
-          ipHeader.SetSource((*i).GetGlobalIp());
-          p->AddHeader(ipHeader);
-          return NF_ACCEPT;
+          p->AddHeader(udpHeader);
         }
+        NS_LOG_DEBUG("Rule match with a port-specific rule");
+        ipHeader.SetSource(rule.GetGlobalIp());
+        p->AddHeader(ipHeader);
+        return NF_ACCEPT;
       }
 
-      // Checking for Dynamic NAT Rules
+      // Checking for Dynamic NAT Rules, which only translate TCP and UDP
+      if (!hasPorts)
+      {
+        p->AddHeader(ipHeader);
+        return NF_ACCEPT;
+      }
+      TcpHeader tcpHeader;
+      UdpHeader udpHeader;
+      uint16_t srcPort;
+      if (protocol == MY_IPPROTO_TCP)
+      {
+        p->RemoveHeader(tcpHeader);
+        srcPort = tcpHeader.GetSourcePort();
+      }
+      else
+      {
+        p->RemoveHeader(udpHeader);
+        srcPort = udpHeader.GetSourcePort();
+      }
+      ExpireTuples();
 
       // Checking for existing connection
-      for (DynamicNatTuple::const_iterator i = m_dynatuple.begin();
-           i != m_dynatuple.end(); i++)
+      std::unordered_map<uint64_t, TupleList::iterator>::iterator t = m_tuplesByLocal.find(LocalKey(srcAddress, protocol, srcPort));
+      Ipv4Address globalAddress;
+      uint16_t globalPort = 0;
+      if (t != m_tuplesByLocal.end())
       {
-        if (srcAddress == (*i).GetLocalAddress())
+        globalAddress = t->second->tuple.GetGlobalAddress();
+        globalPort = t->second->tuple.GetGlobalPort();
+        RefreshTuple(t->second);
+      }
+      else
+      {
+        // This is for the new connections: the last rule added first
+        for (DynamicNatRules::const_reverse_iterator r = m_dynamictable.rbegin();
+             r != m_dynamictable.rend(); r++)
         {
-          if (ipHeader.GetProtocol() == MY_IPPROTO_TCP)
+          // Source address belong to the network mask that must be translated by NAT
+          if ((*r).GetLocalNet().CombineMask((*r).GetLocalMask()) == srcAddress.CombineMask((*r).GetLocalMask()))
           {
-            TcpHeader tcpHeader;
-            p->RemoveHeader(tcpHeader);
-            if (tcpHeader.GetSourcePort() == (*i).GetLocalPort())
+            NS_LOG_DEBUG("New stream through NAT");
+            globalPort = AllocatePort(protocol);
+            if (globalPort == 0)
             {
-              ipHeader.SetSource((*i).GetGlobalAddress());
-              tcpHeader.SetSourcePort((*i).GetGlobalPort());
-              p->AddHeader(tcpHeader);
+              NS_LOG_WARN("NAT port pool exhausted, dropping packet from " << srcAddress << ":" << srcPort);
+              if (protocol == MY_IPPROTO_TCP)
+              {
+                p->AddHeader(tcpHeader);
+              }
+              else
+              {
+                p->AddHeader(udpHeader);
+              }
               p->AddHeader(ipHeader);
-              return NF_ACCEPT;
+              return NF_DROP;
             }
-            p->AddHeader(tcpHeader);
-          }
-          else
-          {
-            UdpHeader udpHeader;
-            p->RemoveHeader(udpHeader);
-            if (udpHeader.GetSourcePort() == (*i).GetLocalPort())
-            {
-              ipHeader.SetSource((*i).GetGlobalAddress());
-              udpHeader.SetSourcePort((*i).GetGlobalPort());
-              p->AddHeader(udpHeader);
-              p->AddHeader(ipHeader);
-              return NF_ACCEPT;
-            }
-            p->AddHeader(udpHeader);
+            globalAddress = GetAddressPoolIp();
+            TupleEntry entry = {Ipv4DynamicNatTuple(srcAddress, globalAddress, srcPort, globalPort, protocol),
+                                Simulator::Now() + GetIdleTimeout(protocol)};
+            TupleList &list = GetTupleList(protocol);
+            list.push_front(entry);
+            m_tuplesByLocal[LocalKey(srcAddress, protocol, srcPort)] = list.begin();
+            m_tuplesByGlobal[GlobalKey(protocol, globalPort)] = list.begin();
+            break;
           }
         }
       }
 
-      // This is for the new connections
-      for (DynamicNatRules::const_iterator i = m_dynamictable.begin();
-           i != m_dynamictable.end(); i++)
+      if (globalPort != 0)
       {
-        NS_LOG_DEBUG("New stream through NAT");
-        // Source address belong to the network mask that must be translated by NAT
-        if ((*i).GetLocalNet().CombineMask((*i).GetLocalMask()) == srcAddress.CombineMask((*i).GetLocalMask()))
-        {
-          ipHeader.SetSource(GetAddressPoolIp());
-
-          if (ipHeader.GetProtocol() == MY_IPPROTO_TCP)
-
-          {
-            NS_LOG_DEBUG("Changing TCP port");
-            TcpHeader tcpHeader;
-            p->RemoveHeader(tcpHeader);
-
-            Ipv4DynamicNatTuple natuple(srcAddress,
-                                        GetAddressPoolIp(),
-                                        tcpHeader.GetSourcePort(),
-                                        GetNewOutsidePort());
-
-            tcpHeader.SetSourcePort(GetCurrentPort());
-
-            p->AddHeader(tcpHeader);
-            m_dynatuple.push_front(natuple);
-          }
-          else
-          {
-            NS_LOG_DEBUG("Changing UDP port");
-            UdpHeader udpHeader;
-            p->RemoveHeader(udpHeader);
-
-            Ipv4DynamicNatTuple natuple(srcAddress,
-                                        GetAddressPoolIp(),
-                                        udpHeader.GetSourcePort(),
-                                        GetNewOutsidePort());
-
-            udpHeader.SetSourcePort(GetCurrentPort());
-
-            p->AddHeader(udpHeader);
-            m_dynatuple.push_front(natuple);
-          }
-
-          p->AddHeader(ipHeader);
-          return NF_ACCEPT;
-        }
+        NS_LOG_DEBUG("Translating " << srcAddress << ":" << srcPort << " to " << globalAddress << ":" << globalPort);
+        ipHeader.SetSource(globalAddress);
+        tcpHeader.SetSourcePort(globalPort);
+        udpHeader.SetSourcePort(globalPort);
       }
+      if (protocol == MY_IPPROTO_TCP)
+      {
+        p->AddHeader(tcpHeader);
+      }
+      else
+      {
+        p->AddHeader(udpHeader);
+      }
+      p->AddHeader(ipHeader);
+      return NF_ACCEPT;
     }
 
     /* No match with any rule to go out -> Leave packet unmodified and accept it */
@@ -641,9 +715,15 @@ namespace ns3
   Ipv4Nat::AddPortPool(uint16_t strtprt, uint16_t endprt) // port range
   {
     NS_LOG_FUNCTION(this << strtprt << endprt);
+    NS_ASSERT_MSG(strtprt > 0 && strtprt <= endprt, "Invalid port pool");
+    NS_ASSERT_MSG(m_tuplesByLocal.empty(), "The port pool changes while ports are in use");
     m_startport = strtprt;
     m_endport = endprt;
-    m_currentPort = strtprt - 1;
+    for (uint32_t i = 0; i < 2; i++)
+    {
+      m_portBitmap[i].assign((endprt - strtprt + 1 + 63) / 64, 0);
+      m_nextPort[i] = 0;
+    }
   }
 
   uint16_t
@@ -659,25 +739,48 @@ namespace ns3
   }
 
   uint16_t
-  Ipv4Nat::GetCurrentPort() const
-  {
-    return m_currentPort;
-  }
-
-  uint16_t
-  Ipv4Nat::GetNewOutsidePort()
+  Ipv4Nat::AllocatePort(uint8_t protocol)
   {
-    for (int i = m_startport - 1; i <= m_endport; i++)
+    std::vector<uint64_t> &bitmap = m_portBitmap[protocol == MY_IPPROTO_TCP ? 0 : 1];
+    uint32_t &nextPort = m_nextPort[protocol == MY_IPPROTO_TCP ? 0 : 1];
+    if (bitmap.empty())
+    {
+      return 0;
+    }
+    // Next fit: the ports are used in turn, so that a released port is not
+    // reused at once. A word of the bitmap is checked at a time.
+    uint32_t size = m_endport - m_startport + 1;
+    uint32_t words = bitmap.size();
+    uint32_t word = nextPort / 64;
+    uint64_t mask = ~0ULL << (nextPort % 64);
+    for (uint32_t n = 0; n <= words; n++)
     {
-      if (m_currentPort == i)
+      uint64_t free = ~bitmap[word] & mask;
+      if (word == words - 1 && size % 64)
+      {
+        free &= (1ULL << (size % 64)) - 1;
+      }
+      if (free)
       {
-        m_currentPort++;
-        return m_currentPort;
+        uint32_t offset = word * 64 + __builtin_ctzll(free);
+        bitmap[word] |= 1ULL << (offset % 64);
+        nextPort = (offset + 1) % size;
+        return m_startport + offset;
       }
+      word = (word + 1) % words;
+      mask = ~0ULL;
     }
     return 0;
   }
 
+  void
+  Ipv4Nat::ReleasePort(uint8_t protocol, uint16_t port)
+  {
+    NS_ASSERT(port >= m_startport && port <= m_endport);
+    uint32_t offset = port - m_startport;
+    m_portBitmap[protocol == MY_IPPROTO_TCP ? 0 : 1][offset / 64] &= ~(1ULL << (offset % 64));
+  }
+
   void
   Ipv4Nat::SetInside(int32_t interfaceIndex)
   {
@@ -697,14 +800,15 @@ namespace ns3
   Ipv4Nat::AddDynamicRule(const Ipv4DynamicNatRule &rule)
   {
     NS_LOG_FUNCTION(this);
-    m_dynamictable.push_front(rule);
+    m_dynamictable.push_back(rule);
   }
 
   void
   Ipv4Nat::AddStaticRule(const Ipv4StaticNatRule &rule)
   {
     NS_LOG_FUNCTION(this);
-    m_statictable.push_front(rule);
+    m_statictable.push_back(rule);
+    IndexStaticRule(m_statictable.size() - 1);
     NS_LOG_DEBUG("list has " << m_statictable.size() << " elements after pushing");
     NS_ASSERT_MSG(m_ipv4, "Forgot to aggregate Ipv4Nat to Node");
     if (m_ipv4->GetInterfaceForAddress(rule.GetGlobalIp()) != -1)
@@ -790,13 +894,15 @@ namespace ns3
     return m_localmask;
   }
 
-  Ipv4DynamicNatTuple::Ipv4DynamicNatTuple(Ipv4Address local, Ipv4Address global, uint16_t localport, uint16_t globalport)
+  Ipv4DynamicNatTuple::Ipv4DynamicNatTuple(Ipv4Address local, Ipv4Address global, uint16_t localport, uint16_t globalport,
+                                           uint8_t protocol)
   {
-    NS_LOG_FUNCTION(this << local << global << localport << globalport);
+    NS_LOG_FUNCTION(this << local << global << localport << globalport << (uint32_t)protocol);
     m_localip = local;
     m_globalip = global;
     m_localport = localport;
     m_globalport = globalport;
+    m_protocol = protocol;
   }
 
   Ipv4Address
@@ -823,4 +929,10 @@ namespace ns3
     return m_localport;
   }
 
+  uint8_t
+  Ipv4DynamicNatTuple::GetProtocol() const
+  {
+    return m_protocol;
+  }
+
 }
@@ -23,11 +23,15 @@
 #include <stdint.h>
 #include <limits.h>
 #include <sys/socket.h>
+#include <list>
+#include <vector>
+#include <unordered_map>
 #include "ns3/ptr.h"
 #include "ns3/net-device.h"
 #include "ns3/packet.h"
 #include "ns3/ipv4-header.h"
 #include "ns3/object.h"
+#include "ns3/nstime.h"
 #include "ipv4-netfilter.h"
 #include "ipv4-netfilter-hook.h"
 #include "netfilter-callback-chain.h"
@@ -158,8 +162,10 @@ public:
   *\param local The local host ip that is translated
   *\param global The global ip that the host has been translated to
   *\param port The source port that the local host has translated to
+  *\param protocol The protocol of the connection (TCP or UDP)
   */
-  Ipv4DynamicNatTuple (Ipv4Address local, Ipv4Address global, uint16_t localport, uint16_t globalport);
+  Ipv4DynamicNatTuple (Ipv4Address local, Ipv4Address global, uint16_t localport, uint16_t globalport,
+                       uint8_t protocol = 0);
 
 /**
   *\return The local host Ipv4Address
@@ -181,11 +187,17 @@ public:
   */
   uint16_t GetLocalPort () const;
 
+/**
+  *\return The protocol of the connection
+  */
+  uint8_t GetProtocol () const;
+
 private:
   Ipv4Address m_localip;
   Ipv4Address m_globalip;
   uint16_t m_localport;
   uint16_t m_globalport;
+  uint8_t m_protocol;
 };
 
 /**
@@ -193,6 +205,18 @@ private:
   *
   * This implements NAT functionality over a Netfilter framework.
   * The NAT is of two major types (static and dynamic).
+  *
+  * The rules and the translations are hash-indexed, so that the cost of a
+  * packet does not grow with their number. The static rules are indexed by
+  * global address, protocol and port for the incoming packets, and by local
+  * address for the outgoing ones; as in a linear search, the last rule
+  * added wins. The dynamic translations (tuples) are endpoint-independent:
+  * they are indexed by protocol, local address and local port for the
+  * outgoing packets, and by protocol and global port for the incoming ones.
+  * A tuple expires when it has not been used in either direction for the
+  * idle timeout of its protocol, which releases its port. The ports of the
+  * pool are allocated from a bitmap per protocol, so that TCP and UDP each
+  * have the whole pool.
   */
 
 class Ipv4Nat : public Object
@@ -201,6 +225,7 @@ public:
   static TypeId GetTypeId (void);
 
   Ipv4Nat ();
+  virtual ~Ipv4Nat ();
 
   /**
    * \brief Add rules to the Dynamic NAT Table.
@@ -241,7 +266,8 @@ public:
   /**
    * \return number of Dynamic NAT Tuples
    *
-   * Returns the number of tuples that are currently listed on the list.
+   * Returns the number of tuples that are currently listed on the list. The
+   * idle tuples are only removed when a packet goes through the NAT.
    */
   uint32_t GetNDynamicTuples (void) const;
 
@@ -265,7 +291,8 @@ public:
    * \param index index in table specifying rule to return
    * \return rule at specified index
    *
-   * Returns the specific Dynamic NAT tuple that is stored on the given index.
+   * Returns the specific Dynamic NAT tuple that is stored on the given index:
+   * the TCP tuples then the UDP ones, the most recently used first.
    */
   Ipv4DynamicNatTuple GetDynamicTuple (uint32_t index) const;
 
@@ -323,9 +350,9 @@ public:
    */
   void SetOutside (int32_t interfaceIndex);
 
-  typedef std::list<Ipv4StaticNatRule> StaticNatRules;
-  typedef std::list<Ipv4DynamicNatRule> DynamicNatRules;
-  typedef std::list<Ipv4DynamicNatTuple> DynamicNatTuple;
+  /// The rules, oldest first: rule i of the table is the (size - 1 - i)-th.
+  typedef std::vector<Ipv4StaticNatRule> StaticNatRules;
+  typedef std::vector<Ipv4DynamicNatRule> DynamicNatRules;
 
 
 protected:
@@ -335,7 +362,18 @@ protected:
 private:
   //bool m_isConnected;
 
+  /// A dynamic translation and the time it expires if not used.
+  struct TupleEntry
+  {
+    Ipv4DynamicNatTuple tuple;
+    Time expires;
+  };
+  /// The tuples of a protocol, the most recently used first.
+  typedef std::list<TupleEntry> TupleList;
+
   Ptr<Ipv4> m_ipv4;
+  Ipv4NetfilterHook m_postRoutingHook;
+  Ipv4NetfilterHook m_preRoutingHook;
 
   /**
     * \param hook The hook number e.g., NF_INET_PRE_ROUTING
@@ -389,25 +427,52 @@ private:
   uint16_t GetEndPort () const;
 
   /**
-  *\return The current port value for the dynamic nat translation
+  *\return A free port of the port pool, marked as used, or 0 if none is free
   */
-  uint16_t GetCurrentPort () const;
+  uint16_t AllocatePort (uint8_t protocol);
+  void ReleasePort (uint8_t protocol, uint16_t port);
+
+  /// Rebuild the indexes of the static rules after a removal.
+  void IndexStaticRules ();
+  void IndexStaticRule (uint32_t position);
 
   /**
-  *\return The a new port to translate to from the port pool
+  *\return The tuple list of a protocol (TCP or UDP)
   */
-  uint16_t GetNewOutsidePort ();
+  TupleList &GetTupleList (uint8_t protocol);
+  Time GetIdleTimeout (uint8_t protocol) const;
+  /// Mark a tuple as just used: it moves to the front of its list.
+  void RefreshTuple (TupleList::iterator it);
+  /// Remove the tuples idle for longer than their timeout.
+  void ExpireTuples ();
+  void RemoveTuple (TupleList::iterator it);
+
+  static uint64_t StaticKey (Ipv4Address address, uint8_t protocol, uint16_t port);
+  static uint64_t LocalKey (Ipv4Address address, uint8_t protocol, uint16_t port);
+  static uint32_t GlobalKey (uint8_t protocol, uint16_t port);
 
   StaticNatRules m_statictable;
   DynamicNatRules m_dynamictable;
-  DynamicNatTuple m_dynatuple;
+  /// Position of the last static rule for a global address, protocol and port (0, 0: any).
+  std::unordered_map<uint64_t, uint32_t> m_staticIn;
+  /// Position of the last static rule for a local address.
+  std::unordered_map<uint32_t, uint32_t> m_staticOut;
+  TupleList m_tcpTuples;
+  TupleList m_udpTuples;
+  std::unordered_map<uint64_t, TupleList::iterator> m_tuplesByLocal;
+  std::unordered_map<uint32_t, TupleList::iterator> m_tuplesByGlobal;
+  Time m_tcpIdleTimeout;
+  Time m_udpIdleTimeout;
   int32_t m_insideInterface;
   int32_t m_outsideInterface;
   Ipv4Address m_globalip;
   Ipv4Mask m_globalmask;
   uint16_t m_startport;
   uint16_t m_endport;
-  uint16_t m_currentPort;
+  /// One bit per port of the pool, set when the port is used (TCP, UDP).
+  std::vector<uint64_t> m_portBitmap[2];
+  /// Offset in the pool where the search for a free port starts (TCP, UDP).
+  uint32_t m_nextPort[2];
 
 };
 
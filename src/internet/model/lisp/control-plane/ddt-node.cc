@@ -19,18 +19,245 @@
  */
 #include "ddt-node.h"
 
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/uinteger.h"
+#include "ns3/socket.h"
+#include "ns3/socket-factory.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/packet.h"
+#include "ns3/lisp-over-ip.h"
+#include "ns3/locators-impl.h"
+#include "ns3/rloc-metrics.h"
+
 namespace ns3
 {
 
-  DdtNode::DdtNode ()
+  NS_LOG_COMPONENT_DEFINE ("DdtNode");
+
+  NS_OBJECT_ENSURE_REGISTERED (DdtNode);
+
+  TypeId
+  DdtNode::GetTypeId (void)
   {
-    // TODO Auto-generated constructor stub
+    static TypeId tid = TypeId ("ns3::DdtNode")
+      .SetParent<Application> ()
+      .SetGroupName ("Lisp")
+      .AddConstructor<DdtNode> ()
+      .AddAttribute ("ReferralTtl",
+                     "TTL (in minutes) of the NODE_REFERRAL and MS_REFERRAL records.",
+                     UintegerValue (1440),
+                     MakeUintegerAccessor (&DdtNode::m_referralTtl),
+                     MakeUintegerChecker<uint32_t> ())
+      .AddAttribute ("NegativeReferralTtl",
+                     "TTL (in minutes) of the DELEGATION_HOLE records.",
+                     UintegerValue (15),
+                     MakeUintegerAccessor (&DdtNode::m_negativeReferralTtl),
+                     MakeUintegerChecker<uint32_t> ())
+      .AddTraceSource ("MapRequestRx", "A DDT Map-Request is received by the DDT node",
+                       MakeTraceSourceAccessor (&DdtNode::m_mapRequestRxTrace),
+                       "ns3::Packet::TracedCallback")
+    ;
+    return tid;
+  }
 
+  DdtNode::DdtNode ()
+    : m_referralTtl (1440),
+      m_negativeReferralTtl (15)
+  {
   }
 
   DdtNode::~DdtNode ()
   {
-    // TODO Auto-generated destructor stub
+    m_socket = 0;
+  }
+
+  void
+  DdtNode::AddAuthoritativePrefix (const Ipv4Address &prefix, const Ipv4Mask &mask)
+  {
+    uint32_t idx = m_delegationTrie.ExactLookup (prefix.CombineMask (mask).Get (), mask.GetPrefixLength ());
+    if (idx != Ipv4LpmTrie::NO_VALUE)
+      {
+        // Already delegated: the delegation wins
+        return;
+      }
+    Delegation delegation;
+    delegation.prefix = prefix.CombineMask (mask);
+    delegation.maskLength = mask.GetPrefixLength ();
+    delegation.action = MapReferralMsg::DELEGATION_HOLE;
+    m_delegationTrie.Insert (delegation.prefix.Get (), delegation.maskLength, m_delegations.size ());
+    m_delegations.push_back (delegation);
+  }
+
+  void
+  DdtNode::AddNodeDelegation (const Ipv4Address &prefix, const Ipv4Mask &mask, const Address &rloc)
+  {
+    AddDelegation (prefix, mask, MapReferralMsg::NODE_REFERRAL, rloc);
+  }
+
+  void
+  DdtNode::AddMapServerDelegation (const Ipv4Address &prefix, const Ipv4Mask &mask, const Address &rloc)
+  {
+    AddDelegation (prefix, mask, MapReferralMsg::MS_REFERRAL, rloc);
+  }
+
+  void
+  DdtNode::AddDelegation (const Ipv4Address &prefix, const Ipv4Mask &mask,
+                          MapReferralMsg::ReferralAction action, const Address &rloc)
+  {
+    NS_LOG_FUNCTION (this << prefix << mask << action << rloc);
+    Ipv4Address network = prefix.CombineMask (mask);
+    uint8_t maskLength = mask.GetPrefixLength ();
+    uint32_t idx = m_delegationTrie.ExactLookup (network.Get (), maskLength);
+    if (idx == Ipv4LpmTrie::NO_VALUE)
+      {
+        AddAuthoritativePrefix (prefix, mask);
+        idx = m_delegations.size () - 1;
+      }
+    Delegation &delegation = m_delegations[idx];
+    if (delegation.action == MapReferralMsg::DELEGATION_HOLE)
+      {
+        delegation.action = action;
+        delegation.referrals = Create<LocatorsImpl> ();
+        m_delegatedPrefixes.insert (std::make_pair (network.Get (), maskLength));
+      }
+    NS_ASSERT_MSG (delegation.action == action,
+                   "EID-Prefix " << network << "/" << unsigned (maskLength)
+                                 << " delegated both to DDT nodes and to Map-Servers");
+    Ptr<Locator> locator = Create<Locator> (rloc);
+    locator->SetRlocMetrics (Create<RlocMetrics> (1, 100, true));
+    delegation.referrals->InsertLocator (locator);
+  }
+
+  uint8_t
+  DdtNode::GetHoleLength (const Ipv4Address &eid, const Delegation &authority) const
+  {
+    for (uint8_t length = authority.maskLength; length < 32; length++)
+      {
+        uint32_t mask = length ? ~((1U << (32 - length)) - 1) : 0;
+        uint32_t first = eid.Get () & mask;
+        uint32_t last = first | ~mask;
+        // The delegations under first/length start in [first, last]. Those
+        // shorter than length start at first and contain it: skip them.
+        bool holdsDelegation = false;
+        for (std::set<std::pair<uint32_t, uint8_t> >::const_iterator it =
+               m_delegatedPrefixes.lower_bound (std::make_pair (first, 0));
+             it != m_delegatedPrefixes.end () && it->first <= last && !holdsDelegation; ++it)
+          {
+            holdsDelegation = it->second >= length;
+          }
+        if (!holdsDelegation)
+          {
+            return length;
+          }
+      }
+    return 32;
+  }
+
+  Ptr<MapReplyRecord>
+  DdtNode::GenerateReferralRecord (Ptr<MapRequestRecord> requestRecord) const
+  {
+    Ptr<MapReplyRecord> record = Create<MapReplyRecord> ();
+    record->SetA (1);
+    record->SetMapVersionNumber (0);
+
+    Address eidAddress = requestRecord->GetEidPrefix ();
+    uint32_t idx = Ipv4LpmTrie::NO_VALUE;
+    if (Ipv4Address::IsMatchingType (eidAddress))
+      {
+        idx = m_delegationTrie.Lookup (Ipv4Address::ConvertFrom (eidAddress).Get ());
+      }
+    if (idx == Ipv4LpmTrie::NO_VALUE)
+      {
+        // Not for us: the requester must not cache this answer
+        MapReferralMsg::SetReferralAction (record, MapReferralMsg::NOT_AUTHORITATIVE);
+        record->SetRecordTtl (0);
+        record->SetEidPrefix (eidAddress);
+        record->SetEidMaskLength (requestRecord->GetMaskLength ());
+        return record;
+      }
+
+    const Delegation &delegation = m_delegations[idx];
+    MapReferralMsg::SetReferralAction (record, delegation.action);
+    if (delegation.action == MapReferralMsg::DELEGATION_HOLE)
+      {
+        Ipv4Address eid = Ipv4Address::ConvertFrom (eidAddress);
+        uint8_t length = GetHoleLength (eid, delegation);
+        record->SetRecordTtl (m_negativeReferralTtl);
+        record->SetEidPrefix (eid.CombineMask (Ipv4Mask (length ? ~((1U << (32 - length)) - 1) : 0)));
+        record->SetEidMaskLength (length);
+      }
+    else
+      {
+        record->SetRecordTtl (m_referralTtl);
+        record->SetEidPrefix (delegation.prefix);
+        record->SetEidMaskLength (delegation.maskLength);
+        record->SetLocators (delegation.referrals);
+      }
+    return record;
+  }
+
+  Ptr<MapReferralMsg>
+  DdtNode::GenerateMapReferral (Ptr<MapRequestMsg> request) const
+  {
+    Ptr<MapReferralMsg> referral = Create<MapReferralMsg> ();
+    referral->SetNonce (request->GetNonce ());
+    for (uint8_t i = 0; i < request->GetNMapRequestRecords (); i++)
+      {
+        referral->AddRecord (GenerateReferralRecord (request->GetMapRequestRecord (i)));
+      }
+    return referral;
+  }
+
+  void
+  DdtNode::StartApplication (void)
+  {
+    NS_LOG_FUNCTION (this);
+    if (m_socket == 0)
+      {
+        TypeId tid = TypeId::LookupByName ("ns3::UdpSocketFactory");
+        m_socket = Socket::CreateSocket (GetNode (), tid);
+        InetSocketAddress local = InetSocketAddress (Ipv4Address::GetAny (), LispOverIp::LISP_SIG_PORT);
+        if (m_socket->Bind (local) == -1)
+          {
+            NS_FATAL_ERROR ("Failed to bind socket of DDT node");
+          }
+      }
+    m_socket->SetRecvCallback (MakeCallback (&DdtNode::HandleRead, this));
+  }
+
+  void
+  DdtNode::StopApplication (void)
+  {
+    NS_LOG_FUNCTION (this);
+    if (m_socket != 0)
+      {
+        m_socket->Close ();
+        m_socket->SetRecvCallback (MakeNullCallback<void, Ptr<Socket> > ());
+        m_socket = 0;
+      }
+  }
+
+  void
+  DdtNode::HandleRead (Ptr<Socket> socket)
+  {
+    Ptr<Packet> packet;
+    Address from;
+    while ((packet = socket->RecvFrom (from)))
+      {
+        uint8_t buf[packet->GetSize ()];
+        packet->CopyData (buf, packet->GetSize ());
+        uint8_t msg_type = buf[0] >> 4;
+        if (msg_type != static_cast<uint8_t> (MapRequestMsg::GetMsgType ()))
+          {
+            NS_LOG_WARN ("DDT node ignores control message of type " << unsigned (msg_type));
+            continue;
+          }
+        m_mapRequestRxTrace (packet);
+        Ptr<MapReferralMsg> referral = GenerateMapReferral (MapRequestMsg::Deserialize (buf));
+        NS_LOG_DEBUG ("DDT node answers with Map-Referral " << *referral);
+        socket->SendTo (referral->ToPacket (), 0, from);
+      }
   }
 
 } /* namespace ns3 */
@@ -20,16 +20,99 @@
 #ifndef SRC_INTERNET_MODEL_LISP_CONTROL_PLANE_DDT_NODE_H_
 #define SRC_INTERNET_MODEL_LISP_CONTROL_PLANE_DDT_NODE_H_
 
+#include <set>
+#include <utility>
+#include <vector>
+
 #include "ns3/application.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/traced-callback.h"
+#include "ns3/lpm-trie.h"
+#include "ns3/locators.h"
+#include "map-referral-msg.h"
+#include "map-request-msg.h"
+
 namespace ns3
 {
 
+class Socket;
+class Packet;
+
+/**
+ * \brief LISP-DDT node (RFC 8111).
+ *
+ * A DDT node is authoritative for some EID-Prefixes and delegates parts of
+ * them, either to child DDT nodes or to the Map-Servers where the sites
+ * register. It answers each DDT Map-Request with a Map-Referral that gives,
+ * for every requested EID, the most specific delegation containing it
+ * (NODE_REFERRAL or MS_REFERRAL), a DELEGATION_HOLE if the EID is in an
+ * authoritative prefix but not delegated, or NOT_AUTHORITATIVE.
+ *
+ * Only IPv4 EID-Prefixes are supported.
+ */
 class DdtNode : public Application
 {
 public:
+  static TypeId GetTypeId (void);
+
   DdtNode ();
   virtual
   ~DdtNode ();
+
+  /**
+   * \brief Make the node authoritative for an EID-Prefix.
+   */
+  void AddAuthoritativePrefix (const Ipv4Address &prefix, const Ipv4Mask &mask);
+  /**
+   * \brief Delegate an EID-Prefix to a child DDT node (NODE_REFERRAL).
+   *
+   * Call it once per RLOC of the child (or of its replicas).
+   */
+  void AddNodeDelegation (const Ipv4Address &prefix, const Ipv4Mask &mask, const Address &rloc);
+  /**
+   * \brief Delegate an EID-Prefix to a Map-Server (MS_REFERRAL).
+   */
+  void AddMapServerDelegation (const Ipv4Address &prefix, const Ipv4Mask &mask, const Address &rloc);
+
+  /**
+   * \brief Build the Map-Referral answering a DDT Map-Request.
+   * \return A Map-Referral with one record per record of request.
+   */
+  Ptr<MapReferralMsg> GenerateMapReferral (Ptr<MapRequestMsg> request) const;
+
+private:
+  struct Delegation
+  {
+    Ipv4Address prefix;
+    uint8_t maskLength;
+    /// DELEGATION_HOLE for an authoritative prefix that is not delegated.
+    MapReferralMsg::ReferralAction action;
+    Ptr<Locators> referrals;
+  };
+
+  virtual void StartApplication (void);
+  virtual void StopApplication (void);
+  void HandleRead (Ptr<Socket> socket);
+
+  void AddDelegation (const Ipv4Address &prefix, const Ipv4Mask &mask,
+                      MapReferralMsg::ReferralAction action, const Address &rloc);
+  Ptr<MapReplyRecord> GenerateReferralRecord (Ptr<MapRequestRecord> requestRecord) const;
+  /**
+   * \return The length of the largest prefix of eid that is inside authority
+   * and contains no delegation.
+   */
+  uint8_t GetHoleLength (const Ipv4Address &eid, const Delegation &authority) const;
+
+  Ptr<Socket> m_socket;
+  std::vector<Delegation> m_delegations;
+  /// Longest-prefix match on the delegations, the values are indexes in m_delegations.
+  Ipv4LpmTrie m_delegationTrie;
+  /// The (prefix, length) of the delegations to DDT nodes and Map-Servers, sorted.
+  std::set<std::pair<uint32_t, uint8_t> > m_delegatedPrefixes;
+  uint32_t m_referralTtl;
+  uint32_t m_negativeReferralTtl;
+
+  TracedCallback<Ptr<const Packet> > m_mapRequestRxTrace;
 };
 
 } /* namespace ns3 */
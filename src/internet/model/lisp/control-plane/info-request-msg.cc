@@ -151,7 +151,22 @@ InfoRequestMsg::GetNatLcaf(void){
 	return m_natLcaf;
 }
 
-void InfoRequestMsg::Serialize(uint8_t *buf) {
+uint32_t InfoRequestMsg::GetSerializedSize(void) const {
+	// Header and authentication data, then TTL, reserved, EID mask length and EID-Prefix-AFI
+	uint32_t size = 16 + m_authDataLen + 8;
+	if (Ipv4Address::IsMatchingType(m_eidPrefix))
+		size += 4;
+	else if (Ipv6Address::IsMatchingType(m_eidPrefix))
+		size += 16;
+	// NAT LCAF of an Info-Reply, or an AFI followed by nothing
+	if (m_natLcaf != 0)
+		size += m_natLcaf->GetSerializedSize();
+	else
+		size += 4;
+	return size;
+}
+
+void InfoRequestMsg::Serialize(uint8_t *buf) const {
 	//NS_LOG_FUNCTION(this);
 	uint8_t type = static_cast<uint8_t>(LispControlMsg::INFO_REQUEST) << 4;
 	buf[0] = (type) | (m_R << 3);
@@ -175,7 +190,7 @@ void InfoRequestMsg::Serialize(uint8_t *buf) {
 		buf[14+i] = (m_authDataLen >> 8*(authen_len_size - 1 -i)) & 0xff;
 	}
 
-	uint8_t size = 16;
+	uint32_t size = 16;
 	// Authentication data field
 	buf[16] = 0xaa;
 	buf[17] = 0xbb;
@@ -65,7 +65,8 @@ public:
   void SetNatLcaf(Ptr<NatLcaf> natLcaf);
   Ptr<NatLcaf> GetNatLcaf(void);
 
-	void Serialize(uint8_t *buf);
+	virtual uint32_t GetSerializedSize(void) const;
+	virtual void Serialize(uint8_t *buf) const;
 	static Ptr<InfoRequestMsg> Deserialize(uint8_t *buf);
 
 	static LispControlMsg::LispControlMsgType GetMsgType(void);
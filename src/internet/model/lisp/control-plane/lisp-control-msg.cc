@@ -19,6 +19,8 @@
  */
 #include "lisp-control-msg.h"
 
+#include <vector>
+
 namespace ns3
 {
 
@@ -33,4 +35,13 @@ namespace ns3
     // TODO Auto-generated destructor stub
   }
 
+  Ptr<Packet>
+  LispControlMsg::ToPacket (void) const
+  {
+    uint32_t size = GetSerializedSize ();
+    std::vector<uint8_t> buf (size);
+    Serialize (buf.data ());
+    return Create<Packet> (buf.data (), size);
+  }
+
 } /* namespace ns3 */
@@ -56,6 +56,19 @@ public:
     IPV6 = 2,
   };
 
+  /**
+   * \return The number of bytes written by Serialize.
+   */
+  virtual uint32_t GetSerializedSize (void) const = 0;
+  /**
+   * \brief Write the message in buf, which holds GetSerializedSize () bytes.
+   */
+  virtual void Serialize (uint8_t *buf) const = 0;
+
+  /**
+   * \brief Serialize the message in a packet of exactly its size.
+   */
+  Ptr<Packet> ToPacket (void) const;
 
 };
 
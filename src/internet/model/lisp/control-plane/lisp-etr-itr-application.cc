@@ -84,6 +84,46 @@ namespace ns3
 									StringValue("ns3::ConstantRandomVariable[Constant=0]"),
 									MakePointerAccessor(&LispEtrItrApplication::m_rttVariable),
 									MakePointerChecker<RandomVariableStream>())
+								.AddAttribute("MapRequestCoalescing",
+											  "The cache misses occurring within this window are sent to the "
+											  "Map-Resolver in a single multi-record Map-Request. "
+											  "0 sends a Map-Request per miss.",
+											  TimeValue(Seconds(0)),
+											  MakeTimeAccessor(&LispEtrItrApplication::m_mapRequestCoalescing),
+											  MakeTimeChecker())
+								.AddAttribute("MapRegisterRecords",
+											  "The maximum number of EID records packed in a Map-Register.",
+											  UintegerValue(16),
+											  MakeUintegerAccessor(&LispEtrItrApplication::m_mapRegisterRecords),
+											  MakeUintegerChecker<uint8_t>(1))
+								.AddAttribute("MapRegisterInterval",
+											  "The time between two Map-Register refreshes, which send the "
+											  "database entries that changed. 0 registers only when the "
+											  "database is updated.",
+											  TimeValue(Seconds(0)),
+											  MakeTimeAccessor(&LispEtrItrApplication::m_mapRegisterInterval),
+											  MakeTimeChecker())
+								.AddAttribute("MapRegisterRefresh",
+											  "The age at which an unchanged database entry is registered "
+											  "again. 0 never registers it again.",
+											  TimeValue(Seconds(0)),
+											  MakeTimeAccessor(&LispEtrItrApplication::m_mapRegisterRefresh),
+											  MakeTimeChecker())
+								.AddAttribute("MapRegisterRetransmit",
+											  "The time after which the records that no Map-Notify "
+											  "acknowledged are registered again with the Map-Servers "
+											  "that did not acknowledge them, whatever MapRegisterInterval. "
+											  "0 waits for the next refresh.",
+											  TimeValue(Seconds(1)),
+											  MakeTimeAccessor(&LispEtrItrApplication::m_mapRegisterRetransmit),
+											  MakeTimeChecker())
+								.AddAttribute("MapRegisterJitter",
+											  "The first registration and each refresh are delayed by a "
+											  "random time up to this value, so that the xTRs do not "
+											  "register all at once.",
+											  TimeValue(Seconds(0)),
+											  MakeTimeAccessor(&LispEtrItrApplication::m_mapRegisterJitter),
+											  MakeTimeChecker())
 								.AddTraceSource("MapRegisterTx", "A MapRegister is sent by the LISP device",
 												MakeTraceSourceAccessor(&LispEtrItrApplication::m_mapRegisterTxTrace),
 												"ns3::Packet::TracedCallback")
@@ -130,6 +170,11 @@ namespace ns3
 		m_requestSent = 0;
 		m_lispProtoAddress = Address(); // invalid address
 		m_recvIvkSmr = false;
+		m_coalescedRequest = 0;
+		m_mapRegisterRecords = 16;
+		m_mapRegisterJitterVariable = 0;
+		m_registerThroughRtr = false;
+		m_mapNotifyPending = true;
 	}
 
 	LispEtrItrApplication::~LispEtrItrApplication()
@@ -141,6 +186,11 @@ namespace ns3
 		m_mapServerAddress = mapServerAddresses;
 	}
 
+	void LispEtrItrApplication::SetMapServerShards(Ptr<MapServerShards> mapServerShards)
+	{
+		m_mapServerShards = mapServerShards;
+	}
+
 	void LispEtrItrApplication::SetMapTables(Ptr<MapTables> mapTablesV4,
 											 Ptr<MapTables> mapTablesV6)
 	{
@@ -175,6 +225,8 @@ namespace ns3
 				// NS_FATAL_ERROR ("Failed to bind socket (LispXtrApp: lispMappingSocket)");
 			}
 			m_lispMappingSocket->Connect(m_lispProtoAddress); // Both client and server
+			// The control plane reads the messages of the data plane as objects
+			DynamicCast<LispMappingSocket>(m_lispMappingSocket)->SetDirectRecv(true);
 			// m_lispProtoAddress is a special kind of address defined for comm between lisp and xTR
 			NS_LOG_DEBUG("LispEtrItrApplication has connected to " << m_lispProtoAddress);
 		}
@@ -195,11 +247,6 @@ namespace ns3
 					NS_LOG_DEBUG("Failed to bind socket (LispXtrApp: m_socket)");
 					// NS_FATAL_ERROR ("Failed to bind socket (LispXtrApp: m_socket)");
 				}
-				m_socket->Connect(
-					InetSocketAddress(
-						Ipv4Address::ConvertFrom(
-							m_mapServerAddress.front()),
-						m_peerPort));
 			}
 			else if (Ipv6Address::IsMatchingType(m_mapServerAddress.front()))
 			{
@@ -208,11 +255,6 @@ namespace ns3
 					NS_LOG_DEBUG("Failed to bind socket (LispXtrApp: m_socket)");
 					// NS_FATAL_ERROR ("Failed to bind socket (LispXtrApp: m_socket)");
 				}
-				m_socket->Connect(
-					Inet6SocketAddress(
-						Ipv6Address::ConvertFrom(
-							m_mapServerAddress.front()),
-						m_peerPort));
 			}
 		}
 		m_socket->SetRecvCallback(
@@ -249,7 +291,7 @@ namespace ns3
 		m_lispCtlMsgRcvSocket->SetRecvCallback(
 			MakeCallback(&LispEtrItrApplication::HandleReadControlMsg, this));
 
-		ScheduleTransmit(Seconds(0.));
+		ScheduleTransmit(GetMapRegisterJitter());
 		NS_LOG_DEBUG("Lisp xTR Application Starts");
 	}
 
@@ -257,6 +299,11 @@ namespace ns3
 	{
 		NS_LOG_FUNCTION(this);
 
+		Simulator::Cancel(m_coalescingEvent);
+		m_coalescedRequest = 0;
+		Simulator::Cancel(m_mapRegisterEvent);
+		Simulator::Cancel(m_mapRegisterRetransmitEvent);
+
 		if (m_lispMappingSocket != 0)
 		{
 			m_lispMappingSocket->Close();
@@ -315,15 +362,9 @@ namespace ns3
 		// Generate InfoRequestMsg
 		Ptr<InfoRequestMsg> infoRequest = LispEtrItrApplication::GenerateInfoRequest(mapEntries.front());
 
-		// Compute number of bytes of InfoRequestMsg
-		uint8_t BUF_SIZE = 16 + infoRequest->GetAuthDataLen() + 16;
-		uint8_t *buf = new uint8_t[BUF_SIZE];
-		infoRequest->Serialize(buf);
-
-		MapResolver::ConnectToPeerAddress(m_mapServerAddress.front(),
-										  LispOverIp::LISP_SIG_PORT, m_socket);
-		Ptr<Packet> p = Create<Packet>(buf, BUF_SIZE);
-		m_socket->Send(p);
+		Ptr<Packet> p = infoRequest->ToPacket();
+		MapResolver::SendToPeer(m_socket, p, m_mapServerAddress.front(),
+								LispOverIp::LISP_SIG_PORT);
 		NS_LOG_DEBUG(
 			"InfoRequest message sent to " << Ipv4Address::ConvertFrom(m_mapServerAddress.front()));
 		++m_sent;
@@ -342,9 +383,19 @@ namespace ns3
 				"Map Register sending is terminated due to empty LISP database...");
 			return;
 		}
+		m_registerThroughRtr = rtr;
 		m_mapTablesV4->GetMapEntryList(MapTables::IN_DATABASE, mapEntries);
 		m_mapTablesV6->GetMapEntryList(MapTables::IN_DATABASE, mapEntries);
-		// Iterate mapEntries to construct Map-Register message.
+
+		// Select the entries to register: those that changed, or whose
+		// registration is too old. The entries no longer in the database are forgotten.
+		RegistrationList_t registrations;
+		std::list<Ptr<MapEntry>> changedEntries;
+		std::list<Ptr<MapEntry>> registeredEntries;
+		std::list<Ptr<MapRegisterMsg>> changedMsgs;
+		std::list<Ptr<MapRegisterMsg>> registeredMsgs;
+		std::list<std::vector<Address>> changedMapServers;
+		std::list<std::vector<Address>> registeredMapServers;
 		for (std::list<Ptr<MapEntry>>::const_iterator it = mapEntries.begin();
 			 it != mapEntries.end(); ++it)
 		{
@@ -368,32 +419,195 @@ namespace ns3
 
 			Ptr<MapRegisterMsg> msg = this->GenerateMapRegister(
 				*it, rtr);
-			/**
-			 * Calculating the bytes held by Map-Register Message...
-			 * BUF_SIZE = 16+AuthDataLen+16+12*LocatorCount
-			 */
-			uint8_t BUF_SIZE = 16 + msg->GetAuthDataLen() + 16 + 12 * msg->GetRecord()->GetLocatorCount();
-			uint8_t *buf = new uint8_t[BUF_SIZE];
-			// std::memset(buf, 0, sizeof(buf));
-			msg->Serialize(buf);
-			MapResolver::ConnectToPeerAddress(m_mapServerAddress.front(),
-											  LispOverIp::LISP_SIG_PORT, m_socket);
-			Ptr<Packet> p = Create<Packet>(buf, BUF_SIZE);
+			std::vector<Address> mapServers = GetMapServers(*it);
+			Registration registration;
+			registration.record.resize(msg->GetRecord()->GetSerializedSize());
+			msg->GetRecord()->Serialize(&registration.record[0]);
+			registration.time = Simulator::Now();
+			registration.unacked.insert(mapServers.begin(), mapServers.end());
+
+			RegistrationList_t::const_iterator last = m_registrations.find((*it)->GetEidPrefix());
+			if (last != m_registrations.end() && last->second.record == registration.record && (m_mapRegisterRefresh.IsZero() || Simulator::Now() - last->second.time < m_mapRegisterRefresh))
+			{
+				registrations[(*it)->GetEidPrefix()] = last->second;
+				if (last->second.unacked.empty())
+				{
+					registeredEntries.push_back(*it);
+					registeredMsgs.push_back(msg);
+					registeredMapServers.push_back(mapServers);
+					continue;
+				}
+				// Not acknowledged by every Map-Server yet: the Map-Register may be lost
+				changedEntries.push_back(*it);
+				changedMsgs.push_back(msg);
+				changedMapServers.push_back(std::vector<Address>(last->second.unacked.begin(), last->second.unacked.end()));
+				continue;
+			}
+			registrations[(*it)->GetEidPrefix()] = registration;
+			changedEntries.push_back(*it);
+			changedMsgs.push_back(msg);
+			changedMapServers.push_back(mapServers);
+		}
+		// Until a Map-Notify arrives, the data plane does not send: something must be registered
+		if (changedEntries.empty() && m_mapNotifyPending)
+		{
+			changedEntries.swap(registeredEntries);
+			changedMsgs.swap(registeredMsgs);
+			changedMapServers.swap(registeredMapServers);
+			for (std::list<Ptr<MapEntry>>::const_iterator it = changedEntries.begin(); it != changedEntries.end(); ++it)
+			{
+				registrations[(*it)->GetEidPrefix()].time = Simulator::Now();
+			}
+		}
+		m_registrations.swap(registrations);
+		NS_LOG_DEBUG("Register " << changedEntries.size() << " of " << mapEntries.size() << " database entries");
+
+		// Pack the records per Map-Server. The RTR reads a single record per
+		// Map-Register: the records registered through it are not packed.
+		uint8_t maxRecords = rtr ? 1 : m_mapRegisterRecords;
+		std::map<Address, Ptr<MapRegisterMsg>> pending;
+		std::list<Ptr<MapRegisterMsg>>::const_iterator msg = changedMsgs.begin();
+		std::list<std::vector<Address>>::const_iterator mapServers = changedMapServers.begin();
+		for (std::list<Ptr<MapEntry>>::const_iterator it = changedEntries.begin();
+			 it != changedEntries.end(); ++it, ++msg, ++mapServers)
+		{
+			for (std::vector<Address>::const_iterator ms = mapServers->begin(); ms != mapServers->end(); ++ms)
+			{
+				Ptr<MapRegisterMsg> &packed = pending[*ms];
+				if (packed != 0 && packed->GetNRecords() >= maxRecords)
+				{
+					SendMapRegister(packed, *ms);
+					packed = 0;
+				}
+				if (packed == 0)
+				{
+					// Same header as the Map-Register generated for the entry
+					packed = Create<MapRegisterMsg>(**msg);
+					packed->SetRecord((*msg)->GetRecord());
+				}
+				else
+				{
+					packed->AddRecord((*msg)->GetRecord());
+				}
+			}
+		}
+		for (std::map<Address, Ptr<MapRegisterMsg>>::const_iterator it = pending.begin(); it != pending.end(); ++it)
+		{
+			SendMapRegister(it->second, it->first);
+		}
 
-			/* --- Tracing --- */
-			m_mapRegisterTxTrace(p);
+		++m_sent;
+		ScheduleMapRegisters();
+	}
 
-			m_socket->Send(p);
-			NS_LOG_DEBUG(
-				"Map-Register message sent to " << Ipv4Address::ConvertFrom(m_mapServerAddress.front()));
+	void LispEtrItrApplication::SendMapRegister(Ptr<MapRegisterMsg> msg, Address mapServer)
+	{
+		Ptr<Packet> p = msg->ToPacket();
+
+		/* --- Tracing --- */
+		m_mapRegisterTxTrace(p);
+
+		MapResolver::SendToPeer(m_socket, p, mapServer, LispOverIp::LISP_SIG_PORT);
+		NS_LOG_DEBUG(
+			"Map-Register message with " << unsigned(msg->GetNRecords()) << " records sent to " << Ipv4Address::ConvertFrom(mapServer));
+	}
+
+	std::vector<Address> LispEtrItrApplication::GetMapServers(Ptr<MapEntry> mapEntry) const
+	{
+		// With a pool of Map-Servers, only the owner of the shard is registered with
+		if (m_mapServerShards != 0 && m_mapServerShards->GetNMapServers() > 0)
+		{
+			return m_mapServerShards->GetMapServers(mapEntry->GetEidPrefix()->GetEidAddress(),
+													mapEntry->GetEidPrefix()->GetIpv4Mask().GetPrefixLength());
 		}
+		return std::vector<Address>(1, m_mapServerAddress.front());
+	}
 
-		++m_sent;
+	void LispEtrItrApplication::AcknowledgeRegistrations(Ptr<MapNotifyMsg> mapNotify, Address mapServer)
+	{
+		for (uint8_t i = 0; i < mapNotify->GetNRecords(); i++)
+		{
+			Ptr<MapReplyRecord> record = mapNotify->GetRecord(i);
+			std::stringstream ss;
+			ss << "/" << (int)record->GetEidMaskLength();
+			Ptr<EndpointId> eid;
+			if (record->GetEidAfi() == LispControlMsg::IP)
+			{
+				eid = Create<EndpointId>(record->GetEidPrefix(), Ipv4Mask(ss.str().c_str()));
+			}
+			else
+			{
+				eid = Create<EndpointId>(record->GetEidPrefix(), Ipv6Prefix(ss.str().c_str()));
+			}
+			RegistrationList_t::iterator registration = m_registrations.find(eid);
+			if (registration == m_registrations.end())
+			{
+				continue;
+			}
+			// The record may have changed since this Map-Notify was sent
+			std::vector<uint8_t> acked(record->GetSerializedSize());
+			record->Serialize(&acked[0]);
+			if (acked == registration->second.record)
+			{
+				registration->second.unacked.erase(mapServer);
+			}
+		}
+	}
 
-		/*if (m_sent < m_count)
-		 {
-		 ScheduleTransmit (m_interval);
-		 }*/
+	Time LispEtrItrApplication::GetMapRegisterJitter(void)
+	{
+		if (m_mapRegisterJitter.IsZero())
+		{
+			return Seconds(0);
+		}
+		// Created on demand: the streams of the other random variables do not depend on the jitter
+		if (m_mapRegisterJitterVariable == 0)
+		{
+			m_mapRegisterJitterVariable = CreateObject<UniformRandomVariable>();
+		}
+		return Seconds(m_mapRegisterJitterVariable->GetValue(0, m_mapRegisterJitter.GetSeconds()));
+	}
+
+	void LispEtrItrApplication::ScheduleMapRegisters(void)
+	{
+		if (!m_mapRegisterRetransmit.IsZero() && !m_mapRegisterRetransmitEvent.IsRunning() && HasUnackedRegistrations())
+		{
+			m_mapRegisterRetransmitEvent = Simulator::Schedule(m_mapRegisterRetransmit,
+															   &LispEtrItrApplication::RetransmitMapRegisters, this);
+		}
+		if (m_mapRegisterInterval.IsZero() || m_mapRegisterEvent.IsRunning())
+		{
+			return;
+		}
+		m_mapRegisterEvent = Simulator::Schedule(m_mapRegisterInterval + GetMapRegisterJitter(),
+												 &LispEtrItrApplication::RefreshMapRegisters, this);
+	}
+
+	void LispEtrItrApplication::RefreshMapRegisters(void)
+	{
+		NS_LOG_FUNCTION(this);
+		SendMapRegisters(m_registerThroughRtr);
+	}
+
+	void LispEtrItrApplication::RetransmitMapRegisters(void)
+	{
+		NS_LOG_FUNCTION(this);
+		if (HasUnackedRegistrations())
+		{
+			SendMapRegisters(m_registerThroughRtr);
+		}
+	}
+
+	bool LispEtrItrApplication::HasUnackedRegistrations(void) const
+	{
+		for (RegistrationList_t::const_iterator it = m_registrations.begin(); it != m_registrations.end(); ++it)
+		{
+			if (!it->second.unacked.empty())
+			{
+				return true;
+			}
+		}
+		return false;
 	}
 
 	void LispEtrItrApplication::SendToLisp(Ptr<Packet> packet)
@@ -408,6 +622,12 @@ namespace ns3
 		NS_LOG_DEBUG(
 			"LispEtrItrApplication sent a packet to lispOverIp by lispMappingSocket! \nThe packet is: " << *packet);
 	}
+
+	void LispEtrItrApplication::SendToLisp(const MappingSocketMsgHeader &mapSockHeader, Ptr<MappingSocketMsg> mapSockMsg)
+	{
+		NS_LOG_FUNCTION(this);
+		DynamicCast<LispMappingSocket>(m_lispMappingSocket)->SendMsg(mapSockHeader, mapSockMsg);
+	}
 	void LispEtrItrApplication::HandleControlMsg(Ptr<Packet> packet, Address from)
 	{
 		uint8_t buf[packet->GetSize()];
@@ -432,12 +652,11 @@ namespace ns3
 			 *
 			 */
 
+			Address itrRlocAddr;
 			if (requestMsg->GetItrRlocAddrIp() != static_cast<Address>(Ipv4Address()))
-				MapResolver::ConnectToPeerAddress(
-					requestMsg->GetItrRlocAddrIp(), m_peerPort, m_socket);
+				itrRlocAddr = requestMsg->GetItrRlocAddrIp();
 			else if ((requestMsg->GetItrRlocAddrIpv6() != static_cast<Address>(Ipv6Address())))
-				MapResolver::ConnectToPeerAddress(
-					requestMsg->GetItrRlocAddrIpv6(), m_peerPort, m_socket);
+				itrRlocAddr = requestMsg->GetItrRlocAddrIpv6();
 			else
 				NS_LOG_ERROR(
 					"NO valid ITR address (neither ipv4 nor ipv6) to send back Map Message!!!");
@@ -452,7 +671,6 @@ namespace ns3
 
 				if (!lisp->IsNated())
 				{
-					uint8_t newBuf[256];
 					Ptr<MapReplyMsg> mapReply = this->GenerateMapReply(requestMsg);
 					/**
 					 * Update, 02-02-2018, Yue
@@ -461,9 +679,8 @@ namespace ns3
 					 */
 					if (mapReply != 0)
 					{
-						mapReply->Serialize(newBuf);
-						reactedPacket = Create<Packet>(newBuf, 256);
-						Send(reactedPacket);
+						reactedPacket = mapReply->ToPacket();
+						Send(reactedPacket, itrRlocAddr, m_peerPort);
 						// TODO: we should add check for the return value of Send method.
 						//  Since it is possible that map reply has not been sent due to cache miss...
 						NS_LOG_DEBUG(
@@ -536,21 +753,19 @@ namespace ns3
 				m_recvIvkSmr = true;
 				// Given reception of SMR-invoked map request, remove the scheduled event.
 				Simulator::Remove(m_resendSmrEvent);
-				uint8_t newBuf[256];
 
 				// Instead of response the queried EID-prefix, maReply conveys the content of database!
 				// Ptr<MapReplyMsg> mapReply = LispEtrItrApplication::GenerateMapReply4ChangedMapping(requestMsg);
-				/* Emeline: this code doesn't work because MapRequest/Reply can only carry one
+				/* Emeline: this code doesn't work because MapRequest/Reply could only carry one
 				 * Mapping Record (due to implementation).
 				 * Therefore: just answer with a normal MapReply */
 				Ptr<MapReplyMsg> mapReply = this->GenerateMapReply(requestMsg);
 				if (mapReply != 0)
 				{
-					mapReply->Serialize(newBuf);
-					reactedPacket = Create<Packet>(newBuf, 256);
+					reactedPacket = mapReply->ToPacket();
 
 					/* --- Artificial delay for SMR procedure --- */
-					Simulator::Schedule(Seconds(m_rttVariable->GetValue() / 2), &LispEtrItrApplication::Send, this, reactedPacket);
+					Simulator::Schedule(Seconds(m_rttVariable->GetValue() / 2), &LispEtrItrApplication::Send, this, reactedPacket, itrRlocAddr, m_peerPort);
 					NS_LOG_DEBUG(
 						"A Map Reply Message Sent to " << Ipv4Address::ConvertFrom(requestMsg->GetItrRlocAddrIp()) << " in response to an invoked SMR");
 				}
@@ -578,32 +793,26 @@ namespace ns3
 			// Get Map Reply
 			Ptr<MapReplyMsg> replyMsg = MapReplyMsg::Deserialize(buf);
 
-			// prepare mapping socket message body+header
-			Ptr<MappingSocketMsg> mapSockMsg = GenerateMapSocketAddMsgBody(
-				replyMsg);
-			MappingSocketMsgHeader mapSockHeader =
-				GenerateMapSocketAddMsgHeader(replyMsg);
-			NS_LOG_DEBUG("Mapping socket message created");
-			NS_ASSERT_MSG(mapSockMsg != 0,
-						  "Cannot create map socket message body !!! Please check why.");
-			uint8_t buf[256];
-			mapSockMsg->Serialize(buf);
-			/**
-			 * In my opinion, it is not necessary to create a packet with 256 bytes as payload.
-			 * In fact, we just need to ensure that length of buffer is more than the length of mapSockMsg.
-			 * Since this is just an exchange between LispOverIp(data plan) and LispEtrItrApplication(control plan)
-			 * Both data plan and control plan are on the same node.
-			 * It is like a socket communication between user and kernel space.
-			 */
-			Ptr<Packet> packet = Create<Packet>(buf, 256);
-			packet->AddHeader(mapSockHeader);
-			// Send to lispOverIp object so that it can insert the mapping entry in Cache.
-			// ATTENTION: with SMR, before inserting one map entry, should first check its presence in Cache.
-			// Now we apply a replacement strategy: if the EID-prefix already in Cache, replace it with the new
-			// One.
-			SendToLisp(packet);
-			// Don't forget to remove Eid in pending list...
-			DeleteFromMapReqList(mapSockMsg->GetEndPointId());
+			// A coalesced Map-Request is answered with one record per EID
+			for (uint8_t i = 0; i < replyMsg->GetNRecords(); i++)
+			{
+				Ptr<MapReplyRecord> replyRecord = replyMsg->GetRecord(i);
+				// prepare mapping socket message body+header
+				Ptr<MappingSocketMsg> mapSockMsg = GenerateMapSocketAddMsgBody(
+					replyRecord);
+				MappingSocketMsgHeader mapSockHeader =
+					GenerateMapSocketAddMsgHeader(replyRecord);
+				NS_LOG_DEBUG("Mapping socket message created");
+				NS_ASSERT_MSG(mapSockMsg != 0,
+							  "Cannot create map socket message body !!! Please check why.");
+				// Send to lispOverIp object so that it can insert the mapping entry in Cache.
+				// ATTENTION: with SMR, before inserting one map entry, should first check its presence in Cache.
+				// Now we apply a replacement strategy: if the EID-prefix already in Cache, replace it with the new
+				// One.
+				SendToLisp(mapSockHeader, mapSockMsg);
+				// Don't forget to remove Eid in pending list...
+				DeleteFromMapReqList(mapSockMsg->GetEndPointId());
+			}
 			/**
 			 * After reception of map reply and insertion of received EID-RLOC mapping into cache,
 			 * remember to check if the map request messages with received EID are present in m_mapReqMsg. If yes,
@@ -629,6 +838,15 @@ namespace ns3
 			NS_LOG_DEBUG("LISP device received MapNotify");
 			/* --- Tracing --- */
 			m_mapNotifyRxTrace(packet);
+			m_mapNotifyPending = false;
+			if (InetSocketAddress::IsMatchingType(from))
+			{
+				AcknowledgeRegistrations(MapNotifyMsg::Deserialize(buf), InetSocketAddress::ConvertFrom(from).GetIpv4());
+			}
+			else if (Inet6SocketAddress::IsMatchingType(from))
+			{
+				AcknowledgeRegistrations(MapNotifyMsg::Deserialize(buf), Inet6SocketAddress::ConvertFrom(from).GetIpv6());
+			}
 
 			/* --- Notifies DataPlane that LISP device is registered (allowed to send data packets)--- */
 			Ptr<MappingSocketMsg> mapSockMsg = Create<MappingSocketMsg>();
@@ -643,11 +861,7 @@ namespace ns3
 			// MAPA_EID used to say that LISP device is registered.
 			// MAPA_EIDMASK is used to say that LISP device is NOT registered.
 
-			uint8_t buf[256];
-			mapSockMsg->Serialize(buf);
-			Ptr<Packet> packet = Create<Packet>(buf, 256);
-			packet->AddHeader(mapSockHeader);
-			SendToLisp(packet);
+			SendToLisp(mapSockHeader, mapSockMsg);
 
 			/* The SMR procedure is now implemented on the RemoteItr Cache, instead of on the LISP Cache */
 			if (!m_remoteItrCache.empty())
@@ -704,14 +918,9 @@ namespace ns3
 				LispEtrItrApplication::GenerateMapRequest(GetLispMnEid());
 			// IMPORTANT: set SMR bit!!!
 			mapReqMsg->SetS(1);
-			uint8_t bufMapReq[64];
-			mapReqMsg->Serialize(bufMapReq);
-			Ptr<Packet> packetSmrMsg = Create<Packet>(bufMapReq, 64);
-
-			MapResolver::ConnectToPeerAddress(dstRlocAddr,
-											  LispOverIp::LISP_SIG_PORT, m_socket);
-			// Before sending map message, first should make sure the m_socket connect to the correct @IP and port number!
-			Send(packetSmrMsg);
+			Ptr<Packet> packetSmrMsg = mapReqMsg->ToPacket();
+
+			Send(packetSmrMsg, dstRlocAddr, LispOverIp::LISP_SIG_PORT);
 			NS_LOG_DEBUG("A SMR message has been sent to PITR " << dstRlocAddr);
 		}
 	}
@@ -723,21 +932,15 @@ namespace ns3
 		 * Determine the dst@IP of this sending: the RLOC of xTR sending SMR
 		 * This @IP is in the received SMR
 		 */
+		Address smrRlocAddr;
 		if (smr->GetItrRlocAddrIp() != static_cast<Address>(Ipv4Address()))
-		{
-			MapResolver::ConnectToPeerAddress(smr->GetItrRlocAddrIp(), m_peerPort,
-											  m_socket);
-			NS_LOG_DEBUG("Now the socket has been binded to:" << Ipv4Address::ConvertFrom(smr->GetItrRlocAddrIp()));
-		}
-
+			smrRlocAddr = smr->GetItrRlocAddrIp();
 		else if ((smr->GetItrRlocAddrIpv6() != static_cast<Address>(Ipv6Address())))
-			MapResolver::ConnectToPeerAddress(smr->GetItrRlocAddrIpv6(), m_peerPort,
-											  m_socket);
+			smrRlocAddr = smr->GetItrRlocAddrIpv6();
 		else
 			NS_LOG_ERROR(
 				"NO valid ITR address (neither ipv4 nor ipv6) to send back Map Message!!!");
 
-		uint8_t newBuf[256];
 		// TODO: verify if we can directly copy map request message as SMR-invoked map request
 		//  We just need to change SMR-invoked bit as 1 and change the source ITR's address
 		// TODO: now I'm lost about defintion of m_mapResolverRlocs...
@@ -754,8 +957,7 @@ namespace ns3
 			smr->SetItrRlocAddrIpv6(itrAddress);
 		}
 		// TODO:Actually, we also choose a new nonce number. (RFC6830)
-		smr->Serialize(newBuf);
-		reactedPacket = Create<Packet>(newBuf, 256);
+		reactedPacket = smr->ToPacket();
 		// IMPORTANT: set invoked-SMR bit as 1.
 		// TODO: Question: what about bit S? 1 or 0 ? or whatever?
 
@@ -769,111 +971,160 @@ namespace ns3
 		 */
 
 		/* --- Artificial delay for SMR procdure --- */
-		Simulator::Schedule(Seconds(m_rttVariable->GetValue() / 2), &LispEtrItrApplication::Send, this, reactedPacket);
+		Simulator::Schedule(Seconds(m_rttVariable->GetValue() / 2), &LispEtrItrApplication::Send, this, reactedPacket, smrRlocAddr, m_peerPort);
 		NS_LOG_DEBUG(
 			"Invoked Map Request Message Sent to " << Ipv4Address::ConvertFrom(itrAddress));
 	}
 
 	void LispEtrItrApplication::SendMapRequest(Ptr<MapRequestMsg> mapReqMsg)
 	{
-		// TODO: whehter here 64 bytes here is good...
-		uint8_t bufMapReq[64];
-		mapReqMsg->Serialize(bufMapReq);
-		Ptr<Packet> packetMapReqMsg;
-		packetMapReqMsg = Create<Packet>(bufMapReq, 64);
-		MapResolver::ConnectToPeerAddress(
-			m_mapResolverRlocs.front()->GetRlocAddress(),
-			LispOverIp::LISP_SIG_PORT, m_socket);
-		Send(packetMapReqMsg);
+		Ptr<Packet> packetMapReqMsg = mapReqMsg->ToPacket();
+		Send(packetMapReqMsg, m_mapResolverRlocs.front()->GetRlocAddress(),
+			 LispOverIp::LISP_SIG_PORT);
+	}
+
+	void LispEtrItrApplication::QueueMapRequest(Ptr<MapRequestMsg> mapReqMsg)
+	{
+		NS_LOG_FUNCTION(this);
+		if (m_mapRequestCoalescing.IsZero())
+		{
+			SendMapRequest(mapReqMsg);
+			return;
+		}
+
+		if (m_coalescedRequest == 0)
+		{
+			// The first miss of the window: its message carries the following records
+			m_coalescedRequest = mapReqMsg;
+			m_coalescingEvent = Simulator::Schedule(m_mapRequestCoalescing,
+													&LispEtrItrApplication::FlushMapRequests, this);
+			return;
+		}
+
+		Ptr<MapRequestRecord> record = mapReqMsg->GetMapRequestRecord();
+		for (uint8_t i = 0; i < m_coalescedRequest->GetNMapRequestRecords(); i++)
+		{
+			Ptr<MapRequestRecord> pending = m_coalescedRequest->GetMapRequestRecord(i);
+			if (pending->GetEidPrefix() == record->GetEidPrefix() && pending->GetMaskLength() == record->GetMaskLength())
+			{
+				NS_LOG_DEBUG("EID already in the pending Map-Request");
+				return;
+			}
+		}
+		m_coalescedRequest->AddMapRequestRecord(record);
+		NS_LOG_DEBUG("Map-Request coalesced, " << unsigned(m_coalescedRequest->GetNMapRequestRecords()) << " records pending");
+		if (m_coalescedRequest->GetNMapRequestRecords() == MapRequestMsg::MAX_RECORDS)
+		{
+			Simulator::Cancel(m_coalescingEvent);
+			FlushMapRequests();
+		}
+	}
+
+	void LispEtrItrApplication::FlushMapRequests(void)
+	{
+		NS_LOG_FUNCTION(this);
+		Ptr<MapRequestMsg> mapReqMsg = m_coalescedRequest;
+		m_coalescedRequest = 0;
+		if (mapReqMsg != 0)
+		{
+			SendMapRequest(mapReqMsg);
+		}
 	}
 
 	void LispEtrItrApplication::HandleMapSockRead(Ptr<Socket> lispMappingSocket)
 	{
 		NS_LOG_FUNCTION(this);
+		MappingSocketMsgHeader sockMsgHdr;
+		Ptr<MappingSocketMsg> msg;
+		// Messages delivered as objects, then the ones serialized in packets
+		Ptr<LispMappingSocket> mappingSocket = DynamicCast<LispMappingSocket>(lispMappingSocket);
+		while ((msg = mappingSocket->RecvMsg(sockMsgHdr)))
+		{
+			HandleMapSockMsg(sockMsgHdr, msg);
+		}
+
 		Ptr<Packet> packet;
 		Address from;
-
 		while ((packet = lispMappingSocket->RecvFrom(from)))
 		{
-			Ptr<Packet> packetCopy = packet->Copy();
 			NS_LOG_DEBUG(
 				"Receive something from LispOverIp (data plan) through lispMappingSocket:)");
-			MappingSocketMsgHeader sockMsgHdr;
 			packet->RemoveHeader(sockMsgHdr);
 			uint8_t buf[packet->GetSize()];
 			packet->CopyData(buf, packet->GetSize());
-			Ptr<MappingSocketMsg> msg = MappingSocketMsg::Deserialize(buf);
-			// Show LISP control plan message header
-			NS_LOG_DEBUG("MSG HEADER: " << sockMsgHdr);
-			if (sockMsgHdr.GetMapType() == static_cast<uint16_t>(LispMappingSocket::MAPM_MISS))
+			HandleMapSockMsg(sockMsgHdr, MappingSocketMsg::Deserialize(buf));
+		}
+	}
+
+	void LispEtrItrApplication::HandleMapSockMsg(MappingSocketMsgHeader const &sockMsgHdr, Ptr<MappingSocketMsg> msg)
+	{
+		// Show LISP control plan message header
+		NS_LOG_DEBUG("MSG HEADER: " << sockMsgHdr);
+		if (sockMsgHdr.GetMapType() == static_cast<uint16_t>(LispMappingSocket::MAPM_MISS))
+		{
+			// Means that: in kernel space, CacheLookup has been tried, but find nothing... => MAPM_MISS
+			// To support LISP-MN, we allows map request for each EID can be up to 3 times
+			Ptr<EndpointId> eid = msg->GetEndPointId();
+
+			uint8_t currRqstNb = 0;
+			if (IsInRequestList(eid))
+				currRqstNb = GetRequestCount(eid);
+			if (not IsInRequestList(eid) or currRqstNb != LispEtrItrApplication::MAX_REQUEST_NB)
 			{
-				// Means that: in kernel space, CacheLookup has been tried, but find nothing... => MAPM_MISS
-				// To support LISP-MN, we allows map request for each EID can be up to 3 times
-				Ptr<EndpointId> eid = msg->GetEndPointId();
-
-				uint8_t currRqstNb = 0;
-				if (IsInRequestList(eid))
-					currRqstNb = GetRequestCount(eid);
-				if (not IsInRequestList(eid) or currRqstNb != LispEtrItrApplication::MAX_REQUEST_NB)
-				{
-					NS_LOG_DEBUG(
-						"Remote EID" << eid->Print() << " has been requested " << unsigned(currRqstNb) << " times. Start to generate map request message.");
-					Ptr<MapRequestMsg> mapReqMsg =
-						LispEtrItrApplication::GenerateMapRequest(eid, msg->GetEIDSource());
-
-					/* If LISP device is PITR -> Set p bit in MapRequest */
-					Ptr<LispOverIpv4> lisp = m_node->GetObject<LispOverIpv4>();
-					if (lisp->GetPitr())
-						mapReqMsg->SetP2(1);
-					// I'm not sure what happens if one insert a key-value pair into map if the key is alreay existing.
-					if (currRqstNb == 0)
-						// AddInMapReqList will populate m_requestCounter and m_requestList
-						AddInMapReqList(eid, mapReqMsg);
-					else
-						// Increment by 1
-						m_requestCounter.find(eid)->second++;
-					// why each time we want to send map request we bind and connect socket operations??
-					SendMapRequest(mapReqMsg);
-					NS_LOG_DEBUG(
-						"Hence, A Mapping request has been sent in control plan to query for EID..." << msg->GetEndPointId()->Print());
-				}
+				NS_LOG_DEBUG(
+					"Remote EID" << eid->Print() << " has been requested " << unsigned(currRqstNb) << " times. Start to generate map request message.");
+				Ptr<MapRequestMsg> mapReqMsg =
+					LispEtrItrApplication::GenerateMapRequest(eid, msg->GetEIDSource());
+
+				/* If LISP device is PITR -> Set p bit in MapRequest */
+				Ptr<LispOverIpv4> lisp = m_node->GetObject<LispOverIpv4>();
+				if (lisp->GetPitr())
+					mapReqMsg->SetP2(1);
+				// I'm not sure what happens if one insert a key-value pair into map if the key is alreay existing.
+				if (currRqstNb == 0)
+					// AddInMapReqList will populate m_requestCounter and m_requestList
+					AddInMapReqList(eid, mapReqMsg);
 				else
-				{
-					// if and only isInRequestList and count = max.allowed.nb
-					NS_LOG_DEBUG(
-						"Remote EID has been requested up to " << unsigned(LispEtrItrApplication::MAX_REQUEST_NB) << " times! Give up to continue sending map request for this EID");
-					return;
-				}
+					// Increment by 1
+					m_requestCounter.find(eid)->second++;
+				// why each time we want to send map request we bind and connect socket operations??
+				QueueMapRequest(mapReqMsg);
+				NS_LOG_DEBUG(
+					"Hence, A Mapping request has been sent in control plan to query for EID..." << msg->GetEndPointId()->Print());
 			}
-			else if (sockMsgHdr.GetMapType() == static_cast<uint16_t>(LispMappingSocket::MAPM_REGISTER))
+			else
 			{
-
-				/* --- Notifies DataPlane that LISP device is NOT registered (NOT allowed to send data packets)--- */
-				Ptr<MappingSocketMsg> mapSockMsg = Create<MappingSocketMsg>();
-				mapSockMsg->SetEndPoint(
-					Create<EndpointId>(Ipv4Address("0.0.0.0"), Ipv4Mask("/32"))); // Don't care about this endpoint (won't be used)
-				MappingSocketMsgHeader mapSockHeader;
-				mapSockHeader.SetMapType(LispMappingSocket::MAPM_ISREGISTERED);
-				mapSockHeader.SetMapRlocCount(0);
-				mapSockHeader.SetMapVersioning(0);
-
-				mapSockHeader.SetMapAddresses(static_cast<uint16_t>(LispMappingSocket::MAPA_EIDMASK));
-				// MAPA_EID used to say that LISP device is registered.
-				// MAPA_EIDMASK is used to say that LISP device is NOT registered.
-
-				uint8_t buf[256];
-				mapSockMsg->Serialize(buf);
-				Ptr<Packet> packet = Create<Packet>(buf, 256);
-				packet->AddHeader(mapSockHeader);
-				SendToLisp(packet);
-
-				/* --- Start InfoRequest Procedure --- */
-				LispEtrItrApplication::SendInfoRequest();
-				// LispEtrItrApplication::SendMapRegisters();
+				// if and only isInRequestList and count = max.allowed.nb
 				NS_LOG_DEBUG(
-					"Reception from Lisp data plan (LispOverIpv4): Lisp database base is updated. Send a new Map Register message.");
+					"Remote EID has been requested up to " << unsigned(LispEtrItrApplication::MAX_REQUEST_NB) << " times! Give up to continue sending map request for this EID");
+				return;
 			}
 		}
+		else if (sockMsgHdr.GetMapType() == static_cast<uint16_t>(LispMappingSocket::MAPM_REGISTER))
+		{
+
+			/* --- Notifies DataPlane that LISP device is NOT registered (NOT allowed to send data packets)--- */
+			Ptr<MappingSocketMsg> mapSockMsg = Create<MappingSocketMsg>();
+			mapSockMsg->SetEndPoint(
+				Create<EndpointId>(Ipv4Address("0.0.0.0"), Ipv4Mask("/32"))); // Don't care about this endpoint (won't be used)
+			MappingSocketMsgHeader mapSockHeader;
+			mapSockHeader.SetMapType(LispMappingSocket::MAPM_ISREGISTERED);
+			mapSockHeader.SetMapRlocCount(0);
+			mapSockHeader.SetMapVersioning(0);
+
+			mapSockHeader.SetMapAddresses(static_cast<uint16_t>(LispMappingSocket::MAPA_EIDMASK));
+			// MAPA_EID used to say that LISP device is registered.
+			// MAPA_EIDMASK is used to say that LISP device is NOT registered.
+
+			SendToLisp(mapSockHeader, mapSockMsg);
+			m_mapNotifyPending = true;
+
+			/* --- Start InfoRequest Procedure --- */
+			LispEtrItrApplication::SendInfoRequest();
+			// LispEtrItrApplication::SendMapRegisters();
+			NS_LOG_DEBUG(
+				"Reception from Lisp data plan (LispOverIpv4): Lisp database base is updated. Send a new Map Register message.");
+		}
 	}
 
 	std::list<Ptr<MapRequestMsg>> LispEtrItrApplication::GetMapRequestMsgList()
@@ -885,11 +1136,16 @@ namespace ns3
 	MappingSocketMsgHeader LispEtrItrApplication::GenerateMapSocketAddMsgHeader(
 		Ptr<MapReplyMsg> replyMsg)
 	{
+		return GenerateMapSocketAddMsgHeader(replyMsg->GetRecord());
+	}
+
+	MappingSocketMsgHeader LispEtrItrApplication::GenerateMapSocketAddMsgHeader(
+		Ptr<MapReplyRecord> replyRecord)
+	{
 
 		MappingSocketMsgHeader mapSockHeader;
 		mapSockHeader.SetMapType(LispMappingSocket::MAPM_ADD);
 
-		Ptr<MapReplyRecord> replyRecord = replyMsg->GetRecord();
 		if (replyRecord->GetLocatorCount() == 0)
 		{
 			// Negative Map Reply
@@ -906,6 +1162,8 @@ namespace ns3
 			mapSockHeader.SetMapAddresses(
 				(int)mapSockHeader.GetMapAddresses() | static_cast<int>(LispMappingSocket::MAPA_RLOC));
 		}
+		// The map-cache expires the entry after the Record TTL
+		mapSockHeader.SetMapTtl(replyRecord->GetRecordTtl());
 
 		NS_LOG_DEBUG(
 			"After receiving a Map Reply, "
@@ -917,9 +1175,14 @@ namespace ns3
 	Ptr<MappingSocketMsg> LispEtrItrApplication::GenerateMapSocketAddMsgBody(
 		Ptr<MapReplyMsg> replyMsg)
 	{
+		return GenerateMapSocketAddMsgBody(replyMsg->GetRecord());
+	}
+
+	Ptr<MappingSocketMsg> LispEtrItrApplication::GenerateMapSocketAddMsgBody(
+		Ptr<MapReplyRecord> replyRecord)
+	{
 
 		Ptr<MappingSocketMsg> mapSockMsg = Create<MappingSocketMsg>();
-		Ptr<MapReplyRecord> replyRecord = replyMsg->GetRecord();
 		if (replyRecord)
 		{
 			mapSockMsg->SetLocators(replyRecord->GetLocators());
@@ -1015,36 +1278,31 @@ namespace ns3
 	{
 		NS_LOG_FUNCTION(this);
 		Ptr<MapReplyMsg> mapReply = Create<MapReplyMsg>(); // Smart pointer, default value is 0
-		Ptr<MapRequestRecord> record = requestMsg->GetMapRequestRecord();
-		Ptr<MapEntry> entry;
-		if (record->GetAfi() == LispControlMsg::IP)
-		{
-			// TODO May be use mapping socket instead
-			NS_LOG_DEBUG("Execute database look up for EID: " << Ipv4Address::ConvertFrom(record->GetEidPrefix()));
-			entry = m_mapTablesV4->DatabaseLookup(record->GetEidPrefix());
-		}
-		else if (record->GetAfi() == LispControlMsg::IPV6)
-		{
-			NS_LOG_DEBUG("Execute database look up for EID: " << Ipv6Address::ConvertFrom(record->GetEidPrefix()));
-			entry = m_mapTablesV6->DatabaseLookup(record->GetEidPrefix());
-		}
-		if (entry == 0)
-		{
-			// TODO: Should implement negative map-reply case.
-			NS_LOG_DEBUG("Send Negative Map-Reply");
-			// Now we simply return a 0 in case of negative map reply.
-
-			return 0;
-		}
-		else
+		mapReply->SetNonce(requestMsg->GetNonce());
+		// A coalesced Map-Request is answered with one record per EID found in the database
+		for (uint8_t i = 0; i < requestMsg->GetNMapRequestRecords(); i++)
 		{
-			// std::cout << Ipv4Address::ConvertFrom(entry->GetEidPrefix()->GetEidAddress()) << std::endl;
-			NS_LOG_DEBUG("Send Map-Reply to ITR");
+			Ptr<MapRequestRecord> record = requestMsg->GetMapRequestRecord(i);
+			Ptr<MapEntry> entry;
+			if (record->GetAfi() == LispControlMsg::IP)
+			{
+				// TODO May be use mapping socket instead
+				NS_LOG_DEBUG("Execute database look up for EID: " << Ipv4Address::ConvertFrom(record->GetEidPrefix()));
+				entry = m_mapTablesV4->DatabaseLookup(record->GetEidPrefix());
+			}
+			else if (record->GetAfi() == LispControlMsg::IPV6)
+			{
+				NS_LOG_DEBUG("Execute database look up for EID: " << Ipv6Address::ConvertFrom(record->GetEidPrefix()));
+				entry = m_mapTablesV6->DatabaseLookup(record->GetEidPrefix());
+			}
+			if (entry == 0)
+			{
+				// TODO: Should implement negative map-reply case.
+				NS_LOG_DEBUG("No mapping for this record, no Map-Reply record");
+				continue;
+			}
 
 			Ptr<MapReplyRecord> replyRecord = Create<MapReplyRecord>();
-
-			mapReply->SetNonce(requestMsg->GetNonce());
-			mapReply->SetRecordCount(1);
 			replyRecord->SetAct(MapReplyRecord::NoAction);
 			replyRecord->SetA(1);
 			replyRecord->SetMapVersionNumber(entry->GetVersionNumber());
@@ -1059,11 +1317,18 @@ namespace ns3
 					entry->GetEidPrefix()->GetIpv6Prefix().GetPrefixLength());
 
 			replyRecord->SetLocators(entry->GetLocators());
-			mapReply->SetRecord(replyRecord);
-			NS_LOG_DEBUG(
-				"MAP REPLY READY, Its content is as follows:\n"
-				<< *mapReply);
+			mapReply->AddRecord(replyRecord);
 		}
+		if (mapReply->GetNRecords() == 0)
+		{
+			// Now we simply return a 0 in case of negative map reply.
+			NS_LOG_DEBUG("Send Negative Map-Reply");
+			return 0;
+		}
+		NS_LOG_DEBUG("Send Map-Reply to ITR");
+		NS_LOG_DEBUG(
+			"MAP REPLY READY, Its content is as follows:\n"
+			<< *mapReply);
 		return mapReply;
 	}
 
@@ -1087,11 +1352,8 @@ namespace ns3
 		m_mapTablesV6->GetMapEntryList(MapTables::IN_DATABASE, mapEntries);
 		Ptr<MapEntry> entry;
 		/**
-		 * For the case where database just has one map entry, the following code works well.
-		 * However, we should implement a list of records. Question:
-		 * It is possible that a map reply can convey more than one record?
-		 * For example, a LISP-MN with ipv4 and ipv6 address at the same time.
-		 * I think yes...
+		 * One record per database entry, e.g. a LISP-MN with an ipv4 and an ipv6
+		 * address at the same time.
 		 */
 		for (std::list<Ptr<MapEntry>>::const_iterator it = mapEntries.begin();
 			 it != mapEntries.end(); ++it)
@@ -1101,7 +1363,6 @@ namespace ns3
 			Ptr<MapReplyRecord> replyRecord = Create<MapReplyRecord>();
 
 			mapReply->SetNonce(requestMsg->GetNonce());
-			mapReply->SetRecordCount(1);
 			replyRecord->SetAct(MapReplyRecord::NoAction);
 			replyRecord->SetA(1);
 			replyRecord->SetMapVersionNumber(entry->GetVersionNumber());
@@ -1116,7 +1377,7 @@ namespace ns3
 					entry->GetEidPrefix()->GetIpv6Prefix().GetPrefixLength());
 
 			replyRecord->SetLocators(entry->GetLocators());
-			mapReply->SetRecord(replyRecord);
+			mapReply->AddRecord(replyRecord);
 			NS_LOG_DEBUG(
 				"MAP REPLY READY, Its content is as follows:\n"
 				<< *mapReply);
@@ -1169,12 +1430,12 @@ namespace ns3
 		return mapReqMsg;
 	}
 
-	void LispEtrItrApplication::Send(Ptr<Packet> packet)
+	void LispEtrItrApplication::Send(Ptr<Packet> packet, Address peerAddress, uint16_t peerPort)
 	{
-		NS_LOG_FUNCTION(this);
+		NS_LOG_FUNCTION(this << peerAddress << peerPort);
 
 		NS_ASSERT(m_event.IsExpired());
-		m_socket->Send(packet);
+		MapResolver::SendToPeer(m_socket, packet, peerAddress, peerPort);
 		++m_sent;
 	}
 
@@ -1389,12 +1650,8 @@ namespace ns3
 					MappingSocketMsgHeader mapSockHeader = GenerateMapSocketAddMsgHeaderForRtr();
 					NS_ASSERT_MSG(mapSockMsg != 0,
 								  "Cannot create map socket message body for RTR !!! Please check why.");
-					uint8_t buf[256];
-					mapSockMsg->Serialize(buf);
-					Ptr<Packet> packet = Create<Packet>(buf, 256);
-					packet->AddHeader(mapSockHeader);
 					// Send to lispOverIp object so that it can insert the mapping entry in Cache.
-					SendToLisp(packet);
+					SendToLisp(mapSockHeader, mapSockMsg);
 
 					/*
 					Send Special MapRegister messages with RTR RLOC
@@ -1420,12 +1677,8 @@ namespace ns3
 					mapSockHeader.SetMapAddresses(
 						(int)mapSockHeader.GetMapAddresses() | static_cast<int>(LispMappingSocket::MAPA_EIDMASK));
 
-					uint8_t buf[256];
-					mapSockMsg->Serialize(buf);
-					Ptr<Packet> packet = Create<Packet>(buf, 256);
-					packet->AddHeader(mapSockHeader);
 					// Send to lispOverIp object so that it knows it is not NATed.
-					SendToLisp(packet);
+					SendToLisp(mapSockHeader, mapSockMsg);
 					/* Send classic MapRegisters messages */
 					SendMapRegisters();
 				}
@@ -32,10 +32,16 @@
 #include "ns3/map-reply-msg.h"
 #include "ns3/info-request-msg.h"
 #include "ns3/map-register-msg.h"
+#include "ns3/map-notify-msg.h"
+#include "ns3/map-server-shards.h"
 #include "ns3/mapping-socket-msg-header.h"
 #include "ns3/mapping-socket-msg.h"
 #include "ns3/locators-impl.h"
 #include "ns3/string.h"
+#include "ns3/random-variable-stream.h"
+#include <map>
+#include <set>
+#include <vector>
 
 
 namespace ns3
@@ -62,6 +68,11 @@ public:
   void SetMapServerAddresses (std::list<Address> mapServerAddress);
   //TODO: implement this getter. useful for DHCP
   std::list<Address> GetMapServerAddresses (std::list<Address> mapServerAddress);
+  /**
+   * \brief Register each EID-Prefix with the Map-Server of its shard,
+   * instead of the first Map-Server address.
+   */
+  void SetMapServerShards (Ptr<MapServerShards> mapServerShards);
   void SetMapTables (Ptr<MapTables> mapTablesV4, Ptr<MapTables> mapTablesV6);
   void AddMapResolverLoc (Ptr<Locator> locator);
   //TODO: implement this getter. useful for DHCP
@@ -75,6 +86,11 @@ public:
     be those of the LISP device.
     If rtr is set to True, this means that all locators will be replaced with the
     locator of an RTR.
+
+    Only the database entries that changed since they were last registered
+    (or that are older than MapRegisterRefresh) are sent, packed by up to
+    MapRegisterRecords records per Map-Register. If MapRegisterInterval is not
+    zero, the next refresh is scheduled.
   */
   void SendMapRegisters(bool rtr = false);
 
@@ -100,6 +116,15 @@ public:
    */
   virtual void SendMapRequest(Ptr<MapRequestMsg> mapRequestMsg);
 
+  /**
+   * \brief Send a map request message triggered by a cache miss.
+   *
+   * If the MapRequestCoalescing attribute is not zero, the record is added to
+   * the pending Map-Request instead, which is sent to the Map-Resolver when
+   * the coalescing window expires (or when it is full).
+   */
+  void QueueMapRequest(Ptr<MapRequestMsg> mapRequestMsg);
+
 //protected:
   /**
    * \brief Schedule the next packet transmission
@@ -108,8 +133,17 @@ public:
   void ScheduleTransmit (Time dt);
 
   void SendToLisp (Ptr<Packet> packet);
+  /**
+   * \brief Send a mapping message to the data plane, as an object when the
+   * mapping socket supports it (see LispMappingSocket::SendMsg).
+   */
+  void SendToLisp (const MappingSocketMsgHeader &mapSockHeader, Ptr<MappingSocketMsg> mapSockMsg);
 
-  void Send (Ptr<Packet> packet);
+  /**
+   * \brief Send a control message to a peer on m_socket, which is not
+   * connected: the replies to several peers may be pending at once.
+   */
+  void Send (Ptr<Packet> packet, Address peerAddress, uint16_t peerPort);
 
   /**
    * \brief Handle a packet reception.
@@ -124,6 +158,7 @@ public:
   virtual void HandleControlMsg(Ptr<Packet> packet, Address from);
 
   void HandleMapSockRead (Ptr<Socket> lispMappingSocket);
+  void HandleMapSockMsg (MappingSocketMsgHeader const &sockMsgHdr, Ptr<MappingSocketMsg> msg);
 
   bool IsInRequestList (Ptr<EndpointId> eid) const;
   bool IsInRequestCounter (Ptr<EndpointId> eid) const;
@@ -144,7 +179,9 @@ public:
   Ptr<MapRequestMsg> GenerateMapRequest(Ptr<EndpointId> eid, Address host = Address(Ipv4Address()));
   virtual Ptr<MapReplyMsg> GenerateMapReply(Ptr<MapRequestMsg> msg);
   Ptr<MappingSocketMsg> GenerateMapSocketAddMsgBody(Ptr<MapReplyMsg> replyMsg);
+  Ptr<MappingSocketMsg> GenerateMapSocketAddMsgBody(Ptr<MapReplyRecord> replyRecord);
   MappingSocketMsgHeader GenerateMapSocketAddMsgHeader(Ptr<MapReplyMsg> replyMsg);
+  MappingSocketMsgHeader GenerateMapSocketAddMsgHeader(Ptr<MapReplyRecord> replyRecord);
   Ptr<MapReplyMsg> GenerateMapReply4ChangedMapping (Ptr<MapRequestMsg> requestMsg);
   Ptr<MappingSocketMsg> GenerateMapSocketAddMsgBodyForRtr(Address rtrAddress);
   MappingSocketMsgHeader GenerateMapSocketAddMsgHeaderForRtr(void);
@@ -161,6 +198,37 @@ protected:
 
   virtual void StopApplication (void);
 
+  /**
+   * \brief Send the pending coalesced Map-Request.
+   */
+  void FlushMapRequests (void);
+
+  /**
+   * \return A random delay in [0, MapRegisterJitter].
+   */
+  Time GetMapRegisterJitter (void);
+  /**
+   * \brief Schedule the next Map-Register refresh, unless one is pending,
+   * and the retransmission of the records not acknowledged yet.
+   */
+  void ScheduleMapRegisters (void);
+  void RefreshMapRegisters (void);
+  /**
+   * \brief Register again the records some Map-Server did not acknowledge.
+   */
+  void RetransmitMapRegisters (void);
+  bool HasUnackedRegistrations (void) const;
+  void SendMapRegister (Ptr<MapRegisterMsg> msg, Address mapServer);
+  /**
+   * \return The Map-Servers a database entry is registered with.
+   */
+  std::vector<Address> GetMapServers (Ptr<MapEntry> mapEntry) const;
+  /**
+   * \brief Mark as registered with mapServer the EID-Prefixes whose record
+   * is acknowledged by its Map-Notify.
+   */
+  void AcknowledgeRegistrations (Ptr<MapNotifyMsg> mapNotify, Address mapServer);
+
   bool m_requestSent;
   bool m_recvIvkSmr;
   EventId m_resendSmrEvent;                //!< Message refresh event
@@ -171,6 +239,8 @@ protected:
   // each etr is configure with the address of the map
   // server it must register to
   std::list<Address> m_mapServerAddress;
+  // the pool of Map-Servers sharing the EID space, if any
+  Ptr<MapServerShards> m_mapServerShards;
   // a map table containing the prefixes it is responsible for
   Ptr<MapTables> m_mapTablesV4;
   Ptr<MapTables> m_mapTablesV6;
@@ -186,6 +256,30 @@ protected:
 
   Ptr<RandomVariableStream> m_rttVariable; //!< RV representing the distribution of RTTs between xTRs
 
+  Time m_mapRequestCoalescing; //!< Window during which the misses share a Map-Request
+  Ptr<MapRequestMsg> m_coalescedRequest; //!< Map-Request being filled, 0 if none
+  EventId m_coalescingEvent; //!< Sends m_coalescedRequest
+
+  /// The last record registered for an EID-Prefix, and when.
+  struct Registration
+  {
+    std::vector<uint8_t> record; //!< The serialized record
+    Time time;
+    std::set<Address> unacked; //!< The Map-Servers whose Map-Notify did not acknowledge the record yet
+  };
+  typedef std::map<Ptr<EndpointId>, Registration, MapTables::CompareEndpointId> RegistrationList_t;
+  RegistrationList_t m_registrations; //!< The EID-Prefixes registered
+  uint8_t m_mapRegisterRecords; //!< Maximum number of records per Map-Register
+  Time m_mapRegisterInterval; //!< Period of the Map-Register refreshes, 0 if none
+  Time m_mapRegisterRefresh; //!< Age at which an unchanged record is registered again
+  Time m_mapRegisterJitter; //!< Maximum random delay of the registrations
+  Ptr<UniformRandomVariable> m_mapRegisterJitterVariable; //!< Created if there is a jitter
+  EventId m_mapRegisterEvent; //!< Next Map-Register refresh
+  Time m_mapRegisterRetransmit; //!< Delay before registering the unacknowledged records again, 0 if none
+  EventId m_mapRegisterRetransmitEvent; //!< Next retransmission of the unacknowledged records
+  bool m_registerThroughRtr; //!< The xTR registers the RLOC of its RTR
+  bool m_mapNotifyPending; //!< The data plane waits for a Map-Notify
+
   Ptr<Socket> m_lispMappingSocket; //Socket for communication with dataplane
   Ptr<Socket> m_socket; // emeline: Socket for communication with MS (MapRegister) and MR (MapRequest)
   Ptr<Socket> m_lispCtlMsgRcvSocket; // Socket to receive Control messages (MapRequest/MapReply)
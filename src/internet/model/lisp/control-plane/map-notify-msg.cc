@@ -31,12 +31,10 @@ namespace ns3
   {
     m_nonce = 0;
     m_recordCount = 0;
-    m_record = 0;
   }
 
   MapNotifyMsg::~MapNotifyMsg ()
   {
-    m_record = 0;
   }
 
   uint8_t
@@ -90,17 +88,56 @@ namespace ns3
   void
   MapNotifyMsg::SetRecord (Ptr<MapReplyRecord> record)
   {
-    m_record = record;
+    m_records.clear ();
+    m_records.push_back (record);
+    m_recordCount = 1;
   }
 
   Ptr<MapReplyRecord>
   MapNotifyMsg::GetRecord (void)
   {
-    return m_record;
+    if (m_records.empty ())
+      {
+        return 0;
+      }
+    return m_records.front ();
+  }
+
+  void
+  MapNotifyMsg::AddRecord (Ptr<MapReplyRecord> record)
+  {
+    NS_ASSERT_MSG (m_records.size () < MAX_RECORDS, "Too many records in Map-Notify");
+    m_records.push_back (record);
+    m_recordCount = m_records.size ();
+  }
+
+  Ptr<MapReplyRecord>
+  MapNotifyMsg::GetRecord (uint8_t idx)
+  {
+    NS_ASSERT (idx < m_records.size ());
+    return m_records[idx];
+  }
+
+  uint8_t
+  MapNotifyMsg::GetNRecords (void) const
+  {
+    return m_records.size ();
+  }
+
+  uint32_t
+  MapNotifyMsg::GetSerializedSize (void) const
+  {
+    uint32_t size = 16 + m_authDataLen;
+    for (std::vector<Ptr<MapReplyRecord> >::const_iterator it = m_records.begin ();
+         it != m_records.end (); ++it)
+      {
+        size += (*it)->GetSerializedSize ();
+      }
+    return size;
   }
 
   void
-  MapNotifyMsg::Serialize (uint8_t *buf)
+  MapNotifyMsg::Serialize (uint8_t *buf) const
   {
     //NS_LOG_FUNCTION(this);
     uint8_t type = static_cast<uint8_t> (LispControlMsg::MAP_NOTIFY) << 4;
@@ -108,7 +145,7 @@ namespace ns3
     buf[0] = type;
     buf[1] = 0x00;
     buf[2] = 0x00;
-    buf[3] = m_recordCount;
+    buf[3] = m_records.size ();
 
     for (int i = 0; i < MapNotifyMsg::NONCE_LEN; i++)
       {
@@ -124,7 +161,7 @@ namespace ns3
 	buf[14 + i] = (m_authDataLen >> 8 * (MapNotifyMsg::AUTHEN_LEN_SIZE - 1 - i)) & 0xff;
       }
 
-    uint8_t size = 16;
+    uint32_t size = 16;
     // Authentication data field
     buf[16] = 0xaa;
     buf[17] = 0xbb;
@@ -133,7 +170,12 @@ namespace ns3
 
     size += m_authDataLen;
 
-    m_record->Serialize (buf + size);
+    for (std::vector<Ptr<MapReplyRecord> >::const_iterator it = m_records.begin ();
+         it != m_records.end (); ++it)
+      {
+        (*it)->Serialize (buf + size);
+        size += (*it)->GetSerializedSize ();
+      }
   }
 
   Ptr<MapNotifyMsg>
@@ -141,7 +183,7 @@ namespace ns3
   {
     Ptr<MapNotifyMsg> msg = Create<MapNotifyMsg> ();
 
-    msg->SetRecordCount (buf[3]);
+    uint8_t recordCount = buf[3];
 
     uint64_t nonce = 0;
 
@@ -152,7 +194,7 @@ namespace ns3
       }
     msg->SetNonce (nonce);
 
-    uint8_t size = 12;
+    uint32_t size = 12;
 
     // Retrieve key ID field
     uint16_t keyID = 0;
@@ -188,7 +230,12 @@ namespace ns3
     NS_LOG_DEBUG(
 	"Decoded Record Count: "<<unsigned(buf[3])<< ";Decoded Key ID: "<<keyID<< ";Authentication data length: "<<authDataLen<< ";Authentication data: "<<authData);
     //but is actually the address of the first element in buf array!
-    msg->SetRecord (MapReplyRecord::Deserialize (buf + size));
+    for (uint8_t i = 0; i < recordCount; i++)
+      {
+        Ptr<MapReplyRecord> record = MapReplyRecord::Deserialize (buf + size);
+        msg->AddRecord (record);
+        size += record->GetSerializedSize ();
+      }
     return msg;
   }
 
@@ -20,6 +20,8 @@
 #ifndef SRC_INTERNET_MODEL_LISP_CONTROL_PLANE_MAP_NOTIFY_MSG_H_
 #define SRC_INTERNET_MODEL_LISP_CONTROL_PLANE_MAP_NOTIFY_MSG_H_
 
+#include <vector>
+
 #include "lisp-control-msg.h"
 #include "map-reply-msg.h"
 
@@ -33,6 +35,7 @@ namespace ns3
     static const int AUTHEN_LEN_SIZE; //!< how many bytes occupied by Authentification Data Length, constant 2
     static const int NONCE_LEN ; //!< how many bytes occupied by Nonce field,
     static const int KEYID_LEN;
+    static const uint8_t MAX_RECORDS = 255;
     MapNotifyMsg ();
     virtual
     ~MapNotifyMsg ();
@@ -52,13 +55,30 @@ namespace ns3
     uint16_t
     GetAuthDataLen (void);
 
+    /**
+     * \brief Replace the records of the message by a single record.
+     */
     void
     SetRecord (Ptr<MapReplyRecord> record);
+    /**
+     * \return The first record of the message, 0 if there is none.
+     */
     Ptr<MapReplyRecord>
     GetRecord (void);
-
+    /**
+     * \brief Append a record to the message (at most MAX_RECORDS).
+     */
     void
-    Serialize (uint8_t *buf);
+    AddRecord (Ptr<MapReplyRecord> record);
+    Ptr<MapReplyRecord>
+    GetRecord (uint8_t idx);
+    uint8_t
+    GetNRecords (void) const;
+
+    virtual uint32_t
+    GetSerializedSize (void) const;
+    virtual void
+    Serialize (uint8_t *buf) const;
     static Ptr<MapNotifyMsg>
     Deserialize (uint8_t *buf);
 
@@ -84,7 +104,7 @@ namespace ns3
     uint16_t m_keyID;
     uint16_t m_authDataLen; //Authentication Data Length
     uint32_t m_authData;	//Authentication Data
-    Ptr<MapReplyRecord> m_record;
+    std::vector<Ptr<MapReplyRecord> > m_records;
   };
 
 } /* namespace ns3 */
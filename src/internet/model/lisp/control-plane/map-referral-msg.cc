@@ -19,18 +19,151 @@
  */
 #include "map-referral-msg.h"
 
+#include "ns3/log.h"
+#include "ns3/assert.h"
+
 namespace ns3
 {
 
-  MapReferralMsg::MapReferralMsg ()
-  {
-    // TODO Auto-generated constructor stub
+NS_LOG_COMPONENT_DEFINE ("MapReferralMsg");
+
+MapReferralMsg::MapReferralMsg ()
+  : m_nonce (0)
+{
+}
+
+MapReferralMsg::~MapReferralMsg ()
+{
+}
+
+void
+MapReferralMsg::SetNonce (uint64_t nonce)
+{
+  m_nonce = nonce;
+}
+
+uint64_t
+MapReferralMsg::GetNonce (void) const
+{
+  return m_nonce;
+}
+
+void
+MapReferralMsg::AddRecord (Ptr<MapReplyRecord> record)
+{
+  NS_ASSERT_MSG (m_records.size () < MAX_RECORDS, "Too many records in Map-Referral");
+  m_records.push_back (record);
+}
+
+Ptr<MapReplyRecord>
+MapReferralMsg::GetRecord (uint8_t idx) const
+{
+  NS_ASSERT (idx < m_records.size ());
+  return m_records[idx];
+}
+
+uint8_t
+MapReferralMsg::GetNRecords (void) const
+{
+  return m_records.size ();
+}
 
-  }
+MapReferralMsg::ReferralAction
+MapReferralMsg::GetReferralAction (Ptr<MapReplyRecord> record)
+{
+  return static_cast<ReferralAction> (record->GetAct ());
+}
 
-  MapReferralMsg::~MapReferralMsg ()
-  {
-    // TODO Auto-generated destructor stub
-  }
+void
+MapReferralMsg::SetReferralAction (Ptr<MapReplyRecord> record, ReferralAction action)
+{
+  record->SetAct (static_cast<MapReplyRecord::ACT> (action));
+}
+
+bool
+MapReferralMsg::IsNegative (ReferralAction action)
+{
+  return action == MS_NOT_REGISTERED || action == DELEGATION_HOLE
+         || action == NOT_AUTHORITATIVE;
+}
+
+uint32_t
+MapReferralMsg::GetSerializedSize (void) const
+{
+  uint32_t size = 12;
+  for (std::vector<Ptr<MapReplyRecord> >::const_iterator it = m_records.begin ();
+       it != m_records.end (); ++it)
+    {
+      size += (*it)->GetSerializedSize ();
+    }
+  return size;
+}
+
+void
+MapReferralMsg::Serialize (uint8_t *buf) const
+{
+  buf[0] = static_cast<uint8_t> (GetMsgType ()) << 4;
+  buf[1] = 0x00;
+  buf[2] = 0x00;
+  buf[3] = m_records.size ();
+  for (int i = 0; i < 8; i++)
+    {
+      buf[4 + i] = (m_nonce >> 8 * (7 - i)) & 0xff;
+    }
+  uint32_t position = 12;
+  for (std::vector<Ptr<MapReplyRecord> >::const_iterator it = m_records.begin ();
+       it != m_records.end (); ++it)
+    {
+      (*it)->Serialize (buf + position);
+      position += (*it)->GetSerializedSize ();
+    }
+}
+
+Ptr<MapReferralMsg>
+MapReferralMsg::Deserialize (uint8_t *buf)
+{
+  Ptr<MapReferralMsg> msg = Create<MapReferralMsg> ();
+  uint8_t recordCount = buf[3];
+  uint64_t nonce = 0;
+  for (int i = 0; i < 8; i++)
+    {
+      nonce <<= 8;
+      nonce |= buf[4 + i];
+    }
+  msg->SetNonce (nonce);
+  uint32_t position = 12;
+  for (uint8_t i = 0; i < recordCount; i++)
+    {
+      Ptr<MapReplyRecord> record = MapReplyRecord::Deserialize (buf + position);
+      msg->AddRecord (record);
+      position += record->GetSerializedSize ();
+    }
+  return msg;
+}
+
+void
+MapReferralMsg::Print (std::ostream& os) const
+{
+  os << "Nonce: " << m_nonce << " Record Count: " << m_records.size ();
+  for (std::vector<Ptr<MapReplyRecord> >::const_iterator it = m_records.begin ();
+       it != m_records.end (); ++it)
+    {
+      os << " Referral-Record: ";
+      (*it)->Print (os);
+    }
+  os << std::endl;
+}
+
+LispControlMsg::LispControlMsgType
+MapReferralMsg::GetMsgType (void)
+{
+  return LispControlMsg::MAP_REFERRAL;
+}
+
+std::ostream& operator<< (std::ostream& os, MapReferralMsg const& mapReferral)
+{
+  mapReferral.Print (os);
+  return os;
+}
 
 } /* namespace ns3 */
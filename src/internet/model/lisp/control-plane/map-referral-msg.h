@@ -21,21 +21,72 @@
 #define SRC_INTERNET_MODEL_LISP_CONTROL_PLANE_MAP_REFERRAL_MSG_H_
 
 #include "lisp-control-msg.h"
+#include "map-reply-record.h"
+
+#include <vector>
+
 namespace ns3
 {
 
+/**
+ * \brief LISP-DDT Map-Referral (RFC 8111, section 6.4).
+ *
+ * A DDT node answers a DDT Map-Request with a Map-Referral that carries one
+ * record per requested EID. The records have the format of the Map-Reply
+ * records: the locators are the RLOCs of the DDT nodes or Map-Servers the
+ * EID-Prefix is delegated to, and the ACT field holds the referral action.
+ */
 class MapReferralMsg : public LispControlMsg
 {
 public:
+  /// The record count is an 8-bit field.
+  static const uint8_t MAX_RECORDS = 255;
+
+  enum ReferralAction
+  {
+    NODE_REFERRAL = 0,     //!< Ask the DDT nodes in the referral set.
+    MS_REFERRAL = 1,       //!< Ask the Map-Servers in the referral set.
+    MS_ACK = 2,            //!< A Map-Server accepted the request.
+    MS_NOT_REGISTERED = 3, //!< The Map-Server has no registration for the EID.
+    DELEGATION_HOLE = 4,   //!< The EID-Prefix is not delegated.
+    NOT_AUTHORITATIVE = 5, //!< The DDT node is not authoritative for the EID.
+  };
+
   MapReferralMsg ();
   virtual
   ~MapReferralMsg ();
 
-  // PLACEHOLDER FOR MAP-REFERRAL
-private:
+  void SetNonce (uint64_t nonce);
+  uint64_t GetNonce (void) const;
 
+  /**
+   * \brief Append a record to the message (at most MAX_RECORDS).
+   */
+  void AddRecord (Ptr<MapReplyRecord> record);
+  Ptr<MapReplyRecord> GetRecord (uint8_t idx) const;
+  uint8_t GetNRecords (void) const;
+
+  static ReferralAction GetReferralAction (Ptr<MapReplyRecord> record);
+  static void SetReferralAction (Ptr<MapReplyRecord> record, ReferralAction action);
+  /**
+   * \return True if action tells that there is no mapping for the EID-Prefix.
+   */
+  static bool IsNegative (ReferralAction action);
+
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (uint8_t *buf) const;
+  static Ptr<MapReferralMsg> Deserialize (uint8_t *buf);
+
+  void Print (std::ostream& os) const;
+  static LispControlMsg::LispControlMsgType GetMsgType (void);
+
+private:
+  std::vector<Ptr<MapReplyRecord> > m_records;
+  uint64_t m_nonce; //!< Nonce echoed from the DDT Map-Request
 };
 
+std::ostream& operator<< (std::ostream& os, MapReferralMsg const& mapReferral);
+
 } /* namespace ns3 */
 
 #endif /* SRC_INTERNET_MODEL_LISP_CONTROL_PLANE_MAP_REFERRAL_MSG_H_ */
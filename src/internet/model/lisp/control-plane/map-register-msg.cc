@@ -27,11 +27,9 @@ MapRegisterMsg::MapRegisterMsg() {
 	m_M = 0;
 	m_nonce = 0;
 	m_recordCount = 0;
-	m_record = 0;
 }
 
 MapRegisterMsg::~MapRegisterMsg() {
-	m_record = 0;
 }
 
 uint8_t MapRegisterMsg::GetP(void) {
@@ -87,21 +85,48 @@ uint16_t MapRegisterMsg::GetAuthDataLen(void){
 uint64_t GetNonce(void);
 
 void MapRegisterMsg::SetRecord(Ptr<MapReplyRecord> record) {
-	m_record = record;
+	m_records.clear();
+	m_records.push_back(record);
+	m_recordCount = 1;
 }
 
 Ptr<MapReplyRecord> MapRegisterMsg::GetRecord(void) {
-	return m_record;
+	if (m_records.empty())
+		return 0;
+	return m_records.front();
 }
 
-void MapRegisterMsg::Serialize(uint8_t *buf) {
+void MapRegisterMsg::AddRecord(Ptr<MapReplyRecord> record) {
+	NS_ASSERT_MSG(m_records.size() < MAX_RECORDS, "Too many records in Map-Register");
+	m_records.push_back(record);
+	m_recordCount = m_records.size();
+}
+
+Ptr<MapReplyRecord> MapRegisterMsg::GetRecord(uint8_t idx) {
+	NS_ASSERT(idx < m_records.size());
+	return m_records[idx];
+}
+
+uint8_t MapRegisterMsg::GetNRecords(void) const {
+	return m_records.size();
+}
+
+uint32_t MapRegisterMsg::GetSerializedSize(void) const {
+	uint32_t size = 16 + m_authDataLen;
+	for (std::vector<Ptr<MapReplyRecord> >::const_iterator it =
+			m_records.begin(); it != m_records.end(); ++it)
+		size += (*it)->GetSerializedSize();
+	return size;
+}
+
+void MapRegisterMsg::Serialize(uint8_t *buf) const {
 	//NS_LOG_FUNCTION(this);
 	uint8_t type = static_cast<uint8_t>(LispControlMsg::MAP_REGISTER) << 4;
 
 	buf[0] = (type) | (m_P << 3);
 	buf[1] = m_P;
 	buf[2] = m_M;
-	buf[3] = m_recordCount;
+	buf[3] = m_records.size();
 
 	int nonce_size = 8;
 	for(int i=0; i< nonce_size; i++){
@@ -118,7 +143,7 @@ void MapRegisterMsg::Serialize(uint8_t *buf) {
 		buf[14+i] = (m_authDataLen >> 8*(authen_len_size - 1 -i)) & 0xff;
 	}
 
-	uint8_t size = 16;
+	uint32_t size = 16;
 	// Authentication data field
 	buf[16] = 0xaa;
 	buf[17] = 0xbb;
@@ -127,7 +152,11 @@ void MapRegisterMsg::Serialize(uint8_t *buf) {
 
 	size += m_authDataLen;
 
-	m_record->Serialize(buf + size);
+	for (std::vector<Ptr<MapReplyRecord> >::const_iterator it =
+			m_records.begin(); it != m_records.end(); ++it) {
+		(*it)->Serialize(buf + size);
+		size += (*it)->GetSerializedSize();
+	}
 }
 
 Ptr<MapRegisterMsg> MapRegisterMsg::Deserialize(uint8_t *buf) {
@@ -135,7 +164,7 @@ Ptr<MapRegisterMsg> MapRegisterMsg::Deserialize(uint8_t *buf) {
 	msg->SetP(buf[1]);
 	msg->SetM(buf[2]);
 
-	msg->SetRecordCount(buf[3]);
+	uint8_t recordCount = buf[3];
 
 	uint64_t nonce = 0;
 
@@ -146,7 +175,7 @@ Ptr<MapRegisterMsg> MapRegisterMsg::Deserialize(uint8_t *buf) {
 		nonce |= buf[4+i];
 	}
 	msg->SetNonce(nonce);
-	uint8_t size = 12;
+	uint32_t size = 12;
 
 	// Retrieve key ID field
 	int keyID_size = 2;
@@ -185,7 +214,11 @@ Ptr<MapRegisterMsg> MapRegisterMsg::Deserialize(uint8_t *buf) {
 			";Authentication data: "<<authData
 	);
 	//but is actually the address of the first element in buf array!
-	msg->SetRecord(MapReplyRecord::Deserialize(buf + size));
+	for (uint8_t i = 0; i < recordCount; i++) {
+		Ptr<MapReplyRecord> record = MapReplyRecord::Deserialize(buf + size);
+		msg->AddRecord(record);
+		size += record->GetSerializedSize();
+	}
 	return msg;
 }
 
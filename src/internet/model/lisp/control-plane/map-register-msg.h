@@ -20,6 +20,8 @@
 #ifndef SRC_INTERNET_MODEL_LISP_CONTROL_PLANE_MAP_REGISTER_MSG_H_
 #define SRC_INTERNET_MODEL_LISP_CONTROL_PLANE_MAP_REGISTER_MSG_H_
 
+#include <vector>
+
 #include "lisp-control-msg.h"
 #include "map-reply-msg.h"
 /**
@@ -33,6 +35,7 @@ namespace ns3 {
 class MapRegisterMsg: public LispControlMsg {
 public:
 	static const LispControlMsgType msgType;
+	static const uint8_t MAX_RECORDS = 255;
 	MapRegisterMsg();
 	virtual
 	~MapRegisterMsg();
@@ -52,10 +55,23 @@ public:
 	void SetAuthDataLen(uint16_t authDataLen);
 	uint16_t GetAuthDataLen(void);
 
+	/**
+	 * \brief Replace the records of the message by a single record.
+	 */
 	void SetRecord(Ptr<MapReplyRecord> record);
+	/**
+	 * \return The first record of the message, 0 if there is none.
+	 */
 	Ptr<MapReplyRecord> GetRecord(void);
-
-	void Serialize(uint8_t *buf);
+	/**
+	 * \brief Append a record to the message (at most MAX_RECORDS).
+	 */
+	void AddRecord(Ptr<MapReplyRecord> record);
+	Ptr<MapReplyRecord> GetRecord(uint8_t idx);
+	uint8_t GetNRecords(void) const;
+
+	virtual uint32_t GetSerializedSize(void) const;
+	virtual void Serialize(uint8_t *buf) const;
 	static Ptr<MapRegisterMsg> Deserialize(uint8_t *buf);
 
 	static LispControlMsg::LispControlMsgType GetMsgType(void);
@@ -77,7 +93,7 @@ public:
 	uint16_t m_keyID;
 	uint16_t m_authDataLen; //Authentication Data Length
 	uint32_t m_authData;	//Authentication Data
-	Ptr<MapReplyRecord> m_record;
+	std::vector<Ptr<MapReplyRecord> > m_records;
 };
 
 } /* namespace ns3 */
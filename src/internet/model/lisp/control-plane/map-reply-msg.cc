@@ -28,9 +28,12 @@ NS_LOG_COMPONENT_DEFINE ("MapReplyMsg");
 
 
 MapReplyMsg::MapReplyMsg() {
+	m_recordCount = 0;
 	m_P = 0;
 	m_E = 0;
 	m_S = 0;
+	m_reserved = 0;
+	m_nonce = 0;
 }
 
 MapReplyMsg::~MapReplyMsg() {
@@ -74,12 +77,12 @@ uint64_t MapReplyMsg::GetNonce(void) {
 void MapReplyMsg::Serialize(uint8_t *buf) const {
 	uint8_t msg_type = static_cast<uint8_t>(GetMsgType());
 	uint8_t type_EPS = 0;
-	uint8_t position = 0;
+	uint32_t position = 0;
 	type_EPS = (msg_type << 4) | (m_P << 3) | (m_E << 2) | (m_S << 1);
 	buf[0] = type_EPS;
 	buf[1] = m_reserved; // should be 0
 	buf[2] = 0x00; // rest part of m_reserved, all bits are 0;
-	buf[3] = m_recordCount;
+	buf[3] = m_records.size();
 	position += 4;
 	buf[position] = (m_nonce >> 56) & 0xffff;
 	buf[position+1] = (m_nonce >> 48) & 0xffff;
@@ -91,13 +94,24 @@ void MapReplyMsg::Serialize(uint8_t *buf) const {
 	buf[position+7] = (m_nonce >> 0) & 0xffff;
 	position += 8;
 
-	if (m_record !=0) //Negative Map Reply case
-		m_record->Serialize(buf + position);
+	for (std::vector<Ptr<MapReplyRecord> >::const_iterator it =
+			m_records.begin(); it != m_records.end(); ++it) {
+		(*it)->Serialize(buf + position);
+		position += (*it)->GetSerializedSize();
+	}
+}
+
+uint32_t MapReplyMsg::GetSerializedSize(void) const {
+	uint32_t size = 12;
+	for (std::vector<Ptr<MapReplyRecord> >::const_iterator it =
+			m_records.begin(); it != m_records.end(); ++it)
+		size += (*it)->GetSerializedSize();
+	return size;
 }
 
 Ptr<MapReplyMsg> MapReplyMsg::Deserialize(uint8_t *buf) {
 	Ptr<MapReplyMsg> msg = Create<MapReplyMsg>();
-	uint8_t position = 0;
+	uint32_t position = 0;
 	// The first bits are about Type, in this case 2
 	// Do not forget to take and bitwise operation with 0x01 to extract each flag value
 	uint8_t EPSres = buf[0];
@@ -105,7 +119,7 @@ Ptr<MapReplyMsg> MapReplyMsg::Deserialize(uint8_t *buf) {
 	msg->SetE((EPSres >> 2) & 0x01);
 	msg->SetS((EPSres >> 1) & 0x01);
 
-	msg->SetRecordCount(buf[3]);
+	uint8_t recordCount = buf[3];
 	position += 4;
 	uint64_t nonce = 0;
 	nonce |= buf[position];
@@ -127,24 +141,48 @@ Ptr<MapReplyMsg> MapReplyMsg::Deserialize(uint8_t *buf) {
 	msg->SetNonce(nonce);
 	position += 8;
 
-	if(msg->GetRecordCount () != 0)
-		msg->SetRecord(MapReplyRecord::Deserialize(buf + position));
-	
+	for (uint8_t i = 0; i < recordCount; i++) {
+		Ptr<MapReplyRecord> record = MapReplyRecord::Deserialize(buf + position);
+		msg->AddRecord(record);
+		position += record->GetSerializedSize();
+	}
+
 	return msg;
 }
 
 void MapReplyMsg::SetRecord(Ptr<MapReplyRecord> record) {
-	m_record = record;
+	m_records.clear();
+	m_records.push_back(record);
+	m_recordCount = 1;
 }
 Ptr<MapReplyRecord> MapReplyMsg::GetRecord(void) {
-	return m_record;
+	if (m_records.empty())
+		return 0;
+	return m_records.front();
+}
+
+void MapReplyMsg::AddRecord(Ptr<MapReplyRecord> record) {
+	NS_ASSERT_MSG(m_records.size() < MAX_RECORDS, "Too many records in Map-Reply");
+	m_records.push_back(record);
+	m_recordCount = m_records.size();
+}
+Ptr<MapReplyRecord> MapReplyMsg::GetRecord(uint8_t idx) {
+	NS_ASSERT(idx < m_records.size());
+	return m_records[idx];
+}
+uint8_t MapReplyMsg::GetNRecords(void) const {
+	return m_records.size();
 }
 
 void MapReplyMsg::Print(std::ostream& os) const {
 	os << "E: " << unsigned(m_E) << " P: " << unsigned(m_P) << " S: "
 			<< unsigned(m_S) << " Nonce: " << unsigned(m_nonce)
-			<< " Record Count: " << unsigned(m_recordCount) << " Reply-Record: ";
-	m_record->Print(os);
+			<< " Record Count: " << unsigned(m_recordCount);
+	for (std::vector<Ptr<MapReplyRecord> >::const_iterator it =
+			m_records.begin(); it != m_records.end(); ++it) {
+		os << " Reply-Record: ";
+		(*it)->Print(os);
+	}
 	os << std::endl;
 }
 
@@ -25,6 +25,8 @@
 #include "ns3/map-tables.h"
 #include "ns3/map-request-msg.h"
 
+#include <vector>
+
 namespace ns3
 {
 
@@ -33,6 +35,9 @@ class MapReplyMsg : public LispControlMsg
 public:
 
   static const LispControlMsgType msgType;
+  /// The record count is an 8-bit field.
+  static const uint8_t MAX_RECORDS = 255;
+
   MapReplyMsg ();
   virtual
   ~MapReplyMsg ();
@@ -52,17 +57,33 @@ public:
   void SetNonce (uint64_t nonce);
   uint64_t GetNonce (void);
 
+  /**
+   * \brief Replace the records of the message by a single record.
+   */
   void SetRecord (Ptr<MapReplyRecord> record);
+  /**
+   * \return The first record of the message, 0 if there is none.
+   */
   Ptr<MapReplyRecord> GetRecord (void);
-
-  void Serialize (uint8_t *buf) const;
+  /**
+   * \brief Append a record to the message (at most MAX_RECORDS).
+   */
+  void AddRecord (Ptr<MapReplyRecord> record);
+  Ptr<MapReplyRecord> GetRecord (uint8_t idx);
+  uint8_t GetNRecords (void) const;
+
+  /**
+   * \return The number of bytes written by Serialize.
+   */
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (uint8_t *buf) const;
   static Ptr<MapReplyMsg> Deserialize (uint8_t *buf);
 
   void Print (std::ostream& os) const;
   static LispControlMsg::LispControlMsgType GetMsgType (void);
 
 private:
-  Ptr<MapReplyRecord> m_record;
+  std::vector<Ptr<MapReplyRecord> > m_records;
   uint8_t m_recordCount;
   uint8_t m_P:1; //!< Probe bit
   uint8_t m_E:1; //!< Echo Nonce enable bit
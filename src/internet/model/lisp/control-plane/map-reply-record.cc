@@ -94,8 +94,8 @@ Ptr<Locators> MapReplyRecord::GetLocators(void) {
 	return m_locators;
 }
 
-void MapReplyRecord::Serialize(uint8_t *buf) {
-	uint8_t size = 0;
+void MapReplyRecord::Serialize(uint8_t *buf) const {
+	uint32_t size = 0;
 	for (int i = 0; i < MapReplyRecord::RECORD_TTL_LEN; i++) {
 		buf[size + i] = (m_recordTtl
 				>> 8 * (MapReplyRecord::RECORD_TTL_LEN - 1 - i)) & 0xff;
@@ -167,20 +167,39 @@ void MapReplyRecord::Serialize(uint8_t *buf) {
 				Ipv4Address::ConvertFrom(tmp_loc_addr).Serialize(buf + size);
 				size += 4;
 			} else {
-				//case of ipv6. Donot care now!
 				buf[size] = 0x00;
+				size += 1;
+				buf[size] = static_cast<uint8_t>(LispControlMsg::IPV6);
+				size++;
+				Ipv6Address::ConvertFrom(tmp_loc_addr).Serialize(buf + size);
+				size += 16;
 			}
 
 //			std::cout << "ID " << i << " of "
 //					<< Ipv4Address::ConvertFrom(m_eidPrefix) << std::endl;
 //			std::cout << m_locators->GetLocatorByIdx(i)->Print() << std::endl;
 		}
-	} else
-		// Do not forget to set current buffer content as zero
-		// since in corresponding deserialize method, it depends current buf[size] value
-		// (0 or 1) to decide whether it is necessary to decode for Locators
-		buf[size] = 0;
+	}
+	// Nothing follows the header of a record without locators: Deserialize
+	// relies on the locator count.
+}
 
+uint32_t MapReplyRecord::GetSerializedSize(void) const {
+	uint32_t size = 12;
+	if (Ipv4Address::IsMatchingType(m_eidPrefix))
+		size += 4;
+	else if (Ipv6Address::IsMatchingType(m_eidPrefix))
+		size += 16;
+	if (m_locators) {
+		for (int i = 0; i < m_locators->GetNLocators(); i++) {
+			// Priority to Loc-AFI, then the RLOC
+			if (Ipv4Address::IsMatchingType(m_locators->GetLocatorByIdx(i)->GetRlocAddress()))
+				size += 8 + 4;
+			else
+				size += 8 + 16;
+		}
+	}
+	return size;
 }
 
 Ptr<MapReplyRecord> MapReplyRecord::Deserialize(uint8_t *buf) {
@@ -60,7 +60,8 @@ public:
   void SetEidPrefix (Address eidPrefix);
   Address GetEidPrefix (void);
 
-  void Serialize (uint8_t *buf);
+  void Serialize (uint8_t *buf) const;
+  uint32_t GetSerializedSize (void) const;
   static Ptr<MapReplyRecord> Deserialize (uint8_t *buf);
 
   void Print (std::ostream& os);
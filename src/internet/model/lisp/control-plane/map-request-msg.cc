@@ -32,7 +32,6 @@ MapRequestMsg::MapRequestMsg() :
 	m_sourceEidAddress = static_cast<Address>(Ipv4Address());
 	m_itrRlocAddrIp = static_cast<Address>(Ipv4Address());
 	m_itrRlocAddrIpv6 = static_cast<Address>(Ipv6Address());
-	m_mapReqRec = 0;
 }
 
 MapRequestMsg::~MapRequestMsg() {
@@ -133,11 +132,47 @@ Address MapRequestMsg::GetItrRlocAddrIpv6(void) {
 }
 
 void MapRequestMsg::SetMapRequestRecord(Ptr<MapRequestRecord> record) {
-	m_mapReqRec = record;
+	m_mapReqRecs.clear();
+	m_mapReqRecs.push_back(record);
+	m_recordCount = 1;
 }
 
 Ptr<MapRequestRecord> MapRequestMsg::GetMapRequestRecord(void) {
-	return m_mapReqRec;
+	if (m_mapReqRecs.empty())
+		return 0;
+	return m_mapReqRecs.front();
+}
+
+void MapRequestMsg::AddMapRequestRecord(Ptr<MapRequestRecord> record) {
+	NS_ASSERT_MSG(m_mapReqRecs.size() < MAX_RECORDS,
+			"Too many records in Map-Request");
+	m_mapReqRecs.push_back(record);
+	m_recordCount = m_mapReqRecs.size();
+}
+
+Ptr<MapRequestRecord> MapRequestMsg::GetMapRequestRecord(uint8_t idx) {
+	NS_ASSERT(idx < m_mapReqRecs.size());
+	return m_mapReqRecs[idx];
+}
+
+uint8_t MapRequestMsg::GetNMapRequestRecords(void) const {
+	return m_mapReqRecs.size();
+}
+
+uint32_t MapRequestMsg::GetSerializedSize(void) const {
+	uint32_t size = 14;
+	if (m_sourceEidAfi == LispControlMsg::IP)
+		size += 4;
+	else if (m_sourceEidAfi == LispControlMsg::IPV6)
+		size += 16;
+	// ITR-RLOC-AFI, then the address if any
+	size += 2;
+	if (!Ipv4Address().IsEqual(Ipv4Address::ConvertFrom(m_itrRlocAddrIp)))
+		size += 4;
+	for (std::vector<Ptr<MapRequestRecord> >::const_iterator it =
+			m_mapReqRecs.begin(); it != m_mapReqRecs.end(); ++it)
+		size += (*it)->GetSerializedSize();
+	return size;
 }
 
 void MapRequestMsg::Serialize(uint8_t *buf) const {
@@ -151,7 +186,7 @@ void MapRequestMsg::Serialize(uint8_t *buf) const {
 	buf[0] = type_AMPS;
 	buf[1] = ps_partialReseverd;
 	buf[2] = m_reserved | m_irc;
-	buf[3] = m_recordCount;
+	buf[3] = m_mapReqRecs.size();
 
 	buf[4] = (m_nonce >> 56) & 0xffff;
 	buf[5] = (m_nonce >> 48) & 0xffff;
@@ -165,7 +200,7 @@ void MapRequestMsg::Serialize(uint8_t *buf) const {
 	buf[12] = 0x00;
 	buf[13] = static_cast<uint8_t>(m_sourceEidAfi);
 
-	uint8_t size = 14;
+	uint32_t size = 14;
 	if (m_sourceEidAfi == LispControlMsg::IP) {
 		Ipv4Address::ConvertFrom(m_sourceEidAddress).Serialize(buf + size);
 		size += 4;
@@ -182,6 +217,9 @@ void MapRequestMsg::Serialize(uint8_t *buf) const {
 		Ipv4Address::ConvertFrom(m_itrRlocAddrIp).Serialize(buf + size);
 		size += 4;
 	} else {
+		// Two bytes of AFI 0, as expected by Deserialize
+		buf[size] = 0x00;
+		size++;
 		buf[size] = 0;
 		size++;
 	}
@@ -196,7 +234,11 @@ void MapRequestMsg::Serialize(uint8_t *buf) const {
 //		size++;
 //	}
 
-	m_mapReqRec->Serialize(buf + size);
+	for (std::vector<Ptr<MapRequestRecord> >::const_iterator it =
+			m_mapReqRecs.begin(); it != m_mapReqRecs.end(); ++it) {
+		(*it)->Serialize(buf + size);
+		size += (*it)->GetSerializedSize();
+	}
 }
 
 void MapRequestMsg::SerializeOld(uint8_t *buf) const {
@@ -252,7 +294,7 @@ void MapRequestMsg::SerializeOld(uint8_t *buf) const {
 //		size++;
 //	}
 
-	m_mapReqRec->Serialize(buf + size);
+	m_mapReqRecs.front()->Serialize(buf + size);
 }
 
 Ptr<MapRequestMsg> MapRequestMsg::Deserialize(uint8_t *buf) {
@@ -271,7 +313,7 @@ Ptr<MapRequestMsg> MapRequestMsg::Deserialize(uint8_t *buf) {
 	msg->SetS2(ps_partialReseverd >> 6);
 
 	msg->SetIrc(buf[2]);
-	msg->SetRecordCount(buf[3]);
+	uint8_t recordCount = buf[3];
 
 	uint64_t nonce = 0;
 	nonce |= buf[4];
@@ -299,7 +341,7 @@ Ptr<MapRequestMsg> MapRequestMsg::Deserialize(uint8_t *buf) {
 			";Decoded Source EID family: "<<static_cast<LispControlMsg::AddressFamily>(buf[13])
 
 	);
-	uint8_t size = 14;
+	uint32_t size = 14;
 
 	if (msg->GetSourceEidAfi() == LispControlMsg::IP) {
 		Address decoded_eid = static_cast<Address>(Ipv4Address::Deserialize(buf + size));
@@ -334,7 +376,11 @@ Ptr<MapRequestMsg> MapRequestMsg::Deserialize(uint8_t *buf) {
 //		size++;
 //	}
 
-	msg->SetMapRequestRecord(MapRequestRecord::Deserialize(buf + size));
+	for (uint8_t i = 0; i < recordCount; i++) {
+		Ptr<MapRequestRecord> record = MapRequestRecord::Deserialize(buf + size);
+		msg->AddMapRequestRecord(record);
+		size += record->GetSerializedSize();
+	}
 	return msg;
 }
 
@@ -434,8 +480,11 @@ void MapRequestMsg::Print(std::ostream& os) const {
 				<< " ";
 	}
 
-	os << "\nRequest Record ";
-	m_mapReqRec->Print(os);
+	for (std::vector<Ptr<MapRequestRecord> >::const_iterator it =
+			m_mapReqRecs.begin(); it != m_mapReqRecs.end(); ++it) {
+		os << "\nRequest Record ";
+		(*it)->Print(os);
+	}
 }
 
 LispControlMsg::LispControlMsgType MapRequestMsg::GetMsgType(void) {
@@ -26,6 +26,8 @@
 #include "ns3/map-reply-record.h"
 #include "ns3/map-request-record.h"
 
+#include <vector>
+
 namespace ns3
 {
 
@@ -34,6 +36,8 @@ class MapRequestMsg : public LispControlMsg
 public:
 
   static const LispControlMsgType msgType;
+  /// The record count is an 8-bit field.
+  static const uint8_t MAX_RECORDS = 255;
 
   MapRequestMsg ();
   virtual
@@ -83,10 +87,26 @@ public:
   void SetItrRlocAddrIpv6 (Address itrRlocAddr);
   Address GetItrRlocAddrIpv6 (void);
 
+  /**
+   * \brief Replace the records of the message by a single record.
+   */
   void SetMapRequestRecord (Ptr<MapRequestRecord> record);
+  /**
+   * \return The first record of the message.
+   */
   Ptr<MapRequestRecord> GetMapRequestRecord (void);
+  /**
+   * \brief Append a record to the message (at most MAX_RECORDS).
+   */
+  void AddMapRequestRecord (Ptr<MapRequestRecord> record);
+  Ptr<MapRequestRecord> GetMapRequestRecord (uint8_t idx);
+  uint8_t GetNMapRequestRecords (void) const;
 
-  void Serialize (uint8_t *buf) const;
+  /**
+   * \return The number of bytes written by Serialize.
+   */
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (uint8_t *buf) const;
   void SerializeOld (uint8_t *buf) const;
   static Ptr<MapRequestMsg> Deserialize (uint8_t *buf);
   static Ptr<MapRequestMsg> DeserializeOld (uint8_t *buf);
@@ -119,7 +139,7 @@ private:
    *
    */
   uint8_t m_irc;
-  //!< Number of records. In this work it will be 1 all the time
+  //!< Number of records
   uint8_t m_recordCount;
   //!< Randomly generated nonce (must be copied in map reply)
   uint64_t m_nonce;
@@ -131,11 +151,11 @@ private:
   Address m_itrRlocAddrIp;
   Address m_itrRlocAddrIpv6;
   /*
-   * In this work, we just consider the case where
-   * we have only one map request record (i.e., record count is 1)
-   * see rfc 6830: "a sender MUST only send Map-Requests containing one record"
+   * rfc 6830 says "a sender MUST only send Map-Requests containing one record",
+   * but an ITR may coalesce the misses of a short window in a single
+   * Map-Request (see LispEtrItrApplication's MapRequestCoalescing attribute).
    */
-  Ptr<MapRequestRecord> m_mapReqRec;
+  std::vector<Ptr<MapRequestRecord> > m_mapReqRecs;
 
   /*
    * we don't use this in this work
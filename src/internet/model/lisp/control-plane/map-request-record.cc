@@ -16,7 +16,10 @@ MapRequestRecord::MapRequestRecord() {
 }
 
 MapRequestRecord::MapRequestRecord(Address eidPrefix, uint8_t eidMaskLength) {
-	m_afi = LispControlMsg::IP;
+	if (Ipv6Address::IsMatchingType(eidPrefix))
+		m_afi = LispControlMsg::IPV6;
+	else
+		m_afi = LispControlMsg::IP;
 	m_eidPrefix = eidPrefix;
 	m_eidMaskLenght = eidMaskLength;
 }
@@ -65,6 +68,12 @@ void MapRequestRecord::Serialize(uint8_t *buf) const {
 		Ipv6Address::ConvertFrom(m_eidPrefix).Serialize(buf + position);
 }
 
+uint32_t MapRequestRecord::GetSerializedSize(void) const {
+	if (m_afi == LispControlMsg::IP)
+		return 4 + 4;
+	return 4 + 16;
+}
+
 //void MapRequestRecord::SerializeOld(uint8_t *buf) const {
 //	buf[0] = static_cast<uint8_t>(m_afi);
 //	buf[1] = m_eidMaskLenght;
@@ -35,6 +35,7 @@ public:
   Address GetEidPrefix (void);
 
   void Serialize (uint8_t *buf) const;
+  uint32_t GetSerializedSize (void) const;
   void SerializeOld(uint8_t *buf);
   static Ptr<MapRequestRecord> Deserialize (uint8_t *buf);
   static Ptr<MapRequestRecord> DeserializeOld (uint8_t *buf);
@@ -26,7 +26,10 @@
 #include "ns3/packet.h"
 #include "ns3/uinteger.h"
 #include "ns3/trace-source-accessor.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/locators-impl.h"
 #include "map-request-msg.h"
+#include "map-reply-msg.h"
 
 namespace ns3
 {
@@ -35,14 +38,18 @@ namespace ns3
   NS_OBJECT_ENSURE_REGISTERED (MapResolverDdt);
 
 MapResolverDdt::MapResolverDdt ()
+  : m_nextDdtNonce (1)
 {
   NS_LOG_DEBUG ("MapResolverDdt Application created");
+  m_ddtRootRlocs = Create<LocatorsImpl> ();
+  m_mapRefCache = Create<MapReferralCache> ();
 }
 
 MapResolverDdt::~MapResolverDdt ()
 {
   m_socket = 0;
   m_mrClientSocket = 0;
+  m_ddtSocket = 0;
 }
 
 TypeId MapResolverDdt::GetTypeId (void)
@@ -51,6 +58,29 @@ TypeId MapResolverDdt::GetTypeId (void)
        .SetParent<Application> ()
        .SetGroupName ("Lisp")
        .AddConstructor<MapResolverDdt> ()
+       .AddAttribute ("MaxReferrals",
+                      "The number of Map-Referrals after which the resolution of an EID is abandoned.",
+                      UintegerValue (16),
+                      MakeUintegerAccessor (&MapResolverDdt::m_maxReferrals),
+                      MakeUintegerChecker<uint32_t> ())
+       .AddAttribute ("ReferralTimeout",
+                      "The time to wait for the Map-Referral of a DDT node before asking the next "
+                      "DDT node of the referral set.",
+                      TimeValue (Seconds (2.0)),
+                      MakeTimeAccessor (&MapResolverDdt::m_referralTimeout),
+                      MakeTimeChecker ())
+       .AddAttribute ("ReferralCacheCapacity",
+                      "Maximum number of entries in the referral cache (0: no limit). "
+                      "When full, an entry is evicted with the CLOCK algorithm.",
+                      UintegerValue (10000),
+                      MakeUintegerAccessor (&MapResolverDdt::m_referralCacheCapacity),
+                      MakeUintegerChecker<uint32_t> ())
+       .AddTraceSource ("MapReferralRx", "A Map-Referral is received by the MR",
+                        MakeTraceSourceAccessor (&MapResolverDdt::m_mapReferralRxTrace),
+                        "ns3::Packet::TracedCallback")
+       .AddTraceSource ("Resolved", "The Map-Server of an EID is found by walking the DDT hierarchy",
+                        MakeTraceSourceAccessor (&MapResolverDdt::m_resolvedTrace),
+                        "ns3::MapResolverDdt::ResolvedTracedCallback")
      ;
      return tid;
 }
@@ -58,6 +88,7 @@ TypeId MapResolverDdt::GetTypeId (void)
 void MapResolverDdt::StartApplication (void)
 {
   NS_LOG_FUNCTION (this);
+  m_mapRefCache->SetCapacity (m_referralCacheCapacity);
 
   NS_LOG_DEBUG ("STARTING MR");
   if (m_socket == 0)
@@ -66,6 +97,13 @@ void MapResolverDdt::StartApplication (void)
        m_socket = Socket::CreateSocket (GetNode (), tid);
     }
   m_socket->SetRecvCallback (MakeCallback (&MapResolverDdt::HandleRead, this));
+  if (m_ddtSocket == 0)
+    {
+      TypeId tid = TypeId::LookupByName ("ns3::UdpSocketFactory");
+      m_ddtSocket = Socket::CreateSocket (GetNode (), tid);
+      m_ddtSocket->Bind ();
+    }
+  m_ddtSocket->SetRecvCallback (MakeCallback (&MapResolverDdt::HandleRead, this));
   if (m_mrClientSocket == 0)
     {
       TypeId tid = TypeId::LookupByName ("ns3::UdpSocketFactory");
@@ -146,25 +184,299 @@ void MapResolverDdt::StopApplication (void)
       m_mrClientSocket6 = 0;
     }
 
+  if (m_ddtSocket)
+    {
+      m_ddtSocket->Close ();
+      m_ddtSocket->SetRecvCallback (MakeNullCallback<void, Ptr<Socket> > ());
+      m_ddtSocket = 0;
+    }
+
+  for (std::map<uint64_t, PendingRequest>::iterator it = m_pendingRequests.begin ();
+       it != m_pendingRequests.end (); ++it)
+    {
+      it->second.timeout.Cancel ();
+    }
+  m_pendingRequests.clear ();
+
   Simulator::Cancel (m_event);
 }
 
 void MapResolverDdt::SendMapRequest (Ptr<MapRequestMsg> mapRequestMsg)
 {
   NS_LOG_FUNCTION (this);
-  NS_ASSERT (m_event.IsExpired ());
 
-  uint8_t buf[64];
-  mapRequestMsg->Serialize (buf);
-  ConnectToPeerAddress (m_mapServerAddress, m_peerPort, m_socket);
-  Ptr<Packet> p = Create<Packet> (buf, 64);
-  m_socket->Send (p);
+  if (m_ddtRootRlocs->GetNLocators () == 0)
+    {
+      NS_ASSERT (m_event.IsExpired ());
+      if (m_mapServerShards == 0 || m_mapServerShards->GetNMapServers () == 0)
+        {
+          // A coalesced Map-Request is forwarded whole: the Map-Server answers all its records
+          SendToPeer (m_socket, mapRequestMsg->ToPacket (), m_mapServerAddress, m_peerPort);
+          return;
+        }
+      // The records are forwarded to the Map-Server of their shard, still coalesced per Map-Server
+      std::map<Address, Ptr<MapRequestMsg> > shardRequests;
+      for (uint8_t i = 0; i < mapRequestMsg->GetNMapRequestRecords (); i++)
+        {
+          Ptr<MapRequestRecord> record = mapRequestMsg->GetMapRequestRecord (i);
+          Address mapServer = m_mapServerShards->GetMapServer (record->GetEidPrefix ());
+          std::map<Address, Ptr<MapRequestMsg> >::iterator it = shardRequests.find (mapServer);
+          if (it == shardRequests.end ())
+            {
+              shardRequests[mapServer] = CopyMapRequest (mapRequestMsg, record, mapRequestMsg->GetNonce ());
+            }
+          else
+            {
+              it->second->AddMapRequestRecord (record);
+            }
+        }
+      for (std::map<Address, Ptr<MapRequestMsg> >::const_iterator it = shardRequests.begin ();
+           it != shardRequests.end (); ++it)
+        {
+          NS_LOG_DEBUG ("Forward Map-Request to Map-Server " << it->first);
+          SendToPeer (m_socket, it->second->ToPacket (), it->first, m_peerPort);
+        }
+      return;
+    }
+
+  /*
+   * The records whose Map-Server is in the referral cache are forwarded at
+   * once, still coalesced per Map-Server. The others walk the hierarchy one
+   * by one, from the deepest DDT node the cache knows for them.
+   */
+  std::map<Address, Ptr<MapRequestMsg> > msRequests;
+  std::map<Address, Ptr<Locators> > mapServers;
+  for (uint8_t i = 0; i < mapRequestMsg->GetNMapRequestRecords (); i++)
+    {
+      Ptr<MapRequestRecord> record = mapRequestMsg->GetMapRequestRecord (i);
+      Ptr<MapRefCacheEntry> entry = m_mapRefCache->Lookup (record->GetEidPrefix ());
+      Ptr<Locator> mapServer;
+      if (entry != 0 && entry->GetAction () == MapReferralMsg::MS_REFERRAL)
+        {
+          mapServer = entry->GetLocators ()->SelectFirsValidRloc ();
+        }
+      if (mapServer != 0)
+        {
+          std::map<Address, Ptr<MapRequestMsg> >::iterator it = msRequests.find (mapServer->GetRlocAddress ());
+          if (it == msRequests.end ())
+            {
+              msRequests[mapServer->GetRlocAddress ()] = CopyMapRequest (mapRequestMsg, record, mapRequestMsg->GetNonce ());
+              mapServers[mapServer->GetRlocAddress ()] = entry->GetLocators ();
+            }
+          else
+            {
+              it->second->AddMapRequestRecord (record);
+            }
+          m_resolvedTrace (Seconds (0), 0);
+        }
+      else if (entry != 0 && MapReferralMsg::IsNegative (entry->GetAction ()))
+        {
+          SendNegativeMapReply (CopyMapRequest (mapRequestMsg, record, mapRequestMsg->GetNonce ()),
+                                entry->GetRecord ());
+          m_resolvedTrace (Seconds (0), 0);
+        }
+      else
+        {
+          uint64_t nonce = m_nextDdtNonce++;
+          PendingRequest &pending = m_pendingRequests[nonce];
+          pending.mapRequest = CopyMapRequest (mapRequestMsg, record, mapRequestMsg->GetNonce ());
+          pending.start = Simulator::Now ();
+          pending.referrals = 0;
+          SendDdtMapRequest (nonce, entry != 0 ? entry->GetLocators () : m_ddtRootRlocs);
+        }
+    }
+  for (std::map<Address, Ptr<MapRequestMsg> >::const_iterator it = msRequests.begin ();
+       it != msRequests.end (); ++it)
+    {
+      SendToMapServer (it->second, mapServers[it->first]);
+    }
+}
+
+Ptr<MapRequestMsg>
+MapResolverDdt::CopyMapRequest (Ptr<MapRequestMsg> mapRequest, Ptr<MapRequestRecord> record, uint64_t nonce)
+{
+  uint8_t buf[mapRequest->GetSerializedSize ()];
+  mapRequest->Serialize (buf);
+  Ptr<MapRequestMsg> copy = MapRequestMsg::Deserialize (buf);
+  copy->SetMapRequestRecord (record);
+  copy->SetNonce (nonce);
+  return copy;
+}
+
+void MapResolverDdt::SendDdtMapRequest (uint64_t nonce, Ptr<Locators> referrals)
+{
+  NS_LOG_FUNCTION (this << nonce);
+  PendingRequest &pending = m_pendingRequests[nonce];
+  pending.ddtNodes = referrals;
+  pending.nextDdtNode = 0;
+  if (!AskNextDdtNode (nonce))
+    {
+      NS_LOG_WARN ("No usable DDT node in the referral set, EID resolution abandoned");
+      AbandonRequest (nonce);
+    }
+}
+
+bool MapResolverDdt::AskNextDdtNode (uint64_t nonce)
+{
+  PendingRequest &pending = m_pendingRequests[nonce];
+  Ptr<Locator> ddtNode;
+  // In the order of SelectFirsValidRloc (): by priority, up ones only
+  while (ddtNode == 0 && pending.nextDdtNode < pending.ddtNodes->GetNLocators ())
+    {
+      Ptr<Locator> locator = pending.ddtNodes->GetLocatorByIdx (pending.nextDdtNode++);
+      if (locator->GetRlocMetrics ()->IsUp ()
+          && locator->GetRlocMetrics ()->GetPriority () < LispOverIp::LISP_MAX_RLOC_PRIO
+          && Ipv4Address::IsMatchingType (locator->GetRlocAddress ()))
+        {
+          ddtNode = locator;
+        }
+    }
+  if (ddtNode == 0)
+    {
+      return false;
+    }
+  Ptr<MapRequestMsg> ddtRequest = CopyMapRequest (pending.mapRequest, pending.mapRequest->GetMapRequestRecord (), nonce);
+  NS_LOG_DEBUG ("Send DDT Map-Request to " << Ipv4Address::ConvertFrom (ddtNode->GetRlocAddress ()));
+  m_ddtSocket->SendTo (ddtRequest->ToPacket (), 0,
+                       InetSocketAddress (Ipv4Address::ConvertFrom (ddtNode->GetRlocAddress ()), LispOverIp::LISP_SIG_PORT));
+  pending.timeout.Cancel ();
+  pending.timeout = Simulator::Schedule (m_referralTimeout, &MapResolverDdt::ReferralTimeout, this, nonce);
+  return true;
+}
+
+void MapResolverDdt::AbandonRequest (uint64_t nonce)
+{
+  std::map<uint64_t, PendingRequest>::iterator it = m_pendingRequests.find (nonce);
+  Ptr<MapRequestRecord> requested = it->second.mapRequest->GetMapRequestRecord ();
+  // The shortest TTL: the ITR asks again soon, when the DDT nodes may be back
+  Ptr<MapReplyRecord> record = Create<MapReplyRecord> ();
+  record->SetRecordTtl (1);
+  record->SetEidPrefix (requested->GetEidPrefix ());
+  record->SetEidMaskLength (requested->GetMaskLength ());
+  SendNegativeMapReply (it->second.mapRequest, record);
+  it->second.timeout.Cancel ();
+  m_pendingRequests.erase (it);
+}
+
+void MapResolverDdt::SendToMapServer (Ptr<MapRequestMsg> mapRequest, Ptr<Locators> mapServers)
+{
+  Ptr<Locator> mapServer = mapServers->SelectFirsValidRloc ();
+  if (mapServer == 0 || !Ipv4Address::IsMatchingType (mapServer->GetRlocAddress ()))
+    {
+      NS_LOG_WARN ("No usable Map-Server in the referral set");
+      return;
+    }
+  NS_LOG_DEBUG ("Forward Map-Request to Map-Server " << Ipv4Address::ConvertFrom (mapServer->GetRlocAddress ()));
+  m_ddtSocket->SendTo (mapRequest->ToPacket (), 0,
+                       InetSocketAddress (Ipv4Address::ConvertFrom (mapServer->GetRlocAddress ()), m_peerPort));
+}
+
+void MapResolverDdt::SendNegativeMapReply (Ptr<MapRequestMsg> mapRequest, Ptr<MapReplyRecord> referralRecord)
+{
+  Ptr<MapReplyRecord> record = Create<MapReplyRecord> ();
+  record->SetRecordTtl (referralRecord->GetRecordTtl ());
+  record->SetAct (MapReplyRecord::NativelyForward);
+  record->SetA (1);
+  record->SetMapVersionNumber (0);
+  record->SetEidPrefix (referralRecord->GetEidPrefix ());
+  record->SetEidMaskLength (referralRecord->GetEidMaskLength ());
+  record->SetLocators (0);
+  Ptr<MapReplyMsg> mapReply = Create<MapReplyMsg> ();
+  mapReply->SetNonce (mapRequest->GetNonce ());
+  mapReply->AddRecord (record);
+
+  Address itrRloc = mapRequest->GetItrRlocAddrIp ();
+  NS_ASSERT (Ipv4Address::IsMatchingType (itrRloc));
+  NS_LOG_DEBUG ("Send negative Map-Reply to " << Ipv4Address::ConvertFrom (itrRloc));
+  m_ddtSocket->SendTo (mapReply->ToPacket (), 0,
+                       InetSocketAddress (Ipv4Address::ConvertFrom (itrRloc), LispOverIp::LISP_SIG_PORT));
+}
+
+void MapResolverDdt::ReferralTimeout (uint64_t nonce)
+{
+  if (AskNextDdtNode (nonce))
+    {
+      NS_LOG_DEBUG ("No Map-Referral for DDT Map-Request " << nonce << ", ask the next DDT node");
+      return;
+    }
+  NS_LOG_WARN ("No Map-Referral for DDT Map-Request " << nonce << ", EID resolution abandoned");
+  AbandonRequest (nonce);
+}
+
+void MapResolverDdt::Resolved (uint64_t nonce)
+{
+  std::map<uint64_t, PendingRequest>::iterator it = m_pendingRequests.find (nonce);
+  it->second.timeout.Cancel ();
+  m_resolvedTrace (Simulator::Now () - it->second.start, it->second.referrals);
+  m_pendingRequests.erase (it);
+}
+
+void MapResolverDdt::HandleMapReferral (Ptr<MapReferralMsg> referral)
+{
+  std::map<uint64_t, PendingRequest>::iterator it = m_pendingRequests.find (referral->GetNonce ());
+  if (it == m_pendingRequests.end () || referral->GetNRecords () == 0)
+    {
+      NS_LOG_DEBUG ("Map-Referral for no pending DDT Map-Request");
+      return;
+    }
+  uint64_t nonce = it->first;
+  PendingRequest &pending = it->second;
+  pending.referrals++;
+
+  Ptr<MapReplyRecord> record = referral->GetRecord (0);
+  MapReferralMsg::ReferralAction action = MapReferralMsg::GetReferralAction (record);
+  if (action != MapReferralMsg::NOT_AUTHORITATIVE && action != MapReferralMsg::MS_ACK)
+    {
+      m_mapRefCache->Insert (record);
+    }
+
+  switch (action)
+    {
+    case MapReferralMsg::NODE_REFERRAL:
+      if (pending.referrals >= m_maxReferrals)
+        {
+          NS_LOG_WARN ("Too many Map-Referrals, EID resolution abandoned");
+          pending.timeout.Cancel ();
+          m_pendingRequests.erase (it);
+          return;
+        }
+      SendDdtMapRequest (nonce, record->GetLocators ());
+      break;
+    case MapReferralMsg::MS_REFERRAL:
+      SendToMapServer (pending.mapRequest, record->GetLocators ());
+      Resolved (nonce);
+      break;
+    case MapReferralMsg::MS_ACK:
+      // The Map-Server answers the ITR itself
+      Resolved (nonce);
+      break;
+    default:
+      SendNegativeMapReply (pending.mapRequest, record);
+      Resolved (nonce);
+      break;
+    }
 }
 
 void MapResolverDdt::HandleRead (Ptr<Socket> socket)
 {
-  NS_LOG_DEBUG("--------------HandleRead MR");
   NS_LOG_FUNCTION (this);
+  Ptr<Packet> packet;
+  Address from;
+  while ((packet = socket->RecvFrom (from)))
+    {
+      if (packet->GetSize () == 0)
+        {
+          continue;
+        }
+      uint8_t buf[packet->GetSize ()];
+      packet->CopyData (buf, packet->GetSize ());
+      uint8_t msg_type = buf[0] >> 4;
+      if (msg_type == static_cast<uint8_t> (MapReferralMsg::GetMsgType ()))
+        {
+          m_mapReferralRxTrace (packet);
+          HandleMapReferral (MapReferralMsg::Deserialize (buf));
+        }
+    }
 }
 
 void MapResolverDdt::SetMapServerAddress (Address mapServer)
@@ -172,4 +484,206 @@ void MapResolverDdt::SetMapServerAddress (Address mapServer)
   m_mapServerAddress = mapServer;
 }
 
+void MapResolverDdt::SetMapServerShards (Ptr<MapServerShards> mapServerShards)
+{
+  m_mapServerShards = mapServerShards;
+}
+
+void MapResolverDdt::SetDdtRootRlocs (std::list<Ptr<Locator> > locators)
+{
+  m_ddtRootRlocs = Create<LocatorsImpl> ();
+  for (std::list<Ptr<Locator> >::const_iterator it = locators.begin (); it != locators.end (); ++it)
+    {
+      m_ddtRootRlocs->InsertLocator (*it);
+    }
+}
+
+Ptr<MapReferralCache> MapResolverDdt::GetMapReferralCache (void) const
+{
+  return m_mapRefCache;
+}
+
+// ================================================================================================
+
+MapRefCacheEntry::MapRefCacheEntry (Ptr<MapReplyRecord> record)
+  : m_record (record)
+{
+  uint8_t maskLength = record->GetEidMaskLength ();
+  m_eidPrefix = Ipv4Address::ConvertFrom (record->GetEidPrefix ())
+    .CombineMask (Ipv4Mask (maskLength ? ~((1U << (32 - maskLength)) - 1) : 0));
+  if (record->GetRecordTtl () == 0xffffffff)
+    {
+      m_expiryTime = Time::Max ();
+    }
+  else
+    {
+      m_expiryTime = Simulator::Now () + Minutes (record->GetRecordTtl ());
+    }
+}
+
+Ipv4Address MapRefCacheEntry::GetEidPrefix (void) const
+{
+  return m_eidPrefix;
+}
+
+uint8_t MapRefCacheEntry::GetMaskLength (void) const
+{
+  return m_record->GetEidMaskLength ();
+}
+
+MapReferralMsg::ReferralAction MapRefCacheEntry::GetAction (void) const
+{
+  return MapReferralMsg::GetReferralAction (m_record);
+}
+
+Ptr<Locators> MapRefCacheEntry::GetLocators (void) const
+{
+  return m_record->GetLocators ();
+}
+
+Ptr<MapReplyRecord> MapRefCacheEntry::GetRecord (void) const
+{
+  return m_record;
+}
+
+bool MapRefCacheEntry::IsExpired (void) const
+{
+  return m_expiryTime <= Simulator::Now ();
+}
+
+uint32_t MapRefCacheEntry::GetRemainingTtl (void) const
+{
+  if (m_expiryTime == Time::Max ())
+    {
+      return 0xffffffff;
+    }
+  if (IsExpired ())
+    {
+      return 0;
+    }
+  return static_cast<uint32_t> ((m_expiryTime - Simulator::Now ()).GetMinutes ());
+}
+
+// ================================================================================================
+
+MapReferralCache::MapReferralCache ()
+  : m_hand (0),
+    m_capacity (0),
+    m_nEvictions (0)
+{
+}
+
+void MapReferralCache::Insert (Ptr<MapReplyRecord> record)
+{
+  if (!Ipv4Address::IsMatchingType (record->GetEidPrefix ()))
+    {
+      return;
+    }
+  Ptr<MapRefCacheEntry> entry = Create<MapRefCacheEntry> (record);
+  uint32_t idx = m_trie.ExactLookup (entry->GetEidPrefix ().Get (), entry->GetMaskLength ());
+  if (idx == Ipv4LpmTrie::NO_VALUE)
+    {
+      if (m_capacity != 0 && GetNEntries () >= m_capacity)
+        {
+          Evict ();
+        }
+      if (m_freeEntries.empty ())
+        {
+          idx = m_entries.size ();
+          m_entries.push_back (entry);
+          m_referenced.push_back (true);
+        }
+      else
+        {
+          idx = m_freeEntries.back ();
+          m_freeEntries.pop_back ();
+          m_entries[idx] = entry;
+          // A new entry gets a full round before it can be evicted
+          m_referenced[idx] = true;
+        }
+      m_trie.Insert (entry->GetEidPrefix ().Get (), entry->GetMaskLength (), idx);
+    }
+  else
+    {
+      m_entries[idx] = entry;
+    }
+}
+
+Ptr<MapRefCacheEntry> MapReferralCache::Lookup (const Address &eid)
+{
+  if (!Ipv4Address::IsMatchingType (eid))
+    {
+      return 0;
+    }
+  uint32_t address = Ipv4Address::ConvertFrom (eid).Get ();
+  uint32_t idx;
+  while ((idx = m_trie.Lookup (address)) != Ipv4LpmTrie::NO_VALUE)
+    {
+      if (!m_entries[idx]->IsExpired ())
+        {
+          m_referenced[idx] = true;
+          return m_entries[idx];
+        }
+      // Fall back on the less specific referrals
+      Remove (idx);
+    }
+  return 0;
+}
+
+uint32_t MapReferralCache::GetNEntries (void) const
+{
+  return m_trie.GetNPrefixes ();
+}
+
+void MapReferralCache::SetCapacity (uint32_t capacity)
+{
+  m_capacity = capacity;
+  while (m_capacity != 0 && GetNEntries () > m_capacity)
+    {
+      Evict ();
+    }
+}
+
+uint32_t MapReferralCache::GetCapacity (void) const
+{
+  return m_capacity;
+}
+
+uint32_t MapReferralCache::GetNEvictions (void) const
+{
+  return m_nEvictions;
+}
+
+void MapReferralCache::Evict (void)
+{
+  // At most two rounds: the first one clears every referenced bit.
+  for (uint32_t n = 0; n < 2 * m_entries.size (); n++)
+    {
+      if (m_hand >= m_entries.size ())
+        {
+          m_hand = 0;
+        }
+      uint32_t idx = m_hand++;
+      if (m_entries[idx] == 0)
+        {
+          continue;
+        }
+      if (m_entries[idx]->IsExpired () || !m_referenced[idx])
+        {
+          Remove (idx);
+          m_nEvictions++;
+          return;
+        }
+      m_referenced[idx] = false;
+    }
+  NS_ASSERT_MSG (false, "MapReferralCache: no entry to evict");
+}
+
+void MapReferralCache::Remove (uint32_t idx)
+{
+  m_trie.Remove (m_entries[idx]->GetEidPrefix ().Get (), m_entries[idx]->GetMaskLength ());
+  m_entries[idx] = 0;
+  m_freeEntries.push_back (idx);
+}
+
 } /* namespace ns3 */
@@ -26,15 +26,32 @@
 #include "ns3/lisp-over-ip.h"
 #include "ns3/map-referral-msg.h"
 #include "ns3/map-request-msg.h"
+#include "ns3/map-server-shards.h"
+#include "ns3/lpm-trie.h"
+#include "ns3/nstime.h"
 
+#include <list>
+#include <map>
+#include <vector>
 
 namespace ns3
 {
 
-class ExtendedEidPrefix;
 class MapReferralCache;
-class PendingRequestList;
 
+/**
+ * \brief Map-Resolver, with LISP-DDT support (RFC 8111).
+ *
+ * Without DDT root, the Map-Requests of the ITRs are forwarded to the
+ * configured Map-Server. Otherwise the Map-Resolver walks the DDT
+ * hierarchy for every requested EID: it sends a DDT Map-Request to a root
+ * DDT node and follows the Map-Referrals down to the Map-Server the EID is
+ * delegated to, to which it forwards the Map-Request of the ITR. The
+ * referrals are kept in a referral cache, so that the next lookups start as
+ * deep in the hierarchy as possible, and skip it entirely when the
+ * Map-Server of the EID is known. Negative referrals are answered to the
+ * ITR with a negative Map-Reply.
+ */
 class MapResolverDdt : public MapResolver
 {
 public:
@@ -47,7 +64,38 @@ public:
 
   void SetMapServerAddress (Address mapServer);
 
+  /**
+   * \brief Without DDT, forward the Map-Requests to the Map-Server of the
+   * shard of their EID rather than to the Map-Server address.
+   */
+  void SetMapServerShards (Ptr<MapServerShards> mapServerShards);
+
+  /**
+   * \brief Set the RLOCs of the DDT root, which enables DDT.
+   */
+  void SetDdtRootRlocs (std::list<Ptr<Locator> > locators);
+
+  Ptr<MapReferralCache> GetMapReferralCache (void) const;
+
+  /**
+   * TracedCallback signature for the resolution of an EID.
+   *
+   * \param [in] delay The time spent walking the DDT hierarchy.
+   * \param [in] referrals The number of Map-Referrals received.
+   */
+  typedef void (* ResolvedTracedCallback)(Time delay, uint32_t referrals);
+
 private:
+  /// A requested EID walking the DDT hierarchy.
+  struct PendingRequest
+  {
+    Ptr<MapRequestMsg> mapRequest; //!< The single record Map-Request, with the nonce of the ITR
+    Time start;
+    uint32_t referrals;
+    EventId timeout;
+    Ptr<Locators> ddtNodes; //!< The referral set asked
+    uint8_t nextDdtNode;    //!< The index in ddtNodes of the DDT node to ask if this one does not answer
+  };
 
   virtual void StartApplication (void);
 
@@ -59,59 +107,122 @@ private:
 
   virtual void HandleReadFromClient (Ptr<Socket> socket);
 
-  // when ddt is used
-  Ptr<Locators> rootDdtNodeRlocs;
-  //
+  void HandleMapReferral (Ptr<MapReferralMsg> referral);
+  void SendDdtMapRequest (uint64_t nonce, Ptr<Locators> referrals);
+  /**
+   * \brief Send the DDT Map-Request to the next usable DDT node of the
+   * referral set.
+   * \return false if the referral set is exhausted.
+   */
+  bool AskNextDdtNode (uint64_t nonce);
+  /**
+   * \brief No DDT node of the referral set answered: answer the ITR with a
+   * negative Map-Reply for the requested EID.
+   */
+  void AbandonRequest (uint64_t nonce);
+  void SendToMapServer (Ptr<MapRequestMsg> mapRequest, Ptr<Locators> mapServers);
+  void SendNegativeMapReply (Ptr<MapRequestMsg> mapRequest, Ptr<MapReplyRecord> referralRecord);
+  void ReferralTimeout (uint64_t nonce);
+  void Resolved (uint64_t nonce);
+
+  /**
+   * \return A copy of mapRequest with record as only record and nonce as nonce.
+   */
+  static Ptr<MapRequestMsg> CopyMapRequest (Ptr<MapRequestMsg> mapRequest,
+                                            Ptr<MapRequestRecord> record, uint64_t nonce);
+
+  Ptr<Locators> m_ddtRootRlocs;
   Address m_mapServerAddress;
+  Ptr<MapServerShards> m_mapServerShards;
   Ptr<MapReferralCache> m_mapRefCache;
-  Ptr<PendingRequestList> m_pendingReqList;
+  /// Walks in progress, by nonce of their DDT Map-Requests.
+  std::map<uint64_t, PendingRequest> m_pendingRequests;
+  uint64_t m_nextDdtNonce;
+  /// Unconnected socket for the DDT Map-Requests, their referrals and the negative Map-Replies.
+  Ptr<Socket> m_ddtSocket;
+  uint32_t m_maxReferrals;
+  Time m_referralTimeout;
+  uint32_t m_referralCacheCapacity;
+
+  TracedCallback<Ptr<const Packet> > m_mapReferralRxTrace;
+  TracedCallback<Time, uint32_t> m_resolvedTrace;
 };
 
+/**
+ * \brief A referral received by a DDT Map-Resolver.
+ */
 class MapRefCacheEntry : public SimpleRefCount<MapRefCacheEntry>
 {
 public:
+  MapRefCacheEntry (Ptr<MapReplyRecord> record);
+
+  Ipv4Address GetEidPrefix (void) const;
+  uint8_t GetMaskLength (void) const;
+  MapReferralMsg::ReferralAction GetAction (void) const;
+  Ptr<Locators> GetLocators (void) const;
+  Ptr<MapReplyRecord> GetRecord (void) const;
+  bool IsExpired (void) const;
+  /**
+   * \return The whole minutes left before the entry expires, to be sent as
+   * record TTL of an answer from the cache. 0xffffffff if it never expires.
+   */
+  uint32_t GetRemainingTtl (void) const;
 
 private:
-  Ptr<Locators> locators;
+  Ptr<MapReplyRecord> m_record;
+  Ipv4Address m_eidPrefix;
+  Time m_expiryTime;
 };
 
+/**
+ * \brief Referral cache of a DDT Map-Resolver (RFC 8111, section 7.3).
+ *
+ * Longest-prefix match of the EIDs on the EID-Prefixes of the referrals
+ * received. Only IPv4 EID-Prefixes are cached. Map-Reply records share
+ * the format of referral records, so the cache also serves as a Map-Reply
+ * cache.
+ *
+ * Like the map-cache (see MapCacheClock), a full cache evicts an entry with
+ * the CLOCK algorithm: the hand sweeps the entries, clearing their
+ * referenced bit, and stops on the first one expired or not looked up since
+ * its previous sweep.
+ */
 class MapReferralCache : public SimpleRefCount<MapReferralCache>
 {
 public:
+  MapReferralCache ();
+
+  /**
+   * \brief Cache a referral record, replacing the referral for the same EID-Prefix.
+   */
+  void Insert (Ptr<MapReplyRecord> record);
+  /**
+   * \return The most specific referral that contains eid and has not
+   * expired, 0 if there is none. The expired referrals met are removed.
+   */
+  Ptr<MapRefCacheEntry> Lookup (const Address &eid);
+  uint32_t GetNEntries (void) const;
+  /**
+   * \param capacity Maximum number of entries, 0 for no limit.
+   */
+  void SetCapacity (uint32_t capacity);
+  uint32_t GetCapacity (void) const;
+  /// \return The number of entries evicted from a full cache.
+  uint32_t GetNEvictions (void) const;
 
 private:
-  std::map<Ptr<ExtendedEidPrefix>, Ptr<MapRefCacheEntry> > m_mapRefCache;
-};
-
-
-class ExtendedEidPrefix : public SimpleRefCount<ExtendedEidPrefix>
-{
-public:
-
-private:
-  Ptr<EndpointId> m_eidPrefix;
-  uint16_t m_lispDdtDbid;
-  LispControlMsg::AddressFamily m_afi;
-  uint32_t m_iid; //!< instance id
-};
-
-class PendingRequestEntry : public SimpleRefCount<PendingRequestEntry>
-{
-public:
-
-private:
-  Ptr<MapRequestMsg> m_mapRequest;
-  Ptr<MapReferralMsg> m_lastMapReferral;
-  Ptr<ExtendedEidPrefix> m_requestedXeid;
-};
-
-class PendingRequestList : public SimpleRefCount<PendingRequestList>
-{
-
-public:
-
-private:
-  std::map<Ptr<ExtendedEidPrefix>, Ptr<PendingRequestEntry> > m_pendingReqList;
+  void Remove (uint32_t idx);
+  /// Remove the entry the hand of the clock stops on.
+  void Evict (void);
+
+  /// The values of the trie are indexes in m_entries.
+  Ipv4LpmTrie m_trie;
+  std::vector<Ptr<MapRefCacheEntry> > m_entries;
+  std::vector<uint32_t> m_freeEntries;
+  std::vector<bool> m_referenced; //!< By index in m_entries: looked up since the last sweep
+  uint32_t m_hand;
+  uint32_t m_capacity;
+  uint32_t m_nEvictions;
 };
 
 } /* namespace ns3 */
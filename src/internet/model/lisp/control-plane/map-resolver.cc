@@ -115,18 +115,18 @@ void MapResolver::HandleReadFromClient (Ptr<Socket> socket)
   NS_LOG_FUNCTION (this);
 }
 
-void MapResolver::ConnectToPeerAddress (Address peerAddress, uint16_t peerPort, Ptr<Socket> socket)
+int MapResolver::SendToPeer (Ptr<Socket> socket, Ptr<Packet> packet, Address peerAddress, uint16_t peerPort)
 {
-  if (Ipv4Address::IsMatchingType(peerAddress) == true)
+  if (Ipv4Address::IsMatchingType (peerAddress))
     {
-      socket->Bind();
-      socket->Connect (InetSocketAddress (Ipv4Address::ConvertFrom(peerAddress), peerPort));
+      return socket->SendTo (packet, 0, InetSocketAddress (Ipv4Address::ConvertFrom (peerAddress), peerPort));
     }
-  else if (Ipv6Address::IsMatchingType(peerAddress) == true)
+  else if (Ipv6Address::IsMatchingType (peerAddress))
     {
-      socket->Bind6();
-      socket->Connect (Inet6SocketAddress (Ipv6Address::ConvertFrom(peerAddress), peerPort));
+      return socket->SendTo (packet, 0, Inet6SocketAddress (Ipv6Address::ConvertFrom (peerAddress), peerPort));
     }
+  NS_LOG_ERROR ("Cannot send a control message to " << peerAddress);
+  return -1;
 }
 
 } /* namespace ns3 */
@@ -43,7 +43,16 @@ public:
 
   static TypeId GetTypeId (void);
 
-  static void ConnectToPeerAddress (Address peerAddress, uint16_t peerPort, Ptr<Socket> socket);
+  /**
+   * \brief Send a control message to a peer on an unconnected socket.
+   *
+   * The destination travels with the packet, so that the replies to many
+   * peers can be outstanding (e.g., scheduled after a lookup delay) on the
+   * same socket at once.
+   *
+   * \return the number of bytes sent, or -1 on error.
+   */
+  static int SendToPeer (Ptr<Socket> socket, Ptr<Packet> packet, Address peerAddress, uint16_t peerPort);
 
 
 
@@ -30,6 +30,7 @@
 #include "ns3/trace-source-accessor.h"
 #include "map-register-msg.h"
 #include "map-resolver.h"
+#include <map>
 
 namespace ns3
 {
@@ -115,7 +116,6 @@ namespace ns3
 		{
 			TypeId tid = TypeId::LookupByName("ns3::UdpSocketFactory");
 			m_socket = Socket::CreateSocket(GetNode(), tid);
-			// ConnectToPeerAddress (m_peerAddress, m_peerPort);
 		}
 		m_socket->SetRecvCallback(MakeCallback(&MapServerDdt::HandleRead, this));
 		if (m_msClientSocket == 0)
@@ -176,21 +176,25 @@ namespace ns3
 	{
 		// TODO implement map notification message here
 		Ptr<MapNotifyMsg> mapNotify = Create<MapNotifyMsg>();
-		mapNotify->SetRecordCount(msg->GetRecordCount());
 		mapNotify->SetNonce(msg->GetNonce());
 		mapNotify->SetAuthDataLen(msg->GetAuthDataLen());
 		mapNotify->setAuthData(msg->getAuthData());
 		mapNotify->setKeyId(msg->getKeyId());
-		mapNotify->SetRecord(msg->GetRecord());
+		// The records registered are all acknowledged
+		for (uint8_t i = 0; i < msg->GetNRecords(); i++)
+		{
+			mapNotify->AddRecord(msg->GetRecord(i));
+		}
 		return mapNotify;
 	}
 
 	void
-	MapServerDdt::Send(Ptr<Packet> p)
+	MapServerDdt::Send(Address peerAddress, Ptr<Packet> p)
 	{
 		NS_LOG_FUNCTION(this);
 		NS_ASSERT(m_event.IsExpired());
-		m_socket->Send(p);
+		// The peer travels with the packet: many replies may be scheduled at once
+		MapResolver::SendToPeer(m_socket, p, peerAddress, m_peerPort);
 	}
 
 	void
@@ -206,49 +210,53 @@ namespace ns3
 		// For multihoming case, combine RLOC for the same RLOC
 		// For LISP-MN, replace them
 		NS_LOG_DEBUG("Get a Map Register Message! Try to decode it...");
-		std::stringstream ss;
-		Ptr<MapReplyRecord> record = msg->GetRecord();
-		Ptr<EndpointId> eid;
-		Ptr<Locators> locators = record->GetLocators();
-		if (record->GetEidAfi() == LispControlMsg::IP)
-		{
-			ss << "/" << unsigned(record->GetEidMaskLength());
-			Ipv4Mask mask = Ipv4Mask(ss.str().c_str());
-			NS_LOG_DEBUG(
-				"Decoded EID prefix length: /" << unsigned(record->GetEidMaskLength()));
-			eid = Create<EndpointId>(record->GetEidPrefix(), mask);
-			Ptr<MapEntryImpl> mapEntry = Create<MapEntryImpl>();
-			mapEntry->SetLocators(locators);
-			mapEntry->SetEidPrefix(eid);
-			/**
-			 * IMPORTANT: For map server, when it receives a map register message, it
-			 * populates the database and cache at the same time. Why we should populate
-			 * cache also? Because in LISP-MN, map-server is risking to forward map request
-			 * to a LISP-MN, whose RLOC is not globally routable. The aforementioned map request
-			 * message need to be encapsulated to be delivered to LISP-MN. In other hand, map
-			 * server need to do cache lookup when calling LispOutput(in LispOverIpv4Impl).
-			 */
-			m_mapTablesv4->SetEntry(record->GetEidPrefix(), mask, mapEntry,
-									MapTables::IN_DATABASE);
-			m_mapTablesv4->SetEntry(record->GetEidPrefix(), mask, mapEntry,
-									MapTables::IN_CACHE);
-			NS_LOG_DEBUG("MS's Map Table Content:" << *m_mapTablesv4);
-		}
-		else if (record->GetEidAfi() == LispControlMsg::IPV6)
+		// A Map-Register may carry several records
+		for (uint8_t i = 0; i < msg->GetNRecords(); i++)
 		{
-			ss << "/" << unsigned(record->GetEidMaskLength());
-
-			eid = Create<EndpointId>(record->GetEidPrefix(),
-									 Ipv6Prefix(ss.str().c_str()));
-			Ipv6Prefix prefix = Ipv6Prefix(ss.str().c_str());
-			eid = Create<EndpointId>(record->GetEidPrefix(), prefix);
-			Ptr<MapEntryImpl> mapEntry = Create<MapEntryImpl>();
-			mapEntry->SetLocators(locators);
-			mapEntry->SetEidPrefix(eid);
-			m_mapTablesv6->SetEntry(record->GetEidPrefix(), prefix, mapEntry,
-									MapTables::IN_DATABASE);
-			m_mapTablesv6->SetEntry(record->GetEidPrefix(), prefix, mapEntry,
-									MapTables::IN_CACHE);
+			std::stringstream ss;
+			Ptr<MapReplyRecord> record = msg->GetRecord(i);
+			Ptr<EndpointId> eid;
+			Ptr<Locators> locators = record->GetLocators();
+			if (record->GetEidAfi() == LispControlMsg::IP)
+			{
+				ss << "/" << unsigned(record->GetEidMaskLength());
+				Ipv4Mask mask = Ipv4Mask(ss.str().c_str());
+				NS_LOG_DEBUG(
+					"Decoded EID prefix length: /" << unsigned(record->GetEidMaskLength()));
+				eid = Create<EndpointId>(record->GetEidPrefix(), mask);
+				Ptr<MapEntryImpl> mapEntry = Create<MapEntryImpl>();
+				mapEntry->SetLocators(locators);
+				mapEntry->SetEidPrefix(eid);
+				/**
+				 * IMPORTANT: For map server, when it receives a map register message, it
+				 * populates the database and cache at the same time. Why we should populate
+				 * cache also? Because in LISP-MN, map-server is risking to forward map request
+				 * to a LISP-MN, whose RLOC is not globally routable. The aforementioned map request
+				 * message need to be encapsulated to be delivered to LISP-MN. In other hand, map
+				 * server need to do cache lookup when calling LispOutput(in LispOverIpv4Impl).
+				 */
+				m_mapTablesv4->SetEntry(record->GetEidPrefix(), mask, mapEntry,
+										MapTables::IN_DATABASE);
+				m_mapTablesv4->SetEntry(record->GetEidPrefix(), mask, mapEntry,
+										MapTables::IN_CACHE);
+				NS_LOG_DEBUG("MS's Map Table Content:" << *m_mapTablesv4);
+			}
+			else if (record->GetEidAfi() == LispControlMsg::IPV6)
+			{
+				ss << "/" << unsigned(record->GetEidMaskLength());
+
+				eid = Create<EndpointId>(record->GetEidPrefix(),
+										 Ipv6Prefix(ss.str().c_str()));
+				Ipv6Prefix prefix = Ipv6Prefix(ss.str().c_str());
+				eid = Create<EndpointId>(record->GetEidPrefix(), prefix);
+				Ptr<MapEntryImpl> mapEntry = Create<MapEntryImpl>();
+				mapEntry->SetLocators(locators);
+				mapEntry->SetEidPrefix(eid);
+				m_mapTablesv6->SetEntry(record->GetEidPrefix(), prefix, mapEntry,
+										MapTables::IN_DATABASE);
+				m_mapTablesv6->SetEntry(record->GetEidPrefix(), prefix, mapEntry,
+										MapTables::IN_CACHE);
+			}
 		}
 	}
 
@@ -296,18 +304,8 @@ namespace ns3
 						entry->GetLocators()->SelectFirsValidRloc();
 					NS_LOG_DEBUG(
 						"Send Map Notify message to ETR " << Ipv4Address::ConvertFrom(locator->GetRlocAddress()));
-					MapResolver::ConnectToPeerAddress(locator->GetRlocAddress(),
-													  m_peerPort, m_socket);
-					Ptr<Packet> reqPacket = Create<Packet>(buf,
-														   packet->GetSize());
-
-					MapResolver::ConnectToPeerAddress(locator->GetRlocAddress(),
-													  m_peerPort, m_socket);
-					uint8_t buf[256];
-					mapNotifyMsg->Serialize(buf);
-					Ptr<Packet> packet = Create<Packet>(buf, 256);
-					// Don't forget to make socket connect to the xTR which send map register message.
-					Send(packet);
+					Ptr<Packet> packet = mapNotifyMsg->ToPacket();
+					Send(locator->GetRlocAddress(), packet);
 					NS_LOG_DEBUG(
 						"Map Register message M bit is 1=> A Map notify message has been sent back");
 				}
@@ -316,36 +314,57 @@ namespace ns3
 			{
 				NS_LOG_DEBUG("Receive Map request on Map-server!");
 				Ptr<MapRequestMsg> requestMsg = MapRequestMsg::Deserialize(buf);
-				Ptr<MapRequestRecord> record = requestMsg->GetMapRequestRecord();
-				Ptr<MapEntry> entry;
-				if (record->GetAfi() == LispControlMsg::IP)
+				// The records of a coalesced Map-Request are forwarded to the ETR of
+				// their EID (one Map-Request per ETR) or answered together with a
+				// negative Map-Reply.
+				Ptr<MapRequestMsg> negRequestMsg;
+				std::map<Address, Ptr<MapRequestMsg>> etrRequests;
+				for (uint8_t i = 0; i < requestMsg->GetNMapRequestRecords(); i++)
 				{
-					entry = m_mapTablesv4->DatabaseLookup(record->GetEidPrefix());
-				}
-				else if (record->GetAfi() == LispControlMsg::IPV6)
-				{
-					entry = m_mapTablesv6->DatabaseLookup(record->GetEidPrefix());
+					Ptr<MapRequestRecord> record = requestMsg->GetMapRequestRecord(i);
+					Ptr<MapEntry> entry;
+					if (record->GetAfi() == LispControlMsg::IP)
+					{
+						entry = m_mapTablesv4->DatabaseLookup(record->GetEidPrefix());
+					}
+					else if (record->GetAfi() == LispControlMsg::IPV6)
+					{
+						entry = m_mapTablesv6->DatabaseLookup(record->GetEidPrefix());
+					}
+					Ptr<MapRequestMsg> &subRequestMsg = entry == 0 ? negRequestMsg : etrRequests[entry->GetLocators()->SelectFirsValidRloc()->GetRlocAddress()];
+					if (subRequestMsg == 0)
+					{
+						// Same header as the received Map-Request
+						subRequestMsg = MapRequestMsg::Deserialize(buf);
+						subRequestMsg->SetMapRequestRecord(record);
+					}
+					else
+					{
+						subRequestMsg->AddMapRequestRecord(record);
+					}
 				}
-				if (entry == 0)
+				if (negRequestMsg != 0)
 				{
-					NS_LOG_DEBUG("Send Negative Map-Reply");
-					MapResolver::ConnectToPeerAddress(
-						requestMsg->GetItrRlocAddrIp(), m_peerPort, m_socket);
-
-					Ptr<MapReplyMsg> mapReply = GenerateNegMapReply(requestMsg);
-					uint8_t newBuf[256];
-					mapReply->Serialize(newBuf);
-					Ptr<Packet> reactedPacket = Create<Packet>(newBuf, 256);
-					Simulator::Schedule(Seconds(m_searchTimeVariable->GetValue()), &MapServerDdt::Send, this, reactedPacket);
+					NS_LOG_DEBUG("Send Negative Map-Reply for " << unsigned(negRequestMsg->GetNMapRequestRecords()) << " records");
+
+					Ptr<Packet> reactedPacket = GenerateNegMapReply(negRequestMsg)->ToPacket();
+					Simulator::Schedule(Seconds(m_searchTimeVariable->GetValue()), &MapServerDdt::Send, this, requestMsg->GetItrRlocAddrIp(), reactedPacket);
 				}
-				else
+				for (std::map<Address, Ptr<MapRequestMsg>>::const_iterator it = etrRequests.begin(); it != etrRequests.end(); ++it)
 				{
-					Ptr<Locator> locator = entry->GetLocators()->SelectFirsValidRloc();
-					NS_LOG_DEBUG("Forward Map-Request to ETR " << Ipv4Address::ConvertFrom(locator->GetRlocAddress()));
+					NS_LOG_DEBUG("Forward Map-Request to ETR " << Ipv4Address::ConvertFrom(it->first));
 
-					Ptr<Packet> reqPacket = Create<Packet>(buf,
-														   packet->GetSize());
-					Simulator::Schedule(Seconds(m_searchTimeVariable->GetValue()), &MapServerDdt::ForwardRequest, this, locator->GetRlocAddress(), reqPacket);
+					Ptr<Packet> reqPacket;
+					if (it->second->GetNMapRequestRecords() == requestMsg->GetNMapRequestRecords())
+					{
+						// All the records are for this ETR: forward the request as is
+						reqPacket = Create<Packet>(buf, packet->GetSize());
+					}
+					else
+					{
+						reqPacket = it->second->ToPacket();
+					}
+					Simulator::Schedule(Seconds(m_searchTimeVariable->GetValue()), &MapServerDdt::Send, this, it->first, reqPacket);
 				}
 			}
 			else if (msg_type == static_cast<uint8_t>(InfoRequestMsg::GetMsgType()))
@@ -380,10 +399,7 @@ namespace ns3
 				Ptr<InfoRequestMsg> msg = InfoRequestMsg::Deserialize(buf);
 				Ptr<InfoRequestMsg> infoReply = GenerateInfoReplyMsg(msg, iaddr.GetPort(), iaddr.GetIpv4(), maddr);
 
-				uint8_t BUF_SIZE = 16 + infoReply->GetAuthDataLen() + 20 + infoReply->GetNatLcaf()->GetLength();
-				uint8_t *newBuf = new uint8_t[BUF_SIZE];
-				infoReply->Serialize(newBuf);
-				Ptr<Packet> reactedPacket = Create<Packet>(newBuf, BUF_SIZE);
+				Ptr<Packet> reactedPacket = infoReply->ToPacket();
 				socket->SendTo(reactedPacket, 0, from);
 			}
 			else
@@ -394,34 +410,28 @@ namespace ns3
 		}
 	}
 
-	void
-	MapServerDdt::ForwardRequest(Address peerAddress, Ptr<Packet> p)
-	{
-
-		MapResolver::ConnectToPeerAddress(peerAddress,
-										  m_peerPort, m_socket);
-		Send(p);
-	}
-
 	Ptr<MapReplyMsg>
 	MapServerDdt::GenerateNegMapReply(Ptr<MapRequestMsg> requestMsg)
 	{
 		Ptr<MapReplyMsg> mapReply = Create<MapReplyMsg>();
 		mapReply->SetNonce(requestMsg->GetNonce());
-		mapReply->SetRecordCount(1);
-
-		// Record (with no locators)
-		Ptr<MapReplyRecord> replyRecord = Create<MapReplyRecord>();
-		replyRecord->SetRecordTtl(MapReplyRecord::m_defaultRecordTtl);
-		replyRecord->SetAct(MapReplyRecord::NoAction);
-		replyRecord->SetA(1);
-		replyRecord->SetMapVersionNumber(0);										  // No map version number
-		replyRecord->SetEidPrefix(requestMsg->GetMapRequestRecord()->GetEidPrefix()); // Also set eid-prefix AFI
-		replyRecord->SetEidMaskLength(32);
-		Ptr<Locators> locators;
-		replyRecord->SetLocators(locators);
-
-		mapReply->SetRecord(replyRecord);
+
+		// One record (with no locators) per requested EID
+		for (uint8_t i = 0; i < requestMsg->GetNMapRequestRecords(); i++)
+		{
+			Ptr<MapRequestRecord> record = requestMsg->GetMapRequestRecord(i);
+			Ptr<MapReplyRecord> replyRecord = Create<MapReplyRecord>();
+			replyRecord->SetRecordTtl(MapReplyRecord::m_defaultRecordTtl);
+			replyRecord->SetAct(MapReplyRecord::NoAction);
+			replyRecord->SetA(1);
+			replyRecord->SetMapVersionNumber(0);			   // No map version number
+			replyRecord->SetEidPrefix(record->GetEidPrefix()); // Also set eid-prefix AFI
+			replyRecord->SetEidMaskLength(record->GetMaskLength());
+			Ptr<Locators> locators;
+			replyRecord->SetLocators(locators);
+
+			mapReply->AddRecord(replyRecord);
+		}
 
 		return mapReply;
 	}
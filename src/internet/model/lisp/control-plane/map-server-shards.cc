@@ -0,0 +1,138 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "map-server-shards.h"
+
+#include <algorithm>
+
+#include "ns3/assert.h"
+#include "ns3/hash.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv6-address.h"
+#include "ns3/log.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("MapServerShards");
+
+MapServerShards::MapServerShards (uint8_t prefixLength, uint8_t prefixLength6)
+  : m_prefixLength (prefixLength),
+    m_prefixLength6 (prefixLength6)
+{
+  NS_ASSERT (prefixLength <= 32 && prefixLength6 <= 128);
+}
+
+void
+MapServerShards::AddMapServer (Address mapServer)
+{
+  NS_LOG_FUNCTION (this << mapServer);
+  if (std::find (m_mapServers.begin (), m_mapServers.end (), mapServer) == m_mapServers.end ())
+    {
+      m_mapServers.push_back (mapServer);
+      BuildRing ();
+    }
+}
+
+void
+MapServerShards::RemoveMapServer (Address mapServer)
+{
+  NS_LOG_FUNCTION (this << mapServer);
+  std::vector<Address>::iterator it = std::find (m_mapServers.begin (), m_mapServers.end (), mapServer);
+  if (it != m_mapServers.end ())
+    {
+      m_mapServers.erase (it);
+      BuildRing ();
+    }
+}
+
+uint32_t
+MapServerShards::GetNMapServers (void) const
+{
+  return m_mapServers.size ();
+}
+
+const std::vector<Address> &
+MapServerShards::GetMapServers (void) const
+{
+  return m_mapServers;
+}
+
+void
+MapServerShards::BuildRing (void)
+{
+  m_ring.clear ();
+  for (uint32_t i = 0; i < m_mapServers.size (); i++)
+    {
+      // The points of a Map-Server only depend on its address
+      uint8_t buf[Address::MAX_SIZE + 4];
+      uint32_t len = m_mapServers[i].CopyTo (buf);
+      for (uint32_t v = 0; v < VIRTUAL_NODES; v++)
+        {
+          buf[len] = v >> 24;
+          buf[len + 1] = v >> 16;
+          buf[len + 2] = v >> 8;
+          buf[len + 3] = v;
+          m_ring.push_back (std::make_pair (Hash32 ((const char *) buf, len + 4), i));
+        }
+    }
+  std::sort (m_ring.begin (), m_ring.end ());
+}
+
+uint32_t
+MapServerShards::GetShard (Address eid) const
+{
+  uint8_t buf[16];
+  uint32_t len;
+  if (Ipv4Address::IsMatchingType (eid))
+    {
+      Ipv4Mask mask (m_prefixLength ? 0xffffffffU << (32 - m_prefixLength) : 0);
+      Ipv4Address::ConvertFrom (eid).CombineMask (mask).Serialize (buf);
+      len = 4;
+    }
+  else
+    {
+      NS_ASSERT (Ipv6Address::IsMatchingType (eid));
+      Ipv6Address::ConvertFrom (eid).CombinePrefix (Ipv6Prefix (m_prefixLength6)).Serialize (buf);
+      len = 16;
+    }
+  return Hash32 ((const char *) buf, len);
+}
+
+Address
+MapServerShards::GetMapServer (Address eid) const
+{
+  NS_ASSERT_MSG (!m_ring.empty (), "No Map-Server in the pool");
+  std::vector<std::pair<uint32_t, uint32_t> >::const_iterator it =
+    std::lower_bound (m_ring.begin (), m_ring.end (), std::make_pair (GetShard (eid), 0U));
+  if (it == m_ring.end ())
+    {
+      it = m_ring.begin ();
+    }
+  return m_mapServers[it->second];
+}
+
+std::vector<Address>
+MapServerShards::GetMapServers (Address eidPrefix, uint8_t maskLength) const
+{
+  uint8_t shardLength = Ipv4Address::IsMatchingType (eidPrefix) ? m_prefixLength : m_prefixLength6;
+  if (maskLength < shardLength)
+    {
+      return m_mapServers;
+    }
+  return std::vector<Address> (1, GetMapServer (eidPrefix));
+}
+
+} /* namespace ns3 */
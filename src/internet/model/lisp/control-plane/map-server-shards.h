@@ -0,0 +1,84 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef SRC_INTERNET_MODEL_LISP_CONTROL_PLANE_MAP_SERVER_SHARDS_H_
+#define SRC_INTERNET_MODEL_LISP_CONTROL_PLANE_MAP_SERVER_SHARDS_H_
+
+#include <vector>
+#include <utility>
+
+#include "ns3/address.h"
+#include "ns3/simple-ref-count.h"
+
+namespace ns3 {
+
+/**
+ * \brief Partition of the EID space among a pool of Map-Servers.
+ *
+ * Each EID belongs to a shard, identified by the EID masked to the shard
+ * prefix length (/24 in IPv4, /48 in IPv6 by default). The shards are
+ * assigned to the Map-Servers by consistent hashing: every Map-Server owns
+ * VIRTUAL_NODES points of a hash ring, and a shard belongs to the
+ * Map-Server of the first point that follows its hash. When a Map-Server
+ * joins a pool of N, it takes about 1/(N+1) of the shards, from all the
+ * others; no other shard moves.
+ *
+ * The xTRs register each EID-Prefix with the Map-Server owning its shard,
+ * and the Map-Resolvers forward the Map-Requests for an EID to the same
+ * Map-Server. An EID-Prefix shorter than the shard prefix length spans
+ * several shards: it is registered with every Map-Server.
+ */
+class MapServerShards : public SimpleRefCount<MapServerShards>
+{
+public:
+  /// Number of points of each Map-Server on the ring.
+  static const uint32_t VIRTUAL_NODES = 64;
+
+  MapServerShards (uint8_t prefixLength = 24, uint8_t prefixLength6 = 48);
+
+  void AddMapServer (Address mapServer);
+  void RemoveMapServer (Address mapServer);
+  uint32_t GetNMapServers (void) const;
+  const std::vector<Address> &GetMapServers (void) const;
+
+  /**
+   * \return The Map-Server owning the shard of an EID. The pool must not be
+   * empty.
+   */
+  Address GetMapServer (Address eid) const;
+  /**
+   * \return The Map-Servers an EID-Prefix is registered with: the owner of
+   * its shard, or all of them if the EID-Prefix spans several shards.
+   */
+  std::vector<Address> GetMapServers (Address eidPrefix, uint8_t maskLength) const;
+
+  /**
+   * \return The shard of an EID: its hash on the ring.
+   */
+  uint32_t GetShard (Address eid) const;
+
+private:
+  void BuildRing (void);
+
+  uint8_t m_prefixLength;
+  uint8_t m_prefixLength6;
+  std::vector<Address> m_mapServers;
+  /// The points of the ring, sorted by hash, with the index of their Map-Server.
+  std::vector<std::pair<uint32_t, uint32_t> > m_ring;
+};
+
+} /* namespace ns3 */
+
+#endif /* SRC_INTERNET_MODEL_LISP_CONTROL_PLANE_MAP_SERVER_SHARDS_H_ */
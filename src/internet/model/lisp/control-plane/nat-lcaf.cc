@@ -120,8 +120,22 @@ NatLcaf::ComputeLength(void){
 }
 
 
-void NatLcaf::Serialize(uint8_t *buf) {
-	uint8_t size = 0;
+uint32_t NatLcaf::GetSerializedSize(void) const {
+	// AFI, Rsvd1, Flags, Type, Rsvd2, Length and the two UDP ports
+	uint32_t size = 12;
+	Address addresses[] = {m_globalEtrRlocAddress, m_msRlocAddress, m_privateEtrRlocAddress, m_rtrRlocAddress};
+	for (int i = 0; i < 4; i++)
+	{
+		if (Ipv4Address::IsMatchingType(addresses[i]))
+			size += 2 + 4;
+		else if (Ipv6Address::IsMatchingType(addresses[i]))
+			size += 2 + 16;
+	}
+	return size;
+}
+
+void NatLcaf::Serialize(uint8_t *buf) const {
+	uint32_t size = 0;
 
 	// Afi
 	int afi_size = 2;
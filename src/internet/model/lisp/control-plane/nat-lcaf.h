@@ -55,7 +55,11 @@ public:
 
   void ComputeLength(void);
 
-	void Serialize(uint8_t *buf);
+	/**
+	 * \return The number of bytes written by Serialize.
+	 */
+	uint32_t GetSerializedSize(void) const;
+	void Serialize(uint8_t *buf) const;
 	static Ptr<NatLcaf> Deserialize(uint8_t *buf);
 
 	static const uint16_t NAT_LCAF_LENGTH = 20; //Limitation (only one RLOC)
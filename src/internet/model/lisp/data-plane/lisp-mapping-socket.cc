@@ -24,6 +24,10 @@
 #include "ns3/packet.h"
 #include "ns3/uinteger.h"
 #include "ns3/integer.h"
+#include "ns3/boolean.h"
+#include "ns3/simulator.h"
+#include "ns3/hash.h"
+#include "endpoint-id.h"
 
 namespace ns3
 {
@@ -44,6 +48,12 @@ LispMappingSocket::GetTypeId ()
                        MakeUintegerAccessor (&LispMappingSocket::GetRcvBufSize,
                                              &LispMappingSocket::SetRcvBufSize),
                        MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("DirectMessages",
+                   "Deliver mapping messages as objects, without serializing "
+                   "them, to the sockets whose owner reads them with RecvMsg",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&LispMappingSocket::m_directMessages),
+                   MakeBooleanChecker ())
   ;
   return tid;
 }
@@ -59,11 +69,16 @@ LispMappingSocket::LispMappingSocket ()
   m_shutdownSend = false;
   m_errno = ERROR_NOTERROR;
   m_rxAvailable = 0;
+  m_msgQueueSize = 0;
+  m_nDrops = 0;
+  m_directMessages = true;
+  m_directRecv = false;
 }
 
 LispMappingSocket::~LispMappingSocket ()
 {
   NS_LOG_FUNCTION_NOARGS ();
+  m_msgNotifyEvent.Cancel ();
 }
 
 void LispMappingSocket::SetNode (Ptr<Node> node)
@@ -208,6 +223,122 @@ int LispMappingSocket::SendTo (Ptr<Packet> p, uint32_t flags,
   return 0;
 }
 
+int LispMappingSocket::SendMsg (const MappingSocketMsgHeader &header, Ptr<MappingSocketMsg> msg)
+{
+  return SendMsgTo (header, msg, m_destAddres);
+}
+
+int LispMappingSocket::SendMsgTo (const MappingSocketMsgHeader &header, Ptr<MappingSocketMsg> msg,
+                                  const Address &toAddress)
+{
+  NS_LOG_FUNCTION (this << toAddress);
+  NS_ASSERT (msg != 0);
+
+  Ptr<LispMappingSocket> destSocket;
+  if (m_connected && !m_shutdownSend && MappingSocketAddress::IsMatchingType (toAddress))
+    {
+      destSocket = m_lisp->GetMappingSocket (MappingSocketAddress::ConvertFrom (toAddress).GetSockIndex ());
+    }
+  if (destSocket == 0 || !m_directMessages || !destSocket->IsDirectRecv ())
+    {
+      // Compatibility path: the usual serialized message (SendTo reports the errors)
+      uint8_t buf[MSG_BUF_SIZE];
+      msg->Serialize (buf);
+      Ptr<Packet> packet = Create<Packet> (buf, MSG_BUF_SIZE);
+      packet->AddHeader (header);
+      return SendTo (packet, 0, toAddress);
+    }
+  destSocket->ForwardMsg (header, msg);
+  return 0;
+}
+
+Ptr<MappingSocketMsg> LispMappingSocket::RecvMsg (MappingSocketMsgHeader &header)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_msgQueue.empty ())
+    {
+      return 0;
+    }
+  header = m_msgQueue.front ().header;
+  Ptr<MappingSocketMsg> msg = m_msgQueue.front ().msg;
+  m_msgQueue.pop_front ();
+  m_msgQueueSize -= header.GetSerializedSize () + MSG_BUF_SIZE;
+  if (header.GetMapType () == static_cast<uint16_t> (MAPM_MISS))
+    {
+      m_queuedMisses.erase (msg->GetEndPointId ()->GetEidAddress ());
+    }
+  return msg;
+}
+
+void LispMappingSocket::SetDirectRecv (bool directRecv)
+{
+  m_directRecv = directRecv;
+}
+
+bool LispMappingSocket::IsDirectRecv (void) const
+{
+  return m_directRecv;
+}
+
+size_t LispMappingSocket::EidHash::operator() (const Address &eid) const
+{
+  // Type, length and value, as compared by operator ==
+  uint8_t buf[Address::MAX_SIZE + 2];
+  uint32_t len = eid.CopyAllTo (buf, sizeof (buf));
+  return Hash32 ((const char *) buf, len);
+}
+
+bool LispMappingSocket::IsMissQueued (Ptr<MappingSocketMsg> msg) const
+{
+  return m_queuedMisses.count (msg->GetEndPointId ()->GetEidAddress ()) != 0;
+}
+
+void LispMappingSocket::ForwardMsg (const MappingSocketMsgHeader &header, Ptr<MappingSocketMsg> msg)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_shutdownRecv)
+    {
+      NS_LOG_WARN ("Receive side shut down. Drop.");
+      return;
+    }
+  // A storm of packets to an unknown EID only needs one pending miss
+  if (header.GetMapType () == static_cast<uint16_t> (MAPM_MISS) && IsMissQueued (msg))
+    {
+      NS_LOG_DEBUG ("Miss for " << msg->GetEndPointId ()->Print () << " already queued");
+      return;
+    }
+  // Same room as the serialized message would take
+  uint32_t size = header.GetSerializedSize () + MSG_BUF_SIZE;
+  if (m_rxAvailable + m_msgQueueSize + size > m_rcvBufSize)
+    {
+      NS_LOG_WARN ("No receive buffer space available.  Drop.");
+      m_nDrops++;
+      return;
+    }
+  if (header.GetMapType () == static_cast<uint16_t> (MAPM_MISS))
+    {
+      m_queuedMisses.insert (msg->GetEndPointId ()->GetEidAddress ());
+    }
+  m_msgQueueSize += size;
+  m_msgQueue.push_back (QueuedMsg ());
+  m_msgQueue.back ().header = header;
+  m_msgQueue.back ().msg = msg;
+  // One notification for all the messages queued during this event
+  if (!m_msgNotifyEvent.IsRunning ())
+    {
+      m_msgNotifyEvent = Simulator::ScheduleNow (&LispMappingSocket::NotifyMsgRecv, this);
+    }
+}
+
+void LispMappingSocket::NotifyMsgRecv (void)
+{
+  NS_LOG_FUNCTION (this << m_msgQueue.size ());
+  if (!m_msgQueue.empty ())
+    {
+      NotifyDataRecv ();
+    }
+}
+
 std::queue<Ptr<Packet> > LispMappingSocket::GetDeliveryQueue (void)
 {
   return m_deliveryQueue;
@@ -300,7 +431,7 @@ void LispMappingSocket::Forward (Ptr<const Packet> packet, const Address &from)
 {
   NS_LOG_FUNCTION (this << packet << from);
 
-  if ((m_rxAvailable + packet->GetSize ()) <= m_rcvBufSize)
+  if ((m_rxAvailable + m_msgQueueSize + packet->GetSize ()) <= m_rcvBufSize)
     {
       Ptr<Packet> copy = packet->Copy ();
       // todo Add packet address tag
@@ -311,9 +442,15 @@ void LispMappingSocket::Forward (Ptr<const Packet> packet, const Address &from)
   else
     {
       NS_LOG_WARN ("No receive buffer space available.  Drop.");
+      m_nDrops++;
     }
 }
 
+uint32_t LispMappingSocket::GetNDrops (void) const
+{
+  return m_nDrops;
+}
+
 uint32_t LispMappingSocket::GetRcvBufSize (void) const
 {
   return m_rcvBufSize;
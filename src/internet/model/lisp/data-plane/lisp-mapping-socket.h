@@ -22,9 +22,14 @@
 
 #include <stdint.h>
 #include <queue>
+#include <deque>
+#include <unordered_set>
 #include "ns3/socket.h"
+#include "ns3/event-id.h"
 #include "ns3/ptr.h"
 #include "lisp-over-ip.h"
+#include "mapping-socket-msg.h"
+#include "mapping-socket-msg-header.h"
 
 
 namespace ns3
@@ -38,6 +43,15 @@ class Packet;
  *
  * This class provides a socket interface
  * to ns3's implementation of LISP.
+ *
+ * Besides the Packet interface of Socket, mapping messages can be exchanged
+ * as objects with SendMsg () and RecvMsg (): the MappingSocketMsg is queued
+ * as is at the destination socket, without being serialized in a Packet.
+ * Messages queued during the same event are notified with a single receive
+ * callback, and a miss for an EID that is already waiting in the queue is
+ * not queued again. A destination socket only receives messages as objects
+ * if its owner reads them with RecvMsg (see SetDirectRecv), otherwise they
+ * are serialized and delivered as Packets.
  */
 class LispMappingSocket : public Socket
 {
@@ -166,10 +180,73 @@ public:
 
   uint32_t GetRcvBufSize (void) const;
   void SetRcvBufSize (uint32_t rcvBufSize);
+  /**
+   * \return The number of packets and messages dropped for lack of receive
+   * buffer space.
+   */
+  uint32_t GetNDrops (void) const;
+
+  /**
+   * \brief Send a mapping message to the connected socket.
+   * \param header The header of the message.
+   * \param msg The body of the message.
+   * \return 0 on success, -1 on error (see GetErrno)
+   */
+  int SendMsg (const MappingSocketMsgHeader &header, Ptr<MappingSocketMsg> msg);
+
+  /**
+   * \brief Send a mapping message to the socket of the given address.
+   * \param header The header of the message.
+   * \param msg The body of the message.
+   * \param toAddress The MappingSocketAddress of the destination socket.
+   * \return 0 on success, -1 on error (see GetErrno)
+   */
+  int SendMsgTo (const MappingSocketMsgHeader &header, Ptr<MappingSocketMsg> msg,
+                 const Address &toAddress);
+
+  /**
+   * \brief Read the next mapping message received as an object.
+   * \param header The header of the message.
+   * \return The body of the message, 0 if there is none.
+   */
+  Ptr<MappingSocketMsg> RecvMsg (MappingSocketMsgHeader &header);
+
+  /**
+   * \brief Declare whether the owner of the socket reads the messages
+   * with RecvMsg.
+   * \param directRecv true if messages can be delivered as objects.
+   */
+  void SetDirectRecv (bool directRecv);
+
+  /**
+   * \return true if messages can be delivered to this socket as objects.
+   */
+  bool IsDirectRecv (void) const;
+
+  /**
+   * \brief Size of the buffer a MappingSocketMsg is serialized in when it is
+   * delivered as a Packet.
+   */
+  static const uint32_t MSG_BUF_SIZE = 256;
 
 private:
+  /// A mapping message queued as an object.
+  struct QueuedMsg
+  {
+    MappingSocketMsgHeader header;
+    Ptr<MappingSocketMsg> msg;
+  };
+  /// Hash of an EID address, for m_queuedMisses.
+  struct EidHash
+  {
+    size_t operator() (const Address &eid) const;
+  };
+
   std::queue<Ptr<Packet> >GetDeliveryQueue (void);
   void Forward (Ptr<const Packet> packet, const Address &from);
+  void ForwardMsg (const MappingSocketMsgHeader &header, Ptr<MappingSocketMsg> msg);
+  void NotifyMsgRecv (void);
+  bool IsMissQueued (Ptr<MappingSocketMsg> msg) const;
   Ptr<LispOverIp> m_lisp;       //!< The associated LISP protocol
   Address m_destAddres;         //!< The destination address
   uint8_t m_lispSockIndex;      //!< The index assigned to this socket
@@ -181,6 +258,13 @@ private:
   std::queue<Ptr<Packet> > m_deliveryQueue;     //!< Packet waiting to be processed.
   uint32_t m_rxAvailable;       //!< Number of available bytes to be received
   uint32_t m_rcvBufSize;        //!< receive buffer size
+  bool m_directMessages;        //!< Send messages as objects when the destination supports it
+  bool m_directRecv;            //!< The owner reads the messages with RecvMsg
+  std::deque<QueuedMsg> m_msgQueue;     //!< Messages waiting to be processed.
+  uint32_t m_msgQueueSize;      //!< Receive buffer space taken by m_msgQueue (bytes)
+  uint32_t m_nDrops;            //!< Packets and messages dropped for lack of buffer space
+  std::unordered_set<Address, EidHash> m_queuedMisses; //!< EIDs of the MAPM_MISS in m_msgQueue
+  EventId m_msgNotifyEvent;     //!< Pending receive notification for m_msgQueue
 
 
 };
@@ -27,9 +27,13 @@
 #include "lisp-mapping-socket-factory.h"
 #include "lisp-mapping-socket.h"
 #include "simple-map-tables.h"
+#include "locators-impl.h"
 #include "ns3/string.h"
+#include "ns3/uinteger.h"
 
 #include <ns3/ipv4-l3-protocol.h>
+#include "ns3/ipv6-header.h"
+#include "ns3/flow-hash.h"
 namespace ns3
 {
 
@@ -75,7 +79,28 @@ namespace ns3
                                 "The random variable representing the delay stretch introduced by the use of an RTR)",
                                 StringValue("ns3::ConstantRandomVariable[Constant=0]"),
                                 MakePointerAccessor(&LispOverIp::m_rtrVariable),
-                                MakePointerChecker<RandomVariableStream>());
+                                MakePointerChecker<RandomVariableStream>())
+                            .AddAttribute(
+                                "MissQueueMaxBytes",
+                                "The maximum number of bytes waiting for a Map-Reply (0 for no limit)",
+                                UintegerValue(1 << 20),
+                                MakeUintegerAccessor(&LispOverIp::SetMissQueueMaxBytes,
+                                                     &LispOverIp::GetMissQueueMaxBytes),
+                                MakeUintegerChecker<uint32_t>())
+                            .AddAttribute(
+                                "MissQueueMaxEidBytes",
+                                "The maximum number of bytes waiting for a Map-Reply, per destination EID (0 for no limit)",
+                                UintegerValue(64 * 1024),
+                                MakeUintegerAccessor(&LispOverIp::SetMissQueueMaxEidBytes,
+                                                     &LispOverIp::GetMissQueueMaxEidBytes),
+                                MakeUintegerChecker<uint32_t>())
+                            .AddAttribute(
+                                "MissQueueMaxDelay",
+                                "The time after which a packet waiting for a Map-Reply is dropped",
+                                TimeValue(Seconds(3)),
+                                MakeTimeAccessor(&LispOverIp::SetMissQueueMaxDelay,
+                                                 &LispOverIp::GetMissQueueMaxDelay),
+                                MakeTimeChecker());
 
     return tid;
   }
@@ -142,7 +167,7 @@ namespace ns3
   }
 
   LispOverIp::LispOverIp(Ptr<LispStatistics> statisticsForIpv4,
-                         Ptr<LispStatistics> statisticsForIpv6) : m_pitr(false), m_petr(false), m_nated(false), m_rtr(false), m_registered(false)
+                         Ptr<LispStatistics> statisticsForIpv6) : m_pitr(false), m_petr(false), m_nated(false), m_rtr(false), m_registered(false), m_sourceRlocEpoch(0)
   {
     NS_LOG_FUNCTION(this);
     NS_ASSERT(statisticsForIpv4 && statisticsForIpv6);
@@ -158,7 +183,7 @@ namespace ns3
     m_statisticsForIpv6 = statisticsV6;
   }
 
-  LispOverIp::LispOverIp() : m_pitr(false), m_petr(false), m_nated(false), m_rtr(false), m_registered(false)
+  LispOverIp::LispOverIp() : m_pitr(false), m_petr(false), m_nated(false), m_rtr(false), m_registered(false), m_sourceRlocEpoch(0)
   {
     /**
      * Yue gives some explanation:
@@ -179,6 +204,8 @@ namespace ns3
      */
     NS_LOG_FUNCTION(this << "LispOverIp constructor is called, the m_sockets size is: " << m_sockets.size());
     m_lispSocket = CreateSocket();
+    // The data plane reads the messages of the control plane as objects
+    DynamicCast<LispMappingSocket>(m_lispSocket)->SetDirectRecv(true);
     // Above instruction make m_lispSocket as the first element (index 0)
     // saved in vector m_sockets. Which place LispOverIp create the second one?
   }
@@ -227,6 +254,7 @@ namespace ns3
   void
   LispOverIp::DoDispose(void)
   {
+    m_missQueue.Clear();
   }
 
   Ptr<Socket>
@@ -328,6 +356,12 @@ namespace ns3
     return mapEntry->RlocSelection();
   }
 
+  Ptr<Locator>
+  LispOverIp::SelectDestinationRloc(Ptr<const MapEntry> mapEntry, uint32_t flowHash) const
+  {
+    return mapEntry->RlocSelection(flowHash);
+  }
+
   Ptr<Locator>
   LispOverIp::SelectSourceRloc(Address const &srcEid,
                                Ptr<const Locator> destLocator) const
@@ -385,272 +419,330 @@ namespace ns3
     NS_LOG_DEBUG("Bind to " << m_lispAddress);
   }
 
+  void
+  LispOverIp::FlushMissQueue(Ptr<const EndpointId> eid)
+  {
+    NS_LOG_FUNCTION(this);
+    // Only IPv4 packets are buffered (see LispOverIpv4::BufferPacket)
+    if (!eid->IsIpv4())
+    {
+      return;
+    }
+    std::list<BufferedPacket> packets;
+    m_missQueue.Dequeue(Ipv4Address::ConvertFrom(eid->GetEidAddress()), eid->GetIpv4Mask(), packets);
+    if (packets.empty())
+    {
+      return;
+    }
+    NS_LOG_DEBUG("Send " << packets.size() << " packets waiting for " << eid->Print());
+    // Ipv4L3Protocol::Send finds the new map-cache entry and hands the packets to LispOutput
+    Ptr<Ipv4L3Protocol> ipv4 = GetNode()->GetObject<Ipv4L3Protocol>();
+    for (std::list<BufferedPacket>::iterator it = packets.begin(); it != packets.end(); ++it)
+    {
+      ipv4->Send(it->packet, it->source, it->destination, it->protocol, it->route);
+    }
+  }
+
+  void
+  LispOverIp::SetMissQueueMaxBytes(uint32_t maxBytes)
+  {
+    m_missQueue.SetMaxBytes(maxBytes);
+  }
+
+  uint32_t
+  LispOverIp::GetMissQueueMaxBytes(void) const
+  {
+    return m_missQueue.GetMaxBytes();
+  }
+
+  void
+  LispOverIp::SetMissQueueMaxEidBytes(uint32_t maxEidBytes)
+  {
+    m_missQueue.SetMaxEidBytes(maxEidBytes);
+  }
+
+  uint32_t
+  LispOverIp::GetMissQueueMaxEidBytes(void) const
+  {
+    return m_missQueue.GetMaxEidBytes();
+  }
+
+  void
+  LispOverIp::SetMissQueueMaxDelay(Time maxDelay)
+  {
+    m_missQueue.SetMaxDelay(maxDelay);
+  }
+
+  Time
+  LispOverIp::GetMissQueueMaxDelay(void) const
+  {
+    return m_missQueue.GetMaxDelay();
+  }
+
   void
   LispOverIp::HandleMapSockRead(Ptr<Socket> socket)
   {
     NS_LOG_FUNCTION(this);
+    MappingSocketMsgHeader sockMsgHdr;
+    Ptr<MappingSocketMsg> msg;
+    // Messages delivered as objects, then the ones serialized in packets
+    Ptr<LispMappingSocket> mappingSocket = DynamicCast<LispMappingSocket>(socket);
+    while ((msg = mappingSocket->RecvMsg(sockMsgHdr)))
+    {
+      HandleMapSockMsg(sockMsgHdr, msg);
+    }
+
     Ptr<Packet> packet;
     Address from;
-
     while ((packet = socket->RecvFrom(from)))
     {
-      MappingSocketMsgHeader sockMsgHdr;
       packet->RemoveHeader(sockMsgHdr);
       uint8_t buf[packet->GetSize()];
       packet->CopyData(buf, packet->GetSize());
-      Ptr<MappingSocketMsg> msg = MappingSocketMsg::Deserialize(buf);
-      NS_LOG_DEBUG("MSG HEADER " << sockMsgHdr);
-      if (sockMsgHdr.GetMapType() == static_cast<uint16_t>(LispMappingSocket::MAPM_ADD))
-      {
-        // TODO: extract the following code and write it as an function
-        //  Both MAPM_ADD and MAPM_UPDATE will use the same code.
-        NS_LOG_DEBUG(
-            "ADD Message received on lisp (" << msg->GetEndPointId()->Print() << ") \n"
-                                             << msg->GetLocators()->Print());
-        Ptr<EndpointId> eid = msg->GetEndPointId();
+      HandleMapSockMsg(sockMsgHdr, MappingSocketMsg::Deserialize(buf));
+    }
+  }
 
-        /* Check if wild card entry. If so, this means the LISP device is NATed */
-        if (eid->GetIpv4Mask().IsEqual(Ipv4Mask("/0")))
-        {
-          NS_LOG_DEBUG("Wild card entry detected -> LISP device is NATed");
-          SetNated(true);
+  void
+  LispOverIp::HandleMapSockMsg(MappingSocketMsgHeader const &sockMsgHdr, Ptr<MappingSocketMsg> msg)
+  {
+    NS_LOG_DEBUG("MSG HEADER " << sockMsgHdr);
+    if (sockMsgHdr.GetMapType() == static_cast<uint16_t>(LispMappingSocket::MAPM_ADD))
+    {
+      // TODO: extract the following code and write it as an function
+      //  Both MAPM_ADD and MAPM_UPDATE will use the same code.
+      NS_LOG_DEBUG(
+          "ADD Message received on lisp (" << msg->GetEndPointId()->Print() << ") \n"
+                                           << msg->GetLocators()->Print());
+      Ptr<EndpointId> eid = msg->GetEndPointId();
 
-          // Delete any previous entry in the cache
-          m_mapTablesIpv4->WipeCache();
-        }
+      /* Check if wild card entry. If so, this means the LISP device is NATed */
+      if (eid->GetIpv4Mask().IsEqual(Ipv4Mask("/0")))
+      {
+        NS_LOG_DEBUG("Wild card entry detected -> LISP device is NATed");
+        SetNated(true);
 
-        Ptr<MapEntry> mapEntry = Create<MapEntryImpl>();
-        Ptr<Locators> locators;
-        mapEntry->SetEidPrefix(eid);
-        if ((int)sockMsgHdr.GetMapFlags() & (int)LispMappingSocket::MAPF_NEGATIVE)
-        {
-          NS_LOG_DEBUG("MAP ENTRY is negative!");
-          mapEntry->setIsNegative(1);
-        }
-        else
-        {
-          NS_LOG_DEBUG("Setting Is Local If to 0!");
-          locators = msg->GetLocators();
-          for (int i = 0; i < locators->GetNLocators(); ++i)
-          {
-            Ptr<Locator> locator = locators->GetLocatorByIdx(i);
-            locator->GetRlocMetrics()->SetIsLocalIf(0);
-          }
-          mapEntry->setIsNegative(0);
-          mapEntry->SetLocators(locators);
-        }
-        if (eid->IsIpv4())
-        {
-          // In the case of cache update, we should first delete the previous one containing EID-prefix
-          // This work is done by SetEntry method!
-          m_mapTablesIpv4->SetEntry(eid->GetEidAddress(),
-                                    eid->GetIpv4Mask(), mapEntry,
-                                    MapTables::IN_CACHE);
-          NS_LOG_DEBUG(
-              "Ipv4 Map Entry IPv4 (Extracted from Map Reply Message) has been saved in cache database by LispOverIp");
-        }
-        else
-        {
-          m_mapTablesIpv6->SetEntry(eid->GetEidAddress(),
-                                    eid->GetIpv6Prefix(), mapEntry,
-                                    MapTables::IN_CACHE);
-          NS_LOG_DEBUG(
-              "Ipv4 Map Entry IPv6 (Extracted from Map Reply Message) has been saved in cache database by LispOverIp");
-        }
+        // Delete any previous entry in the cache
+        m_mapTablesIpv4->WipeCache();
+      }
 
-        /*
-         * ns3-privacy addition
-         * Modification to send the buffered packets waiting for the Map reply.
-         */
-        Ptr<Ipv4L3Protocol> ipv4 = GetNode()->GetObject<Ipv4L3Protocol>();
-        Ipv4Address eidPrefix = Ipv4Address::ConvertFrom(eid->GetEidAddress());    
-        for (auto it = m_bufferedPackets.begin(); it != m_bufferedPackets.end(); it++)
+      Ptr<MapEntry> mapEntry = Create<MapEntryImpl>();
+      Ptr<Locators> locators;
+      mapEntry->SetEidPrefix(eid);
+      mapEntry->SetTtl(sockMsgHdr.GetMapTtl());
+      if ((int)sockMsgHdr.GetMapFlags() & (int)LispMappingSocket::MAPF_NEGATIVE)
+      {
+        NS_LOG_DEBUG("MAP ENTRY is negative!");
+        mapEntry->setIsNegative(1);
+      }
+      else
+      {
+        NS_LOG_DEBUG("Setting Is Local If to 0!");
+        // A message delivered as an object still belongs to its sender: cache copies
+        Ptr<Locators> received = msg->GetLocators();
+        locators = Create<LocatorsImpl>();
+        for (int i = 0; i < received->GetNLocators(); ++i)
         {
-          if (eidPrefix.Get() == it->destination.CombineMask("/24").Get())
-          {
-            ipv4->Send(it->packet, it->source, it->destination, it->protocol, it->route);
-            it = m_bufferedPackets.erase(it);
-          }
-          else
-          {
-          }
+          Ptr<Locator> locator = Create<Locator>(received->GetLocatorByIdx(i)->GetRlocAddress());
+          locator->SetRlocMetrics(Create<RlocMetrics>(*received->GetLocatorByIdx(i)->GetRlocMetrics()));
+          locator->GetRlocMetrics()->SetIsLocalIf(0);
+          locators->InsertLocator(locator);
         }
+        mapEntry->setIsNegative(0);
+        mapEntry->SetLocators(locators);
       }
-      else if (sockMsgHdr.GetMapType() == static_cast<uint16_t>(LispMappingSocket::MAPM_DELETE))
+      if (eid->IsIpv4())
+      {
+        // In the case of cache update, we should first delete the previous one containing EID-prefix
+        // This work is done by SetEntry method!
+        m_mapTablesIpv4->SetEntry(eid->GetEidAddress(),
+                                  eid->GetIpv4Mask(), mapEntry,
+                                  MapTables::IN_CACHE);
+        NS_LOG_DEBUG(
+            "Ipv4 Map Entry IPv4 (Extracted from Map Reply Message) has been saved in cache database by LispOverIp");
+      }
+      else
       {
+        m_mapTablesIpv6->SetEntry(eid->GetEidAddress(),
+                                  eid->GetIpv6Prefix(), mapEntry,
+                                  MapTables::IN_CACHE);
+        NS_LOG_DEBUG(
+            "Ipv4 Map Entry IPv6 (Extracted from Map Reply Message) has been saved in cache database by LispOverIp");
       }
-      else if (sockMsgHdr.GetMapType() == static_cast<uint16_t>(LispMappingSocket::MAPM_GET))
+
+      FlushMissQueue(eid);
+    }
+    else if (sockMsgHdr.GetMapType() == static_cast<uint16_t>(LispMappingSocket::MAPM_DELETE))
+    {
+    }
+    else if (sockMsgHdr.GetMapType() == static_cast<uint16_t>(LispMappingSocket::MAPM_GET))
+    {
+    }
+    else if (sockMsgHdr.GetMapType() == static_cast<uint16_t>(LispMappingSocket::MAPM_NAT))
+    {
+      NS_LOG_DEBUG("MAPM_NAT received in LispOverIp: SetNated(false)");
+      SetNated(false);
+      /* Remove wild card entry if any */
+      m_mapTablesIpv4->CacheDelete(Ipv4Address("0.0.0.0"));
+    }
+    else if (sockMsgHdr.GetMapType() == static_cast<uint16_t>(LispMappingSocket::MAPM_ISREGISTERED))
+    {
+      NS_LOG_DEBUG("MAPM_ISREGISTERED received in LispOverIp");
+      // MAPA_EID used to say that LISP device is registered.
+      // MAPA_EIDMASK is used to say that LISP device is NOT registered.
+      if ((int)sockMsgHdr.GetMapAddresses() == (int)LispMappingSocket::MAPA_EID)
       {
+        NS_LOG_DEBUG("LISP device is registered to the MDS");
+        m_registered = true;
       }
-      else if (sockMsgHdr.GetMapType() == static_cast<uint16_t>(LispMappingSocket::MAPM_NAT))
+      else
       {
-        NS_LOG_DEBUG("MAPM_NAT received in LispOverIp: SetNated(false)");
-        SetNated(false);
-        /* Remove wild card entry if any */
-        m_mapTablesIpv4->CacheDelete(Ipv4Address("0.0.0.0"));
+        NS_LOG_DEBUG("LISP device is NOT registered to the MDS");
+        m_registered = false;
       }
-      else if (sockMsgHdr.GetMapType() == static_cast<uint16_t>(LispMappingSocket::MAPM_ISREGISTERED))
+    }
+    else if (sockMsgHdr.GetMapType() == static_cast<uint16_t>(LispMappingSocket::MAPM_DATABASE_UPDATE))
+    {
+      /**
+       * TODO: Notify to xTR to send a new Map-Register message.
+       * In this case, first check whether the received EID is in the database.
+       * If yes => update the map entry
+       * If no => add the map entry.
+       * Maybe we can use another solution:
+       * 1) if DHCP client detect link state change
+       * (e.g. during mobility, the wifi link is temporarily lost), DHCP has no
+       * IP address (RLOC). Trigger a MAPM_DELETE message to flush LISP-MN database
+       * 10-07-2017: The answer is no. Since flush LISP-MN database cannot update map version number!
+       * (how to treat Cache?=> Never touch Cache! Since it is the only place we
+       * know to which it communicate!! if cache is not flushed. It is OK if we have
+       * cache but no database? or database is empty?)
+       */
+      NS_LOG_DEBUG(
+          "Update or Add one mapping (" << msg->GetEndPointId()->Print() << ") \n"
+                                        << msg->GetLocators()->Print());
+      Ptr<EndpointId> eid = msg->GetEndPointId();
+      Ptr<MapEntry> mapEntry = Create<MapEntryImpl>();
+      Ptr<Locators> locators = msg->GetLocators();
+      mapEntry->SetEidPrefix(eid);
+      /* MAPM_DATABASE_UPDATE is only sent dy DHCP client when receiving a new LRLOC.
+       *
+       * We need an additional MapEntry in database for encapsulation (in case of NAT).
+       * This additional MapEntry is equivalent to the config file where we add:
+       * <if-address-v4>  192.168.1.1 </if-address-v4>
+       * <entry>
+       * <eid-v4>  192.168.1.0 255.255.255.0 0 </eid-v4>
+       * <rloc-v4> 192.168.1.1 200 30  1 </rloc-v4>
+       * </entry>
+       */
+      Ptr<MapEntry> mapEntryEncap = Create<MapEntryImpl>();
+
+      if ((int)sockMsgHdr.GetMapFlags() & (int)LispMappingSocket::MAPF_NEGATIVE)
       {
-        NS_LOG_DEBUG("MAPM_ISREGISTERED received in LispOverIp");
-        // MAPA_EID used to say that LISP device is registered.
-        // MAPA_EIDMASK is used to say that LISP device is NOT registered.
-        if ((int)sockMsgHdr.GetMapAddresses() == (int)LispMappingSocket::MAPA_EID)
-        {
-          NS_LOG_DEBUG("LISP device is registered to the MDS");
-          m_registered = true;
-        }
-        else
-        {
-          NS_LOG_DEBUG("LISP device is NOT registered to the MDS");
-          m_registered = false;
-        }
+        NS_LOG_DEBUG("MAP ENTRY is negative!");
+        mapEntry->setIsNegative(1);
       }
-      else if (sockMsgHdr.GetMapType() == static_cast<uint16_t>(LispMappingSocket::MAPM_DATABASE_UPDATE))
+      else
       {
-        /**
-         * TODO: Notify to xTR to send a new Map-Register message.
-         * In this case, first check whether the received EID is in the database.
-         * If yes => update the map entry
-         * If no => add the map entry.
-         * Maybe we can use another solution:
-         * 1) if DHCP client detect link state change
-         * (e.g. during mobility, the wifi link is temporarily lost), DHCP has no
-         * IP address (RLOC). Trigger a MAPM_DELETE message to flush LISP-MN database
-         * 10-07-2017: The answer is no. Since flush LISP-MN database cannot update map version number!
-         * (how to treat Cache?=> Never touch Cache! Since it is the only place we
-         * know to which it communicate!! if cache is not flushed. It is OK if we have
-         * cache but no database? or database is empty?)
-         */
-        NS_LOG_DEBUG(
-            "Update or Add one mapping (" << msg->GetEndPointId()->Print() << ") \n"
-                                          << msg->GetLocators()->Print());
-        Ptr<EndpointId> eid = msg->GetEndPointId();
-        Ptr<MapEntry> mapEntry = Create<MapEntryImpl>();
-        Ptr<Locators> locators = msg->GetLocators();
-        mapEntry->SetEidPrefix(eid);
-        /* MAPM_DATABASE_UPDATE is only sent dy DHCP client when receiving a new LRLOC.
-         *
-         * We need an additional MapEntry in database for encapsulation (in case of NAT).
-         * This additional MapEntry is equivalent to the config file where we add:
-         * <if-address-v4>  192.168.1.1 </if-address-v4>
-         * <entry>
-         * <eid-v4>  192.168.1.0 255.255.255.0 0 </eid-v4>
-         * <rloc-v4> 192.168.1.1 200 30  1 </rloc-v4>
-         * </entry>
-         */
-        Ptr<MapEntry> mapEntryEncap = Create<MapEntryImpl>();
+        mapEntry->setIsNegative(0);
+        mapEntry->SetLocators(locators);
 
-        if ((int)sockMsgHdr.GetMapFlags() & (int)LispMappingSocket::MAPF_NEGATIVE)
-        {
-          NS_LOG_DEBUG("MAP ENTRY is negative!");
-          mapEntry->setIsNegative(1);
-        }
-        else
-        {
-          mapEntry->setIsNegative(0);
-          mapEntry->SetLocators(locators);
+        mapEntryEncap->SetEidPrefix(
+            Create<EndpointId>(locators->GetLocatorByIdx(0)->GetRlocAddress(), Ipv4Mask("/32")));
+        mapEntryEncap->setIsNegative(0);
+        mapEntryEncap->SetLocators(locators);
+      }
+      /* Get current (MN EID -> LRLOC) mapping */
+      Ptr<MapEntry> curEidMapEntry = LispOverIp::DatabaseLookup(eid->GetEidAddress());
+      if (curEidMapEntry != 0)
+      {
+        Address curRlocAddr = curEidMapEntry->GetLocators()->GetLocatorByIdx(0)->GetRlocAddress();
+        /* Erase previous (LRLOC -> LRLOC) mapping */
+        LispOverIp::DatabaseDelete(curRlocAddr);
+      }
 
-          mapEntryEncap->SetEidPrefix(
-              Create<EndpointId>(locators->GetLocatorByIdx(0)->GetRlocAddress(), Ipv4Mask("/32")));
-          mapEntryEncap->setIsNegative(0);
-          mapEntryEncap->SetLocators(locators);
-        }
-        /* Get current (MN EID -> LRLOC) mapping */
-        Ptr<MapEntry> curEidMapEntry = LispOverIp::DatabaseLookup(eid->GetEidAddress());
-        if (curEidMapEntry != 0)
+      if (eid->IsIpv4())
+      {
+        // TODO: to verify if map data structure supports add (or update) manipulation.
+        //  This is important cause DHCP will periodically received offered @IP.
+        //  If two different RLOCs, how to treat it?
+        //  07-10-2017: DHCP client should guarantee that the newly assigned @IP is different from previous one
+        //  In the case of cache update, we should first delete the previous one containing EID-prefix
+        //  This work is done by SetEntry method!
+
+        /* Add new (MN EID -> LRLOC) mapping */
+        m_mapTablesIpv4->SetEntry(
+            eid->GetEidAddress(),
+            eid->GetIpv4Mask(),
+            mapEntry,
+            MapTables::IN_DATABASE);
+        /* Add new (LRLOC -> LRLOC) mapping */
+        m_mapTablesIpv4->SetEntry(
+            mapEntryEncap->GetEidPrefix()->GetEidAddress(),
+            mapEntryEncap->GetEidPrefix()->GetIpv4Mask(),
+            mapEntryEncap,
+            MapTables::IN_DATABASE);
+        NS_LOG_DEBUG(
+            "Ipv4 Map Entry IPv4 (Received from DHCP client) has been saved in database by LispOverIp");
+        NS_LOG_DEBUG("After message from DHCP to LISP, LISP Database now: \n"
+                     << *(LispOverIp::GetMapTablesV4()));
+      }
+      else
+      {
+        m_mapTablesIpv6->SetEntry(eid->GetEidAddress(),
+                                  eid->GetIpv6Prefix(), mapEntry,
+                                  MapTables::IN_DATABASE);
+        NS_LOG_DEBUG(
+            "Ipv4 Map Entry IPv6 (Received from DHCP client) has been saved in database by LispOverIp");
+      }
+      /**
+       * IMPORTANT: To support LISP-MN.
+       * 1) Send a signal (MAPM_REGISTER) to xTR application so that xTR send map register again
+       * 2) Delete the previously assigned RLOC IP address (by DHCP server) in m_rlocsList attribute
+       * of lispOverIpv4 object. This attribute is previously set by lispHelper class.
+       * 3) Add the newly obtained RLOC IP address into m_rlocsList
+       *
+       * TODO: Current implementation does not support empty message content.
+       * Otherwise error occurs. Should consider this!
+       */
+      Ptr<MappingSocketMsg> mapSockMsg = Create<MappingSocketMsg>();
+      MappingSocketMsgHeader mapSockHeader;
+      mapSockMsg->SetEndPoint(eid);
+      mapSockMsg->SetLocators(msg->GetLocators());
+      mapSockHeader.SetMapType(LispMappingSocket::MAPM_REGISTER);
+      uint8_t messageType = static_cast<uint8_t>(LispMappingSocket::MAPM_REGISTER);
+
+      // Normally the received EID-RLOC mapping contains just one RLOC.
+      // If more than one RLOCs, it is anormal!! First delete the RLOC in
+      // m_rlocsList then add the newly assigned RLOC into it.
+      NS_ASSERT(msg->GetLocators()->GetNLocators() == 1);
+
+      // Is necessary to delete the previously RLOC? What's the hurt?
+      // What if EID has two RLOCs assigned? which one to delete?
+      //	    Ptr<MapEntry> curEidMapEntry = LispOverIp::DatabaseLookup(eid->GetEidAddress());
+      //	    Address curRlocAddr = curEidMapEntry->GetLocators()->GetLocatorByIdx(0)->GetRlocAddress();
+      //	    m_rlocsList.erase(curRlocAddr);
+      Address rlocAddr = msg->GetLocators()->GetLocatorByIdx(0)->GetRlocAddress();
+      m_rlocsList.insert(rlocAddr);
+      for (std::set<Address>::const_iterator it = m_rlocsList.begin(); it != m_rlocsList.end(); ++it)
+      {
+        if (Ipv4Address::IsMatchingType(*it))
         {
-          Address curRlocAddr = curEidMapEntry->GetLocators()->GetLocatorByIdx(0)->GetRlocAddress();
-          /* Erase previous (LRLOC -> LRLOC) mapping */
-          LispOverIp::DatabaseDelete(curRlocAddr);
+          NS_LOG_DEBUG("RLOC list item: " << Ipv4Address::ConvertFrom(*it));
         }
-
-        if (eid->IsIpv4())
+        else if (Ipv6Address::IsMatchingType(*it))
         {
-          // TODO: to verify if map data structure supports add (or update) manipulation.
-          //  This is important cause DHCP will periodically received offered @IP.
-          //  If two different RLOCs, how to treat it?
-          //  07-10-2017: DHCP client should guarantee that the newly assigned @IP is different from previous one
-          //  In the case of cache update, we should first delete the previous one containing EID-prefix
-          //  This work is done by SetEntry method!
-
-          /* Add new (MN EID -> LRLOC) mapping */
-          m_mapTablesIpv4->SetEntry(
-              eid->GetEidAddress(),
-              eid->GetIpv4Mask(),
-              mapEntry,
-              MapTables::IN_DATABASE);
-          /* Add new (LRLOC -> LRLOC) mapping */
-          m_mapTablesIpv4->SetEntry(
-              mapEntryEncap->GetEidPrefix()->GetEidAddress(),
-              mapEntryEncap->GetEidPrefix()->GetIpv4Mask(),
-              mapEntryEncap,
-              MapTables::IN_DATABASE);
-          NS_LOG_DEBUG(
-              "Ipv4 Map Entry IPv4 (Received from DHCP client) has been saved in database by LispOverIp");
-          NS_LOG_DEBUG("After message from DHCP to LISP, LISP Database now: \n"
-                       << *(LispOverIp::GetMapTablesV4()));
+          NS_LOG_DEBUG("RLOC list item: " << Ipv6Address::ConvertFrom(*it));
         }
         else
         {
-          m_mapTablesIpv6->SetEntry(eid->GetEidAddress(),
-                                    eid->GetIpv6Prefix(), mapEntry,
-                                    MapTables::IN_DATABASE);
-          NS_LOG_DEBUG(
-              "Ipv4 Map Entry IPv6 (Received from DHCP client) has been saved in database by LispOverIp");
-        }
-        /**
-         * IMPORTANT: To support LISP-MN.
-         * 1) Send a signal (MAPM_REGISTER) to xTR application so that xTR send map register again
-         * 2) Delete the previously assigned RLOC IP address (by DHCP server) in m_rlocsList attribute
-         * of lispOverIpv4 object. This attribute is previously set by lispHelper class.
-         * 3) Add the newly obtained RLOC IP address into m_rlocsList
-         *
-         * TODO: Current implementation does not support empty message content.
-         * Otherwise error occurs. Should consider this!
-         */
-        uint8_t buf[256];
-        Ptr<MappingSocketMsg> mapSockMsg = Create<MappingSocketMsg>();
-        MappingSocketMsgHeader mapSockHeader;
-        mapSockMsg->SetEndPoint(eid);
-        mapSockMsg->SetLocators(msg->GetLocators());
-        mapSockMsg->Serialize(buf);
-        mapSockHeader.SetMapType(LispMappingSocket::MAPM_REGISTER);
-        Ptr<Packet> packet = Create<Packet>(buf, 100);
-        uint8_t messageType = static_cast<uint8_t>(LispMappingSocket::MAPM_REGISTER);
-
-        // Normally the received EID-RLOC mapping contains just one RLOC.
-        // If more than one RLOCs, it is anormal!! First delete the RLOC in
-        // m_rlocsList then add the newly assigned RLOC into it.
-        NS_ASSERT(msg->GetLocators()->GetNLocators() == 1);
-
-        // Is necessary to delete the previously RLOC? What's the hurt?
-        // What if EID has two RLOCs assigned? which one to delete?
-        //	    Ptr<MapEntry> curEidMapEntry = LispOverIp::DatabaseLookup(eid->GetEidAddress());
-        //	    Address curRlocAddr = curEidMapEntry->GetLocators()->GetLocatorByIdx(0)->GetRlocAddress();
-        //	    m_rlocsList.erase(curRlocAddr);
-        Address rlocAddr = msg->GetLocators()->GetLocatorByIdx(0)->GetRlocAddress();
-        m_rlocsList.insert(rlocAddr);
-        for (std::set<Address>::const_iterator it = m_rlocsList.begin(); it != m_rlocsList.end(); ++it)
-        {
-          if (Ipv4Address::IsMatchingType(*it))
-          {
-            NS_LOG_DEBUG("RLOC list item: " << Ipv4Address::ConvertFrom(*it));
-          }
-          else if (Ipv6Address::IsMatchingType(*it))
-          {
-            NS_LOG_DEBUG("RLOC list item: " << Ipv6Address::ConvertFrom(*it));
-          }
-          else
-          {
-            NS_LOG_ERROR("Unknown Address Type...");
-          }
+          NS_LOG_ERROR("Unknown Address Type...");
         }
-
-        // First populate m_rlocList then send map register message. Otherwise
-        // Lisp data plan will try to find a RLOC for the real RLOC...
-        NS_LOG_DEBUG("Notify xTR to send map register message.");
-        LispOverIp::SendNotifyMessage(messageType, packet, mapSockHeader, 0);
       }
+
+      // First populate m_rlocList then send map register message. Otherwise
+      // Lisp data plan will try to find a RLOC for the real RLOC...
+      NS_LOG_DEBUG("Notify xTR to send map register message.");
+      LispOverIp::SendNotifyMessage(messageType, mapSockMsg, mapSockHeader, 0);
     }
   }
 
@@ -661,7 +753,7 @@ namespace ns3
   }
 
   void
-  LispOverIp::SendNotifyMessage(uint8_t messageType, Ptr<Packet> packet,
+  LispOverIp::SendNotifyMessage(uint8_t messageType, Ptr<MappingSocketMsg> msg,
                                 MappingSocketMsgHeader mapSockMsgHeader,
                                 int flags)
   {
@@ -685,7 +777,7 @@ namespace ns3
       break;
     }
     mapSockMsgHeader.SetMapFlags(flags | LispMappingSocket::MAPF_DONE);
-    packet->AddHeader(mapSockMsgHeader);
+    Ptr<LispMappingSocket> mappingSocket = DynamicCast<LispMappingSocket>(m_lispSocket);
     NS_LOG_DEBUG("Send Messages from data plan to control plan: " << m_sockets.size() - 1 << " sockets.");
     for (uint32_t i = 1; i < m_sockets.size(); ++i)
     {
@@ -695,10 +787,9 @@ namespace ns3
       // Lionel initially use Socket's Send method, which always send packet
       // to m_lispSocket with index 1. Now this bug is fixed to support
       // communication between LispOverIp and DHCP server (surely DHCP client)
-      m_lispSocket->SendTo(packet, flags, ad);
+      mappingSocket->SendMsgTo(mapSockMsgHeader, msg, ad);
       NS_LOG_DEBUG(
           "Send Notification: " << MappingSocketAddress::ConvertFrom(m_lispAddress) << "-->" << MappingSocketAddress::ConvertFrom(ad));
-      NS_LOG_DEBUG("Sent Notification content is: " << *packet);
     }
   }
 
@@ -923,7 +1014,70 @@ namespace ns3
 
   uint16_t LispOverIp::GetLispSrcPort(Ptr<const Packet> packet)
   {
-    return LISP_DATA_PORT;
+    /*
+     * RFC 6830, section 5.3: the UDP source port is a hash of the inner
+     * header, so that the ECMP of the core spreads the flows between two
+     * RLOCs. The port is taken in the dynamic range 49152-65535.
+     */
+    uint8_t version = 0;
+    if (packet->CopyData(&version, 1) != 1)
+    {
+      return LISP_DATA_PORT;
+    }
+    uint32_t hash = 0x4c495350; // differs from GetFlowHash () seed
+    if ((version >> 4) == 4)
+    {
+      Ipv4Header innerHeader;
+      packet->PeekHeader(innerHeader);
+      hash = FlowHash::HashIpv4(hash, packet, innerHeader.GetSerializedSize(), innerHeader);
+    }
+    else if ((version >> 4) == 6)
+    {
+      Ipv6Header innerHeader;
+      packet->PeekHeader(innerHeader);
+      uint8_t addresses[32];
+      innerHeader.GetSourceAddress().GetBytes(addresses);
+      innerHeader.GetDestinationAddress().GetBytes(addresses + 16);
+      for (uint32_t i = 0; i < 32; i += 4)
+      {
+        hash = FlowHash::Mix(hash, (addresses[i] << 24) | (addresses[i + 1] << 16) | (addresses[i + 2] << 8) | addresses[i + 3]);
+      }
+      // Extension headers (fragments included) are not parsed: ports are
+      // only read right after the fixed header.
+      hash = FlowHash::Mix(hash, innerHeader.GetNextHeader());
+      hash = FlowHash::Mix(hash, FlowHash::ReadPorts(packet, innerHeader.GetSerializedSize(),
+                                                     innerHeader.GetNextHeader(), false));
+      hash = FlowHash::Mix(hash, innerHeader.GetFlowLabel());
+    }
+    else
+    {
+      return LISP_DATA_PORT;
+    }
+    return 0xc000 | (hash >> 18);
+  }
+
+  uint32_t LispOverIp::GetFlowHash(Ptr<const Packet> payload, Ipv4Header const &innerHeader)
+  {
+    return FlowHash::HashIpv4(0, payload, 0, innerHeader);
+  }
+
+  uint8_t LispOverIp::PeekControlMsgType(Ptr<const Packet> datagram, uint32_t offset)
+  {
+    // UDP header, ECM header and inner IPv4 and UDP headers at most
+    uint8_t buf[8 + 4 + 60 + 8 + 1];
+    NS_ASSERT(8 + offset < sizeof(buf));
+    if (datagram->GetSize() <= 8 + offset)
+    {
+      return 0;
+    }
+    datagram->CopyData(buf, 8 + offset + 1);
+    uint16_t srcPort = (buf[0] << 8) | buf[1];
+    uint16_t dstPort = (buf[2] << 8) | buf[3];
+    if (srcPort != LISP_SIG_PORT && dstPort != LISP_SIG_PORT)
+    {
+      return 0;
+    }
+    return buf[8 + offset] >> 4;
   }
 
   bool LispOverIp::IsMapVersionNumberNewer(uint16_t vnum2, uint16_t vnum1)
@@ -964,6 +1118,7 @@ namespace ns3
   LispOverIp::SetPitr(bool pitr)
   {
     m_pitr = pitr;
+    InvalidateSourceRlocs();
   }
 
   bool
@@ -988,6 +1143,20 @@ namespace ns3
   LispOverIp::SetRtr(bool rtr)
   {
     m_rtr = rtr;
+    InvalidateSourceRlocs();
+  }
+
+  void
+  LispOverIp::InvalidateSourceRlocs(void)
+  {
+    NS_LOG_FUNCTION(this);
+    m_sourceRlocEpoch++;
+  }
+
+  uint32_t
+  LispOverIp::GetSourceRlocEpoch(void) const
+  {
+    return m_sourceRlocEpoch;
   }
 
   bool
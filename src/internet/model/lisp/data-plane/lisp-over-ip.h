@@ -19,6 +19,7 @@
  */
 #ifndef LISP_OVER_IP_H_
 #define LISP_OVER_IP_H_
+#include "ns3/ipv4-header.h"
 #include "ns3/ipv4-route.h"
 #include "ns3/node.h"
 #include "ns3/packet.h"
@@ -33,6 +34,7 @@
 #include "ns3/object.h"
 #include "mapping-socket-address.h"
 #include "mapping-socket-msg.h"
+#include "miss-queue.h"
 #include "ns3/random-variable-stream.h"
 #include "ns3/pointer.h"
 #include "ns3/double.h"
@@ -48,14 +50,6 @@ class Node;
 class Socket;
 class LispMappingSocket;
 
-// ns3-privacy addition
-struct BufferedPacket{
-  Ptr<Packet> packet;
-  Ipv4Address source;
-  Ipv4Address destination;
-  uint8_t protocol;
-  Ptr<Ipv4Route> route;
-};
 /**
  * \class LispOverIp
  * \brief An abstract class for LISP data plane.
@@ -68,7 +62,6 @@ struct BufferedPacket{
 class LispOverIp : public Object
 {
 public:
-  std::list<BufferedPacket> m_bufferedPackets;
   static const uint8_t PROT_NUMBER; //!< protocol number (0x)
   static const uint16_t LISP_DATA_PORT; //!< LISP data operations port
   static const uint16_t LISP_SIG_PORT; //!< LISP control operations port
@@ -179,14 +172,41 @@ public:
 
   /**
    * The goal of this method is to select the source UDP port for the
-   * LISP packet.
+   * LISP packet: a hash of the inner IPv4 or IPv6 5-tuple, in the dynamic
+   * port range, so that ECMP routers spread the flows between two RLOCs.
    *
-   * \param packet The LISP packet
+   * \param packet The LISP packet, starting with the inner IP header
    *
    * \return the selected source UDP port.
    */
   static uint16_t GetLispSrcPort (Ptr<const Packet> packet);
 
+  /**
+   * \brief Hash the flow of a packet to be encapsulated.
+   *
+   * The hash covers the source and destination EIDs, the protocol and, for
+   * TCP and UDP, the ports. The ports are ignored for fragments, so that all
+   * the fragments of a packet have the same hash.
+   *
+   * \param payload The payload of the inner IP packet (without its header).
+   * \param innerHeader The inner IP header.
+   * \return The flow hash.
+   */
+  static uint32_t GetFlowHash (Ptr<const Packet> payload, Ipv4Header const &innerHeader);
+
+  /**
+   * \brief Get the type of the LISP control message carried by a UDP
+   * datagram, without copying the packet.
+   *
+   * Only the UDP header and the first byte of the message are read.
+   *
+   * \param datagram The UDP datagram, starting with its UDP header.
+   * \param offset Bytes between the UDP header and the LISP message.
+   * \return The type of the message (see LispControlMsg::LispControlMsgType),
+   * 0 if no UDP port is LISP_SIG_PORT or the datagram is too short.
+   */
+  static uint8_t PeekControlMsgType (Ptr<const Packet> datagram, uint32_t offset = 0);
+
   /**
    * This method determine if the Mapping version number 2 (vnum2)
    *  is greater (newer) than the Mapping version number 1 (vnum1). It
@@ -294,6 +314,15 @@ public:
    * \return A pointer to the selected RLOC.
    */
   Ptr<Locator> SelectDestinationRloc(Ptr<const MapEntry> mapEntry) const;
+  /**
+   * \brief Select the destination RLOC of a flow among the RLOCs of the
+   * best priority, according to their weight.
+   *
+   * \param mapEntry Entry that contains the set of RLOCs
+   * \param flowHash The hash of the flow (see GetFlowHash)
+   * \return A pointer to the selected RLOC, 0 if none is usable.
+   */
+  Ptr<Locator> SelectDestinationRloc(Ptr<const MapEntry> mapEntry, uint32_t flowHash) const;
   /**
    * \brief Select  the source RLOC according to the destination RLOC.
    *
@@ -366,7 +395,21 @@ public:
    * \param socket The socket on which the packet is received.
    */
   void HandleMapSockRead (Ptr<Socket> socket);
-  void SendNotifyMessage (uint8_t messageType, Ptr<Packet> packet, MappingSocketMsgHeader mapSockMsgHeader, int flags);
+
+  /**
+   * \brief Process a message received from the control plane, whether it
+   * was delivered as an object or serialized in a packet.
+   *
+   * \param sockMsgHdr The header of the message.
+   * \param msg The body of the message.
+   */
+  void HandleMapSockMsg (MappingSocketMsgHeader const &sockMsgHdr, Ptr<MappingSocketMsg> msg);
+
+  /**
+   * \brief Send a message to every application connected to the data plane
+   * (see LispMappingSocket::SendMsgTo).
+   */
+  void SendNotifyMessage (uint8_t messageType, Ptr<MappingSocketMsg> msg, MappingSocketMsgHeader mapSockMsgHeader, int flags);
 
   /**
    * \brief Set the List of the RLOC addresses of the system.
@@ -468,6 +511,24 @@ public:
    */
   bool IsRtr (void);
 
+  /**
+   * \brief Invalidate the source RLOCs selected so far.
+   *
+   * The source RLOC of an encapsulated packet is the address of the interface
+   * towards the destination RLOC, so the selections made by the MapTables
+   * must be forgotten whenever routes, interface addresses or interface
+   * states change. Ipv4L3Protocol calls this on interface and address events;
+   * call it after changing routes by hand (e.g. after
+   * Ipv4GlobalRoutingHelper::RecomputeRoutingTables ()).
+   */
+  void InvalidateSourceRlocs (void);
+
+  /**
+   * \brief Get the number of times the source RLOCs were invalidated.
+   * \return A counter that changes each time InvalidateSourceRlocs () is called.
+   */
+  uint32_t GetSourceRlocEpoch (void) const;
+
   /**
    * \brief Get the m_registered member.
    * \return True if the device is registered to the MDS.
@@ -488,14 +549,31 @@ protected:
   Ptr<RandomVariableStream> m_pxtrStretchVariable; //!< RV representing the relative delay stretch introduced by the use of proxies
   Ptr<RandomVariableStream> m_rtrVariable;
 
+  MissQueue m_missQueue; //!< Packets waiting for a Map-Reply (ns3-privacy addition)
+
+  virtual void DoDispose (void);
+
 private:
+  /**
+   * \brief Send again the packets waiting for the mapping of an EID-prefix
+   * that has just been added to the map-cache.
+   * \param eid The EID-prefix of the new map-cache entry.
+   */
+  void FlushMissQueue (Ptr<const EndpointId> eid);
+
+  void SetMissQueueMaxBytes (uint32_t maxBytes);
+  uint32_t GetMissQueueMaxBytes (void) const;
+  void SetMissQueueMaxEidBytes (uint32_t maxEidBytes);
+  uint32_t GetMissQueueMaxEidBytes (void) const;
+  void SetMissQueueMaxDelay (Time maxDelay);
+  Time GetMissQueueMaxDelay (void) const;
+
 
   /**
    * This function will notify other components connected to the node that a new stack member is now connected
    * This will be used to notify Layer 3 protocol of layer 4 protocol stack to connect them together.
    */
   virtual void NotifyNewAggregate ();
-  virtual void DoDispose (void);
   std::vector<Ptr<LispMappingSocket> > m_sockets;       //!< list of mapping sockets
   Ptr<Socket> m_lispSocket; //!< the socket owned by the data plane.
   Address m_lispAddress; //!< the "address" of the data plane (to connect to the socket)
@@ -510,6 +588,8 @@ private:
 
   bool m_registered; //!< True after the LISP device receives a MapNotify. Used to not send LISP encapsulated packets before registration is complete
 
+  uint32_t m_sourceRlocEpoch; //!< Incremented when the selected source RLOCs become stale
+
   };
 
 } /* namespace ns3 */
@@ -121,7 +121,7 @@ namespace ns3
     }
     else
     {
-      destLocator = SelectDestinationRloc(remoteMapping);
+      destLocator = SelectDestinationRloc(remoteMapping, GetFlowHash(packet, innerHeader));
       NS_LOG_DEBUG("Destination RLOC address: " << Ipv4Address::ConvertFrom(destLocator->GetRlocAddress()));
     }
 
@@ -247,7 +247,8 @@ namespace ns3
       else
       {
         // compute src port based on inner header(Follow algo get_lisp_srcport)
-        udpSrcPort = LispOverIp::GetLispSrcPort(packet);
+        // A NATed xTR keeps the port of the NAT state set up by its Map-Register
+        udpSrcPort = IsNated() ? LispOverIp::LISP_DATA_PORT : LispOverIp::GetLispSrcPort(packet);
         udpDstPort = LispOverIp::LISP_DATA_PORT;
       }
 
@@ -353,9 +354,12 @@ namespace ns3
       packet->RemoveHeader(ecmHeader);
     NS_LOG_LOGIC("Lisp header removed: " << lispHeader);
 
-    packet->EnableChecking();
-    PacketMetadata::Item item;
-    PacketMetadata::ItemIterator metadataIterator = packet->BeginItem();
+    // The inner header follows the LISP header: its version gives its
+    // address family, which does not need the packet metadata (disabled in
+    // the headless runs).
+    uint8_t version = 0;
+    packet->CopyData(&version, 1);
+    version >>= 4;
 
     /*
      * We know that the first header is an ip header
@@ -366,95 +370,91 @@ namespace ns3
      * of maq request. Lionel's implementation has not considered that the inner header
      * is a lisp data plan message?
      */
-    while (metadataIterator.HasNext())
+    if (version == 4)
     {
-      item = metadataIterator.Next();
-      if (!(item.tid.GetName().compare(Ipv4Header::GetTypeId().GetName())))
-      {
-        NS_LOG_DEBUG("Before checking metadata");
+      NS_LOG_DEBUG("Before checking metadata");
 
-        if (GetPetr() || IsRtr()) // PETR or RTR case -> No need to check (decapsulate everything)
-          isMappingForPacket = true;
-        else
-        {
-          NS_LOG_DEBUG("Classic xTR");
-          isMappingForPacket = LispOverIp::m_mapTablesIpv4->IsMapForReceivedPacket(
-              packet,
-              lispHeader,
-              static_cast<Address>(outerHeader.GetSource()),
-              static_cast<Address>(outerHeader.GetDestination()));
-        }
+      if (GetPetr() || IsRtr()) // PETR or RTR case -> No need to check (decapsulate everything)
+        isMappingForPacket = true;
+      else
+      {
+        NS_LOG_DEBUG("Classic xTR");
+        isMappingForPacket = LispOverIp::m_mapTablesIpv4->IsMapForReceivedPacket(
+            packet,
+            lispHeader,
+            static_cast<Address>(outerHeader.GetSource()),
+            static_cast<Address>(outerHeader.GetDestination()));
+      }
 
-        NS_LOG_DEBUG("Check passed");
-        bool isControlPlanMsg = false;
-        // if inner UDP of innerIpv4header is at port 4342. we should
-        // use ipv4->Receive() to send this packet to itself.
-        // that's why whether isMappingForPacket is true, we also retrieve @ip and port
-        Ptr<Node> node = GetNode();
-        packet->RemoveHeader(innerIpv4Header);
+      NS_LOG_DEBUG("Check passed");
+      bool isControlPlanMsg = false;
+      // if inner UDP of innerIpv4header is at port 4342. we should
+      // use ipv4->Receive() to send this packet to itself.
+      // that's why whether isMappingForPacket is true, we also retrieve @ip and port
+      Ptr<Node> node = GetNode();
+      packet->RemoveHeader(innerIpv4Header);
 
-        if (innerIpv4Header.GetProtocol() == UdpL4Protocol::PROT_NUMBER)
+      if (innerIpv4Header.GetProtocol() == UdpL4Protocol::PROT_NUMBER)
+      {
+        NS_LOG_DEBUG("Next Header of Inner IP is still UDP, let's see the port");
+        packet->RemoveHeader(udpHeader);
+        if (udpHeader.GetDestinationPort() == LispOverIp::LISP_SIG_PORT)
         {
-          NS_LOG_DEBUG("Next Header of Inner IP is still UDP, let's see the port");
-          packet->RemoveHeader(udpHeader);
-          if (udpHeader.GetDestinationPort() == LispOverIp::LISP_SIG_PORT)
-          {
-            NS_LOG_DEBUG("UDP on port:" << unsigned(udpHeader.GetDestinationPort()) << "->LISP Control Plan Message!");
-            isControlPlanMsg = true;
-          }
-          // Add UDP&IP header to the packet
-          packet->AddHeader(udpHeader);
+          NS_LOG_DEBUG("UDP on port:" << unsigned(udpHeader.GetDestinationPort()) << "->LISP Control Plan Message!");
+          isControlPlanMsg = true;
         }
-        innerIpv4Header.SetTtl(outerHeader.GetTtl());
-        Address from = static_cast<Address>(innerIpv4Header.GetSource());
-        Address to = static_cast<Address>(innerIpv4Header.GetDestination());
-        innerIpv4Header.EnableChecksum();
+        // Add UDP&IP header to the packet
+        packet->AddHeader(udpHeader);
+      }
+      innerIpv4Header.SetTtl(outerHeader.GetTtl());
+      Address from = static_cast<Address>(innerIpv4Header.GetSource());
+      Address to = static_cast<Address>(innerIpv4Header.GetDestination());
+      innerIpv4Header.EnableChecksum();
 
-        packet->AddHeader(innerIpv4Header);
+      packet->AddHeader(innerIpv4Header);
 
-        // Either find mapping for inner ip header or find the inner message is control message
-        // use ip receive procedure to forward packet
-        if (isMappingForPacket or isControlPlanMsg)
-        {
-          Ptr<Ipv4L3Protocol> ipv4 = (node->GetObject<Ipv4L3Protocol>());
-          // put it back in ip Receive ()
-          // Attention: it's the method LispOverIpv4::RecordReceiveParams that
-          // retrieve m_currentDevice values!!! This method is called in
-          // Ipv4L3Protocol::Received() method!
-          ipv4->Receive(m_currentDevice, packet, m_ipProtocol, from, to, m_currentPacketType);
-          NS_LOG_DEBUG("Re-inject the packet in receive to forward it to: " << innerIpv4Header.GetDestination());
-        }
-        else
-        {
-          // TODO drop and log
-          NS_LOG_ERROR("Mapping check failed during local deliver! Attention if this is cause by double encapsulation!");
-        }
-        return;
+      // Either find mapping for inner ip header or find the inner message is control message
+      // use ip receive procedure to forward packet
+      if (isMappingForPacket or isControlPlanMsg)
+      {
+        Ptr<Ipv4L3Protocol> ipv4 = (node->GetObject<Ipv4L3Protocol>());
+        // put it back in ip Receive ()
+        // Attention: it's the method LispOverIpv4::RecordReceiveParams that
+        // retrieve m_currentDevice values!!! This method is called in
+        // Ipv4L3Protocol::Received() method!
+        ipv4->Receive(m_currentDevice, packet, m_ipProtocol, from, to, m_currentPacketType);
+        NS_LOG_DEBUG("Re-inject the packet in receive to forward it to: " << innerIpv4Header.GetDestination());
       }
-      // if inner header is ipv6
-      else if (!(item.tid.GetName().compare(Ipv6Header::GetTypeId().GetName())))
+      else
       {
-        m_statisticsForIpv6->IncInputDifAfPackets();
-        isMappingForPacket = LispOverIp::m_mapTablesIpv6->IsMapForReceivedPacket(packet, lispHeader, static_cast<Address>(outerHeader.GetSource()), static_cast<Address>(outerHeader.GetDestination()));
-        if (isMappingForPacket)
-        {
-          // remove inner ipheader
-          // TODO do the same for Ipv6
-        }
-        else
-        {
-          // TODO drop and log
-        }
-        return;
+        // TODO drop and log
+        NS_LOG_ERROR("Mapping check failed during local deliver! Attention if this is cause by double encapsulation!");
+      }
+      return;
+    }
+    // if inner header is ipv6
+    else if (version == 6)
+    {
+      m_statisticsForIpv6->IncInputDifAfPackets();
+      isMappingForPacket = LispOverIp::m_mapTablesIpv6->IsMapForReceivedPacket(packet, lispHeader, static_cast<Address>(outerHeader.GetSource()), static_cast<Address>(outerHeader.GetDestination()));
+      if (isMappingForPacket)
+      {
+        // remove inner ipheader
+        // TODO do the same for Ipv6
       }
       else
       {
-        // should not happen -- report error
-        NS_LOG_ERROR("[LISP_INPUT] Drop! Unrecognized inner AF");
-
-        m_statisticsForIpv4->IncBadSizePackets();
-        return;
+        // TODO drop and log
       }
+      return;
+    }
+    else
+    {
+      // should not happen -- report error
+      NS_LOG_ERROR("[LISP_INPUT] Drop! Unrecognized inner AF");
+
+      m_statisticsForIpv4->IncBadSizePackets();
+      return;
     }
   }
   // ns3-privacy addition
@@ -464,13 +464,19 @@ namespace ns3
                                       uint8_t protocol,
                                       Ptr<Ipv4Route> route)
   {
-    m_bufferedPackets.push_back({
-        packet,
-        source,
-        destination,
-        protocol,
-        route,
-    });
+    NS_LOG_FUNCTION(this << destination);
+    BufferedPacket buffered;
+    buffered.packet = packet;
+    buffered.source = source;
+    buffered.destination = destination;
+    buffered.protocol = protocol;
+    buffered.route = route;
+    if (!m_missQueue.Enqueue(buffered))
+    {
+      m_statisticsForIpv4->IncNoEnoughSpace();
+      m_statisticsForIpv4->IncOutputDropPackets();
+      NS_LOG_WARN("No space left to buffer the packet to " << destination << ". Drop");
+    }
   }
   LispOverIpv4::MapStatus LispOverIpv4Impl::IsMapForEncapsulation(Ipv4Header const &innerHeader, Ptr<MapEntry> &srcMapEntry, Ptr<MapEntry> &destMapEntry, Ipv4Mask mask)
   {
@@ -543,11 +549,8 @@ namespace ns3
       mapSockMsg->SetEIDSource(innerHeader.GetSource());
 
       NS_LOG_DEBUG("[MapForEncap] EID not found " << innerHeader.GetDestination());
-      uint8_t buf[64];
-      mapSockMsg->Serialize(buf);
-      Ptr<Packet> packet = Create<Packet>(buf, 100);
       NS_LOG_DEBUG("Send Notification to all LISP apps");
-      SendNotifyMessage(static_cast<uint8_t>(LispMappingSocket::MAPM_MISS), packet, sockMsgHdr, 0);
+      SendNotifyMessage(static_cast<uint8_t>(LispMappingSocket::MAPM_MISS), mapSockMsg, sockMsgHdr, 0);
       return LispOverIpv4::No_Mapping;
     }
     else if (destMapEntry->IsNegative())
@@ -609,7 +612,6 @@ namespace ns3
     NS_LOG_FUNCTION(this << " outer header: " << ipHeader);
     NS_ASSERT(packet != 0);
 
-    Ptr<Packet> p = packet->Copy();
     UdpHeader udpHeader;
     LispHeader lispHeader;
     // Exclude too small packets (malformed)
@@ -622,12 +624,15 @@ namespace ns3
     if (ipHeader.GetProtocol() == UdpL4Protocol::PROT_NUMBER)
     {
       NS_LOG_DEBUG("Protocol beneath IP is really UDP");
-      p->RemoveHeader(udpHeader);
+      /* Only the ports of the UDP header are needed */
+      uint8_t ports[4];
+      packet->CopyData(ports, sizeof(ports));
+      uint16_t dstPort = (ports[2] << 8) | ports[3];
 
-      /* Accept all DATA packets (packets with UDP dest 4342) */
+      /* Accept all DATA packets (packets with UDP dest 4341) */
       if (lispPort == LispOverIp::LISP_DATA_PORT)
       {
-        if (udpHeader.GetDestinationPort() == lispPort) // LispOverIp::LISP_DATA_PORT or LispOverIp::LISP_SIG_PORT
+        if (dstPort == lispPort) // LispOverIp::LISP_DATA_PORT or LispOverIp::LISP_SIG_PORT
         {
           NS_LOG_DEBUG("Data packet => Needs decapsulation");
           return true;
@@ -637,10 +642,9 @@ namespace ns3
          Control packets that are not ECM encapsulated musn't be decapsulated, obviously */
       else
       {
-        uint8_t buf[p->GetSize()];
-        p->CopyData(buf, p->GetSize());
-        uint8_t msg_type = (buf[0] >> 4);
-        if (msg_type == static_cast<uint8_t>(LispEncapsulatedControlMsgHeader::GetMsgType()))
+        uint8_t msg_type = LispOverIp::PeekControlMsgType(packet);
+        if (dstPort == LispOverIp::LISP_SIG_PORT
+            && msg_type == static_cast<uint8_t>(LispEncapsulatedControlMsgHeader::GetMsgType()))
         {
           NS_LOG_DEBUG("ECM encapsulated Control packet => Needs decapsulation");
           return true;
@@ -658,19 +662,12 @@ namespace ns3
   bool
   LispOverIpv4Impl::IsMapNotifyForNatedXtr(Ptr<Packet> packet, Ipv4Header const &ipHeader, Ptr<MapEntry> &mapEntry)
   {
-
-    UdpHeader udpHeader;
-    packet->RemoveHeader(udpHeader);
-
-    uint8_t buf[packet->GetSize()];
-    packet->CopyData(buf, packet->GetSize());
-    uint8_t msg_type = buf[0] >> 4;
-
-    packet->AddHeader(udpHeader);
-
-    if (msg_type == static_cast<uint8_t>(LispControlMsg::MAP_NOTIFY))
+    /* Only the message type is read unless this is a MapNotify */
+    if (LispOverIp::PeekControlMsgType(packet) == static_cast<uint8_t>(LispControlMsg::MAP_NOTIFY))
     {
-      Ptr<MapNotifyMsg> mapNotify = MapNotifyMsg::Deserialize(buf);
+      uint8_t buf[packet->GetSize()];
+      packet->CopyData(buf, packet->GetSize());
+      Ptr<MapNotifyMsg> mapNotify = MapNotifyMsg::Deserialize(buf + UdpHeader().GetSerializedSize());
 
       Address eid = mapNotify->GetRecord()->GetEidPrefix();
       NS_LOG_DEBUG("MapNotify for EID: " << eid);
@@ -694,18 +691,12 @@ namespace ns3
   bool
   LispOverIpv4Impl::IsMapRequestForNatedXtr(Ptr<Packet> packet, Ipv4Header const &ipHeader, Ptr<MapEntry> &mapEntry)
   {
-    UdpHeader udpHeader;
-    packet->RemoveHeader(udpHeader);
-
-    uint8_t buf[packet->GetSize()];
-    packet->CopyData(buf, packet->GetSize());
-    uint8_t msg_type = buf[0] >> 4;
-
-    packet->AddHeader(udpHeader);
-
-    if (msg_type == static_cast<uint8_t>(LispControlMsg::MAP_REQUEST))
+    /* Only the message type is read unless this is a MapRequest */
+    if (LispOverIp::PeekControlMsgType(packet) == static_cast<uint8_t>(LispControlMsg::MAP_REQUEST))
     {
-      Ptr<MapRequestMsg> mapRequest = MapRequestMsg::Deserialize(buf);
+      uint8_t buf[packet->GetSize()];
+      packet->CopyData(buf, packet->GetSize());
+      Ptr<MapRequestMsg> mapRequest = MapRequestMsg::Deserialize(buf + UdpHeader().GetSerializedSize());
 
       if (mapRequest->GetS() == 1) // SMR or SMR-invoqued MapRequest
         return false;
@@ -760,36 +751,28 @@ namespace ns3
 
     msg->SetItrRlocAddrIp(address);
 
-    /*uint8_t BUF_SIZE = 16 + msg->GetAuthDataLen() + 16
-          + 12 * msg->GetRecord()->GetLocatorCount();*/
-    uint8_t *newbuf = new uint8_t[64];
-    msg->Serialize(newbuf);
-    Ptr<Packet> p = Create<Packet>(newbuf, 64);
-    packet = p;
+    packet = msg->ToPacket();
 
     /* Add back UDP header */
     packet->AddHeader(udpHeader);
   }
 
   bool
-  LispOverIpv4Impl::IsMapRegister(Ptr<Packet> packet)
+  LispOverIpv4Impl::IsMapRegister(Ptr<const Packet> packet)
   {
-    /* Remove UDP header */
-    UdpHeader udpHeader;
-    packet->RemoveHeader(udpHeader);
-    /* Remove ECM header */
-    LispEncapsulatedControlMsgHeader ecmHeader;
-    packet->RemoveHeader(ecmHeader);
-    /* Remove Inner IpHeader */
-    Ipv4Header innerHeader;
-    packet->RemoveHeader(innerHeader);
-    /* Remove inner UDP header */
-    UdpHeader innerUdpHeader;
-    packet->RemoveHeader(innerUdpHeader);
-    /* We arrive at LISP msg */
-    uint8_t buf[packet->GetSize()];
-    packet->CopyData(buf, packet->GetSize());
-    uint8_t msg_type = (buf[0] >> 4);
+    /* UDP header, then ECM header */
+    uint32_t ecmOffset = UdpHeader().GetSerializedSize();
+    uint32_t innerOffset = LispEncapsulatedControlMsgHeader().GetSerializedSize();
+    if (LispOverIp::PeekControlMsgType(packet) != static_cast<uint8_t>(LispEncapsulatedControlMsgHeader::GetMsgType())
+        || packet->GetSize() <= ecmOffset + innerOffset)
+    {
+      return false;
+    }
+    /* Skip the inner IpHeader (IHL in 32-bit words) and peek after the inner UDP header */
+    uint8_t buf[ecmOffset + innerOffset + 1];
+    packet->CopyData(buf, sizeof(buf));
+    uint32_t innerIpSize = (buf[ecmOffset + innerOffset] & 0x0f) * 4;
+    uint8_t msg_type = LispOverIp::PeekControlMsgType(packet, innerOffset + innerIpSize + UdpHeader().GetSerializedSize());
 
     return msg_type == static_cast<uint8_t>(MapRegisterMsg::GetMsgType());
   }
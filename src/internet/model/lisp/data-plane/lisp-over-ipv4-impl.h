@@ -86,7 +86,7 @@ public:
   /**
    * Checks whether inner msg is a MapRegister
    */
-  bool IsMapRegister (Ptr<Packet> packet);
+  bool IsMapRegister (Ptr<const Packet> packet);
 
   /**
    * Method for use only by RTRs.
@@ -116,7 +116,8 @@ public:
    * \brief Buffer packet waiting on a map reply.
    *
    * Instead of discarding a packket that triggered a map request, buffer it and
-   * send it when the amp reply arrives.
+   * send it when the amp reply arrives. The packet is dropped if the miss
+   * queue is full (see the MissQueue* attributes of LispOverIp).
    * \param packet
    */
   virtual void BufferPacket(Ptr<Packet> packet,
@@ -157,7 +158,7 @@ public:
 
   virtual void SetNatedEntry (Ptr<Packet> packet, Ipv4Header const &outerHeader) = 0;
 
-  virtual bool IsMapRegister (Ptr<Packet> packet) = 0;
+  virtual bool IsMapRegister (Ptr<const Packet> packet) = 0;
 
   virtual void ChangeItrRloc (Ptr<Packet> &packet, Address address) = 0;
   /**
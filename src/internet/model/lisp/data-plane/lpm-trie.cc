@@ -0,0 +1,507 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/lpm-trie.h"
+
+#include <cstring>
+
+#include "ns3/assert.h"
+
+namespace ns3 {
+
+/* ---------------------------------------------------------------------- */
+/*                              Ipv4LpmTrie                               */
+/* ---------------------------------------------------------------------- */
+
+const uint32_t Ipv4LpmTrie::NO_VALUE = 0xffffffff;
+
+Ipv4LpmTrie::Ipv4LpmTrie ()
+{
+  Clear ();
+}
+
+uint32_t
+Ipv4LpmTrie::MaskOf (uint8_t len)
+{
+  return len == 0 ? 0 : (0xffffffff << (32 - len));
+}
+
+uint64_t
+Ipv4LpmTrie::KeyOf (uint32_t prefix, uint8_t len)
+{
+  return (static_cast<uint64_t> (prefix & MaskOf (len)) << 8) | len;
+}
+
+uint8_t
+Ipv4LpmTrie::LevelOf (uint8_t len)
+{
+  // /1../8 live in level 0, /9../16 in level 1, ... /0 is expanded in level 0
+  return len == 0 ? 0 : (len - 1) / 8;
+}
+
+uint32_t
+Ipv4LpmTrie::NewNode (void)
+{
+  uint32_t index;
+  if (!m_freeNodes.empty ())
+    {
+      index = m_freeNodes.back ();
+      m_freeNodes.pop_back ();
+    }
+  else
+    {
+      index = m_nodes.size ();
+      m_nodes.push_back (Node ());
+    }
+  Slot *slots = m_nodes[index].slots;
+  for (uint32_t i = 0; i < 256; i++)
+    {
+      slots[i].value = NO_VALUE;
+      slots[i].child = 0;
+      slots[i].len = 0;
+    }
+  return index;
+}
+
+bool
+Ipv4LpmTrie::IsEmpty (uint32_t node) const
+{
+  const Slot *slots = m_nodes[node].slots;
+  for (uint32_t i = 0; i < 256; i++)
+    {
+      if (slots[i].value != NO_VALUE || slots[i].child != 0)
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+void
+Ipv4LpmTrie::Clear (void)
+{
+  m_nodes.clear ();
+  m_freeNodes.clear ();
+  m_prefixes.clear ();
+  NewNode (); // the root, always at index 0
+}
+
+uint32_t
+Ipv4LpmTrie::GetNPrefixes (void) const
+{
+  return m_prefixes.size ();
+}
+
+uint32_t
+Ipv4LpmTrie::GetNNodes (void) const
+{
+  return m_nodes.size () - m_freeNodes.size ();
+}
+
+void
+Ipv4LpmTrie::Insert (uint32_t prefix, uint8_t len, uint32_t value)
+{
+  NS_ASSERT (len <= 32);
+  NS_ASSERT (value != NO_VALUE);
+  prefix &= MaskOf (len);
+  m_prefixes[KeyOf (prefix, len)] = value;
+
+  uint8_t level = LevelOf (len);
+  uint32_t node = 0;
+  for (uint8_t l = 0; l < level; l++)
+    {
+      uint8_t byte = (prefix >> (24 - 8 * l)) & 0xff;
+      uint32_t child = m_nodes[node].slots[byte].child;
+      if (child == 0)
+        {
+          // NewNode () may reallocate m_nodes: do not keep references.
+          child = NewNode ();
+          m_nodes[node].slots[byte].child = child;
+        }
+      node = child;
+    }
+
+  uint8_t first = (prefix >> (24 - 8 * level)) & 0xff;
+  uint32_t count = 1 << (8 * (level + 1) - len);
+  Slot *slots = m_nodes[node].slots;
+  for (uint32_t i = first; i < first + count; i++)
+    {
+      if (slots[i].value == NO_VALUE || slots[i].len <= len)
+        {
+          slots[i].value = value;
+          slots[i].len = len;
+        }
+    }
+}
+
+uint32_t
+Ipv4LpmTrie::Remove (uint32_t prefix, uint8_t len)
+{
+  NS_ASSERT (len <= 32);
+  prefix &= MaskOf (len);
+  std::map<uint64_t, uint32_t>::iterator it = m_prefixes.find (KeyOf (prefix, len));
+  if (it == m_prefixes.end ())
+    {
+      return NO_VALUE;
+    }
+  uint32_t value = it->second;
+  m_prefixes.erase (it);
+
+  uint8_t level = LevelOf (len);
+  uint32_t path[4];
+  uint8_t bytes[4];
+  uint32_t node = 0;
+  for (uint8_t l = 0; l < level; l++)
+    {
+      path[l] = node;
+      bytes[l] = (prefix >> (24 - 8 * l)) & 0xff;
+      node = m_nodes[node].slots[bytes[l]].child;
+      NS_ASSERT (node != 0);
+    }
+
+  // Every slot that was expanded from this prefix falls back to the next
+  // longest prefix of the same level covering it, if any.
+  uint8_t lowest = level == 0 ? 0 : 8 * level + 1;
+  uint8_t first = (prefix >> (24 - 8 * level)) & 0xff;
+  uint32_t count = 1 << (8 * (level + 1) - len);
+  for (uint32_t i = first; i < first + count; i++)
+    {
+      Slot &slot = m_nodes[node].slots[i];
+      if (slot.value == NO_VALUE || slot.len != len)
+        {
+          continue;
+        }
+      slot.value = NO_VALUE;
+      slot.len = 0;
+      uint32_t address = (prefix & MaskOf (8 * level)) | (i << (24 - 8 * level));
+      for (int32_t l = len - 1; l >= lowest; l--)
+        {
+          std::map<uint64_t, uint32_t>::const_iterator found =
+            m_prefixes.find (KeyOf (address, l));
+          if (found != m_prefixes.end ())
+            {
+              slot.value = found->second;
+              slot.len = l;
+              break;
+            }
+        }
+    }
+
+  // Release the nodes that no longer hold anything.
+  for (int32_t l = level - 1; l >= 0 && node != 0 && IsEmpty (node); l--)
+    {
+      m_nodes[path[l]].slots[bytes[l]].child = 0;
+      m_freeNodes.push_back (node);
+      node = path[l];
+    }
+  return value;
+}
+
+uint32_t
+Ipv4LpmTrie::Lookup (uint32_t address) const
+{
+  uint8_t len;
+  return Lookup (address, len);
+}
+
+uint32_t
+Ipv4LpmTrie::Lookup (uint32_t address, uint8_t &len) const
+{
+  uint32_t best = NO_VALUE;
+  uint32_t node = 0;
+  for (uint8_t shift = 24;; shift -= 8)
+    {
+      const Slot &slot = m_nodes[node].slots[(address >> shift) & 0xff];
+      if (slot.value != NO_VALUE)
+        {
+          // Deeper levels only hold longer prefixes
+          best = slot.value;
+          len = slot.len;
+        }
+      if (slot.child == 0 || shift == 0)
+        {
+          break;
+        }
+      node = slot.child;
+    }
+  return best;
+}
+
+uint32_t
+Ipv4LpmTrie::ExactLookup (uint32_t prefix, uint8_t len) const
+{
+  std::map<uint64_t, uint32_t>::const_iterator it = m_prefixes.find (KeyOf (prefix, len));
+  return it == m_prefixes.end () ? NO_VALUE : it->second;
+}
+
+/* ---------------------------------------------------------------------- */
+/*                              Ipv6LpmTrie                               */
+/* ---------------------------------------------------------------------- */
+
+const uint32_t Ipv6LpmTrie::NO_VALUE = 0xffffffff;
+const uint32_t Ipv6LpmTrie::NO_NODE = 0xffffffff;
+
+Ipv6LpmTrie::Ipv6LpmTrie ()
+  : m_root (NO_NODE),
+    m_nPrefixes (0)
+{
+}
+
+bool
+Ipv6LpmTrie::GetBit (const uint8_t key[16], uint8_t bit)
+{
+  return (key[bit / 8] >> (7 - bit % 8)) & 1;
+}
+
+bool
+Ipv6LpmTrie::Match (const uint8_t prefix[16], const uint8_t key[16], uint8_t len)
+{
+  uint8_t bytes = len / 8;
+  if (std::memcmp (prefix, key, bytes) != 0)
+    {
+      return false;
+    }
+  uint8_t bits = len % 8;
+  if (bits == 0)
+    {
+      return true;
+    }
+  uint8_t mask = 0xff << (8 - bits);
+  return (prefix[bytes] & mask) == (key[bytes] & mask);
+}
+
+uint8_t
+Ipv6LpmTrie::CommonLength (const uint8_t a[16], const uint8_t b[16], uint8_t max)
+{
+  uint8_t len = 0;
+  for (uint8_t i = 0; i < 16 && len < max; i++)
+    {
+      uint8_t diff = a[i] ^ b[i];
+      if (diff == 0)
+        {
+          len += 8;
+          continue;
+        }
+      while ((diff & 0x80) == 0)
+        {
+          diff <<= 1;
+          len++;
+        }
+      break;
+    }
+  return len < max ? len : max;
+}
+
+uint32_t
+Ipv6LpmTrie::NewNode (const uint8_t key[16], uint8_t len, uint32_t value)
+{
+  uint32_t index;
+  if (!m_freeNodes.empty ())
+    {
+      index = m_freeNodes.back ();
+      m_freeNodes.pop_back ();
+    }
+  else
+    {
+      index = m_nodes.size ();
+      m_nodes.push_back (Node ());
+    }
+  Node &node = m_nodes[index];
+  std::memset (node.key, 0, 16);
+  std::memcpy (node.key, key, (len + 7) / 8);
+  if (len % 8 != 0)
+    {
+      node.key[len / 8] &= 0xff << (8 - len % 8);
+    }
+  node.len = len;
+  node.value = value;
+  node.child[0] = NO_NODE;
+  node.child[1] = NO_NODE;
+  return index;
+}
+
+void
+Ipv6LpmTrie::SetLink (uint32_t parent, bool dir, uint32_t node)
+{
+  if (parent == NO_NODE)
+    {
+      m_root = node;
+    }
+  else
+    {
+      m_nodes[parent].child[dir] = node;
+    }
+}
+
+void
+Ipv6LpmTrie::Clear (void)
+{
+  m_nodes.clear ();
+  m_freeNodes.clear ();
+  m_root = NO_NODE;
+  m_nPrefixes = 0;
+}
+
+uint32_t
+Ipv6LpmTrie::GetNPrefixes (void) const
+{
+  return m_nPrefixes;
+}
+
+void
+Ipv6LpmTrie::Insert (const uint8_t prefix[16], uint8_t len, uint32_t value)
+{
+  NS_ASSERT (len <= 128);
+  NS_ASSERT (value != NO_VALUE);
+  uint32_t parent = NO_NODE;
+  bool dir = 0;
+  uint32_t n = m_root;
+  while (n != NO_NODE)
+    {
+      uint8_t nodeLen = m_nodes[n].len;
+      uint8_t common = CommonLength (prefix, m_nodes[n].key, len < nodeLen ? len : nodeLen);
+      if (common == nodeLen && common == len)
+        {
+          if (m_nodes[n].value == NO_VALUE)
+            {
+              m_nPrefixes++;
+            }
+          m_nodes[n].value = value;
+          return;
+        }
+      if (common == nodeLen)
+        {
+          parent = n;
+          dir = GetBit (prefix, nodeLen);
+          n = m_nodes[n].child[dir];
+          continue;
+        }
+      m_nPrefixes++;
+      if (common == len)
+        {
+          // The new prefix covers the current node: insert it above
+          bool below = GetBit (m_nodes[n].key, len);
+          uint32_t node = NewNode (prefix, len, value);
+          m_nodes[node].child[below] = n;
+          SetLink (parent, dir, node);
+        }
+      else
+        {
+          // Keys diverge before both lengths: add a glue node
+          uint32_t glue = NewNode (prefix, common, NO_VALUE);
+          uint32_t leaf = NewNode (prefix, len, value);
+          m_nodes[glue].child[GetBit (prefix, common)] = leaf;
+          m_nodes[glue].child[GetBit (m_nodes[n].key, common)] = n;
+          SetLink (parent, dir, glue);
+        }
+      return;
+    }
+  m_nPrefixes++;
+  SetLink (parent, dir, NewNode (prefix, len, value));
+}
+
+uint32_t
+Ipv6LpmTrie::Remove (const uint8_t prefix[16], uint8_t len)
+{
+  uint32_t grandParent = NO_NODE;
+  bool parentDir = 0;
+  uint32_t parent = NO_NODE;
+  bool dir = 0;
+  uint32_t n = m_root;
+  while (n != NO_NODE && m_nodes[n].len < len && Match (prefix, m_nodes[n].key, m_nodes[n].len))
+    {
+      grandParent = parent;
+      parentDir = dir;
+      parent = n;
+      dir = GetBit (prefix, m_nodes[n].len);
+      n = m_nodes[n].child[dir];
+    }
+  if (n == NO_NODE || m_nodes[n].len != len || !Match (prefix, m_nodes[n].key, len)
+      || m_nodes[n].value == NO_VALUE)
+    {
+      return NO_VALUE;
+    }
+
+  uint32_t value = m_nodes[n].value;
+  m_nodes[n].value = NO_VALUE;
+  m_nPrefixes--;
+
+  uint32_t left = m_nodes[n].child[0];
+  uint32_t right = m_nodes[n].child[1];
+  if (left != NO_NODE && right != NO_NODE)
+    {
+      return value; // n stays as a glue node
+    }
+  SetLink (parent, dir, left != NO_NODE ? left : right);
+  m_freeNodes.push_back (n);
+
+  // A glue parent left with a single child is useless.
+  if (left == NO_NODE && right == NO_NODE && parent != NO_NODE
+      && m_nodes[parent].value == NO_VALUE)
+    {
+      uint32_t other = m_nodes[parent].child[!dir];
+      SetLink (grandParent, parentDir, other);
+      m_freeNodes.push_back (parent);
+    }
+  return value;
+}
+
+uint32_t
+Ipv6LpmTrie::Lookup (const uint8_t address[16]) const
+{
+  uint32_t best = NO_VALUE;
+  uint32_t n = m_root;
+  while (n != NO_NODE)
+    {
+      const Node &node = m_nodes[n];
+      if (!Match (address, node.key, node.len))
+        {
+          break;
+        }
+      if (node.value != NO_VALUE)
+        {
+          best = node.value;
+        }
+      if (node.len == 128)
+        {
+          break;
+        }
+      n = node.child[GetBit (address, node.len)];
+    }
+  return best;
+}
+
+uint32_t
+Ipv6LpmTrie::ExactLookup (const uint8_t prefix[16], uint8_t len) const
+{
+  uint32_t n = m_root;
+  while (n != NO_NODE)
+    {
+      const Node &node = m_nodes[n];
+      if (node.len > len || !Match (prefix, node.key, node.len))
+        {
+          break;
+        }
+      if (node.len == len)
+        {
+          return node.value;
+        }
+      n = node.child[GetBit (prefix, node.len)];
+    }
+  return NO_VALUE;
+}
+
+} /* namespace ns3 */
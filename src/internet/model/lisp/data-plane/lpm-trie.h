@@ -0,0 +1,150 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef SRC_INTERNET_MODEL_LISP_DATA_PLANE_LPM_TRIE_H_
+#define SRC_INTERNET_MODEL_LISP_DATA_PLANE_LPM_TRIE_H_
+
+#include <stdint.h>
+#include <vector>
+#include <map>
+
+namespace ns3 {
+
+/**
+ * \brief Longest-prefix-match table for IPv4 keys.
+ *
+ * Multibit trie with a fixed stride of 8 bits, so that a lookup costs at
+ * most four memory accesses. A prefix is stored, with controlled prefix
+ * expansion, in the level that holds its last bit (DIR-24-8 style, but
+ * without the 64MB first-level array, since a simulation may instantiate
+ * thousands of tables).
+ *
+ * Values are opaque 32-bit handles chosen by the caller. Neither Lookup ()
+ * nor ExactLookup () allocates memory.
+ */
+class Ipv4LpmTrie
+{
+public:
+  static const uint32_t NO_VALUE; //!< Returned when nothing matches.
+
+  Ipv4LpmTrie ();
+
+  /**
+   * \brief Insert (or replace) a prefix.
+   * \param prefix The prefix (host byte order). Bits beyond len are ignored.
+   * \param len The prefix length (0 to 32).
+   * \param value The handle associated to the prefix (not NO_VALUE).
+   */
+  void Insert (uint32_t prefix, uint8_t len, uint32_t value);
+
+  /**
+   * \brief Remove a prefix.
+   * \return The handle that was associated to the prefix, NO_VALUE if the
+   * prefix was not in the table.
+   */
+  uint32_t Remove (uint32_t prefix, uint8_t len);
+
+  /**
+   * \brief Longest prefix match.
+   * \param address The address to look up (host byte order).
+   * \return The handle of the most specific prefix containing address.
+   */
+  uint32_t Lookup (uint32_t address) const;
+
+  /**
+   * \brief Same as Lookup but also returns the length of the matched prefix.
+   */
+  uint32_t Lookup (uint32_t address, uint8_t &len) const;
+
+  /**
+   * \return The handle of exactly prefix/len, NO_VALUE if not present.
+   */
+  uint32_t ExactLookup (uint32_t prefix, uint8_t len) const;
+
+  void Clear (void);
+  uint32_t GetNPrefixes (void) const;
+  uint32_t GetNNodes (void) const;
+
+private:
+  /// One slot of a 256-ary node.
+  struct Slot
+  {
+    uint32_t value; //!< Handle of the longest prefix expanded in this slot.
+    uint32_t child; //!< Index of the child node, 0 if none (0 is the root).
+    uint8_t len;    //!< Length of the prefix whose handle is in value.
+  };
+  /// A 256-ary node.
+  struct Node
+  {
+    Slot slots[256];
+  };
+
+  static uint32_t MaskOf (uint8_t len);
+  static uint64_t KeyOf (uint32_t prefix, uint8_t len);
+  static uint8_t LevelOf (uint8_t len);
+  uint32_t NewNode (void);
+  bool IsEmpty (uint32_t node) const;
+
+  std::vector<Node> m_nodes;
+  std::vector<uint32_t> m_freeNodes;
+  std::map<uint64_t, uint32_t> m_prefixes; //!< Exact prefixes (for deletion and ExactLookup).
+};
+
+/**
+ * \brief Longest-prefix-match table for IPv6 keys.
+ *
+ * Path-compressed binary (Patricia) trie: every node stores the full
+ * prefix it stands for, so a lookup only visits nodes where keys actually
+ * diverge (at most one per distinct prefix length on the path).
+ */
+class Ipv6LpmTrie
+{
+public:
+  static const uint32_t NO_VALUE; //!< Returned when nothing matches.
+
+  Ipv6LpmTrie ();
+
+  void Insert (const uint8_t prefix[16], uint8_t len, uint32_t value);
+  uint32_t Remove (const uint8_t prefix[16], uint8_t len);
+  uint32_t Lookup (const uint8_t address[16]) const;
+  uint32_t ExactLookup (const uint8_t prefix[16], uint8_t len) const;
+  void Clear (void);
+  uint32_t GetNPrefixes (void) const;
+
+private:
+  static const uint32_t NO_NODE;
+  struct Node
+  {
+    uint8_t key[16];    //!< Prefix of the node (masked to len bits).
+    uint8_t len;        //!< Prefix length of the node.
+    uint32_t value;     //!< Handle if the node holds a prefix, NO_VALUE otherwise.
+    uint32_t child[2];  //!< Children, indexed by bit len of the key.
+  };
+
+  static bool GetBit (const uint8_t key[16], uint8_t bit);
+  static bool Match (const uint8_t prefix[16], const uint8_t key[16], uint8_t len);
+  static uint8_t CommonLength (const uint8_t a[16], const uint8_t b[16], uint8_t max);
+  uint32_t NewNode (const uint8_t key[16], uint8_t len, uint32_t value);
+  void SetLink (uint32_t parent, bool dir, uint32_t node);
+
+  std::vector<Node> m_nodes;
+  std::vector<uint32_t> m_freeNodes;
+  uint32_t m_root;
+  uint32_t m_nPrefixes;
+};
+
+} /* namespace ns3 */
+
+#endif /* SRC_INTERNET_MODEL_LISP_DATA_PLANE_LPM_TRIE_H_ */
@@ -0,0 +1,140 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/map-cache-clock.h"
+
+#include "ns3/assert.h"
+
+namespace ns3 {
+
+static const uint32_t NO_SLOT = 0xffffffff;
+
+MapCacheClock::MapCacheClock ()
+  : m_hand (0),
+    m_size (0),
+    m_capacity (0)
+{
+}
+
+void
+MapCacheClock::SetCapacity (uint32_t capacity)
+{
+  m_capacity = capacity;
+}
+
+uint32_t
+MapCacheClock::GetCapacity (void) const
+{
+  return m_capacity;
+}
+
+uint32_t
+MapCacheClock::GetSize (void) const
+{
+  return m_size;
+}
+
+bool
+MapCacheClock::IsFull (void) const
+{
+  return m_capacity != 0 && m_size >= m_capacity;
+}
+
+void
+MapCacheClock::Insert (Ptr<MapEntry> entry)
+{
+  uint32_t slot = entry->m_cacheSlot;
+  if (slot != NO_SLOT && slot < m_ring.size () && m_ring[slot] == entry)
+    {
+      return; // already tracked
+    }
+  if (!m_freeSlots.empty ())
+    {
+      slot = m_freeSlots.back ();
+      m_freeSlots.pop_back ();
+      m_ring[slot] = entry;
+    }
+  else
+    {
+      slot = m_ring.size ();
+      m_ring.push_back (entry);
+    }
+  entry->m_cacheSlot = slot;
+  // A new entry gets a full round before it can be evicted
+  entry->m_cacheReferenced = true;
+  m_size++;
+}
+
+void
+MapCacheClock::Remove (Ptr<MapEntry> entry)
+{
+  uint32_t slot = entry->m_cacheSlot;
+  if (slot == NO_SLOT || slot >= m_ring.size () || m_ring[slot] != entry)
+    {
+      return;
+    }
+  m_ring[slot] = 0;
+  m_freeSlots.push_back (slot);
+  entry->m_cacheSlot = NO_SLOT;
+  m_size--;
+}
+
+void
+MapCacheClock::Clear (void)
+{
+  for (std::vector<Ptr<MapEntry> >::iterator it = m_ring.begin (); it != m_ring.end (); ++it)
+    {
+      if (*it)
+        {
+          (*it)->m_cacheSlot = NO_SLOT;
+        }
+    }
+  m_ring.clear ();
+  m_freeSlots.clear ();
+  m_hand = 0;
+  m_size = 0;
+}
+
+Ptr<MapEntry>
+MapCacheClock::SelectVictim (void)
+{
+  if (m_size == 0)
+    {
+      return 0;
+    }
+  // At most two rounds: the first one clears every referenced bit.
+  for (uint32_t n = 0; n < 2 * m_ring.size (); n++)
+    {
+      if (m_hand >= m_ring.size ())
+        {
+          m_hand = 0;
+        }
+      Ptr<MapEntry> entry = m_ring[m_hand++];
+      if (!entry)
+        {
+          continue;
+        }
+      if (entry->IsExpired () || !entry->m_cacheReferenced)
+        {
+          return entry;
+        }
+      entry->m_cacheReferenced = false;
+    }
+  NS_ASSERT_MSG (false, "MapCacheClock: no victim found");
+  return 0;
+}
+
+} /* namespace ns3 */
@@ -0,0 +1,82 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef SRC_INTERNET_MODEL_LISP_DATA_PLANE_MAP_CACHE_CLOCK_H_
+#define SRC_INTERNET_MODEL_LISP_DATA_PLANE_MAP_CACHE_CLOCK_H_
+
+#include <vector>
+
+#include "ns3/ptr.h"
+#include "ns3/map-entry.h"
+
+namespace ns3 {
+
+/**
+ * \brief CLOCK (second chance) replacement for the LISP map-cache.
+ *
+ * The entries of the cache sit in a ring swept by a hand. A hit only sets
+ * the referenced bit of the entry; when the cache is full, the hand clears
+ * the bits it passes over and stops on the first entry that is expired or
+ * was not referenced since the previous sweep. Every operation is O(1)
+ * (amortized for SelectVictim ()).
+ *
+ * The class only tracks the entries: the owner (a MapTables) removes the
+ * selected victim from its own storage.
+ */
+class MapCacheClock
+{
+public:
+  MapCacheClock ();
+
+  /**
+   * \param capacity Maximum number of entries, 0 for no limit.
+   */
+  void SetCapacity (uint32_t capacity);
+  uint32_t GetCapacity (void) const;
+  uint32_t GetSize (void) const;
+  /**
+   * \return True if one more entry would exceed the capacity.
+   */
+  bool IsFull (void) const;
+
+  void Insert (Ptr<MapEntry> entry);
+  void Remove (Ptr<MapEntry> entry);
+  void Clear (void);
+
+  /**
+   * \brief Record a hit on entry.
+   */
+  static void Touch (MapEntry *entry)
+  {
+    entry->m_cacheReferenced = true;
+  }
+
+  /**
+   * \brief Advance the hand to the next entry to evict.
+   * \return The entry to evict (still tracked), 0 if the cache is empty.
+   */
+  Ptr<MapEntry> SelectVictim (void);
+
+private:
+  std::vector<Ptr<MapEntry> > m_ring;
+  std::vector<uint32_t> m_freeSlots;
+  uint32_t m_hand;
+  uint32_t m_size;
+  uint32_t m_capacity;
+};
+
+} /* namespace ns3 */
+
+#endif /* SRC_INTERNET_MODEL_LISP_DATA_PLANE_MAP_CACHE_CLOCK_H_ */
@@ -8,6 +8,7 @@
 #include "map-entry.h"
 #include "ns3/log.h"
 #include "ns3/assert.h"
+#include "ns3/simulator.h"
 
 namespace ns3
 {
@@ -27,6 +28,9 @@ namespace ns3
     m_isExpired = 0;
     m_port = 0;
     m_proxyReply = false;
+    m_expiryTime = Time::Max();
+    m_cacheSlot = 0xffffffff;
+    m_cacheReferenced = false;
   }
 
   MapEntry::~MapEntry()
@@ -149,4 +153,29 @@ namespace ns3
     return m_port != 0;
   }
 
+  void
+  MapEntry::SetTtl(uint32_t ttl)
+  {
+    if (ttl == 0xffffffff)
+    {
+      m_expiryTime = Time::Max();
+    }
+    else
+    {
+      m_expiryTime = Simulator::Now() + Minutes(ttl);
+    }
+  }
+
+  Time
+  MapEntry::GetExpiryTime(void) const
+  {
+    return m_expiryTime;
+  }
+
+  bool
+  MapEntry::IsExpired(void) const
+  {
+    return m_expiryTime <= Simulator::Now();
+  }
+
 } /* namespace ns3 */
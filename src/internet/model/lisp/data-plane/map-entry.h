@@ -13,6 +13,7 @@
 #include "ns3/ptr.h"
 #include "ns3/simple-ref-count.h"
 #include "ns3/endpoint-id.h"
+#include "ns3/nstime.h"
 
 namespace ns3 {
 /**
@@ -29,6 +30,12 @@ public:
 
   virtual Ptr<Locator> FindLocator (const Address &address) const = 0;
   virtual Ptr<Locator> RlocSelection (void) const = 0;
+  /**
+   * \brief Select the RLOC of a flow by priority and weight (RFC 6830).
+   * \param flowHash The hash of the flow, see LispOverIp::GetFlowHash ().
+   * \return The selected RLOC, 0 if none is usable.
+   */
+  virtual Ptr<Locator> RlocSelection (uint32_t flowHash) const = 0;
   void InsertLocator (Ptr<Locator> locator);
   Ptr<Locators> GetLocators (void);
   void SetLocators (Ptr<Locators> locators);
@@ -57,6 +64,19 @@ public:
   bool GetProxyReply (void) const;
   void SetProxyReply (bool val);
 
+  /**
+   * \brief Set the lifetime of the entry from its Record TTL.
+   * \param ttl TTL in minutes (RFC 6830). 0xffffffff means that the entry
+   * never expires.
+   */
+  void SetTtl (uint32_t ttl);
+  /**
+   * \return The simulation time at which the entry expires,
+   * Time::Max () if it never does.
+   */
+  Time GetExpiryTime (void) const;
+  bool IsExpired (void) const;
+
 protected:
   bool m_proxyReply;
   // TODO add a possible lock to the entry
@@ -84,7 +104,13 @@ private:
 
   uint16_t m_mappingVersionNumber; // Version number of the mapping
   uint32_t m_rlocsStatusBits;
-  // TODO investigate last time it has been used (to expunge cache)
+
+  Time m_expiryTime;
+
+  // Map-cache replacement state, see MapCacheClock
+  friend class MapCacheClock;
+  uint32_t m_cacheSlot;
+  bool m_cacheReferenced;
 };
 
 } /* namespace ns3 */
@@ -31,7 +31,9 @@ MapTables::MapTables (void)
   : m_dbMiss (0),
     m_dbHit (0),
     m_cacheMiss (0),
-    m_cacheHit (0)
+    m_cacheHit (0),
+    m_cacheEviction (0),
+    m_cacheExpiration (0)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -71,6 +73,46 @@ void MapTables::CacheMiss (void)
   m_cacheMiss++;
 }
 
+void MapTables::CacheEviction (void)
+{
+  m_cacheEviction++;
+}
+
+void MapTables::CacheExpiration (void)
+{
+  m_cacheExpiration++;
+}
+
+uint32_t MapTables::GetDbMisses (void) const
+{
+  return m_dbMiss;
+}
+
+uint32_t MapTables::GetDbHits (void) const
+{
+  return m_dbHit;
+}
+
+uint32_t MapTables::GetCacheMisses (void) const
+{
+  return m_cacheMiss;
+}
+
+uint32_t MapTables::GetCacheHits (void) const
+{
+  return m_cacheHit;
+}
+
+uint32_t MapTables::GetCacheEvictions (void) const
+{
+  return m_cacheEviction;
+}
+
+uint32_t MapTables::GetCacheExpirations (void) const
+{
+  return m_cacheExpiration;
+}
+
 std::ostream& operator<< (std::ostream &os, MapTables const &mapTable)
 {
   mapTable.Print(os);
@@ -110,6 +110,21 @@ public:
   void DbHit (void);
   void CacheHit (void);
   void CacheMiss (void);
+  void CacheEviction (void);
+  void CacheExpiration (void);
+
+  uint32_t GetDbMisses (void) const;
+  uint32_t GetDbHits (void) const;
+  uint32_t GetCacheMisses (void) const;
+  uint32_t GetCacheHits (void) const;
+  /**
+   * \return The number of map-cache entries removed to make room for new ones.
+   */
+  uint32_t GetCacheEvictions (void) const;
+  /**
+   * \return The number of map-cache entries removed because their TTL ran out.
+   */
+  uint32_t GetCacheExpirations (void) const;
 
   struct CompareEndpointId
    {
@@ -217,6 +232,8 @@ private:
   uint32_t m_dbHit;     // # successful lookups in db
   uint32_t m_cacheMiss; // # failed lookups in cache
   uint32_t m_cacheHit;  // # successful lookups in cache
+  uint32_t m_cacheEviction;   // # entries evicted from a full cache
+  uint32_t m_cacheExpiration; // # entries expired from the cache
 };
 
 std::ostream& operator<< (std::ostream &os, MapTables const &mapTable);
@@ -26,7 +26,8 @@ TypeId MappingSocketMsgHeader::GetInstanceTypeId(void) const {
 MappingSocketMsgHeader::MappingSocketMsgHeader() :
 		m_mapVersion(0), m_mapType(0), m_mapFlags(0), m_mapAddresses(0), m_mapVersioning(
 				0), /* Map Version number */
-		m_mapRlocCount(0) /* Number of RLOCs appended*/
+		m_mapRlocCount(0), /* Number of RLOCs appended*/
+		m_mapTtl(0xffffffff)
 {
 	// TODO Auto-generated constructor stub
 }
@@ -42,11 +43,12 @@ void MappingSocketMsgHeader::Print(std::ostream& os) const {
 			<< (int) m_mapType << " " << "Flags " << (int) m_mapFlags << " "
 			<< "Addresses " << (int) m_mapAddresses << " "
 			<< "Message Version Number " << (int) m_mapVersioning << " "
-			<< "RLOC Number " << (int) m_mapRlocCount;
+			<< "RLOC Number " << (int) m_mapRlocCount << " "
+			<< "TTL " << m_mapTtl;
 }
 
 uint32_t MappingSocketMsgHeader::GetSerializedSize(void) const {
-	return 15;
+	return 19;
 }
 
 void MappingSocketMsgHeader::Serialize(Buffer::Iterator start) const {
@@ -59,6 +61,7 @@ void MappingSocketMsgHeader::Serialize(Buffer::Iterator start) const {
 	i.WriteU16(m_mapAddresses);
 	i.WriteU16(m_mapVersioning);
 	i.WriteU32(m_mapRlocCount);
+	i.WriteU32(m_mapTtl);
 }
 
 uint32_t MappingSocketMsgHeader::Deserialize(Buffer::Iterator start) {
@@ -71,6 +74,7 @@ uint32_t MappingSocketMsgHeader::Deserialize(Buffer::Iterator start) {
 	m_mapAddresses = i.ReadU16();
 	m_mapVersioning = i.ReadU16();
 	m_mapRlocCount = i.ReadU32();
+	m_mapTtl = i.ReadU32();
 
 	return GetSerializedSize();
 }
@@ -78,14 +82,14 @@ uint32_t MappingSocketMsgHeader::Deserialize(Buffer::Iterator start) {
 void MappingSocketMsgHeader::SetMapVersion(uint8_t mapVersion) {
 	m_mapVersion = mapVersion;
 }
-uint8_t MappingSocketMsgHeader::GetMapVersion(void) {
+uint8_t MappingSocketMsgHeader::GetMapVersion(void) const {
 	return m_mapVersion;
 }
 
 void MappingSocketMsgHeader::SetMapType(uint16_t mapType) {
 	m_mapType = mapType;
 }
-uint16_t MappingSocketMsgHeader::GetMapType(void) {
+uint16_t MappingSocketMsgHeader::GetMapType(void) const {
 	return m_mapType;
 }
 
@@ -93,7 +97,7 @@ void MappingSocketMsgHeader::SetMapFlags(uint32_t mapFlags) {
 	m_mapFlags = mapFlags;
 }
 
-uint32_t MappingSocketMsgHeader::GetMapFlags(void) {
+uint32_t MappingSocketMsgHeader::GetMapFlags(void) const {
 	return m_mapFlags;
 }
 
@@ -101,7 +105,7 @@ void MappingSocketMsgHeader::SetMapAddresses(uint16_t mapAddresses) {
 	m_mapAddresses = mapAddresses;
 }
 
-uint16_t MappingSocketMsgHeader::GetMapAddresses(void) {
+uint16_t MappingSocketMsgHeader::GetMapAddresses(void) const {
 	return m_mapAddresses;
 }
 
@@ -109,7 +113,7 @@ void MappingSocketMsgHeader::SetMapVersioning(uint16_t mapVersioning) {
 	m_mapVersioning = mapVersioning;
 }
 
-uint16_t MappingSocketMsgHeader::GetMapVersioning(void) {
+uint16_t MappingSocketMsgHeader::GetMapVersioning(void) const {
 	return m_mapVersioning;
 }
 
@@ -117,8 +121,16 @@ void MappingSocketMsgHeader::SetMapRlocCount(uint32_t mapRlocCount) {
 	m_mapRlocCount = mapRlocCount;
 }
 
-uint32_t MappingSocketMsgHeader::GetMapRlocCount(void) {
+uint32_t MappingSocketMsgHeader::GetMapRlocCount(void) const {
 	return m_mapRlocCount;
 }
 
+void MappingSocketMsgHeader::SetMapTtl(uint32_t mapTtl) {
+	m_mapTtl = mapTtl;
+}
+
+uint32_t MappingSocketMsgHeader::GetMapTtl(void) const {
+	return m_mapTtl;
+}
+
 } /* namespace ns3 */
@@ -59,22 +59,29 @@ public:
     virtual TypeId GetInstanceTypeId (void) const;
 
     void SetMapVersion (uint8_t mapVersion);
-    uint8_t GetMapVersion (void);
+    uint8_t GetMapVersion (void) const;
 
     void SetMapType (uint16_t mapType);
-    uint16_t GetMapType (void);
+    uint16_t GetMapType (void) const;
 
     void SetMapFlags (uint32_t mapFlags);
-    uint32_t GetMapFlags (void);
+    uint32_t GetMapFlags (void) const;
 
     void SetMapAddresses (uint16_t mapAddresses);
-    uint16_t GetMapAddresses (void);
+    uint16_t GetMapAddresses (void) const;
 
     void SetMapVersioning (uint16_t mapVersioning);
-    uint16_t GetMapVersioning (void);
+    uint16_t GetMapVersioning (void) const;
 
     void SetMapRlocCount (uint32_t mapRlocCount);
-    uint32_t GetMapRlocCount (void);
+    uint32_t GetMapRlocCount (void) const;
+
+    /**
+     * \brief Set the TTL (in minutes) of the carried mapping, as given by
+     * the Record TTL of the Map-Reply. 0xffffffff means no expiry.
+     */
+    void SetMapTtl (uint32_t mapTtl);
+    uint32_t GetMapTtl (void) const;
   private:
     uint8_t m_mapVersion; /* ? future binary compatibility */
     uint16_t m_mapType; /* message type */
@@ -82,6 +89,7 @@ public:
     uint16_t m_mapAddresses;
     uint16_t m_mapVersioning; /* Map Version number */
     uint32_t m_mapRlocCount; /* Number of RLOCs appended*/
+    uint32_t m_mapTtl; /* Record TTL of the mapping (minutes) */
 
 };
 } /* namespace ns3 */
@@ -0,0 +1,224 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/miss-queue.h"
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("MissQueue");
+
+static bool
+CompareSequence (const BufferedPacket &a, const BufferedPacket &b)
+{
+  return a.sequence < b.sequence;
+}
+
+MissQueue::Queue::Queue ()
+  : m_bytes (0)
+{
+}
+
+MissQueue::MissQueue ()
+  : m_maxBytes (0),
+    m_maxEidBytes (0),
+    m_maxDelay (Time::Max ()),
+    m_nPackets (0),
+    m_nBytes (0),
+    m_nExpired (0),
+    m_sequence (0)
+{
+}
+
+void
+MissQueue::SetMaxBytes (uint32_t maxBytes)
+{
+  m_maxBytes = maxBytes;
+}
+
+uint32_t
+MissQueue::GetMaxBytes (void) const
+{
+  return m_maxBytes;
+}
+
+void
+MissQueue::SetMaxEidBytes (uint32_t maxEidBytes)
+{
+  m_maxEidBytes = maxEidBytes;
+}
+
+uint32_t
+MissQueue::GetMaxEidBytes (void) const
+{
+  return m_maxEidBytes;
+}
+
+void
+MissQueue::SetMaxDelay (Time maxDelay)
+{
+  m_maxDelay = maxDelay;
+}
+
+Time
+MissQueue::GetMaxDelay (void) const
+{
+  return m_maxDelay;
+}
+
+bool
+MissQueue::Enqueue (BufferedPacket packet)
+{
+  NS_LOG_FUNCTION (this << packet.destination);
+  uint32_t size = packet.packet->GetSize ();
+  if (m_maxBytes != 0 && m_nBytes + size > m_maxBytes)
+    {
+      // Make room with the packets whose Map-Request was given up on
+      ExpireAll ();
+      if (m_nBytes + size > m_maxBytes)
+        {
+          NS_LOG_DEBUG ("Miss queue full (" << m_nBytes << " bytes), drop packet to " << packet.destination);
+          return false;
+        }
+    }
+
+  QueueMap::iterator it = m_queues.find (packet.destination.Get ());
+  if (it != m_queues.end () && Expire (it))
+    {
+      it = m_queues.end ();
+    }
+  if (it == m_queues.end ())
+    {
+      it = m_queues.insert (std::make_pair (packet.destination.Get (), Queue ())).first;
+    }
+  Queue &queue = it->second;
+  if (m_maxEidBytes != 0 && queue.m_bytes + size > m_maxEidBytes)
+    {
+      NS_LOG_DEBUG ("Miss queue of " << packet.destination << " full (" << queue.m_bytes << " bytes), drop packet");
+      if (queue.m_packets.empty ())
+        {
+          m_queues.erase (it);
+        }
+      return false;
+    }
+
+  packet.arrival = Simulator::Now ();
+  packet.sequence = m_sequence++;
+  queue.m_packets.push_back (packet);
+  queue.m_bytes += size;
+  m_nPackets++;
+  m_nBytes += size;
+  return true;
+}
+
+void
+MissQueue::Dequeue (Ipv4Address eidPrefix, Ipv4Mask mask, std::list<BufferedPacket> &packets)
+{
+  NS_LOG_FUNCTION (this << eidPrefix << mask);
+  uint32_t first = eidPrefix.CombineMask (mask).Get ();
+  uint32_t last = first | ~mask.Get ();
+
+  std::list<BufferedPacket> dequeued;
+  QueueMap::iterator it = m_queues.lower_bound (first);
+  while (it != m_queues.end () && it->first <= last)
+    {
+      QueueMap::iterator current = it++;
+      if (Expire (current))
+        {
+          continue;
+        }
+      Queue &queue = current->second;
+      dequeued.insert (dequeued.end (), queue.m_packets.begin (), queue.m_packets.end ());
+      m_nPackets -= queue.m_packets.size ();
+      m_nBytes -= queue.m_bytes;
+      m_queues.erase (current);
+    }
+  // Each queue is in order: only the destinations need to be interleaved
+  dequeued.sort (CompareSequence);
+  NS_LOG_DEBUG (dequeued.size () << " packets dequeued for " << eidPrefix << "/" << mask.GetPrefixLength ());
+  packets.splice (packets.end (), dequeued);
+}
+
+void
+MissQueue::Clear (void)
+{
+  m_queues.clear ();
+  m_nPackets = 0;
+  m_nBytes = 0;
+}
+
+uint32_t
+MissQueue::GetNPackets (void) const
+{
+  return m_nPackets;
+}
+
+uint32_t
+MissQueue::GetNBytes (void) const
+{
+  return m_nBytes;
+}
+
+uint32_t
+MissQueue::GetNExpired (void) const
+{
+  return m_nExpired;
+}
+
+bool
+MissQueue::Expire (QueueMap::iterator it)
+{
+  Queue &queue = it->second;
+  // Packets are queued in arrival order: the oldest ones are at the front
+  while (m_maxDelay != Time::Max () && !queue.m_packets.empty ()
+         && Simulator::Now () - queue.m_packets.front ().arrival > m_maxDelay)
+    {
+      uint32_t size = queue.m_packets.front ().packet->GetSize ();
+      NS_LOG_DEBUG ("Drop packet to " << queue.m_packets.front ().destination
+                    << " after " << (Simulator::Now () - queue.m_packets.front ().arrival).GetSeconds ()
+                    << "s without mapping");
+      queue.m_packets.pop_front ();
+      queue.m_bytes -= size;
+      m_nPackets--;
+      m_nBytes -= size;
+      m_nExpired++;
+    }
+  if (queue.m_packets.empty ())
+    {
+      m_queues.erase (it);
+      return true;
+    }
+  return false;
+}
+
+void
+MissQueue::ExpireAll (void)
+{
+  if (m_maxDelay == Time::Max ())
+    {
+      return;
+    }
+  QueueMap::iterator it = m_queues.begin ();
+  while (it != m_queues.end ())
+    {
+      QueueMap::iterator current = it++;
+      Expire (current);
+    }
+}
+
+} /* namespace ns3 */
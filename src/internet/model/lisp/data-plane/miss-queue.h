@@ -0,0 +1,125 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef SRC_INTERNET_MODEL_LISP_DATA_PLANE_MISS_QUEUE_H_
+#define SRC_INTERNET_MODEL_LISP_DATA_PLANE_MISS_QUEUE_H_
+
+#include <deque>
+#include <list>
+#include <map>
+
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv4-route.h"
+#include "ns3/net-device.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+#include "ns3/ptr.h"
+
+namespace ns3 {
+
+/**
+ * \brief A packet that missed the map-cache, with what is needed to send
+ * it again through Ipv4L3Protocol::Send ().
+ */
+struct BufferedPacket
+{
+  Ptr<Packet> packet;
+  Ipv4Address source;
+  Ipv4Address destination;
+  uint8_t protocol;
+  Ptr<Ipv4Route> route;
+  Time arrival;       //!< Time at which the packet missed the cache
+  uint64_t sequence;  //!< Arrival order, set by MissQueue::Enqueue ()
+};
+
+/**
+ * \brief Packets waiting for the Map-Reply that resolves their destination.
+ *
+ * The EID-prefix of the destination is not known until the Map-Reply is
+ * received, so the packets are queued by destination EID. When the mapping
+ * of an EID-prefix is added to the map-cache, Dequeue () returns every packet
+ * whose destination is covered by the prefix, in arrival order.
+ *
+ * The memory is bounded per destination and globally (in bytes, 0 means no
+ * limit). A packet that would exceed either bound is dropped (tail drop),
+ * and packets older than the maximum delay are dropped lazily, once the
+ * control plane has likely given up on their Map-Request.
+ */
+class MissQueue
+{
+public:
+  MissQueue ();
+
+  void SetMaxBytes (uint32_t maxBytes);
+  uint32_t GetMaxBytes (void) const;
+  void SetMaxEidBytes (uint32_t maxEidBytes);
+  uint32_t GetMaxEidBytes (void) const;
+  void SetMaxDelay (Time maxDelay);
+  Time GetMaxDelay (void) const;
+
+  /**
+   * \brief Queue a packet that missed the map-cache.
+   * \param packet The packet and its sending parameters.
+   * \return False if the packet was dropped because the queue is full.
+   */
+  bool Enqueue (BufferedPacket packet);
+
+  /**
+   * \brief Remove the packets destined to an EID-prefix.
+   * \param eidPrefix The EID-prefix whose mapping is now in the map-cache.
+   * \param mask The mask of the EID-prefix.
+   * \param packets The removed packets are appended in arrival order.
+   */
+  void Dequeue (Ipv4Address eidPrefix, Ipv4Mask mask, std::list<BufferedPacket> &packets);
+
+  void Clear (void);
+
+  uint32_t GetNPackets (void) const;
+  uint32_t GetNBytes (void) const;
+  /**
+   * \return The number of packets dropped because they waited too long.
+   */
+  uint32_t GetNExpired (void) const;
+
+private:
+  struct Queue
+  {
+    Queue ();
+    std::deque<BufferedPacket> m_packets;
+    uint32_t m_bytes;
+  };
+  /// Queues by destination EID address (host order, so a prefix is a range).
+  typedef std::map<uint32_t, Queue> QueueMap;
+
+  /**
+   * \brief Drop the packets of a queue that waited longer than m_maxDelay.
+   * \return True if the queue is now empty (and was erased).
+   */
+  bool Expire (QueueMap::iterator it);
+  void ExpireAll (void);
+
+  QueueMap m_queues;
+  uint32_t m_maxBytes;
+  uint32_t m_maxEidBytes;
+  Time m_maxDelay;
+  uint32_t m_nPackets;
+  uint32_t m_nBytes;
+  uint32_t m_nExpired;
+  uint64_t m_sequence;
+};
+
+} /* namespace ns3 */
+
+#endif /* SRC_INTERNET_MODEL_LISP_DATA_PLANE_MISS_QUEUE_H_ */
@@ -0,0 +1,235 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "rloc-lookup-table.h"
+
+#include <algorithm>
+
+#include "ns3/address.h"
+#include "ns3/log.h"
+#include "ns3/lisp-over-ip.h"
+#include "rloc-metrics.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("RlocLookupTable");
+
+/*
+ * FNV-1a hash of the RLOC address. The address only determines the order in
+ * which an RLOC claims the slots, so that the table does not depend on the
+ * order of the locators in the mapping.
+ */
+static uint32_t
+HashRloc (const Address &address, uint32_t seed)
+{
+  uint8_t buf[Address::MAX_SIZE];
+  uint32_t len = address.CopyTo (buf);
+  uint32_t hash = 2166136261U ^ seed;
+  for (uint32_t i = 0; i < len; i++)
+    {
+      hash ^= buf[i];
+      hash *= 16777619U;
+    }
+  return hash;
+}
+
+RlocLookupTable::RlocLookupTable ()
+  : m_metricsChangeCount (0),
+    m_valid (false)
+{
+}
+
+void
+RlocLookupTable::Invalidate (void)
+{
+  m_valid = false;
+}
+
+void
+RlocLookupTable::Snapshot (Ptr<Locators> locators, std::vector<Candidate> &snapshot) const
+{
+  snapshot.clear ();
+  for (uint8_t i = 0; i < locators->GetNLocators (); i++)
+    {
+      Ptr<Locator> locator = locators->GetLocatorByIdx (i);
+      Ptr<RlocMetrics> metrics = locator->GetRlocMetrics ();
+      Candidate candidate;
+      candidate.locator = locator;
+      candidate.priority = metrics->GetPriority ();
+      candidate.weight = metrics->GetWeight ();
+      candidate.up = metrics->IsUp ();
+      snapshot.push_back (candidate);
+    }
+}
+
+bool
+RlocLookupTable::IsStale (Ptr<Locators> locators) const
+{
+  if (!m_valid || locators != m_locators || locators->GetNLocators () != m_snapshot.size ())
+    {
+      return true;
+    }
+  if (RlocMetrics::GetChangeCount () == m_metricsChangeCount)
+    {
+      return false;
+    }
+  // Some metrics changed somewhere: check whether they are ours
+  std::vector<Candidate> snapshot;
+  Snapshot (locators, snapshot);
+  for (uint32_t i = 0; i < snapshot.size (); i++)
+    {
+      if (snapshot[i].locator != m_snapshot[i].locator
+          || snapshot[i].priority != m_snapshot[i].priority
+          || snapshot[i].weight != m_snapshot[i].weight
+          || snapshot[i].up != m_snapshot[i].up)
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+void
+RlocLookupTable::Build (Ptr<Locators> locators)
+{
+  NS_LOG_FUNCTION (this);
+  m_locators = locators;
+  m_metricsChangeCount = RlocMetrics::GetChangeCount ();
+  Snapshot (locators, m_snapshot);
+  m_valid = true;
+  m_rlocs.clear ();
+  m_table.clear ();
+
+  // The usable RLOCs with the best priority
+  uint8_t bestPriority = LispOverIp::LISP_MAX_RLOC_PRIO;
+  for (std::vector<Candidate>::const_iterator it = m_snapshot.begin (); it != m_snapshot.end (); ++it)
+    {
+      if (it->up && it->priority < bestPriority)
+        {
+          bestPriority = it->priority;
+        }
+    }
+  std::vector<uint32_t> weights;
+  uint32_t maxWeight = 0;
+  for (std::vector<Candidate>::const_iterator it = m_snapshot.begin (); it != m_snapshot.end (); ++it)
+    {
+      // Priority 255 means "do not use", even if no other RLOC is up
+      if (it->up && it->priority == bestPriority && it->priority < LispOverIp::LISP_MAX_RLOC_PRIO)
+        {
+          m_rlocs.push_back (it->locator);
+          weights.push_back (it->weight);
+          maxWeight = std::max (maxWeight, (uint32_t) it->weight);
+        }
+    }
+
+  if (maxWeight == 0)
+    {
+      // All the weights are 0: equal split
+      weights.assign (weights.size (), 1);
+      maxWeight = 1;
+    }
+  else
+    {
+      // An RLOC with a weight of 0 receives no traffic
+      for (uint32_t i = 0; i < m_rlocs.size ();)
+        {
+          if (weights[i] == 0)
+            {
+              m_rlocs.erase (m_rlocs.begin () + i);
+              weights.erase (weights.begin () + i);
+            }
+          else
+            {
+              i++;
+            }
+        }
+    }
+  NS_LOG_DEBUG (m_rlocs.size () << " RLOCs of priority " << (uint32_t) bestPriority << " in use");
+  if (m_rlocs.size () <= 1)
+    {
+      // No table needed
+      return;
+    }
+
+  /*
+   * Maglev population: every RLOC walks its own permutation of the slots
+   * (offset + j * skip) and claims the first free one when it has earned
+   * enough credit. An RLOC earns its weight at each round and a slot costs
+   * the largest weight, so the RLOCs own slots in proportion to their
+   * weight.
+   */
+  uint32_t n = m_rlocs.size ();
+  std::vector<uint32_t> offset (n), skip (n), next (n, 0), credit (n, 0);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      Address address = m_rlocs[i]->GetRlocAddress ();
+      offset[i] = HashRloc (address, 0) % SIZE;
+      skip[i] = HashRloc (address, 0x9e3779b9) % (SIZE - 1) + 1;
+    }
+  const uint8_t unused = 0xff;
+  NS_ASSERT (n < unused);
+  m_table.assign (SIZE, unused);
+  uint32_t filled = 0;
+  while (filled < SIZE)
+    {
+      for (uint32_t i = 0; i < n && filled < SIZE; i++)
+        {
+          credit[i] += weights[i];
+          while (credit[i] >= maxWeight && filled < SIZE)
+            {
+              uint32_t slot = (offset[i] + next[i] * skip[i]) % SIZE;
+              while (m_table[slot] != unused)
+                {
+                  next[i]++;
+                  slot = (offset[i] + next[i] * skip[i]) % SIZE;
+                }
+              m_table[slot] = i;
+              next[i]++;
+              credit[i] -= maxWeight;
+              filled++;
+            }
+        }
+    }
+}
+
+Ptr<Locator>
+RlocLookupTable::Select (Ptr<Locators> locators, uint32_t flowHash)
+{
+  if (locators == 0)
+    {
+      return 0;
+    }
+  if (IsStale (locators))
+    {
+      Build (locators);
+    }
+  else
+    {
+      m_metricsChangeCount = RlocMetrics::GetChangeCount ();
+    }
+
+  if (m_rlocs.empty ())
+    {
+      return 0;
+    }
+  if (m_rlocs.size () == 1)
+    {
+      return m_rlocs.front ();
+    }
+  return m_rlocs[m_table[flowHash % SIZE]];
+}
+
+} /* namespace ns3 */
@@ -0,0 +1,91 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef SRC_INTERNET_MODEL_LISP_DATA_PLANE_RLOC_LOOKUP_TABLE_H_
+#define SRC_INTERNET_MODEL_LISP_DATA_PLANE_RLOC_LOOKUP_TABLE_H_
+
+#include <vector>
+
+#include "ns3/ptr.h"
+#include "locator.h"
+#include "locators.h"
+
+namespace ns3 {
+
+/**
+ * \brief Destination RLOC selection by priority and weight (RFC 6830,
+ * section 6.5).
+ *
+ * Only the RLOCs that are up and have the best (lowest) priority below 255
+ * are used. Traffic is split among them in proportion to their weight; if
+ * all of them have a weight of 0, it is split equally.
+ *
+ * The split is done with a Maglev lookup table: SIZE slots, each owning
+ * one RLOC, indexed by the hash of the inner flow. Selecting the RLOC of a
+ * packet is a single table access, all the packets of a flow use the same
+ * RLOC and, when an RLOC is added or removed, only the flows of the slots
+ * that change owner are moved.
+ *
+ * The table is built lazily, from the locators given to Select (): it is
+ * rebuilt when the locator set or the metrics of one of its RLOCs change.
+ */
+class RlocLookupTable
+{
+public:
+  /// Number of slots of the table, a prime so that every skip visits all the slots.
+  static const uint32_t SIZE = 251;
+
+  RlocLookupTable ();
+
+  /**
+   * \brief Select the RLOC of a flow.
+   * \param locators The RLOCs of the mapping.
+   * \param flowHash The hash of the inner flow of the packet.
+   * \return The RLOC to encapsulate the packet to, 0 if none is usable.
+   */
+  Ptr<Locator> Select (Ptr<Locators> locators, uint32_t flowHash);
+
+  /**
+   * \brief Force the table to be rebuilt at the next selection.
+   */
+  void Invalidate (void);
+
+private:
+  struct Candidate
+  {
+    Ptr<Locator> locator;
+    uint8_t priority;
+    uint8_t weight;
+    bool up;
+  };
+
+  bool IsStale (Ptr<Locators> locators) const;
+  void Snapshot (Ptr<Locators> locators, std::vector<Candidate> &snapshot) const;
+  void Build (Ptr<Locators> locators);
+
+  /// The locators the table was built from, with the metrics used.
+  Ptr<Locators> m_locators;
+  std::vector<Candidate> m_snapshot;
+  uint32_t m_metricsChangeCount;
+  bool m_valid;
+
+  /// The RLOCs in use, m_table holds indexes in this vector.
+  std::vector<Ptr<Locator> > m_rlocs;
+  std::vector<uint8_t> m_table;
+};
+
+} /* namespace ns3 */
+
+#endif /* SRC_INTERNET_MODEL_LISP_DATA_PLANE_RLOC_LOOKUP_TABLE_H_ */
@@ -26,41 +26,39 @@ namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE("RlocMetrics");
 
+// Changes of the metrics used to select RLOCs, see GetChangeCount ()
+static uint32_t g_rlocMetricsChangeCount = 0;
+
 RlocMetrics::RlocMetrics() :
 		m_priority(0), m_mpriority(0), m_weight(0), m_mweight(0), m_rlocIsUp(
 				true), m_rlocIsLocalInterface(false), m_txNoncePresent(false), m_rxNoncePresent(
 				false), m_txNonce(0), m_rxNonce(0), m_mtu(0) {
-
+	g_rlocMetricsChangeCount++;
 }
 
-RlocMetrics::RlocMetrics(uint8_t priority, uint8_t weight) {
-	m_priority = priority;
-	m_weight = weight;
-	// by default locator is up
-	m_rlocIsUp = true;
-	// mtu not set yet
-	m_mtu = 0;
+RlocMetrics::RlocMetrics(uint8_t priority, uint8_t weight) :
+		m_priority(priority), m_mpriority(0), m_weight(weight), m_mweight(0), m_rlocIsUp(
+				true), m_rlocIsLocalInterface(false), m_txNoncePresent(false), m_rxNoncePresent(
+				false), m_txNonce(0), m_rxNonce(0), m_mtu(0) {
+	// by default locator is up and mtu not set yet
+	g_rlocMetricsChangeCount++;
 }
 
 RlocMetrics::RlocMetrics(uint8_t priority, uint8_t mpriority, uint8_t weight,
-		uint8_t mweight) {
-	m_mpriority = mpriority;
-	m_mweight = mweight;
-	m_priority = priority;
-	m_weight = weight;
-	// by default locator is up
-	m_rlocIsUp = true;
-	// mtu not set yet
-	m_mtu = 0;
+		uint8_t mweight) :
+		m_priority(priority), m_mpriority(mpriority), m_weight(weight), m_mweight(
+				mweight), m_rlocIsUp(true), m_rlocIsLocalInterface(false), m_txNoncePresent(
+				false), m_rxNoncePresent(false), m_txNonce(0), m_rxNonce(0), m_mtu(0) {
+	// by default locator is up and mtu not set yet
+	g_rlocMetricsChangeCount++;
 }
 
-RlocMetrics::RlocMetrics(uint8_t priority, uint8_t weight, bool reachable) {
-	m_priority = priority;
-	m_weight = weight;
-	// by default locator is up
-	m_rlocIsUp = reachable;
+RlocMetrics::RlocMetrics(uint8_t priority, uint8_t weight, bool reachable) :
+		m_priority(priority), m_mpriority(0), m_weight(weight), m_mweight(0), m_rlocIsUp(
+				reachable), m_rlocIsLocalInterface(false), m_txNoncePresent(false), m_rxNoncePresent(
+				false), m_txNonce(0), m_rxNonce(0), m_mtu(0) {
 	// default 0 : mtu not set yet
-	m_mtu = 0;
+	g_rlocMetricsChangeCount++;
 }
 
 RlocMetrics::~RlocMetrics() {
@@ -73,6 +71,7 @@ uint8_t RlocMetrics::GetPriority(void) const {
 void RlocMetrics::SetPriority(uint8_t priority) {
 	NS_ASSERT(priority >= 0 && priority <= LispOverIp::LISP_MAX_RLOC_PRIO);
 	m_priority = priority;
+	g_rlocMetricsChangeCount++;
 }
 
 uint8_t RlocMetrics::GetWeight(void) const {
@@ -81,6 +80,7 @@ uint8_t RlocMetrics::GetWeight(void) const {
 
 void RlocMetrics::SetWeight(uint8_t weight) {
 	m_weight = weight;
+	g_rlocMetricsChangeCount++;
 }
 
 uint32_t RlocMetrics::GetMtu(void) const {
@@ -96,7 +96,12 @@ bool RlocMetrics::IsUp(void) {
 }
 
 void RlocMetrics::SetUp(bool status) {
-	m_rlocIsUp = true;
+	m_rlocIsUp = status;
+	g_rlocMetricsChangeCount++;
+}
+
+uint32_t RlocMetrics::GetChangeCount(void) {
+	return g_rlocMetricsChangeCount;
 }
 
 bool RlocMetrics::IsLocalInterface(void) {
@@ -269,14 +274,13 @@ Ptr<RlocMetrics> RlocMetrics::DeserializedInMapReplyRecord(const uint8_t *buf){
 	 from the receiver's point of view.  See also Section 6.4 for
 	 another way the R-bit may be used.
 
-	 I'm not sure if flag R represents status up/down
+	 R does not represent the status up/down (MapReplyRecord::Serialize
+	 never sets it): the RLOC stays up.
 	 * */
 	if (buf[5] & RLOCF_R){
-		rlocMetrics->SetUp(true);
 		rlocMetrics->SetFlagR(true);
 	}
 	else{
-		rlocMetrics->SetUp(false);
 		rlocMetrics->SetFlagR(false);
 	}
 
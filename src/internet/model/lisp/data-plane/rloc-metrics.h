@@ -119,6 +119,14 @@ public:
    */
   void SetUp (bool status);
 
+  /**
+   * Get the number of changes of the priority, weight or state of any RLOC
+   * (including the creation of new metrics), so that the users of these
+   * metrics can detect that they are stale.
+   * \return The change counter.
+   */
+  static uint32_t GetChangeCount (void);
+
   /**
    * Get if the RLOC address is the one of a local interface or not.
    *
@@ -40,6 +40,7 @@
 #include "ns3/lisp-header.h"
 #include "ns3/assert.h"
 #include "ns3/log.h"
+#include "ns3/uinteger.h"
 
 namespace ns3
 {
@@ -51,11 +52,18 @@ namespace ns3
 	TypeId SimpleMapTables::GetTypeId()
 	{
 		static TypeId tid =
-			TypeId("ns3::SimpleMapTables").SetParent<MapTables>().SetGroupName("Lisp").AddConstructor<SimpleMapTables>();
+			TypeId("ns3::SimpleMapTables").SetParent<MapTables>().SetGroupName("Lisp").AddConstructor<SimpleMapTables>()
+			.AddAttribute("CacheCapacity",
+						  "Maximum number of entries in the LISP cache (0: no limit). "
+						  "When full, an entry is evicted with the CLOCK algorithm.",
+						  UintegerValue(0),
+						  MakeUintegerAccessor(&SimpleMapTables::SetCacheCapacity,
+											   &SimpleMapTables::GetCacheCapacity),
+						  MakeUintegerChecker<uint32_t>());
 		return tid;
 	}
 
-	SimpleMapTables::SimpleMapTables()
+	SimpleMapTables::SimpleMapTables() : m_sourceRlocEpoch(0)
 	{
 		NS_LOG_FUNCTION(this);
 	}
@@ -152,11 +160,13 @@ namespace ns3
 		Ptr<EndpointId> eid = Create<EndpointId>(eidAddress);
 		NS_LOG_DEBUG("Searching in Cache Database for EID:" << eid->GetEidAddress());
 
-		if (m_mappingCache.find(eid) != m_mappingCache.end())
+		std::map<Ptr<EndpointId>, Ptr<MapEntry>, CompareEndpointId>::iterator it =
+			m_mappingCache.find(eid);
+		if (it != m_mappingCache.end() && CheckCacheEntry(it->second))
 		{
 			MapTables::CacheHit();
 			NS_LOG_DEBUG("Find mapping in Cache for EID:" << eid->GetEidAddress());
-			return m_mappingCache.at(eid);
+			return it->second;
 		}
 
 		NS_LOG_DEBUG("No search result in Cache Database for EID:" << eid->GetEidAddress());
@@ -171,19 +181,85 @@ namespace ns3
 	{
 		Ptr<EndpointId> eid = Create<EndpointId>(eidAddress);
 		m_mappingDatabase.erase(eid);
+		InvalidateSourceRlocCache();
 	}
 
 	void
 	SimpleMapTables::CacheDelete(const Address &eidAddress)
 	{
 		Ptr<EndpointId> eid = Create<EndpointId>(eidAddress);
-		m_mappingCache.erase(eid);
+		std::map<Ptr<EndpointId>, Ptr<MapEntry>, CompareEndpointId>::iterator it =
+			m_mappingCache.find(eid);
+		if (it != m_mappingCache.end())
+		{
+			m_cacheClock.Remove(it->second);
+			m_mappingCache.erase(it);
+		}
 	}
 
 	void
 	SimpleMapTables::WipeCache(void)
 	{
 		m_mappingCache.clear();
+		m_cacheClock.Clear();
+	}
+
+	void
+	SimpleMapTables::SetCacheCapacity(uint32_t capacity)
+	{
+		m_cacheClock.SetCapacity(capacity);
+	}
+
+	uint32_t
+	SimpleMapTables::GetCacheCapacity(void) const
+	{
+		return m_cacheClock.GetCapacity();
+	}
+
+	Ptr<MapEntry>
+	SimpleMapTables::CheckCacheEntry(Ptr<MapEntry> entry)
+	{
+		if (entry->IsExpired())
+		{
+			NS_LOG_DEBUG("Cache entry for " << entry->GetEidPrefix()->Print() << " has expired");
+			RemoveCacheEntry(entry);
+			m_cacheClock.Remove(entry);
+			MapTables::CacheExpiration();
+			return 0;
+		}
+		MapCacheClock::Touch(PeekPointer(entry));
+		return entry;
+	}
+
+	void
+	SimpleMapTables::AdmitCacheEntry(Ptr<MapEntry> entry, Ptr<MapEntry> replaced)
+	{
+		if (replaced)
+		{
+			m_cacheClock.Remove(replaced);
+		}
+		else
+		{
+			while (m_cacheClock.IsFull())
+			{
+				Ptr<MapEntry> victim = m_cacheClock.SelectVictim();
+				NS_LOG_DEBUG("Cache full, evict entry for " << victim->GetEidPrefix()->Print());
+				if (victim->IsExpired())
+					MapTables::CacheExpiration();
+				else
+					MapTables::CacheEviction();
+				RemoveCacheEntry(victim);
+				m_cacheClock.Remove(victim);
+			}
+		}
+		m_cacheClock.Insert(entry);
+	}
+
+	void
+	SimpleMapTables::RemoveCacheEntry(Ptr<MapEntry> entry)
+	{
+		// The EID-prefix carries its mask: the lookup is exact
+		m_mappingCache.erase(entry->GetEidPrefix());
 	}
 
 	Ptr<LispEtrItrApplication> SimpleMapTables::GetxTRApp()
@@ -231,6 +307,7 @@ namespace ns3
 
 			m_mappingDatabase.insert(
 				std::pair<Ptr<EndpointId>, Ptr<MapEntry>>(eid, mapEntry));
+			InvalidateSourceRlocCache();
 
 			m_mutexDatabase.Unlock();
 		}
@@ -240,46 +317,56 @@ namespace ns3
 			m_mutexCache.Lock();
 			std::map<Ptr<EndpointId>, Ptr<MapEntry>, CompareEndpointId>::iterator it =
 				m_mappingCache.find(eid);
+			Ptr<MapEntry> replaced = 0;
 			if (it != m_mappingCache.end())
+			{
+				replaced = it->second;
 				m_mappingCache.erase(it);
+			}
+			AdmitCacheEntry(mapEntry, replaced);
 			m_mappingCache.insert(
 				std::pair<Ptr<EndpointId>, Ptr<MapEntry>>(eid, mapEntry));
 			m_mutexCache.Unlock();
 			NS_LOG_DEBUG("Set an Mapping Entry for EID:" << eid->GetEidAddress());
-			/**
-			 * TODO: Here we should care about whether we could send the saved invoked-SMR.
-			 * First thing: not all simple map table should have a pointer to xTR application.
-			 * SimpleMapTables class in MapServer has no such a pointer.
-			 * Thus, we first need to make sure whether the xTR smart pointer's value is 0.
-			 * If yes. bypass all the following logics.
-			 */
-			NS_LOG_DEBUG("xTR application pointer of this map table is :" << m_xTRApp);
-			if (m_xTRApp != NULL)
+			SendBufferedInvokedSmr(eidAddress, mask);
+		}
+	}
+
+	void SimpleMapTables::SendBufferedInvokedSmr(const Address &eidAddress, const Ipv4Mask &mask)
+	{
+		/**
+		 * TODO: Here we should care about whether we could send the saved invoked-SMR.
+		 * First thing: not all simple map table should have a pointer to xTR application.
+		 * SimpleMapTables class in MapServer has no such a pointer.
+		 * Thus, we first need to make sure whether the xTR smart pointer's value is 0.
+		 * If yes. bypass all the following logics.
+		 */
+		NS_LOG_DEBUG("xTR application pointer of this map table is :" << m_xTRApp);
+		if (m_xTRApp != NULL)
+		{
+			std::list<Ptr<MapRequestMsg>> m_mapReqMsg = m_xTRApp->GetMapRequestMsgList();
+			Ipv4Address eidAddressIpv4 = Ipv4Address::ConvertFrom(eidAddress);
+			NS_LOG_DEBUG("The newly received mapping has an EID:" << eidAddressIpv4);
+			for (std::list<Ptr<MapRequestMsg>>::const_iterator it = m_mapReqMsg.begin(); it != m_mapReqMsg.end(); ++it)
 			{
-				std::list<Ptr<MapRequestMsg>> m_mapReqMsg = m_xTRApp->GetMapRequestMsgList();
-				Ipv4Address eidAddressIpv4 = Ipv4Address::ConvertFrom(eidAddress);
-				NS_LOG_DEBUG("The newly received mapping has an EID:" << eidAddressIpv4);
-				for (std::list<Ptr<MapRequestMsg>>::const_iterator it = m_mapReqMsg.begin(); it != m_mapReqMsg.end(); ++it)
+				// it here is a pointer of pointer??
+				Ptr<MapRequestMsg> requestMsg = (*it);
+				Ipv4Address queriedEid = Ipv4Address::ConvertFrom(requestMsg->GetItrRlocAddrIp());
+				Ipv4Address queriedEidPrefix = queriedEid.CombineMask(mask);
+				NS_LOG_DEBUG("The buffered SMR contains an unknown RLOC (i.e. a Local RLOC, an EID):" << Ipv4Address::ConvertFrom(queriedEid));
+				// Should verify if queriedEid belongs to eidAddress (which is a prefix)
+				if (eidAddressIpv4.IsEqual(queriedEidPrefix))
 				{
-					// it here is a pointer of pointer??
-					Ptr<MapRequestMsg> requestMsg = (*it);
-					Ipv4Address queriedEid = Ipv4Address::ConvertFrom(requestMsg->GetItrRlocAddrIp());
-					Ipv4Address queriedEidPrefix = queriedEid.CombineMask(mask);
-					NS_LOG_DEBUG("The buffered SMR contains an unknown RLOC (i.e. a Local RLOC, an EID):" << Ipv4Address::ConvertFrom(queriedEid));
-					// Should verify if queriedEid belongs to eidAddress (which is a prefix)
-					if (eidAddressIpv4.IsEqual(queriedEidPrefix))
-					{
-						GetxTRApp()->SendInvokedSmrMsg(requestMsg);
-						NS_LOG_DEBUG("Now a buffered invoked-SMR has been sent... ");
-						// Don't forget to delete the sent invoked-SMR
-						//					m_mapReqMsg.remove(*it);
-					}
+					GetxTRApp()->SendInvokedSmrMsg(requestMsg);
+					NS_LOG_DEBUG("Now a buffered invoked-SMR has been sent... ");
+					// Don't forget to delete the sent invoked-SMR
+					//					m_mapReqMsg.remove(*it);
 				}
 			}
-			else
-			{
-				NS_LOG_DEBUG("This map table is not managed by any xTR application");
-			}
+		}
+		else
+		{
+			NS_LOG_DEBUG("This map table is not managed by any xTR application");
 		}
 	}
 
@@ -306,6 +393,7 @@ namespace ns3
 			if (dbEntry)
 			{
 				dbEntry->InsertLocator(locator);
+				InvalidateSourceRlocCache();
 			}
 			else
 			{
@@ -391,6 +479,60 @@ namespace ns3
 	// associe a cet eid
 	Ptr<Locator> SimpleMapTables::SourceRlocSelection(Address const &srcEid,
 													  Ptr<const Locator> destLocator)
+	{
+		NS_ASSERT(destLocator);
+		Ptr<Locator> srcLocator;
+		const Address &destRloc = destLocator->GetRlocAddress();
+		if (Ipv4Address::IsMatchingType(srcEid) && Ipv4Address::IsMatchingType(destRloc))
+		{
+			uint32_t epoch = MapTables::GetLispOverIp()->GetSourceRlocEpoch();
+			if (epoch != m_sourceRlocEpoch)
+			{
+				// Routes or interfaces changed since the selections were made
+				m_sourceRlocCache.clear();
+				m_sourceRlocEpoch = epoch;
+			}
+			uint64_t key = (static_cast<uint64_t>(Ipv4Address::ConvertFrom(srcEid).Get()) << 32) | Ipv4Address::ConvertFrom(destRloc).Get();
+			std::unordered_map<uint64_t, Ptr<Locator>>::const_iterator it = m_sourceRlocCache.find(key);
+			if (it != m_sourceRlocCache.end())
+			{
+				srcLocator = it->second;
+			}
+			else
+			{
+				srcLocator = FindSourceRloc(srcEid, destLocator);
+				if (srcLocator)
+				{
+					if (m_sourceRlocCache.size() >= SOURCE_RLOC_CACHE_SIZE)
+						m_sourceRlocCache.clear();
+					m_sourceRlocCache.insert(std::make_pair(key, srcLocator));
+				}
+			}
+		}
+		else
+		{
+			srcLocator = FindSourceRloc(srcEid, destLocator);
+		}
+		if (!srcLocator)
+		{
+			return 0;
+		}
+
+		// The metrics can change in place: they are checked for every packet
+		// Doit on verifier si c'est une interface locale alors qu'on sait que l'adresse est celle de l'interface de sortie ?
+		// TODO add it back in condition && srcLocator->GetRlocMetrics ()->IsLocalInterface ()
+		if (srcLocator->GetRlocMetrics()->IsUp() && srcLocator->GetRlocMetrics()->IsLocalInterface() && srcLocator->GetRlocMetrics()->GetPriority() < LispOverIp::LISP_MAX_RLOC_PRIO)
+		{
+			NS_LOG_DEBUG("Selected Source RLOC Address: " << srcLocator->GetRlocAddress());
+			return srcLocator;
+		}
+
+		NS_LOG_DEBUG("No source locator found for source Address");
+		return 0;
+	}
+
+	Ptr<Locator> SimpleMapTables::FindSourceRloc(Address const &srcEid,
+												 Ptr<const Locator> destLocator)
 	{
 		NS_LOG_FUNCTION(this << "source EID: " << srcEid << " Destination RLOC Address: " << destLocator->GetRlocAddress());
 		NS_LOG_DEBUG("Selecting Source Locator for the source eid: " << Ipv4Address::ConvertFrom(srcEid) << " to dest locator " << Ipv4Address::ConvertFrom(destLocator->GetRlocAddress()));
@@ -539,16 +681,13 @@ namespace ns3
 			if (!Ipv6Address::IsMatchingType(srcLocator->GetRlocAddress()))
 				return 0;
 		}
-		// Doit on verifier si c'est une interface locale alors qu'on sait que l'adresse est celle de l'interface de sortie ?
-		// TODO add it back in condition && srcLocator->GetRlocMetrics ()->IsLocalInterface ()
-		if (srcLocator->GetRlocMetrics()->IsUp() && srcLocator->GetRlocMetrics()->IsLocalInterface() && srcLocator->GetRlocMetrics()->GetPriority() < LispOverIp::LISP_MAX_RLOC_PRIO)
-		{
-			NS_LOG_DEBUG("Selected Source RLOC Address: " << srcLocator->GetRlocAddress());
-			return srcLocator;
-		}
+		return srcLocator;
+	}
 
-		NS_LOG_DEBUG("No source locator found for source Address");
-		return 0;
+	void
+	SimpleMapTables::InvalidateSourceRlocCache(void)
+	{
+		m_sourceRlocCache.clear();
 	}
 
 	void SimpleMapTables::GetMapEntryList(MapTables::MapEntryLocation location,
@@ -707,6 +846,11 @@ namespace ns3
 		return m_locators->SelectFirsValidRloc();
 	}
 
+	Ptr<Locator> MapEntryImpl::RlocSelection(uint32_t flowHash) const
+	{
+		return m_rlocTable.Select(m_locators, flowHash);
+	}
+
 	std::string MapEntryImpl::Print(void) const
 	{
 		// std::string mapEntry = "EID prefix:";
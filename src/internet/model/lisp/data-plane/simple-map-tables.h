@@ -25,12 +25,15 @@
 //#include <ns3/ptr.h>
 //#include <list> Do not need. Since "locators-impl.h" has alread included...
 #include <map>
+#include <unordered_map>
 #include <ns3/log.h>
 #include <ns3/system-mutex.h>
 
 #include "ns3/lisp-protocol.h"
 #include "ns3/map-tables.h"
 #include "ns3/locators-impl.h"
+#include "ns3/map-cache-clock.h"
+#include "ns3/rloc-lookup-table.h"
 
 #include "ns3/map-request-msg.h"
 #include "ns3/lisp-etr-itr-application.h"
@@ -139,6 +142,50 @@ namespace ns3
     GetMapEntryList (MapTables::MapEntryLocation location,
 		     std::list<Ptr<MapEntry> > &entryList);
 
+    /**
+     * \brief Bound the number of entries of the LISP cache.
+     * \param capacity The maximum number of entries, 0 for no limit.
+     */
+    void SetCacheCapacity (uint32_t capacity);
+    uint32_t GetCacheCapacity (void) const;
+
+
+  protected:
+    /**
+     * \brief Send the invoked-SMRs buffered by the xTR application that
+     * were waiting for a mapping of eidAddress/mask.
+     */
+    void
+    SendBufferedInvokedSmr (const Address &eidAddress, const Ipv4Mask &mask);
+
+    /**
+     * \brief Account for a hit on a cache entry.
+     * \return entry, or 0 if it has expired (it is then removed).
+     */
+    Ptr<MapEntry>
+    CheckCacheEntry (Ptr<MapEntry> entry);
+    /**
+     * \brief Make room for a new cache entry, evicting one if the cache is
+     * full, and start tracking it.
+     * \param entry The entry about to be added.
+     * \param replaced The entry it replaces (same EID-prefix), if any.
+     */
+    void
+    AdmitCacheEntry (Ptr<MapEntry> entry, Ptr<MapEntry> replaced);
+    /**
+     * \brief Remove exactly the EID-prefix of entry from the cache storage.
+     */
+    virtual void
+    RemoveCacheEntry (Ptr<MapEntry> entry);
+
+    /**
+     * \brief Forget the source RLOCs selected so far, after a change of
+     * the LISP database.
+     */
+    void
+    InvalidateSourceRlocCache (void);
+
+    MapCacheClock m_cacheClock;
 
   private:
     void
@@ -147,10 +194,22 @@ namespace ns3
 		   uint8_t priority, uint8_t weight, MapEntryLocation location,
 		   bool reachable);
 
+    /**
+     * \brief Select the source RLOC towards destLocator, without the
+     * per-packet checks of its metrics.
+     */
+    Ptr<Locator>
+    FindSourceRloc (Address const &srcEid, Ptr<const Locator> destLocator);
+
     SystemMutex m_mutexCache;
     SystemMutex m_mutexDatabase;
     std::map<Ptr<EndpointId>, Ptr<MapEntry>, CompareEndpointId> m_mappingCache;
     std::map<Ptr<EndpointId>, Ptr<MapEntry>, CompareEndpointId> m_mappingDatabase;
+    /// Maximum number of source RLOCs remembered before starting over
+    static const uint32_t SOURCE_RLOC_CACHE_SIZE = 4096;
+    /// Source RLOC selected per (IPv4 source EID, IPv4 destination RLOC)
+    std::unordered_map<uint64_t, Ptr<Locator> > m_sourceRlocCache;
+    uint32_t m_sourceRlocEpoch; //!< LispOverIp::GetSourceRlocEpoch () of m_sourceRlocCache
     Ptr<LispEtrItrApplication> m_xTRApp;
 
 
@@ -176,8 +235,14 @@ namespace ns3
     FindLocator (const Address &address) const;
     Ptr<Locator>
     RlocSelection (void) const;
+    Ptr<Locator>
+    RlocSelection (uint32_t flowHash) const;
     std::string
     Print (void) const;
+
+  private:
+    // Built lazily from m_locators by the data plane
+    mutable RlocLookupTable m_rlocTable;
   };
   std::ostream& operator<< (std::ostream &os, SimpleMapTables const &simpleMapTable);
 } /* namespace ns3 */
@@ -0,0 +1,330 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/trie-map-tables.h"
+
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv6-address.h"
+#include "ns3/assert.h"
+#include "ns3/log.h"
+
+namespace ns3
+{
+
+  NS_LOG_COMPONENT_DEFINE ("TrieMapTables");
+
+  NS_OBJECT_ENSURE_REGISTERED (TrieMapTables);
+
+  TypeId
+  TrieMapTables::GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::TrieMapTables")
+      .SetParent<SimpleMapTables> ()
+      .SetGroupName ("Lisp")
+      .AddConstructor<TrieMapTables> ();
+    return tid;
+  }
+
+  TrieMapTables::TrieMapTables ()
+  {
+    NS_LOG_FUNCTION (this);
+  }
+
+  TrieMapTables::~TrieMapTables ()
+  {
+    NS_LOG_FUNCTION (this);
+  }
+
+  int
+  TrieMapTables::GetNMapEntriesLispDataBase (void)
+  {
+    return m_database.m_ipv4.GetNPrefixes () + m_database.m_ipv6.GetNPrefixes ();
+  }
+
+  int
+  TrieMapTables::GetNMapEntriesLispCache (void)
+  {
+    return m_cache.m_ipv4.GetNPrefixes () + m_cache.m_ipv6.GetNPrefixes ();
+  }
+
+  int
+  TrieMapTables::GetNMapEntries (void)
+  {
+    return GetNMapEntriesLispDataBase () + GetNMapEntriesLispCache ();
+  }
+
+  void
+  TrieMapTables::Print (std::ostream &os) const
+  {
+    NS_LOG_FUNCTION (this);
+    os << "LISP Database:" << std::endl;
+    PrintTable (m_database, os);
+    os << "LISP Cache:" << std::endl;
+    PrintTable (m_cache, os);
+  }
+
+  void
+  TrieMapTables::PrintTable (const Table &table, std::ostream &os)
+  {
+    for (uint32_t i = 0; i < table.m_entries.size (); i++)
+      {
+        if (table.m_entries[i])
+          {
+            os << table.m_eids[i]->Print () << std::endl;
+            os << table.m_entries[i]->Print () << std::endl;
+          }
+      }
+  }
+
+  TrieMapTables::Table &
+  TrieMapTables::GetTable (MapEntryLocation location)
+  {
+    return location == IN_DATABASE ? m_database : m_cache;
+  }
+
+  uint32_t
+  TrieMapTables::Find (const Table &table, const Address &eidAddress)
+  {
+    if (Ipv4Address::IsMatchingType (eidAddress))
+      {
+        return table.m_ipv4.Lookup (Ipv4Address::ConvertFrom (eidAddress).Get ());
+      }
+    else if (Ipv6Address::IsMatchingType (eidAddress))
+      {
+        uint8_t buf[16];
+        Ipv6Address::ConvertFrom (eidAddress).GetBytes (buf);
+        return table.m_ipv6.Lookup (buf);
+      }
+    NS_LOG_WARN ("Unknown EID address type");
+    return Ipv4LpmTrie::NO_VALUE;
+  }
+
+  uint32_t
+  TrieMapTables::FindExact (const Table &table, Ptr<const EndpointId> eid)
+  {
+    if (eid->IsIpv4 ())
+      {
+        return table.m_ipv4.ExactLookup (
+            Ipv4Address::ConvertFrom (eid->GetEidAddress ()).Get (),
+            eid->GetIpv4Mask ().GetPrefixLength ());
+      }
+    uint8_t buf[16];
+    Ipv6Address::ConvertFrom (eid->GetEidAddress ()).GetBytes (buf);
+    return table.m_ipv6.ExactLookup (buf, eid->GetIpv6Prefix ().GetPrefixLength ());
+  }
+
+  void
+  TrieMapTables::Set (Table &table, Ptr<EndpointId> eid, Ptr<MapEntry> mapEntry)
+  {
+    uint32_t index = FindExact (table, eid);
+    if (index != Ipv4LpmTrie::NO_VALUE)
+      {
+        // Same EID-prefix: the new entry replaces the old one in place
+        table.m_entries[index] = mapEntry;
+        table.m_eids[index] = eid;
+        return;
+      }
+
+    if (!table.m_freeEntries.empty ())
+      {
+        index = table.m_freeEntries.back ();
+        table.m_freeEntries.pop_back ();
+        table.m_entries[index] = mapEntry;
+        table.m_eids[index] = eid;
+      }
+    else
+      {
+        index = table.m_entries.size ();
+        table.m_entries.push_back (mapEntry);
+        table.m_eids.push_back (eid);
+      }
+
+    if (eid->IsIpv4 ())
+      {
+        table.m_ipv4.Insert (Ipv4Address::ConvertFrom (eid->GetEidAddress ()).Get (),
+                             eid->GetIpv4Mask ().GetPrefixLength (), index);
+      }
+    else
+      {
+        uint8_t buf[16];
+        Ipv6Address::ConvertFrom (eid->GetEidAddress ()).GetBytes (buf);
+        table.m_ipv6.Insert (buf, eid->GetIpv6Prefix ().GetPrefixLength (), index);
+      }
+  }
+
+  Ptr<MapEntry>
+  TrieMapTables::Delete (Table &table, uint32_t index)
+  {
+    Ptr<EndpointId> eid = table.m_eids[index];
+    Ptr<MapEntry> entry = table.m_entries[index];
+    if (eid->IsIpv4 ())
+      {
+        table.m_ipv4.Remove (Ipv4Address::ConvertFrom (eid->GetEidAddress ()).Get (),
+                             eid->GetIpv4Mask ().GetPrefixLength ());
+      }
+    else
+      {
+        uint8_t buf[16];
+        Ipv6Address::ConvertFrom (eid->GetEidAddress ()).GetBytes (buf);
+        table.m_ipv6.Remove (buf, eid->GetIpv6Prefix ().GetPrefixLength ());
+      }
+    table.m_entries[index] = 0;
+    table.m_eids[index] = 0;
+    table.m_freeEntries.push_back (index);
+    return entry;
+  }
+
+  void
+  TrieMapTables::Clear (Table &table)
+  {
+    table.m_ipv4.Clear ();
+    table.m_ipv6.Clear ();
+    table.m_entries.clear ();
+    table.m_eids.clear ();
+    table.m_freeEntries.clear ();
+  }
+
+  Ptr<MapEntry>
+  TrieMapTables::DatabaseLookup (const Address &eidAddress)
+  {
+    NS_LOG_FUNCTION (this);
+    uint32_t index = Find (m_database, eidAddress);
+    if (index != Ipv4LpmTrie::NO_VALUE)
+      {
+        MapTables::DbHit ();
+        return m_database.m_entries[index];
+      }
+    MapTables::DbMiss ();
+    return 0;
+  }
+
+  Ptr<MapEntry>
+  TrieMapTables::CacheLookup (const Address &eidAddress)
+  {
+    NS_LOG_FUNCTION (this);
+    uint32_t index = Find (m_cache, eidAddress);
+    if (index != Ipv4LpmTrie::NO_VALUE && CheckCacheEntry (m_cache.m_entries[index]))
+      {
+        MapTables::CacheHit ();
+        return m_cache.m_entries[index];
+      }
+    MapTables::CacheMiss ();
+    return 0;
+  }
+
+  void
+  TrieMapTables::DatabaseDelete (const Address &eidAddress)
+  {
+    uint32_t index = Find (m_database, eidAddress);
+    if (index != Ipv4LpmTrie::NO_VALUE)
+      {
+        Delete (m_database, index);
+        InvalidateSourceRlocCache ();
+      }
+  }
+
+  void
+  TrieMapTables::CacheDelete (const Address &eidAddress)
+  {
+    uint32_t index = Find (m_cache, eidAddress);
+    if (index != Ipv4LpmTrie::NO_VALUE)
+      {
+        m_cacheClock.Remove (Delete (m_cache, index));
+      }
+  }
+
+  void
+  TrieMapTables::WipeCache (void)
+  {
+    Clear (m_cache);
+    m_cacheClock.Clear ();
+  }
+
+  void
+  TrieMapTables::RemoveCacheEntry (Ptr<MapEntry> entry)
+  {
+    uint32_t index = FindExact (m_cache, entry->GetEidPrefix ());
+    if (index != Ipv4LpmTrie::NO_VALUE)
+      {
+        Delete (m_cache, index);
+      }
+  }
+
+  void
+  TrieMapTables::SetEntry (const Address &eidAddress, const Ipv4Mask &mask,
+                           Ptr<MapEntry> mapEntry, MapEntryLocation location)
+  {
+    NS_ASSERT (Ipv4Address::IsMatchingType (eidAddress));
+    Ptr<EndpointId> eid = Create<EndpointId> (
+        static_cast<Address> (Ipv4Address::ConvertFrom (eidAddress).CombineMask (mask)),
+        mask);
+    mapEntry->SetEidPrefix (eid);
+    if (location == IN_CACHE)
+      {
+        uint32_t index = FindExact (m_cache, eid);
+        AdmitCacheEntry (mapEntry, index == Ipv4LpmTrie::NO_VALUE ? 0 : m_cache.m_entries[index]);
+      }
+    else
+      {
+        InvalidateSourceRlocCache ();
+      }
+    Set (GetTable (location), eid, mapEntry);
+    NS_LOG_DEBUG ("Set a Mapping Entry for EID:" << eid->Print ());
+
+    if (location == IN_CACHE)
+      {
+        SendBufferedInvokedSmr (eidAddress, mask);
+      }
+  }
+
+  void
+  TrieMapTables::SetEntry (const Address &eidAddress, const Ipv6Prefix &prefix,
+                           Ptr<MapEntry> mapEntry, MapEntryLocation location)
+  {
+    NS_ASSERT (Ipv6Address::IsMatchingType (eidAddress));
+    Ptr<EndpointId> eid = Create<EndpointId> (
+        static_cast<Address> (Ipv6Address::ConvertFrom (eidAddress).CombinePrefix (prefix)),
+        prefix);
+    mapEntry->SetEidPrefix (eid);
+    if (location == IN_CACHE)
+      {
+        uint32_t index = FindExact (m_cache, eid);
+        AdmitCacheEntry (mapEntry, index == Ipv4LpmTrie::NO_VALUE ? 0 : m_cache.m_entries[index]);
+      }
+    else
+      {
+        InvalidateSourceRlocCache ();
+      }
+    Set (GetTable (location), eid, mapEntry);
+    NS_LOG_DEBUG ("Set a Mapping Entry for EID:" << eid->Print ());
+  }
+
+  void
+  TrieMapTables::GetMapEntryList (MapTables::MapEntryLocation location,
+                                  std::list<Ptr<MapEntry> > &entryList)
+  {
+    Table &table = GetTable (location);
+    for (uint32_t i = 0; i < table.m_entries.size (); i++)
+      {
+        if (table.m_entries[i])
+          {
+            table.m_entries[i]->SetEidPrefix (table.m_eids[i]);
+            entryList.push_back (table.m_entries[i]);
+          }
+      }
+  }
+
+} /* namespace ns3 */
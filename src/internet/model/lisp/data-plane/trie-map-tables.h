@@ -0,0 +1,117 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef TRIE_MAP_TABLES_H_
+#define TRIE_MAP_TABLES_H_
+
+#include <vector>
+
+#include "ns3/simple-map-tables.h"
+#include "ns3/lpm-trie.h"
+
+namespace ns3
+{
+
+  /**
+   * \brief MapTables whose LISP database and cache are longest-prefix-match
+   * tries.
+   *
+   * SimpleMapTables keeps its entries in a std::map ordered by
+   * CompareEndpointId and allocates an EndpointId for each lookup. Here the
+   * IPv4 EID-prefixes are kept in an Ipv4LpmTrie and the IPv6 ones in an
+   * Ipv6LpmTrie, whose values index a vector of map entries, so that a
+   * lookup on the data plane path is bounded and never allocates.
+   *
+   * Locator insertion, RLOC selection and the check of received packets are
+   * inherited from SimpleMapTables.
+   */
+  class TrieMapTables : public SimpleMapTables
+  {
+  public:
+    static TypeId
+    GetTypeId (void);
+    TrieMapTables ();
+    virtual
+    ~TrieMapTables ();
+
+    int
+    GetNMapEntries (void);
+    int
+    GetNMapEntriesLispDataBase (void);
+    int
+    GetNMapEntriesLispCache (void);
+
+    void Print (std::ostream &os) const;
+
+    Ptr<MapEntry>
+    DatabaseLookup (const Address &eidAddress);
+
+    Ptr<MapEntry>
+    CacheLookup (const Address &eidAddress);
+
+    void DatabaseDelete (const Address &eidAddress);
+
+    void CacheDelete (const Address &eidAddress);
+
+    void WipeCache (void);
+
+    void
+    SetEntry (const Address &eid, const Ipv4Mask &mask, Ptr<MapEntry> mapEntry,
+              MapEntryLocation location);
+    void
+    SetEntry (const Address &eid, const Ipv6Prefix &prefix,
+              Ptr<MapEntry> mapEntry, MapEntryLocation location);
+
+    void
+    GetMapEntryList (MapTables::MapEntryLocation location,
+                     std::list<Ptr<MapEntry> > &entryList);
+
+  protected:
+    void
+    RemoveCacheEntry (Ptr<MapEntry> entry);
+
+  private:
+    /// Either the LISP database or the LISP cache.
+    struct Table
+    {
+      Ipv4LpmTrie m_ipv4;
+      Ipv6LpmTrie m_ipv6;
+      std::vector<Ptr<MapEntry> > m_entries; //!< Indexed by the trie values.
+      std::vector<Ptr<EndpointId> > m_eids;  //!< EID-prefix of each entry.
+      std::vector<uint32_t> m_freeEntries;
+    };
+
+    Table &
+    GetTable (MapEntryLocation location);
+    static uint32_t
+    Find (const Table &table, const Address &eidAddress);
+    static uint32_t
+    FindExact (const Table &table, Ptr<const EndpointId> eid);
+    static void
+    Set (Table &table, Ptr<EndpointId> eid, Ptr<MapEntry> mapEntry);
+    static Ptr<MapEntry>
+    Delete (Table &table, uint32_t index);
+    static void
+    Clear (Table &table);
+    static void
+    PrintTable (const Table &table, std::ostream &os);
+
+    Table m_database;
+    Table m_cache;
+  };
+
+} /* namespace ns3 */
+
+#endif /* TRIE_MAP_TABLES_H_ */
@@ -186,7 +186,7 @@ std::ostream& operator << (std::ostream& os, NetfilterConntrackTuple const& tupl
 #define JHASH_GOLDEN_RATIO  0x9e3779b9
 
 void
-JHashMix (uint32_t a, uint32_t b, uint32_t c)
+JHashMix (uint32_t &a, uint32_t &b, uint32_t &c)
 {
   a -= b;
   a -= c;
@@ -254,19 +254,21 @@ JHash2 (const uint32_t *k, uint32_t length, uint32_t initval)
 size_t
 ConntrackTupleHash::operator() (const NetfilterConntrackTuple &x) const
 {
-  uint32_t n;
   uint32_t h;
   uint16_t rnd = 2;
-  uint32_t size = 12;
 
-  n = (sizeof (x.GetSource ()) + sizeof (x.GetSourcePort ()) +
-       sizeof (x.GetDestination ()) + sizeof (x.GetDestinationPort ())) / sizeof (uint32_t);
+  // Only the fields compared by operator==, without the padding of the
+  // tuple; the whole hash is used, the container picks the bucket
+  uint32_t k[3];
+  k[0] = x.GetSource ().Get ();
+  k[1] = ((uint32_t) x.GetSourcePort () << 16) | x.GetDestinationPort ();
+  k[2] = x.GetDestination ().Get ();
 
-  h = JHash2 ((uint32_t*)(x.ToString ()), n, rnd ^ (((x.GetDestinationPort ()) << 16) | x.GetDestinationProtocol ()));
+  h = JHash2 (k, 3, rnd);
 
-  NS_LOG_DEBUG ("Hashing ==> Tuple " <<  "( " << x.GetSource () << "," << x.GetSourcePort () << "," << x.GetDestination () << "," << x.GetDestinationPort () << "," << (int)x.GetDirection () << ")" << " Hash: " << (((uint64_t)h * size) >> 32));
+  NS_LOG_DEBUG ("Hashing ==> Tuple " <<  "( " << x.GetSource () << "," << x.GetSourcePort () << "," << x.GetDestination () << "," << x.GetDestinationPort () << "," << (int)x.GetDirection () << ")" << " Hash: " << h);
 
-  return ((uint64_t)h * size) >> 32;
+  return h;
 }
 
 }
@@ -19,6 +19,7 @@
 #include "ns3/test.h"
 #include "ns3/ipv4-address-generator.h"
 #include "ns3/ipv4-address-helper.h"
+#include "ns3/ipv4-interface-address.h"
 #include "ns3/simulator.h"
 
 using namespace ns3;
@@ -279,6 +280,55 @@ IpAddressHelperTestCasev4::DoTeardown (void)
 }
 
 
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief IPv4 /31 point-to-point subnets (RFC 3021) Test
+ */
+class PointToPointSubnetHelperTestCase : public TestCase
+{
+public:
+  PointToPointSubnetHelperTestCase ();
+  virtual void DoRun (void);
+  virtual void DoTeardown (void);
+};
+
+PointToPointSubnetHelperTestCase::PointToPointSubnetHelperTestCase ()
+  : TestCase ("Make sure both addresses of a 31-bit prefix are hosts")
+{
+}
+
+void
+PointToPointSubnetHelperTestCase::DoRun (void)
+{
+  Ipv4Address address;
+  Ipv4AddressHelper h;
+
+  h.SetBase ("10.0.0.4", "255.255.255.254", "0.0.0.0");
+  address = h.NewAddress ();
+  NS_TEST_EXPECT_MSG_EQ (address, Ipv4Address ("10.0.0.4"), "401");
+  address = h.NewAddress ();
+  NS_TEST_EXPECT_MSG_EQ (address, Ipv4Address ("10.0.0.5"), "402");
+  Ipv4Address network = h.NewNetwork ();
+  NS_TEST_EXPECT_MSG_EQ (network, Ipv4Address ("10.0.0.6"), "403");
+  address = h.NewAddress ();
+  NS_TEST_EXPECT_MSG_EQ (address, Ipv4Address ("10.0.0.6"), "404");
+
+  Ipv4Mask mask ("/31");
+  NS_TEST_EXPECT_MSG_EQ (Ipv4Address ("10.0.0.5").IsSubnetDirectedBroadcast (mask), false, "405");
+  NS_TEST_EXPECT_MSG_EQ (Ipv4Address ("10.0.0.7").IsSubnetDirectedBroadcast (Ipv4Mask ("/30")), true, "406");
+  Ipv4InterfaceAddress ifAddr (Ipv4Address ("10.0.0.4"), mask);
+  NS_TEST_EXPECT_MSG_EQ (ifAddr.GetBroadcast (), Ipv4Address::GetBroadcast (), "407");
+}
+
+void
+PointToPointSubnetHelperTestCase::DoTeardown (void)
+{
+  Ipv4AddressGenerator::Reset ();
+  Simulator::Destroy ();
+}
+
 /**
  * \ingroup internet-test
  * \ingroup tests
@@ -299,6 +349,7 @@ Ipv4AddressHelperTestSuite::Ipv4AddressHelperTestSuite ()
   AddTestCase (new AddressAllocatorHelperTestCase (), TestCase::QUICK);
   AddTestCase (new ResetAllocatorHelperTestCase (), TestCase::QUICK);
   AddTestCase (new IpAddressHelperTestCasev4 (), TestCase::QUICK);
+  AddTestCase (new PointToPointSubnetHelperTestCase (), TestCase::QUICK);
 }
 
 static Ipv4AddressHelperTestSuite g_ipv4AddressHelperTestSuite; //!< Static variable for test initialization
@@ -426,6 +426,166 @@ NatDynamicDrop::DoRun (void)
 
 // ===================================================================================
 
+class NatDynamicTimeout : public TestCase
+{
+public:
+  NatDynamicTimeout ();
+  virtual ~NatDynamicTimeout ();
+private:
+  virtual void DoRun (void);
+  virtual void DoSetup (void);
+
+  TestVectors<PacketTuple> m_eventsDrop;
+  TestVectors<PacketTuple> m_eventsSend;
+
+  std::vector<PacketTuple> m_expectedEventsSend;
+
+  void DropSink (const Ipv4Header & ipHeader, Ptr<const Packet> p, Ipv4L3Protocol::DropReason reason, Ptr<Ipv4> ipv4, uint32_t interface);
+  void TxSink (Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint32_t interface);
+
+};
+
+NatDynamicTimeout::NatDynamicTimeout ()
+  : TestCase ("Check dynamic NAT: expiry of idle translations")
+{
+}
+
+NatDynamicTimeout::~NatDynamicTimeout ()
+{
+}
+
+void
+NatDynamicTimeout::DropSink (const Ipv4Header & ipHeader, Ptr<const Packet> p, Ipv4L3Protocol::DropReason reason, Ptr<Ipv4> ipv4, uint32_t interface)
+{
+  if (reason == Ipv4L3Protocol::DROP_NETFILTER)
+  {
+    m_eventsDrop.Add (ExtractPacketTuple (ipHeader, p->Copy ()));
+  }
+}
+
+void
+NatDynamicTimeout::TxSink (Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint32_t interface)
+{
+  Ptr<Packet> packetCopy = p->Copy ();
+  Ipv4Header ipHeader;
+  packetCopy->RemoveHeader (ipHeader);
+  m_eventsSend.Add (ExtractPacketTuple (ipHeader, packetCopy));
+}
+
+void
+NatDynamicTimeout::DoSetup (void)
+{
+  // The first translation expires between the two requests: the second
+  // request gets the next port of the pool
+  m_expectedEventsSend.push_back (PacketTuple (Ipv4Address ("192.168.1.2"), Ipv4Address ("192.168.1.1"), 49163, 9));
+  m_expectedEventsSend.push_back (PacketTuple (Ipv4Address ("192.168.1.1"), Ipv4Address ("10.1.2.2"), 9, DONT_CARE));
+  m_expectedEventsSend.push_back (PacketTuple (Ipv4Address ("192.168.1.2"), Ipv4Address ("192.168.1.1"), 49164, 9));
+  m_expectedEventsSend.push_back (PacketTuple (Ipv4Address ("192.168.1.1"), Ipv4Address ("10.1.2.2"), 9, DONT_CARE));
+}
+
+void
+NatDynamicTimeout::DoRun (void)
+{
+  // Topology: n0 <----> n1 <-----> n2
+  //               Out        NATed
+
+
+  /*--------------------*\
+           SETUP
+  \*--------------------*/
+  NodeContainer nodes;
+  nodes.Create (3);
+
+  NodeContainer n0n1 = NodeContainer (nodes.Get (0), nodes.Get (1));
+  NodeContainer n1n2 = NodeContainer (nodes.Get (1), nodes.Get (2));
+
+  InternetStackHelper internet;
+  internet.Install(nodes);
+
+  PointToPointHelper p2p;
+  p2p.SetDeviceAttribute ("DataRate", StringValue ("5Mbps"));
+  p2p.SetChannelAttribute ("Delay", StringValue ("2ms"));
+
+  NetDeviceContainer d0d1 = p2p.Install (n0n1);
+  NetDeviceContainer d1d2 = p2p.Install (n1n2);
+
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase ("192.168.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer i0i1 = ipv4.Assign (d0d1);
+  ipv4.SetBase ("10.1.2.0", "255.255.255.0");
+  Ipv4InterfaceContainer i1i2 = ipv4.Assign (d1d2);
+
+  Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+
+  /* NAT */
+  Ipv4NatHelper natHelper;
+  Ptr<Ipv4Nat> nat = natHelper.Install (nodes.Get (1));
+  nat->SetAttribute ("UdpIdleTimeout", TimeValue (Seconds (1.0)));
+
+  nat->SetInside (2);
+  nat->SetOutside (1);
+  nat->AddAddressPool (Ipv4Address ("192.168.1.2"), Ipv4Mask ("255.255.255.255"));
+  nat->AddPortPool (49163, 49173);
+  Ipv4DynamicNatRule rule (Ipv4Address ("10.1.2.0"), Ipv4Mask ("255.255.255.0"));
+  nat->AddDynamicRule (rule);
+
+  /* Applications */
+  UdpEchoServerHelper echoServer (9);
+
+  ApplicationContainer serverApps = echoServer.Install (nodes.Get (0));
+  serverApps.Start (Seconds (1.0));
+  serverApps.Stop (Seconds (10.0));
+
+  UdpEchoClientHelper echoClient (i0i1.GetAddress (0), 9);
+  echoClient.SetAttribute ("MaxPackets", UintegerValue (2));
+  echoClient.SetAttribute ("Interval", TimeValue (Seconds (3.0)));
+  echoClient.SetAttribute ("PacketSize", UintegerValue (1024));
+
+  ApplicationContainer clientApps = echoClient.Install (nodes.Get (2));
+  clientApps.Start (Seconds (2.0));
+  clientApps.Stop (Seconds (10.0));
+
+  /* Trace sinks */
+  Ptr<Ipv4L3Protocol> ipv4L3 = nodes.Get (1)->GetObject<Ipv4L3Protocol> ();
+  ipv4L3->TraceConnectWithoutContext ("Drop", MakeCallback (&NatDynamicTimeout::DropSink, this));
+  ipv4L3->TraceConnectWithoutContext ("Tx", MakeCallback (&NatDynamicTimeout::TxSink, this));
+
+
+  /* SIMULATION */
+  Simulator::Run ();
+
+  /*--------------------*\
+           CHECKS
+  \*--------------------*/
+  /* Only the second translation is left, expired ones are removed on the next packet */
+  NS_TEST_ASSERT_MSG_EQ (nat->GetNDynamicTuples (), 1, "Unexpected number of translations");
+  NS_TEST_ASSERT_MSG_EQ (nat->GetDynamicTuple (0).GetGlobalPort (), 49164, "Unexpected port of the translation");
+
+  Simulator::Destroy ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_eventsDrop.GetN (), 0, "Unexpected drop of packet");
+  NS_TEST_ASSERT_MSG_EQ (m_eventsSend.GetN (), m_expectedEventsSend.size (), "Unexpected number of Send events");
+
+  for (uint32_t i = 0; i < m_expectedEventsSend.size (); ++i)
+  {
+    PacketTuple pt = m_eventsSend.Get (i);
+    PacketTuple expected_pt = m_expectedEventsSend.at (i);
+
+    NS_TEST_ASSERT_MSG_EQ (pt.IsEqual(expected_pt), true, "Unexpected Send event: " << i <<": Got "
+      << Ipv4Address::ConvertFrom(pt.m_src) <<" "
+      << Ipv4Address::ConvertFrom(pt.m_dest) << " "
+      << pt.m_srcPort << " "
+      << pt.m_destPort <<". Expected "
+      << Ipv4Address::ConvertFrom(expected_pt.m_src) << " "
+      << Ipv4Address::ConvertFrom(expected_pt.m_dest) << " "
+      << expected_pt.m_srcPort << " "
+      << expected_pt.m_destPort);
+  }
+
+}
+
+// ===================================================================================
+
 class Ipv4NatTestSuite : public TestSuite
 {
 public:
@@ -437,6 +597,7 @@ Ipv4NatTestSuite::Ipv4NatTestSuite ()
 {
   AddTestCase (new NatDynamic, TestCase::QUICK);
   AddTestCase (new NatDynamicDrop, TestCase::QUICK);
+  AddTestCase (new NatDynamicTimeout, TestCase::QUICK);
 }
 
 static Ipv4NatTestSuite ipv4NatTestSuite;
@@ -0,0 +1,294 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/map-request-msg.h"
+#include "ns3/map-reply-msg.h"
+#include "ns3/map-register-msg.h"
+#include "ns3/map-notify-msg.h"
+#include "ns3/info-request-msg.h"
+#include "ns3/locators-impl.h"
+#include "ns3/rloc-metrics.h"
+
+#include "ns3/test.h"
+
+using namespace ns3;
+
+// ================================================================================================
+
+class MultiRecordMapRequestTestCase : public TestCase
+{
+public:
+  MultiRecordMapRequestTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+MultiRecordMapRequestTestCase::MultiRecordMapRequestTestCase ()
+  : TestCase ("A Map-Request carries all its records")
+{
+}
+
+void
+MultiRecordMapRequestTestCase::DoRun (void)
+{
+  Ptr<MapRequestMsg> request = Create<MapRequestMsg> ();
+  request->SetNonce (0x0123456789abcdefULL);
+  request->SetSourceEidAddr (Ipv4Address ("10.1.1.1"));
+  request->SetItrRlocAddrIp (Ipv4Address ("192.168.1.1"));
+  request->SetMapRequestRecord (Create<MapRequestRecord> (Ipv4Address ("10.1.2.1"), 32));
+  request->AddMapRequestRecord (Create<MapRequestRecord> (Ipv4Address ("10.1.3.1"), 32));
+  request->AddMapRequestRecord (Create<MapRequestRecord> (Ipv6Address ("2001:db8::1"), 128));
+
+  std::vector<uint8_t> buf (request->GetSerializedSize ());
+  request->Serialize (&buf[0]);
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) buf[3], 3u, "record count");
+
+  Ptr<MapRequestMsg> decoded = MapRequestMsg::Deserialize (&buf[0]);
+  NS_TEST_ASSERT_MSG_EQ (decoded->GetNonce (), 0x0123456789abcdefULL, "nonce");
+  NS_TEST_ASSERT_MSG_EQ (Ipv4Address::ConvertFrom (decoded->GetItrRlocAddrIp ()), Ipv4Address ("192.168.1.1"), "ITR-RLOC");
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) decoded->GetNMapRequestRecords (), 3u, "all the records are decoded");
+  NS_TEST_ASSERT_MSG_EQ (Ipv4Address::ConvertFrom (decoded->GetMapRequestRecord (1)->GetEidPrefix ()),
+                         Ipv4Address ("10.1.3.1"), "second record");
+  NS_TEST_ASSERT_MSG_EQ (Ipv6Address::ConvertFrom (decoded->GetMapRequestRecord (2)->GetEidPrefix ()),
+                         Ipv6Address ("2001:db8::1"), "ipv6 record");
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) decoded->GetMapRequestRecord (2)->GetMaskLength (), 128u, "ipv6 mask");
+  NS_TEST_ASSERT_MSG_EQ (decoded->GetMapRequestRecord (), decoded->GetMapRequestRecord (0), "first record");
+
+  // Without ITR-RLOC, the records still follow the two bytes of AFI 0
+  request->SetItrRlocAddrIp (Ipv4Address ());
+  buf.assign (request->GetSerializedSize (), 0);
+  request->Serialize (&buf[0]);
+  decoded = MapRequestMsg::Deserialize (&buf[0]);
+  NS_TEST_ASSERT_MSG_EQ (Ipv4Address::ConvertFrom (decoded->GetMapRequestRecord (0)->GetEidPrefix ()),
+                         Ipv4Address ("10.1.2.1"), "first record without ITR-RLOC");
+}
+
+// ================================================================================================
+
+class MultiRecordMapReplyTestCase : public TestCase
+{
+public:
+  MultiRecordMapReplyTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+MultiRecordMapReplyTestCase::MultiRecordMapReplyTestCase ()
+  : TestCase ("A Map-Reply carries positive and negative records")
+{
+}
+
+static Ptr<MapReplyRecord>
+CreateReplyRecord (const char *eid, uint32_t nLocators)
+{
+  Ptr<MapReplyRecord> record = Create<MapReplyRecord> ();
+  record->SetRecordTtl (MapReplyRecord::m_defaultRecordTtl);
+  record->SetEidPrefix (Ipv4Address (eid));
+  record->SetEidMaskLength (24);
+  Ptr<Locators> locators;
+  if (nLocators)
+    {
+      locators = Create<LocatorsImpl> ();
+      for (uint32_t i = 0; i < nLocators; i++)
+        {
+          Ptr<Locator> locator = Create<Locator> (Ipv4Address (0xc0a80001 + i));
+          locator->SetRlocMetrics (Create<RlocMetrics> (1, 50, true));
+          locators->InsertLocator (locator);
+        }
+    }
+  record->SetLocators (locators);
+  return record;
+}
+
+void
+MultiRecordMapReplyTestCase::DoRun (void)
+{
+  Ptr<MapReplyMsg> reply = Create<MapReplyMsg> ();
+  reply->SetNonce (42);
+  reply->AddRecord (CreateReplyRecord ("10.1.2.0", 2));
+  reply->AddRecord (CreateReplyRecord ("10.1.3.0", 0));
+  reply->AddRecord (CreateReplyRecord ("10.1.4.0", 30));
+
+  std::vector<uint8_t> buf (reply->GetSerializedSize ());
+  NS_TEST_ASSERT_MSG_GT (buf.size (), 256u, "larger than the former fixed buffer");
+  reply->Serialize (&buf[0]);
+
+  Ptr<MapReplyMsg> decoded = MapReplyMsg::Deserialize (&buf[0]);
+  NS_TEST_ASSERT_MSG_EQ (decoded->GetNonce (), 42u, "nonce");
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) decoded->GetNRecords (), 3u, "all the records are decoded");
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) decoded->GetRecord (0)->GetLocatorCount (), 2u, "positive record");
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) decoded->GetRecord (1)->GetLocatorCount (), 0u, "negative record");
+  NS_TEST_ASSERT_MSG_EQ (Ipv4Address::ConvertFrom (decoded->GetRecord (1)->GetEidPrefix ()),
+                         Ipv4Address ("10.1.3.0"), "negative record EID");
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) decoded->GetRecord (2)->GetLocatorCount (), 30u, "many locators");
+  NS_TEST_ASSERT_MSG_EQ (Ipv4Address::ConvertFrom (decoded->GetRecord (2)->GetLocators ()->GetLocatorByIdx (29)->GetRlocAddress ()),
+                         Ipv4Address (0xc0a80001 + 29), "last locator");
+}
+
+// ================================================================================================
+
+class MultiRecordMapRegisterTestCase : public TestCase
+{
+public:
+  MultiRecordMapRegisterTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+MultiRecordMapRegisterTestCase::MultiRecordMapRegisterTestCase ()
+  : TestCase ("A Map-Register and its Map-Notify carry several records")
+{
+}
+
+void
+MultiRecordMapRegisterTestCase::DoRun (void)
+{
+  Ptr<MapRegisterMsg> mapRegister = Create<MapRegisterMsg> ();
+  mapRegister->SetM (1);
+  mapRegister->SetAuthDataLen (4);
+  mapRegister->AddRecord (CreateReplyRecord ("10.1.2.0", 1));
+  mapRegister->AddRecord (CreateReplyRecord ("10.1.3.0", 3));
+  mapRegister->AddRecord (CreateReplyRecord ("10.1.4.0", 2));
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) mapRegister->GetRecordCount (), 3u, "record count follows the records");
+
+  std::vector<uint8_t> buf (mapRegister->GetSerializedSize ());
+  mapRegister->Serialize (&buf[0]);
+  Ptr<MapRegisterMsg> decoded = MapRegisterMsg::Deserialize (&buf[0]);
+  NS_TEST_ASSERT_MSG_EQ (decoded->GetM (), 1, "M bit");
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) decoded->GetNRecords (), 3u, "all the records are decoded");
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) decoded->GetRecord (1)->GetLocatorCount (), 3u, "second record");
+  NS_TEST_ASSERT_MSG_EQ (Ipv4Address::ConvertFrom (decoded->GetRecord (2)->GetEidPrefix ()),
+                         Ipv4Address ("10.1.4.0"), "last record EID");
+  NS_TEST_ASSERT_MSG_EQ (decoded->GetSerializedSize (), mapRegister->GetSerializedSize (), "same size once decoded");
+
+  Ptr<MapNotifyMsg> mapNotify = Create<MapNotifyMsg> ();
+  mapNotify->SetAuthDataLen (4);
+  for (uint8_t i = 0; i < decoded->GetNRecords (); i++)
+    {
+      mapNotify->AddRecord (decoded->GetRecord (i));
+    }
+  buf.assign (mapNotify->GetSerializedSize (), 0);
+  mapNotify->Serialize (&buf[0]);
+  Ptr<MapNotifyMsg> notified = MapNotifyMsg::Deserialize (&buf[0]);
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) notified->GetNRecords (), 3u, "all the records are acknowledged");
+  NS_TEST_ASSERT_MSG_EQ (Ipv4Address::ConvertFrom (notified->GetRecord (2)->GetEidPrefix ()),
+                         Ipv4Address ("10.1.4.0"), "last acknowledged EID");
+}
+
+// ================================================================================================
+
+class ExactSizeTestCase : public TestCase
+{
+public:
+  ExactSizeTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void CheckExactSize (Ptr<const LispControlMsg> msg, std::string name);
+};
+
+ExactSizeTestCase::ExactSizeTestCase ()
+  : TestCase ("Control messages are serialized at their exact size")
+{
+}
+
+void
+ExactSizeTestCase::CheckExactSize (Ptr<const LispControlMsg> msg, std::string name)
+{
+  // Serialize must neither write beyond GetSerializedSize () nor leave bytes unwritten at its end
+  const uint32_t guard = 16;
+  uint32_t size = msg->GetSerializedSize ();
+  std::vector<uint8_t> buf (size + guard, 0xee);
+  msg->Serialize (&buf[0]);
+  for (uint32_t i = size; i < size + guard; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ ((uint32_t) buf[i], 0xeeu, name << " written beyond its size");
+    }
+  NS_TEST_ASSERT_MSG_EQ (msg->ToPacket ()->GetSize (), size, name << " packet size");
+}
+
+void
+ExactSizeTestCase::DoRun (void)
+{
+  Ptr<MapRegisterMsg> mapRegister = Create<MapRegisterMsg> ();
+  mapRegister->SetAuthDataLen (4);
+  mapRegister->SetRecordCount (1);
+  mapRegister->SetRecord (CreateReplyRecord ("10.1.2.0", 20));
+  CheckExactSize (mapRegister, "Map-Register");
+  NS_TEST_ASSERT_MSG_EQ (mapRegister->GetSerializedSize (), 16u + 4u + 16u + 20u * 12u, "Map-Register size");
+  std::vector<uint8_t> buf (mapRegister->GetSerializedSize ());
+  mapRegister->Serialize (&buf[0]);
+  Ptr<MapRegisterMsg> decoded = MapRegisterMsg::Deserialize (&buf[0]);
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) decoded->GetRecord ()->GetLocatorCount (), 20u,
+                         "no Map-Register locator lost to a fixed buffer");
+
+  Ptr<MapNotifyMsg> mapNotify = Create<MapNotifyMsg> ();
+  mapNotify->SetAuthDataLen (4);
+  mapNotify->SetRecordCount (1);
+  mapNotify->SetRecord (CreateReplyRecord ("10.1.2.0", 2));
+  CheckExactSize (mapNotify, "Map-Notify");
+
+  Ptr<InfoRequestMsg> infoRequest = Create<InfoRequestMsg> ();
+  infoRequest->SetAuthDataLen (4);
+  infoRequest->SetEidMaskLength (24);
+  infoRequest->SetEidPrefix (Ipv4Address ("10.1.2.0"));
+  CheckExactSize (infoRequest, "Info-Request");
+
+  Ptr<NatLcaf> natLcaf = Create<NatLcaf> ();
+  natLcaf->SetGlobalEtrRlocAddress (Ipv4Address ("192.168.1.1"));
+  natLcaf->SetMsRlocAddress (Ipv4Address ("192.168.2.1"));
+  natLcaf->SetPrivateEtrRlocAddress (Ipv4Address ("0.0.0.0"));
+  natLcaf->SetRtrRlocAddress (Ipv6Address ("2001:db8::1"));
+  Ptr<InfoRequestMsg> infoReply = Create<InfoRequestMsg> ();
+  infoReply->SetR (1);
+  infoReply->SetAuthDataLen (4);
+  infoReply->SetEidMaskLength (24);
+  infoReply->SetEidPrefix (Ipv4Address ("10.1.2.0"));
+  infoReply->SetNatLcaf (natLcaf);
+  CheckExactSize (infoReply, "Info-Reply");
+
+  Ptr<MapRequestMsg> request = Create<MapRequestMsg> ();
+  request->SetSourceEidAddr (Ipv4Address ("10.1.1.1"));
+  request->SetItrRlocAddrIp (Ipv4Address ("192.168.1.1"));
+  request->SetMapRequestRecord (Create<MapRequestRecord> (Ipv4Address ("10.1.2.1"), 32));
+  CheckExactSize (request, "Map-Request");
+}
+
+// ================================================================================================
+
+class ControlMsgTestSuite : public TestSuite
+{
+public:
+  ControlMsgTestSuite ();
+};
+
+ControlMsgTestSuite::ControlMsgTestSuite ()
+  : TestSuite ("lisp-control-msg", UNIT)
+{
+  AddTestCase (new MultiRecordMapRequestTestCase, TestCase::QUICK);
+  AddTestCase (new MultiRecordMapReplyTestCase, TestCase::QUICK);
+  AddTestCase (new MultiRecordMapRegisterTestCase, TestCase::QUICK);
+  AddTestCase (new ExactSizeTestCase, TestCase::QUICK);
+}
+
+static ControlMsgTestSuite controlMsgTestSuite;
@@ -0,0 +1,624 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <list>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/ddt-node.h"
+#include "ns3/map-referral-msg.h"
+#include "ns3/map-reply-msg.h"
+#include "ns3/map-resolver-ddt.h"
+#include "ns3/ddt-node-helper.h"
+#include "ns3/map-server-helper.h"
+#include "../lisp-test-utils.h"
+
+#include "ns3/test.h"
+
+using namespace ns3;
+
+static Ptr<MapReferralMsg>
+Refer (Ptr<DdtNode> node, const char *eid)
+{
+  Ptr<MapRequestMsg> request = Create<MapRequestMsg> ();
+  request->SetNonce (7);
+  request->SetItrRlocAddrIp (Ipv4Address ("192.168.1.1"));
+  request->SetMapRequestRecord (Create<MapRequestRecord> (Ipv4Address (eid), 32));
+  return node->GenerateMapReferral (request);
+}
+
+// ================================================================================================
+
+class MapReferralMsgTestCase : public TestCase
+{
+public:
+  MapReferralMsgTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+MapReferralMsgTestCase::MapReferralMsgTestCase ()
+  : TestCase ("A Map-Referral carries its action and referral set")
+{
+}
+
+void
+MapReferralMsgTestCase::DoRun (void)
+{
+  Ptr<DdtNode> node = CreateObject<DdtNode> ();
+  node->AddMapServerDelegation (Ipv4Address ("10.1.1.0"), Ipv4Mask ("255.255.255.0"), Ipv4Address ("192.168.4.1"));
+  node->AddMapServerDelegation (Ipv4Address ("10.1.1.0"), Ipv4Mask ("255.255.255.0"), Ipv4Address ("192.168.4.2"));
+  Ptr<MapReferralMsg> referral = Refer (node, "10.1.1.1");
+
+  std::vector<uint8_t> buf (referral->GetSerializedSize ());
+  referral->Serialize (&buf[0]);
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) (buf[0] >> 4), (uint32_t) MapReferralMsg::GetMsgType (), "message type");
+  NS_TEST_ASSERT_MSG_EQ (referral->ToPacket ()->GetSize (), referral->GetSerializedSize (), "exact size");
+
+  Ptr<MapReferralMsg> decoded = MapReferralMsg::Deserialize (&buf[0]);
+  NS_TEST_ASSERT_MSG_EQ (decoded->GetNonce (), 7u, "the nonce of the Map-Request");
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) decoded->GetNRecords (), 1u, "one record per requested EID");
+  Ptr<MapReplyRecord> record = decoded->GetRecord (0);
+  NS_TEST_ASSERT_MSG_EQ (MapReferralMsg::GetReferralAction (record), MapReferralMsg::MS_REFERRAL, "action");
+  NS_TEST_ASSERT_MSG_EQ (Ipv4Address::ConvertFrom (record->GetEidPrefix ()), Ipv4Address ("10.1.1.0"), "delegated prefix");
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) record->GetEidMaskLength (), 24u, "delegated prefix length");
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) record->GetLocatorCount (), 2u, "referral set");
+  NS_TEST_ASSERT_MSG_EQ (Ipv4Address::ConvertFrom (record->GetLocators ()->GetLocatorByIdx (1)->GetRlocAddress ()),
+                         Ipv4Address ("192.168.4.2"), "second Map-Server");
+}
+
+// ================================================================================================
+
+class DdtNodeReferralTestCase : public TestCase
+{
+public:
+  DdtNodeReferralTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+DdtNodeReferralTestCase::DdtNodeReferralTestCase ()
+  : TestCase ("A DDT node refers to its most specific delegation")
+{
+}
+
+void
+DdtNodeReferralTestCase::DoRun (void)
+{
+  Ptr<DdtNode> node = CreateObject<DdtNode> ();
+  node->AddAuthoritativePrefix (Ipv4Address ("10.0.0.0"), Ipv4Mask ("255.0.0.0"));
+  node->AddNodeDelegation (Ipv4Address ("10.1.0.0"), Ipv4Mask ("255.255.0.0"), Ipv4Address ("192.168.6.1"));
+  node->AddMapServerDelegation (Ipv4Address ("10.1.2.0"), Ipv4Mask ("255.255.255.0"), Ipv4Address ("192.168.4.1"));
+
+  Ptr<MapReplyRecord> record = Refer (node, "10.1.3.1")->GetRecord (0);
+  NS_TEST_ASSERT_MSG_EQ (MapReferralMsg::GetReferralAction (record), MapReferralMsg::NODE_REFERRAL, "child DDT node");
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) record->GetEidMaskLength (), 16u, "node delegation");
+
+  record = Refer (node, "10.1.2.1")->GetRecord (0);
+  NS_TEST_ASSERT_MSG_EQ (MapReferralMsg::GetReferralAction (record), MapReferralMsg::MS_REFERRAL, "longest match");
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) record->GetEidMaskLength (), 24u, "Map-Server delegation");
+
+  // The hole is the largest prefix around the EID that holds no delegation
+  record = Refer (node, "10.128.0.1")->GetRecord (0);
+  NS_TEST_ASSERT_MSG_EQ (MapReferralMsg::GetReferralAction (record), MapReferralMsg::DELEGATION_HOLE, "hole");
+  NS_TEST_ASSERT_MSG_EQ (Ipv4Address::ConvertFrom (record->GetEidPrefix ()), Ipv4Address ("10.128.0.0"), "hole prefix");
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) record->GetEidMaskLength (), 9u, "hole length");
+  NS_TEST_ASSERT_MSG_EQ (record->GetRecordTtl (), 15u, "negative referral TTL");
+  NS_TEST_ASSERT_MSG_EQ (MapReferralMsg::IsNegative (MapReferralMsg::DELEGATION_HOLE), true, "holes are negative");
+
+  record = Refer (node, "11.0.0.1")->GetRecord (0);
+  NS_TEST_ASSERT_MSG_EQ (MapReferralMsg::GetReferralAction (record), MapReferralMsg::NOT_AUTHORITATIVE, "not authoritative");
+  NS_TEST_ASSERT_MSG_EQ (record->GetRecordTtl (), 0u, "not to be cached");
+}
+
+// ================================================================================================
+
+class MapReferralCacheTestCase : public TestCase
+{
+public:
+  MapReferralCacheTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void CheckExpired (Ptr<MapReferralCache> cache);
+};
+
+MapReferralCacheTestCase::MapReferralCacheTestCase ()
+  : TestCase ("The referral cache returns the deepest unexpired referral")
+{
+}
+
+void
+MapReferralCacheTestCase::CheckExpired (Ptr<MapReferralCache> cache)
+{
+  NS_TEST_EXPECT_MSG_EQ (cache->Lookup (Ipv4Address ("10.2.0.1"))->GetAction (), MapReferralMsg::NODE_REFERRAL,
+                         "expired negative referral");
+  NS_TEST_EXPECT_MSG_EQ (cache->GetNEntries (), 2u, "expired referral removed");
+  NS_TEST_EXPECT_MSG_EQ (cache->Lookup (Ipv4Address ("10.1.2.1"))->GetAction (), MapReferralMsg::MS_REFERRAL,
+                         "unexpired referral");
+}
+
+void
+MapReferralCacheTestCase::DoRun (void)
+{
+  Ptr<DdtNode> node = CreateObject<DdtNode> ();
+  node->SetAttribute ("ReferralTtl", UintegerValue (10));
+  node->SetAttribute ("NegativeReferralTtl", UintegerValue (1));
+  node->AddNodeDelegation (Ipv4Address ("10.0.0.0"), Ipv4Mask ("255.0.0.0"), Ipv4Address ("192.168.6.1"));
+  Ptr<DdtNode> child = CreateObject<DdtNode> ();
+  child->SetAttribute ("NegativeReferralTtl", UintegerValue (1));
+  child->AddAuthoritativePrefix (Ipv4Address ("10.0.0.0"), Ipv4Mask ("255.0.0.0"));
+  child->AddMapServerDelegation (Ipv4Address ("10.1.2.0"), Ipv4Mask ("255.255.255.0"), Ipv4Address ("192.168.4.1"));
+
+  Ptr<MapReferralCache> cache = Create<MapReferralCache> ();
+  cache->Insert (Refer (node, "10.1.2.1")->GetRecord (0));
+  cache->Insert (Refer (child, "10.1.2.1")->GetRecord (0));
+  cache->Insert (Refer (child, "10.1.2.1")->GetRecord (0));
+  cache->Insert (Refer (child, "10.2.0.1")->GetRecord (0));
+  NS_TEST_ASSERT_MSG_EQ (cache->GetNEntries (), 3u, "a prefix is cached once");
+
+  NS_TEST_ASSERT_MSG_EQ (cache->Lookup (Ipv4Address ("10.1.2.200"))->GetAction (), MapReferralMsg::MS_REFERRAL, "deepest referral");
+  NS_TEST_ASSERT_MSG_EQ (cache->Lookup (Ipv4Address ("10.200.0.1"))->GetAction (), MapReferralMsg::NODE_REFERRAL, "upper level");
+  NS_TEST_ASSERT_MSG_EQ (cache->Lookup (Ipv4Address ("10.2.0.1"))->GetAction (), MapReferralMsg::DELEGATION_HOLE, "negative referral");
+  NS_TEST_ASSERT_MSG_EQ (cache->Lookup (Ipv4Address ("11.0.0.1")), Ptr<MapRefCacheEntry> (), "no referral");
+
+  // Expired referrals fall back on the upper levels
+  Simulator::Schedule (Minutes (5), &MapReferralCacheTestCase::CheckExpired, this, cache);
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+// ================================================================================================
+
+class MapReferralCacheCapacityTestCase : public TestCase
+{
+public:
+  MapReferralCacheCapacityTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+MapReferralCacheCapacityTestCase::MapReferralCacheCapacityTestCase ()
+  : TestCase ("A full referral cache evicts an entry for each new one")
+{
+}
+
+void
+MapReferralCacheCapacityTestCase::DoRun (void)
+{
+  Ptr<DdtNode> node = CreateObject<DdtNode> ();
+  node->AddMapServerDelegation (Ipv4Address ("10.1.1.0"), Ipv4Mask ("255.255.255.0"), Ipv4Address ("192.168.4.1"));
+  node->AddMapServerDelegation (Ipv4Address ("10.1.2.0"), Ipv4Mask ("255.255.255.0"), Ipv4Address ("192.168.4.1"));
+  node->AddMapServerDelegation (Ipv4Address ("10.1.3.0"), Ipv4Mask ("255.255.255.0"), Ipv4Address ("192.168.4.1"));
+
+  Ptr<MapReferralCache> cache = Create<MapReferralCache> ();
+  cache->SetCapacity (2);
+  cache->Insert (Refer (node, "10.1.1.1")->GetRecord (0));
+  cache->Insert (Refer (node, "10.1.2.1")->GetRecord (0));
+  // Replacing a cached prefix evicts nothing
+  cache->Insert (Refer (node, "10.1.2.1")->GetRecord (0));
+  NS_TEST_ASSERT_MSG_EQ (cache->GetNEvictions (), 0u, "the cache is not full yet");
+
+  cache->Insert (Refer (node, "10.1.3.1")->GetRecord (0));
+  NS_TEST_ASSERT_MSG_EQ (cache->GetNEntries (), 2u, "the capacity is not exceeded");
+  NS_TEST_ASSERT_MSG_EQ (cache->GetNEvictions (), 1u, "one entry evicted");
+  NS_TEST_ASSERT_MSG_NE (cache->Lookup (Ipv4Address ("10.1.3.1")), Ptr<MapRefCacheEntry> (), "the new entry is cached");
+
+  cache->SetCapacity (1);
+  NS_TEST_ASSERT_MSG_EQ (cache->GetNEntries (), 1u, "a smaller capacity evicts the extra entries");
+  NS_TEST_ASSERT_MSG_EQ (cache->GetNEvictions (), 2u, "evictions");
+
+  cache->SetCapacity (0);
+  cache->Insert (Refer (node, "10.1.1.1")->GetRecord (0));
+  cache->Insert (Refer (node, "10.1.2.1")->GetRecord (0));
+  NS_TEST_ASSERT_MSG_EQ (cache->GetNEntries (), 3u, "no limit");
+}
+
+// ================================================================================================
+
+class DdtNodeFailoverTestCase : public TestCase
+{
+public:
+  DdtNodeFailoverTestCase (bool rootUp);
+
+private:
+  virtual void DoRun (void);
+
+  void HandleMapRequest (Ptr<Socket> socket);
+  void HandleMapReply (Ptr<Socket> socket);
+  void RootRx (Ptr<const Packet> p);
+
+  bool m_rootUp;              //!< Whether the second DDT root answers
+  uint32_t m_silentRequests;  //!< The DDT Map-Requests the silent DDT root received
+  uint32_t m_rootRequests;    //!< The DDT Map-Requests the second DDT root received
+  std::vector<uint32_t> m_ttls;
+  std::vector<Time> m_replyTimes;
+};
+
+DdtNodeFailoverTestCase::DdtNodeFailoverTestCase (bool rootUp)
+  : TestCase (rootUp ? "The MR asks the next DDT node of the referral set when one does not answer"
+                     : "The MR answers with a negative Map-Reply when no DDT node of the referral set answers"),
+    m_rootUp (rootUp),
+    m_silentRequests (0),
+    m_rootRequests (0)
+{
+}
+
+void
+DdtNodeFailoverTestCase::HandleMapRequest (Ptr<Socket> socket)
+{
+  Ptr<Packet> packet;
+  while ((packet = socket->Recv ()))
+    {
+      m_silentRequests++;
+    }
+}
+
+void
+DdtNodeFailoverTestCase::RootRx (Ptr<const Packet> p)
+{
+  m_rootRequests++;
+}
+
+void
+DdtNodeFailoverTestCase::HandleMapReply (Ptr<Socket> socket)
+{
+  Ptr<Packet> packet;
+  while ((packet = socket->Recv ()))
+    {
+      uint8_t buf[packet->GetSize ()];
+      packet->CopyData (buf, packet->GetSize ());
+      Ptr<MapReplyMsg> reply = MapReplyMsg::Deserialize (buf);
+      NS_TEST_EXPECT_MSG_EQ ((uint32_t) reply->GetRecord (0)->GetLocatorCount (), 0u, "negative Map-Reply");
+      m_ttls.push_back (reply->GetRecord (0)->GetRecordTtl ());
+      m_replyTimes.push_back (Simulator::Now ());
+    }
+}
+
+void
+DdtNodeFailoverTestCase::DoRun (void)
+{
+  /* Topology:  ITR (n0) --- R (n1) --- MR (n2)
+                             |
+               silent DDT (n3), DDT root (n4)
+
+     The referral set of the root lists the silent node first. The DDT root
+     is authoritative for 10.0.0.0/8 and delegates none of it: it answers a
+     negative referral.
+  */
+  const Time timeout = Seconds (2.0);
+  NodeContainer nodes;
+  nodes.Create (5);
+  InternetStackHelper internet;
+  internet.Install (nodes);
+  std::vector<Ipv4Address> addresses = InstallStarTopology (nodes, nodes.Get (1));
+
+  Ptr<Socket> silent = Socket::CreateSocket (nodes.Get (3), UdpSocketFactory::GetTypeId ());
+  silent->Bind (InetSocketAddress (Ipv4Address::GetAny (), LispOverIp::LISP_SIG_PORT));
+  silent->SetRecvCallback (MakeCallback (&DdtNodeFailoverTestCase::HandleMapRequest, this));
+
+  if (m_rootUp)
+    {
+      DdtNodeHelper ddtHelper;
+      ApplicationContainer ddtApps = ddtHelper.Install (nodes.Get (4));
+      Ptr<DdtNode> root = DynamicCast<DdtNode> (ddtApps.Get (0));
+      root->AddAuthoritativePrefix (Ipv4Address ("10.0.0.0"), Ipv4Mask ("255.0.0.0"));
+      root->TraceConnectWithoutContext ("MapRequestRx", MakeCallback (&DdtNodeFailoverTestCase::RootRx, this));
+      ddtApps.Start (Seconds (0.0));
+    }
+
+  // The MR needs no LispOverIp to resolve
+  Ptr<MapResolverDdt> mr = CreateObject<MapResolverDdt> ();
+  mr->SetAttribute ("ReferralTimeout", TimeValue (timeout));
+  std::list<Ptr<Locator> > roots;
+  roots.push_back (Create<Locator> (addresses[3]));
+  roots.push_back (Create<Locator> (addresses[4]));
+  mr->SetDdtRootRlocs (roots);
+  nodes.Get (2)->AddApplication (mr);
+  mr->SetStartTime (Seconds (0.0));
+
+  Ptr<Socket> itr = Socket::CreateSocket (nodes.Get (0), UdpSocketFactory::GetTypeId ());
+  itr->Bind (InetSocketAddress (Ipv4Address::GetAny (), LispOverIp::LISP_SIG_PORT));
+  itr->SetRecvCallback (MakeCallback (&DdtNodeFailoverTestCase::HandleMapReply, this));
+  Simulator::Schedule (Seconds (1.0), &SendEidMapRequest, itr, addresses[2], addresses[0], Ipv4Address ("10.255.0.1"), 1);
+
+  Simulator::Stop (Seconds (10.0));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_silentRequests, 1u, "the silent DDT node is asked first");
+  NS_TEST_ASSERT_MSG_EQ (m_ttls.size (), 1u, "the ITR is answered once");
+  if (m_rootUp)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_rootRequests, 1u, "the next DDT node is asked after the timeout");
+      NS_TEST_ASSERT_MSG_EQ (m_ttls[0], 15u, "the answer of the DDT root");
+      NS_TEST_ASSERT_MSG_GT (m_replyTimes[0], Seconds (1.0) + timeout, "after one timeout");
+      NS_TEST_ASSERT_MSG_LT (m_replyTimes[0], Seconds (1.0) + 2 * timeout, "before the second one");
+    }
+  else
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_ttls[0], 1u, "a short-lived negative Map-Reply");
+      NS_TEST_ASSERT_MSG_GT (m_replyTimes[0], Seconds (1.0) + 2 * timeout, "once both DDT nodes timed out");
+    }
+  Simulator::Destroy ();
+}
+
+// ================================================================================================
+
+class DdtResolutionTestCase : public TestCase
+{
+public:
+  DdtResolutionTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  void RxSink (Ptr<const Packet> p);
+  void RootRx (Ptr<const Packet> p);
+  void ChildRx (Ptr<const Packet> p);
+  void Resolved (Time delay, uint32_t referrals);
+
+  bool m_receivedPacket;
+  uint32_t m_rootRequests;
+  uint32_t m_childRequests;
+  std::vector<uint32_t> m_referrals;
+};
+
+DdtResolutionTestCase::DdtResolutionTestCase ()
+  : TestCase ("The Map-Resolver walks the DDT hierarchy and caches the referrals"),
+    m_receivedPacket (false),
+    m_rootRequests (0),
+    m_childRequests (0)
+{
+}
+
+void
+DdtResolutionTestCase::RxSink (Ptr<const Packet> p)
+{
+  m_receivedPacket = true;
+}
+
+void
+DdtResolutionTestCase::RootRx (Ptr<const Packet> p)
+{
+  m_rootRequests++;
+}
+
+void
+DdtResolutionTestCase::ChildRx (Ptr<const Packet> p)
+{
+  m_childRequests++;
+}
+
+void
+DdtResolutionTestCase::Resolved (Time delay, uint32_t referrals)
+{
+  m_referrals.push_back (referrals);
+}
+
+void
+DdtResolutionTestCase::DoRun (void)
+{
+  /* Topology:         MR (n5)  MS (n6)  root DDT (n7)  DDT (n8)
+                          \       |       /              /
+                xTR1 (n1) <----> R (n2) <-----> xTR2 (n3)
+                /               (non-LISP)        \
+               /                                   \
+            n0 (non-LISP)                         n4 (non-LISP)
+
+     The root delegates 10.0.0.0/8 to n8, which delegates the EID-Prefixes
+     of both xTRs to the Map-Server.
+  */
+  PacketMetadata::Enable ();
+
+  NodeContainer nodes;
+  nodes.Create (9);
+
+  InternetStackHelper internet;
+  internet.Install (nodes);
+
+  PointToPointHelper p2p;
+  p2p.SetDeviceAttribute ("DataRate", StringValue ("5Mbps"));
+  p2p.SetChannelAttribute ("Delay", StringValue ("2ms"));
+
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase ("10.1.1.0", "255.255.255.0");
+  ipv4.Assign (p2p.Install (nodes.Get (0), nodes.Get (1)));
+  ipv4.SetBase ("192.168.1.0", "255.255.255.0");
+  ipv4.Assign (p2p.Install (nodes.Get (1), nodes.Get (2)));
+  ipv4.SetBase ("192.168.2.0", "255.255.255.0");
+  ipv4.Assign (p2p.Install (nodes.Get (2), nodes.Get (3)));
+  ipv4.SetBase ("10.1.2.0", "255.255.255.0");
+  Ipv4InterfaceContainer ixTR2_in4 = ipv4.Assign (p2p.Install (nodes.Get (3), nodes.Get (4)));
+  ipv4.SetBase ("192.168.3.0", "255.255.255.0");
+  Ipv4InterfaceContainer iR_iMR = ipv4.Assign (p2p.Install (nodes.Get (2), nodes.Get (5)));
+  ipv4.SetBase ("192.168.4.0", "255.255.255.0");
+  Ipv4InterfaceContainer iR_iMS = ipv4.Assign (p2p.Install (nodes.Get (2), nodes.Get (6)));
+  ipv4.SetBase ("192.168.5.0", "255.255.255.0");
+  Ipv4InterfaceContainer iR_iRoot = ipv4.Assign (p2p.Install (nodes.Get (2), nodes.Get (7)));
+  ipv4.SetBase ("192.168.6.0", "255.255.255.0");
+  Ipv4InterfaceContainer iR_iDdt = ipv4.Assign (p2p.Install (nodes.Get (2), nodes.Get (8)));
+
+  Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+
+  NodeContainer lispRouters = NodeContainer (nodes.Get (1), nodes.Get (3), nodes.Get (5), nodes.Get (6));
+  NodeContainer xTRs = NodeContainer (nodes.Get (1), nodes.Get (3));
+
+  LispHelper lispHelper;
+  lispHelper.BuildRlocsSet ("src/internet/test/lisp-test/simple-lisp/simple_lisp_rlocs.txt");
+  lispHelper.Install (lispRouters);
+  lispHelper.BuildMapTables2 ("src/internet/test/lisp-test/simple-lisp/simple_lisp_rlocs_config_xml.txt");
+  lispHelper.InstallMapTables (lispRouters);
+
+  LispEtrItrAppHelper lispAppHelper;
+  lispAppHelper.AddMapResolverRlocs (Create<Locator> (iR_iMR.GetAddress (1)));
+  lispAppHelper.AddMapServerAddress (static_cast<Address> (iR_iMS.GetAddress (1)));
+  ApplicationContainer xtrApps = lispAppHelper.Install (xTRs);
+  xtrApps.Start (Seconds (1.0));
+  xtrApps.Stop (Seconds (20.0));
+
+  // DDT hierarchy
+  DdtNodeHelper ddtHelper;
+  Ptr<DdtNode> root = DynamicCast<DdtNode> (ddtHelper.Install (nodes.Get (7)).Get (0));
+  root->AddNodeDelegation (Ipv4Address ("10.0.0.0"), Ipv4Mask ("255.0.0.0"), iR_iDdt.GetAddress (1));
+  Ptr<DdtNode> ddt = DynamicCast<DdtNode> (ddtHelper.Install (nodes.Get (8)).Get (0));
+  ddt->AddAuthoritativePrefix (Ipv4Address ("10.0.0.0"), Ipv4Mask ("255.0.0.0"));
+  ddt->AddMapServerDelegation (Ipv4Address ("10.1.1.0"), Ipv4Mask ("255.255.255.0"), iR_iMS.GetAddress (1));
+  ddt->AddMapServerDelegation (Ipv4Address ("10.1.2.0"), Ipv4Mask ("255.255.255.0"), iR_iMS.GetAddress (1));
+  root->TraceConnectWithoutContext ("MapRequestRx", MakeCallback (&DdtResolutionTestCase::RootRx, this));
+  ddt->TraceConnectWithoutContext ("MapRequestRx", MakeCallback (&DdtResolutionTestCase::ChildRx, this));
+  ApplicationContainer ddtApps (root);
+  ddtApps.Add (ddt);
+  ddtApps.Start (Seconds (0.0));
+  ddtApps.Stop (Seconds (20.0));
+
+  MapResolverDdtHelper mrHelper;
+  mrHelper.AddDdtRootRloc (Create<Locator> (iR_iRoot.GetAddress (1)));
+  ApplicationContainer mrApps = mrHelper.Install (nodes.Get (5));
+  mrApps.Start (Seconds (0.0));
+  mrApps.Stop (Seconds (20.0));
+  Ptr<MapResolverDdt> mr = DynamicCast<MapResolverDdt> (mrApps.Get (0));
+  mr->TraceConnectWithoutContext ("Resolved", MakeCallback (&DdtResolutionTestCase::Resolved, this));
+
+  MapServerDdtHelper msHelper;
+  ApplicationContainer msApps = msHelper.Install (nodes.Get (6));
+  msApps.Start (Seconds (0.0));
+  msApps.Stop (Seconds (20.0));
+
+  UdpEchoServerHelper echoServer (9);
+  ApplicationContainer serverApps = echoServer.Install (nodes.Get (4));
+  serverApps.Start (Seconds (1.0));
+  serverApps.Stop (Seconds (20.0));
+
+  UdpEchoClientHelper echoClient (ixTR2_in4.GetAddress (1), 9);
+  echoClient.SetAttribute ("MaxPackets", UintegerValue (10));
+  echoClient.SetAttribute ("Interval", TimeValue (Seconds (1.0)));
+  echoClient.SetAttribute ("PacketSize", UintegerValue (1024));
+  ApplicationContainer clientApps = echoClient.Install (nodes.Get (0));
+  clientApps.Start (Seconds (4.0));
+  clientApps.Stop (Seconds (20.0));
+  clientApps.Get (0)->TraceConnectWithoutContext ("Rx", MakeCallback (&DdtResolutionTestCase::RxSink, this));
+
+  Simulator::Stop (Seconds (20.0));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_receivedPacket, true, "No communication between both ends");
+  NS_TEST_ASSERT_MSG_GT (m_referrals.size (), 1u, "both EIDs resolved");
+  NS_TEST_ASSERT_MSG_EQ (m_referrals[0], 2u, "the first resolution walks the whole hierarchy");
+  NS_TEST_ASSERT_MSG_EQ (m_referrals[1], 1u, "the next resolution starts from the cached DDT node");
+  NS_TEST_ASSERT_MSG_EQ (m_rootRequests, 1u, "the root is asked once");
+  NS_TEST_ASSERT_MSG_EQ (m_childRequests, 2u, "the child DDT node is asked for each EID");
+  NS_TEST_ASSERT_MSG_GT (mr->GetMapReferralCache ()->GetNEntries (), 0u, "referrals cached");
+  Simulator::Destroy ();
+}
+
+// ================================================================================================
+
+class ConcurrentRepliesTestCase : public TestCase
+{
+public:
+  ConcurrentRepliesTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  std::vector<std::vector<uint64_t> > m_nonces;
+};
+
+ConcurrentRepliesTestCase::ConcurrentRepliesTestCase ()
+  : TestCase ("The Map-Server answers concurrent Map-Requests to their own ITR")
+{
+}
+
+void
+ConcurrentRepliesTestCase::DoRun (void)
+{
+  /* Topology:  ITR (n0..n3) --- R (n4) --- MS (n5)
+
+     Every ITR asks for an unregistered EID while the Map-Server is still
+     searching for the others: each must receive its own negative Map-Reply.
+  */
+  const uint32_t nItrs = 4;
+  NodeContainer nodes;
+  nodes.Create (nItrs + 2);
+  Ptr<Node> router = nodes.Get (nItrs);
+  InternetStackHelper internet;
+  internet.Install (nodes);
+
+  std::vector<Ipv4Address> addresses = InstallStarTopology (nodes, router);
+
+  // The MS is a LISP-speaking device
+  Ptr<Node> ms = nodes.Get (nItrs + 1);
+  LispHelper lispHelper;
+  lispHelper.AddRlocToSet (addresses[nItrs + 1]);
+  lispHelper.Install (ms);
+  lispHelper.SetMapTablesForEtr (addresses[nItrs + 1], lispHelper.CreateMapTables (), lispHelper.CreateMapTables ());
+  lispHelper.InstallMapTables (NodeContainer (ms));
+
+  MapServerDdtHelper msHelper;
+  ApplicationContainer msApps = msHelper.Install (ms);
+  msApps.Start (Seconds (0.0));
+
+  m_nonces.assign (nItrs, std::vector<uint64_t> ());
+  for (uint32_t i = 0; i < nItrs; i++)
+    {
+      Ptr<Socket> socket = Socket::CreateSocket (nodes.Get (i), UdpSocketFactory::GetTypeId ());
+      socket->Bind (InetSocketAddress (Ipv4Address::GetAny (), LispOverIp::LISP_SIG_PORT));
+      socket->SetRecvCallback (MakeBoundCallback (&ReceiveMapReplyNonce, &m_nonces[i]));
+      Simulator::Schedule (Seconds (1.0) + MilliSeconds (10 * i), &SendEidMapRequest, socket,
+                           addresses[nItrs + 1], addresses[i], Ipv4Address ("10.255.0.1"), i + 1);
+    }
+
+  Simulator::Stop (Seconds (5.0));
+  Simulator::Run ();
+
+  for (uint32_t i = 0; i < nItrs; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_nonces[i].size (), 1u, "ITR " << i << " receives one Map-Reply");
+      NS_TEST_ASSERT_MSG_EQ (m_nonces[i].front (), i + 1, "ITR " << i << " receives its own Map-Reply");
+    }
+  Simulator::Destroy ();
+}
+
+// ================================================================================================
+
+class DdtTestSuite : public TestSuite
+{
+public:
+  DdtTestSuite ();
+};
+
+DdtTestSuite::DdtTestSuite ()
+  : TestSuite ("lisp-ddt", UNIT)
+{
+  // First, as the LISP data plane needs the packet metadata from the start
+  AddTestCase (new DdtResolutionTestCase, TestCase::QUICK);
+  AddTestCase (new MapReferralMsgTestCase, TestCase::QUICK);
+  AddTestCase (new DdtNodeReferralTestCase, TestCase::QUICK);
+  AddTestCase (new MapReferralCacheTestCase, TestCase::QUICK);
+  AddTestCase (new MapReferralCacheCapacityTestCase, TestCase::QUICK);
+  AddTestCase (new DdtNodeFailoverTestCase (true), TestCase::QUICK);
+  AddTestCase (new DdtNodeFailoverTestCase (false), TestCase::QUICK);
+  AddTestCase (new ConcurrentRepliesTestCase, TestCase::QUICK);
+}
+
+static DdtTestSuite ddtTestSuite;
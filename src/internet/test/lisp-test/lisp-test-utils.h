@@ -0,0 +1,102 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LISP_TEST_UTILS_H
+#define LISP_TEST_UTILS_H
+
+#include <vector>
+
+#include "ns3/node-container.h"
+#include "ns3/socket.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/ipv4-global-routing-helper.h"
+#include "ns3/point-to-point-helper.h"
+#include "ns3/string.h"
+#include "ns3/lisp-over-ip.h"
+#include "ns3/map-request-msg.h"
+#include "ns3/map-reply-msg.h"
+
+/*
+ * Control plane test utilities shared by the LISP test suites, header-only
+ * so that the test libraries of other modules can use them as well.
+ */
+
+namespace ns3 {
+
+/**
+ * \brief Receive callback of an ITR socket: record the nonce of every
+ * Map-Reply received.
+ */
+inline void
+ReceiveMapReplyNonce (std::vector<uint64_t> *nonces, Ptr<Socket> socket)
+{
+  Ptr<Packet> packet;
+  while ((packet = socket->Recv ()))
+    {
+      uint8_t buf[packet->GetSize ()];
+      packet->CopyData (buf, packet->GetSize ());
+      nonces->push_back (MapReplyMsg::Deserialize (buf)->GetNonce ());
+    }
+}
+
+/**
+ * \brief Send a Map-Request for EID 10.9.9.1/32 from an ITR socket.
+ */
+inline void
+SendEidMapRequest (Ptr<Socket> socket, Ipv4Address to, Ipv4Address itrRloc, Ipv4Address source, uint64_t nonce)
+{
+  Ptr<MapRequestMsg> request = Create<MapRequestMsg> ();
+  request->SetNonce (nonce);
+  request->SetSourceEidAddr (source);
+  request->SetItrRlocAddrIp (itrRloc);
+  request->SetMapRequestRecord (Create<MapRequestRecord> (Ipv4Address ("10.9.9.1"), 32));
+  socket->SendTo (request->ToPacket (), 0, InetSocketAddress (to, LispOverIp::LISP_SIG_PORT));
+}
+
+/**
+ * \brief Link every node to the router by a point-to-point /30 link and
+ * populate the routing tables. The nodes need an internet stack.
+ *
+ * \return The address of each node on its link, by node index; the
+ * router has none.
+ */
+inline std::vector<Ipv4Address>
+InstallStarTopology (NodeContainer nodes, Ptr<Node> router)
+{
+  PointToPointHelper p2p;
+  p2p.SetDeviceAttribute ("DataRate", StringValue ("100Mbps"));
+  p2p.SetChannelAttribute ("Delay", StringValue ("2ms"));
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase ("192.168.0.0", "255.255.255.252");
+  std::vector<Ipv4Address> addresses;
+  for (uint32_t i = 0; i < nodes.GetN (); i++)
+    {
+      if (nodes.Get (i) == router)
+        {
+          addresses.push_back (Ipv4Address ());
+          continue;
+        }
+      addresses.push_back (ipv4.Assign (p2p.Install (nodes.Get (i), router)).GetAddress (0));
+      ipv4.NewNetwork ();
+    }
+  Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+  return addresses;
+}
+
+} // namespace ns3
+
+#endif /* LISP_TEST_UTILS_H */
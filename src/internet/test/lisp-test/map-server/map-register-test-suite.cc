@@ -0,0 +1,392 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/map-server-ddt.h"
+#include "ns3/map-server-helper.h"
+#include "ns3/map-server-shards.h"
+
+#include "ns3/test.h"
+
+using namespace ns3;
+
+// ================================================================================================
+
+class MapRegisterRefreshTestCase : public TestCase
+{
+public:
+  MapRegisterRefreshTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  void MapRegisterTx (Ptr<const Packet> p);
+
+  std::vector<Time> m_times;
+  std::vector<uint32_t> m_records;
+};
+
+MapRegisterRefreshTestCase::MapRegisterRefreshTestCase ()
+  : TestCase ("The xTR packs its records in jittered Map-Registers and then only registers the changes")
+{
+}
+
+void
+MapRegisterRefreshTestCase::MapRegisterTx (Ptr<const Packet> p)
+{
+  uint8_t buf[4];
+  p->CopyData (buf, 4);
+  m_times.push_back (Simulator::Now ());
+  m_records.push_back (buf[3]);
+}
+
+static void
+InsertDatabaseLocator (Ptr<MapTables> database, Ipv4Address eidPrefix, Ipv4Address rloc)
+{
+  database->InsertLocator (eidPrefix, Ipv4Mask ("255.255.255.0"), rloc, 200, 30, MapTables::IN_DATABASE, true);
+}
+
+void
+MapRegisterRefreshTestCase::DoRun (void)
+{
+  // xTR (n0) <-----> MS (n1)
+  PacketMetadata::Enable ();
+
+  NodeContainer nodes;
+  nodes.Create (2);
+  InternetStackHelper internet;
+  internet.Install (nodes);
+  PointToPointHelper p2p;
+  p2p.SetDeviceAttribute ("DataRate", StringValue ("5Mbps"));
+  p2p.SetChannelAttribute ("Delay", StringValue ("2ms"));
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase ("192.168.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer interfaces = ipv4.Assign (p2p.Install (nodes));
+  Ipv4Address xtrRloc = interfaces.GetAddress (0);
+  Ipv4Address msRloc = interfaces.GetAddress (1);
+
+  // The xTR is responsible for 40 EID-Prefixes
+  LispHelper lispHelper;
+  lispHelper.AddRlocToSet (xtrRloc);
+  lispHelper.AddRlocToSet (msRloc);
+  lispHelper.Install (nodes);
+  Ptr<MapTables> database = lispHelper.CreateMapTables ();
+  for (uint32_t i = 0; i < 40; i++)
+    {
+      database->InsertLocator (Ipv4Address (0x0a000000 + (i << 8)), Ipv4Mask ("255.255.255.0"), xtrRloc, 200, 30,
+                               MapTables::IN_DATABASE, true);
+    }
+  lispHelper.SetMapTablesForEtr (xtrRloc, database, lispHelper.CreateMapTables ());
+  // The MS answers the Info-Requests with the locator of its database
+  Ptr<MapTables> msLocalDatabase = lispHelper.CreateMapTables ();
+  msLocalDatabase->InsertLocator (msRloc, Ipv4Mask ("255.255.255.255"), msRloc, 200, 30, MapTables::IN_DATABASE, true);
+  lispHelper.SetMapTablesForEtr (msRloc, msLocalDatabase, lispHelper.CreateMapTables ());
+  lispHelper.InstallMapTables (nodes);
+
+  LispEtrItrAppHelper lispAppHelper;
+  lispAppHelper.AddMapResolverRlocs (Create<Locator> (msRloc));
+  lispAppHelper.AddMapServerAddress (static_cast<Address> (msRloc));
+  lispAppHelper.SetAttribute ("MapRegisterRecords", UintegerValue (16));
+  lispAppHelper.SetAttribute ("MapRegisterInterval", TimeValue (Seconds (10)));
+  lispAppHelper.SetAttribute ("MapRegisterJitter", TimeValue (Seconds (1)));
+  ApplicationContainer xtrApps = lispAppHelper.Install (nodes.Get (0));
+  xtrApps.Start (Seconds (1.0));
+  xtrApps.Stop (Seconds (40.0));
+  xtrApps.Get (0)->TraceConnectWithoutContext ("MapRegisterTx",
+                                               MakeCallback (&MapRegisterRefreshTestCase::MapRegisterTx, this));
+
+  MapServerDdtHelper msHelper;
+  ApplicationContainer msApps = msHelper.Install (nodes.Get (1));
+  msApps.Start (Seconds (0.0));
+  msApps.Stop (Seconds (40.0));
+
+  // One EID-Prefix gains a locator and another one is added
+  Simulator::Schedule (Seconds (15.0), &InsertDatabaseLocator, database, Ipv4Address ("10.0.0.0"),
+                       Ipv4Address ("192.168.2.1"));
+  Simulator::Schedule (Seconds (15.0), &InsertDatabaseLocator, database, Ipv4Address ("10.0.100.0"), xtrRloc);
+
+  Simulator::Stop (Seconds (40.0));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_records.size (), 4u, "three Map-Registers at start-up, one for the changes");
+  if (m_records.size () == 4)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_records[0], 16u, "full Map-Register");
+      NS_TEST_ASSERT_MSG_EQ (m_records[1], 16u, "full Map-Register");
+      NS_TEST_ASSERT_MSG_EQ (m_records[2], 8u, "remaining records");
+      NS_TEST_ASSERT_MSG_EQ (m_records[3], 2u, "only the changed records");
+      NS_TEST_ASSERT_MSG_LT (m_times[0], Seconds (2.1), "start-up registration within the jitter");
+      NS_TEST_ASSERT_MSG_GT (m_times[3], Seconds (15.0), "changes registered at the next refresh");
+      NS_TEST_ASSERT_MSG_LT (m_times[3], Seconds (25.0), "changes registered at the next refresh");
+    }
+  Ptr<MapTables> msDatabase = DynamicCast<MapServerDdt> (msApps.Get (0))->GetMapTablesV4 ();
+  NS_TEST_ASSERT_MSG_EQ (msDatabase->GetNMapEntriesLispDataBase (), 1 + 41, "every EID-Prefix is registered next to the MS entry");
+  NS_TEST_ASSERT_MSG_NE (msDatabase->DatabaseLookup (Ipv4Address ("10.0.0.1"))->FindLocator (Ipv4Address ("192.168.2.1")), 0,
+                         "the new locator is registered");
+  Simulator::Destroy ();
+}
+
+// ================================================================================================
+
+class LostMapRegisterTestCase : public TestCase
+{
+public:
+  LostMapRegisterTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  void MapRegisterTx (Ptr<const Packet> p);
+
+  std::vector<uint32_t> m_records;
+};
+
+LostMapRegisterTestCase::LostMapRegisterTestCase ()
+  : TestCase ("The xTR registers again the changes whose Map-Register is not acknowledged")
+{
+}
+
+void
+LostMapRegisterTestCase::MapRegisterTx (Ptr<const Packet> p)
+{
+  uint8_t buf[4];
+  p->CopyData (buf, 4);
+  m_records.push_back (buf[3]);
+}
+
+void
+LostMapRegisterTestCase::DoRun (void)
+{
+  // xTR (n0) <-----> MS (n1)
+  PacketMetadata::Enable ();
+
+  NodeContainer nodes;
+  nodes.Create (2);
+  InternetStackHelper internet;
+  internet.Install (nodes);
+  PointToPointHelper p2p;
+  p2p.SetDeviceAttribute ("DataRate", StringValue ("5Mbps"));
+  p2p.SetChannelAttribute ("Delay", StringValue ("2ms"));
+  NetDeviceContainer devices = p2p.Install (nodes);
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase ("192.168.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer interfaces = ipv4.Assign (devices);
+  Ipv4Address xtrRloc = interfaces.GetAddress (0);
+  Ipv4Address msRloc = interfaces.GetAddress (1);
+
+  LispHelper lispHelper;
+  lispHelper.AddRlocToSet (xtrRloc);
+  lispHelper.AddRlocToSet (msRloc);
+  lispHelper.Install (nodes);
+  Ptr<MapTables> database = lispHelper.CreateMapTables ();
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      database->InsertLocator (Ipv4Address (0x0a000000 + (i << 8)), Ipv4Mask ("255.255.255.0"), xtrRloc, 200, 30,
+                               MapTables::IN_DATABASE, true);
+    }
+  lispHelper.SetMapTablesForEtr (xtrRloc, database, lispHelper.CreateMapTables ());
+  Ptr<MapTables> msLocalDatabase = lispHelper.CreateMapTables ();
+  msLocalDatabase->InsertLocator (msRloc, Ipv4Mask ("255.255.255.255"), msRloc, 200, 30, MapTables::IN_DATABASE, true);
+  lispHelper.SetMapTablesForEtr (msRloc, msLocalDatabase, lispHelper.CreateMapTables ());
+  lispHelper.InstallMapTables (nodes);
+
+  // Unchanged records are never registered again (MapRegisterRefresh is 0),
+  // and the lost ones only at the next refresh
+  LispEtrItrAppHelper lispAppHelper;
+  lispAppHelper.AddMapResolverRlocs (Create<Locator> (msRloc));
+  lispAppHelper.AddMapServerAddress (static_cast<Address> (msRloc));
+  lispAppHelper.SetAttribute ("MapRegisterInterval", TimeValue (Seconds (10)));
+  lispAppHelper.SetAttribute ("MapRegisterRetransmit", TimeValue (Seconds (0)));
+  lispAppHelper.SetAttribute ("MapRegisterJitter", TimeValue (Seconds (1)));
+  ApplicationContainer xtrApps = lispAppHelper.Install (nodes.Get (0));
+  xtrApps.Start (Seconds (1.0));
+  xtrApps.Stop (Seconds (40.0));
+  xtrApps.Get (0)->TraceConnectWithoutContext ("MapRegisterTx",
+                                               MakeCallback (&LostMapRegisterTestCase::MapRegisterTx, this));
+
+  MapServerDdtHelper msHelper;
+  ApplicationContainer msApps = msHelper.Install (nodes.Get (1));
+  msApps.Start (Seconds (0.0));
+  msApps.Stop (Seconds (40.0));
+
+  // The Map-Register of the change, at the refresh after 15s, is lost
+  Ptr<RateErrorModel> lossModel = CreateObject<RateErrorModel> ();
+  lossModel->SetRate (1.0);
+  lossModel->SetUnit (RateErrorModel::ERROR_UNIT_PACKET);
+  lossModel->Disable ();
+  devices.Get (1)->SetAttribute ("ReceiveErrorModel", PointerValue (lossModel));
+  Simulator::Schedule (Seconds (14.0), &ErrorModel::Enable, lossModel);
+  Simulator::Schedule (Seconds (26.0), &ErrorModel::Disable, lossModel);
+  Simulator::Schedule (Seconds (15.0), &InsertDatabaseLocator, database, Ipv4Address ("10.0.0.0"),
+                       Ipv4Address ("192.168.2.1"));
+
+  Simulator::Stop (Seconds (40.0));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_records.size (), 3u, "start-up, the lost change, and the change again");
+  if (m_records.size () == 3)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_records[0], 4u, "every record at start-up");
+      NS_TEST_ASSERT_MSG_EQ (m_records[1], 1u, "only the changed record");
+      NS_TEST_ASSERT_MSG_EQ (m_records[2], 1u, "only the unacknowledged record");
+    }
+  Ptr<MapTables> msDatabase = DynamicCast<MapServerDdt> (msApps.Get (0))->GetMapTablesV4 ();
+  NS_TEST_ASSERT_MSG_NE (msDatabase->DatabaseLookup (Ipv4Address ("10.0.0.1"))->FindLocator (Ipv4Address ("192.168.2.1")), 0,
+                         "the change is registered despite the lost Map-Register");
+  Simulator::Destroy ();
+}
+
+// ================================================================================================
+
+class MapRegisterRetransmitTestCase : public TestCase
+{
+public:
+  MapRegisterRetransmitTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  void MapRegisterTx (Ptr<const Packet> p);
+
+  std::vector<Time> m_times;
+};
+
+MapRegisterRetransmitTestCase::MapRegisterRetransmitTestCase ()
+  : TestCase ("Without refresh, the xTR registers again with the Map-Servers that did not acknowledge a record")
+{
+}
+
+void
+MapRegisterRetransmitTestCase::MapRegisterTx (Ptr<const Packet> p)
+{
+  m_times.push_back (Simulator::Now ());
+}
+
+void
+MapRegisterRetransmitTestCase::DoRun (void)
+{
+  /* Topology:  xTR (n0) --- R (n1) --- MS0 (n2)
+                              |
+                              MS1 (n3)
+
+     The EID-Prefix spans several shards: it is registered with both
+     Map-Servers. Only MS1 loses the first Map-Register.
+  */
+  PacketMetadata::Enable ();
+
+  NodeContainer nodes;
+  nodes.Create (4);
+  InternetStackHelper internet;
+  internet.Install (nodes);
+  PointToPointHelper p2p;
+  p2p.SetDeviceAttribute ("DataRate", StringValue ("5Mbps"));
+  p2p.SetChannelAttribute ("Delay", StringValue ("2ms"));
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase ("192.168.1.0", "255.255.255.0");
+  Ipv4Address xtrRloc = ipv4.Assign (p2p.Install (nodes.Get (0), nodes.Get (1))).GetAddress (0);
+  ipv4.SetBase ("192.168.2.0", "255.255.255.0");
+  Ipv4Address ms0Rloc = ipv4.Assign (p2p.Install (nodes.Get (2), nodes.Get (1))).GetAddress (0);
+  ipv4.SetBase ("192.168.3.0", "255.255.255.0");
+  NetDeviceContainer ms1Devices = p2p.Install (nodes.Get (3), nodes.Get (1));
+  Ipv4Address ms1Rloc = ipv4.Assign (ms1Devices).GetAddress (0);
+  Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+
+  NodeContainer lispRouters (nodes.Get (0), nodes.Get (2), nodes.Get (3));
+  LispHelper lispHelper;
+  lispHelper.AddRlocToSet (xtrRloc);
+  lispHelper.AddRlocToSet (ms0Rloc);
+  lispHelper.AddRlocToSet (ms1Rloc);
+  lispHelper.Install (lispRouters);
+  Ptr<MapTables> database = lispHelper.CreateMapTables ();
+  database->InsertLocator (Ipv4Address ("10.0.0.0"), Ipv4Mask ("255.255.0.0"), xtrRloc, 200, 30,
+                           MapTables::IN_DATABASE, true);
+  lispHelper.SetMapTablesForEtr (xtrRloc, database, lispHelper.CreateMapTables ());
+  Ipv4Address msRlocs[] = { ms0Rloc, ms1Rloc };
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      Ptr<MapTables> msLocalDatabase = lispHelper.CreateMapTables ();
+      msLocalDatabase->InsertLocator (msRlocs[i], Ipv4Mask ("255.255.255.255"), msRlocs[i], 200, 30,
+                                      MapTables::IN_DATABASE, true);
+      lispHelper.SetMapTablesForEtr (msRlocs[i], msLocalDatabase, lispHelper.CreateMapTables ());
+    }
+  lispHelper.InstallMapTables (lispRouters);
+
+  Ptr<MapServerShards> shards = Create<MapServerShards> ();
+  shards->AddMapServer (ms0Rloc);
+  shards->AddMapServer (ms1Rloc);
+
+  // MapRegisterInterval is 0: no refresh
+  LispEtrItrAppHelper lispAppHelper;
+  lispAppHelper.AddMapResolverRlocs (Create<Locator> (ms0Rloc));
+  lispAppHelper.AddMapServerAddress (static_cast<Address> (ms0Rloc));
+  lispAppHelper.SetMapServerShards (shards);
+  ApplicationContainer xtrApps = lispAppHelper.Install (nodes.Get (0));
+  xtrApps.Start (Seconds (1.0));
+  xtrApps.Stop (Seconds (10.0));
+  xtrApps.Get (0)->TraceConnectWithoutContext ("MapRegisterTx",
+                                               MakeCallback (&MapRegisterRetransmitTestCase::MapRegisterTx, this));
+
+  MapServerDdtHelper msHelper;
+  ApplicationContainer msApps = msHelper.Install (NodeContainer (nodes.Get (2), nodes.Get (3)));
+  msApps.Start (Seconds (0.0));
+  msApps.Stop (Seconds (10.0));
+
+  Ptr<RateErrorModel> lossModel = CreateObject<RateErrorModel> ();
+  lossModel->SetRate (1.0);
+  lossModel->SetUnit (RateErrorModel::ERROR_UNIT_PACKET);
+  ms1Devices.Get (0)->SetAttribute ("ReceiveErrorModel", PointerValue (lossModel));
+  Simulator::Schedule (Seconds (1.5), &ErrorModel::Disable, lossModel);
+
+  Simulator::Stop (Seconds (10.0));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_times.size (), 3u, "one Map-Register per Map-Server, then one to MS1 only");
+  if (m_times.size () == 3)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_times[2] - m_times[1], Seconds (1.0), "after the retransmission delay");
+    }
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      Ptr<MapTables> msDatabase = DynamicCast<MapServerDdt> (msApps.Get (i))->GetMapTablesV4 ();
+      NS_TEST_ASSERT_MSG_NE (msDatabase->DatabaseLookup (Ipv4Address ("10.0.0.1")), 0,
+                             "the EID-Prefix is registered with MS" << i);
+    }
+  Simulator::Destroy ();
+}
+
+// ================================================================================================
+
+class MapRegisterTestSuite : public TestSuite
+{
+public:
+  MapRegisterTestSuite ();
+};
+
+MapRegisterTestSuite::MapRegisterTestSuite ()
+  : TestSuite ("lisp-map-register", UNIT)
+{
+  // First, as the LISP data plane needs the packet metadata from the start
+  AddTestCase (new MapRegisterRefreshTestCase, TestCase::QUICK);
+  AddTestCase (new LostMapRegisterTestCase, TestCase::QUICK);
+  AddTestCase (new MapRegisterRetransmitTestCase, TestCase::QUICK);
+}
+
+static MapRegisterTestSuite mapRegisterTestSuite;
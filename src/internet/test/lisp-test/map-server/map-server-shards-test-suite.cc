@@ -0,0 +1,266 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <map>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/map-server-shards.h"
+#include "ns3/map-server-ddt.h"
+#include "ns3/map-server-helper.h"
+#include "ns3/map-resolver-helper.h"
+
+#include "ns3/test.h"
+
+using namespace ns3;
+
+// ================================================================================================
+
+class MapServerShardsTestCase : public TestCase
+{
+public:
+  MapServerShardsTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+MapServerShardsTestCase::MapServerShardsTestCase ()
+  : TestCase ("The shards are spread over the Map-Servers and move little when one joins")
+{
+}
+
+void
+MapServerShardsTestCase::DoRun (void)
+{
+  const uint32_t nShards = 4096;
+  Ptr<MapServerShards> shards = Create<MapServerShards> ();
+  for (uint32_t i = 1; i <= 4; i++)
+    {
+      shards->AddMapServer (Ipv4Address (0xc0a80000 + i));
+    }
+  shards->AddMapServer (Ipv4Address (0xc0a80001));
+  NS_TEST_ASSERT_MSG_EQ (shards->GetNMapServers (), 4u, "a Map-Server is added once");
+
+  std::vector<Address> owners;
+  std::map<Address, uint32_t> load;
+  for (uint32_t i = 0; i < nShards; i++)
+    {
+      Ipv4Address prefix (0x0a000000 + (i << 8));
+      owners.push_back (shards->GetMapServer (prefix));
+      load[owners.back ()]++;
+      NS_TEST_ASSERT_MSG_EQ (shards->GetMapServer (Ipv4Address (prefix.Get () + 42)), owners.back (),
+                             "an EID belongs to the shard of its /24");
+    }
+  for (std::map<Address, uint32_t>::const_iterator it = load.begin (); it != load.end (); ++it)
+    {
+      NS_TEST_ASSERT_MSG_GT (it->second, nShards / 8, "no Map-Server is starved");
+      NS_TEST_ASSERT_MSG_LT (it->second, nShards / 2, "no Map-Server owns half the shards");
+    }
+
+  // A new Map-Server only takes shards, about 1/5 of them
+  Ipv4Address newMapServer (0xc0a80005);
+  shards->AddMapServer (newMapServer);
+  uint32_t moved = 0;
+  for (uint32_t i = 0; i < nShards; i++)
+    {
+      Address owner = shards->GetMapServer (Ipv4Address (0x0a000000 + (i << 8)));
+      if (owner != owners[i])
+        {
+          NS_TEST_ASSERT_MSG_EQ (owner, Address (newMapServer), "shards only move to the new Map-Server");
+          moved++;
+        }
+    }
+  NS_TEST_ASSERT_MSG_GT (moved, nShards / 10, "the new Map-Server takes its share");
+  NS_TEST_ASSERT_MSG_LT (moved, nShards * 3 / 10, "most shards stay in place");
+
+  shards->RemoveMapServer (newMapServer);
+  for (uint32_t i = 0; i < nShards; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (shards->GetMapServer (Ipv4Address (0x0a000000 + (i << 8))), owners[i],
+                             "removing the Map-Server restores the assignment");
+    }
+
+  // Registration targets
+  NS_TEST_ASSERT_MSG_EQ (shards->GetMapServers (Ipv4Address ("10.0.1.0"), 24).size (), 1u, "a /24 has one shard");
+  NS_TEST_ASSERT_MSG_EQ (shards->GetMapServers (Ipv4Address ("10.0.1.128"), 25)[0], owners[1],
+                         "a longer prefix belongs to the shard of its /24");
+  NS_TEST_ASSERT_MSG_EQ (shards->GetMapServers (Ipv4Address ("10.0.0.0"), 16).size (), 4u,
+                         "a shorter prefix is registered with every Map-Server");
+  NS_TEST_ASSERT_MSG_EQ (shards->GetMapServers (Ipv6Address ("2001:db8:1::"), 48).size (), 1u, "a /48 has one shard");
+  NS_TEST_ASSERT_MSG_EQ (shards->GetMapServer (Ipv6Address ("2001:db8:1::1")),
+                         shards->GetMapServer (Ipv6Address ("2001:db8:1:ffff::1")),
+                         "an IPv6 EID belongs to the shard of its /48");
+}
+
+// ================================================================================================
+
+class ShardedMappingSystemTestCase : public TestCase
+{
+public:
+  ShardedMappingSystemTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  void RxSink (Ptr<const Packet> p);
+
+  bool m_receivedPacket;
+};
+
+ShardedMappingSystemTestCase::ShardedMappingSystemTestCase ()
+  : TestCase ("The xTRs register with, and the Map-Resolver asks, the Map-Server of each shard"),
+    m_receivedPacket (false)
+{
+}
+
+void
+ShardedMappingSystemTestCase::RxSink (Ptr<const Packet> p)
+{
+  m_receivedPacket = true;
+}
+
+void
+ShardedMappingSystemTestCase::DoRun (void)
+{
+  /* Topology:         MR (n5)  MS0 (n6)  MS1 (n7)
+                          \       |       /
+                xTR1 (n1) <----> R (n2) <-----> xTR2 (n3)
+                /               (non-LISP)        \
+               /                                   \
+            n0 (non-LISP)                         n4 (non-LISP)
+  */
+  PacketMetadata::Enable ();
+
+  NodeContainer nodes;
+  nodes.Create (8);
+
+  InternetStackHelper internet;
+  internet.Install (nodes);
+
+  PointToPointHelper p2p;
+  p2p.SetDeviceAttribute ("DataRate", StringValue ("5Mbps"));
+  p2p.SetChannelAttribute ("Delay", StringValue ("2ms"));
+
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase ("10.1.1.0", "255.255.255.0");
+  ipv4.Assign (p2p.Install (nodes.Get (0), nodes.Get (1)));
+  ipv4.SetBase ("192.168.1.0", "255.255.255.0");
+  ipv4.Assign (p2p.Install (nodes.Get (1), nodes.Get (2)));
+  ipv4.SetBase ("192.168.2.0", "255.255.255.0");
+  ipv4.Assign (p2p.Install (nodes.Get (2), nodes.Get (3)));
+  ipv4.SetBase ("10.1.2.0", "255.255.255.0");
+  Ipv4InterfaceContainer ixTR2_in4 = ipv4.Assign (p2p.Install (nodes.Get (3), nodes.Get (4)));
+  ipv4.SetBase ("192.168.3.0", "255.255.255.0");
+  Ipv4InterfaceContainer iR_iMR = ipv4.Assign (p2p.Install (nodes.Get (2), nodes.Get (5)));
+  ipv4.SetBase ("192.168.4.0", "255.255.255.0");
+  Ipv4InterfaceContainer iR_iMS0 = ipv4.Assign (p2p.Install (nodes.Get (2), nodes.Get (6)));
+  ipv4.SetBase ("192.168.5.0", "255.255.255.0");
+  Ipv4InterfaceContainer iR_iMS1 = ipv4.Assign (p2p.Install (nodes.Get (2), nodes.Get (7)));
+
+  Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+
+  NodeContainer lispRouters = NodeContainer (nodes.Get (1), nodes.Get (3), nodes.Get (5), nodes.Get (6));
+  lispRouters.Add (nodes.Get (7));
+  NodeContainer xTRs = NodeContainer (nodes.Get (1), nodes.Get (3));
+
+  LispHelper lispHelper;
+  lispHelper.BuildRlocsSet ("src/internet/test/lisp-test/simple-lisp/simple_lisp_rlocs.txt");
+  // The second Map-Server is not in the configuration files
+  lispHelper.AddRlocToSet (iR_iMS1.GetAddress (1));
+  lispHelper.Install (lispRouters);
+  lispHelper.BuildMapTables2 ("src/internet/test/lisp-test/simple-lisp/simple_lisp_rlocs_config_xml.txt");
+  lispHelper.SetMapTablesForEtr (iR_iMS1.GetAddress (1), lispHelper.CreateMapTables (), lispHelper.CreateMapTables ());
+  lispHelper.InstallMapTables (lispRouters);
+
+  Ptr<MapServerShards> shards = Create<MapServerShards> ();
+  shards->AddMapServer (iR_iMS0.GetAddress (1));
+  shards->AddMapServer (iR_iMS1.GetAddress (1));
+
+  LispEtrItrAppHelper lispAppHelper;
+  lispAppHelper.AddMapResolverRlocs (Create<Locator> (iR_iMR.GetAddress (1)));
+  lispAppHelper.AddMapServerAddress (static_cast<Address> (iR_iMS0.GetAddress (1)));
+  lispAppHelper.SetMapServerShards (shards);
+  ApplicationContainer xtrApps = lispAppHelper.Install (xTRs);
+  xtrApps.Start (Seconds (1.0));
+  xtrApps.Stop (Seconds (20.0));
+
+  MapResolverDdtHelper mrHelper;
+  mrHelper.SetMapServerAddress (iR_iMS0.GetAddress (1));
+  mrHelper.SetMapServerShards (shards);
+  ApplicationContainer mrApps = mrHelper.Install (nodes.Get (5));
+  mrApps.Start (Seconds (0.0));
+  mrApps.Stop (Seconds (20.0));
+
+  MapServerDdtHelper msHelper;
+  ApplicationContainer msApps = msHelper.Install (NodeContainer (nodes.Get (6), nodes.Get (7)));
+  msApps.Start (Seconds (0.0));
+  msApps.Stop (Seconds (20.0));
+
+  UdpEchoServerHelper echoServer (9);
+  ApplicationContainer serverApps = echoServer.Install (nodes.Get (4));
+  serverApps.Start (Seconds (1.0));
+  serverApps.Stop (Seconds (20.0));
+
+  UdpEchoClientHelper echoClient (ixTR2_in4.GetAddress (1), 9);
+  echoClient.SetAttribute ("MaxPackets", UintegerValue (10));
+  echoClient.SetAttribute ("Interval", TimeValue (Seconds (1.0)));
+  echoClient.SetAttribute ("PacketSize", UintegerValue (1024));
+  ApplicationContainer clientApps = echoClient.Install (nodes.Get (0));
+  clientApps.Start (Seconds (4.0));
+  clientApps.Stop (Seconds (20.0));
+  clientApps.Get (0)->TraceConnectWithoutContext ("Rx", MakeCallback (&ShardedMappingSystemTestCase::RxSink, this));
+
+  Simulator::Stop (Seconds (20.0));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_receivedPacket, true, "No communication between both ends");
+  const char *prefixes[] = { "10.1.1.0", "10.1.2.0", "192.168.1.0", "192.168.2.0" };
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      Ipv4Address prefix (prefixes[i]);
+      for (uint32_t ms = 0; ms < msApps.GetN (); ms++)
+        {
+          Address msAddress = ms == 0 ? iR_iMS0.GetAddress (1) : iR_iMS1.GetAddress (1);
+          bool registered = DynamicCast<MapServerDdt> (msApps.Get (ms))->GetMapTablesV4 ()->DatabaseLookup (prefix) != 0;
+          NS_TEST_ASSERT_MSG_EQ (registered, (shards->GetMapServer (prefix) == msAddress),
+                                 prefix << " registered with the Map-Server of its shard only");
+        }
+    }
+  Simulator::Destroy ();
+}
+
+// ================================================================================================
+
+class MapServerShardsTestSuite : public TestSuite
+{
+public:
+  MapServerShardsTestSuite ();
+};
+
+MapServerShardsTestSuite::MapServerShardsTestSuite ()
+  : TestSuite ("lisp-map-server-shards", UNIT)
+{
+  // First, as the LISP data plane needs the packet metadata from the start
+  AddTestCase (new ShardedMappingSystemTestCase, TestCase::QUICK);
+  AddTestCase (new MapServerShardsTestCase, TestCase::QUICK);
+}
+
+static MapServerShardsTestSuite mapServerShardsTestSuite;
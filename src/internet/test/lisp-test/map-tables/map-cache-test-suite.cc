@@ -0,0 +1,167 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/simple-map-tables.h"
+
+#include "ns3/test.h"
+
+using namespace ns3;
+
+static Ptr<MapTables>
+CreateMapTables (std::string typeId, uint32_t capacity)
+{
+  ObjectFactory factory;
+  factory.SetTypeId (typeId);
+  factory.Set ("CacheCapacity", UintegerValue (capacity));
+  return factory.Create<MapTables> ();
+}
+
+/// Add 10.0.<i>.0/24 to the cache, with the given TTL (minutes).
+static void
+AddCacheEntry (Ptr<MapTables> mapTables, uint8_t i, uint32_t ttl)
+{
+  Ptr<Locator> locator = Create<Locator> (Ipv4Address ("192.168.0.1"));
+  locator->SetRlocMetrics (Create<RlocMetrics> (200, 30, true));
+  Ptr<MapEntry> entry = Create<MapEntryImpl> (locator);
+  entry->SetTtl (ttl);
+  mapTables->SetEntry (Ipv4Address ((10 << 24) | (i << 8)), Ipv4Mask ("255.255.255.0"), entry,
+                       MapTables::IN_CACHE);
+}
+
+static bool
+IsCached (Ptr<MapTables> mapTables, uint8_t i)
+{
+  return mapTables->CacheLookup (Ipv4Address ((10 << 24) | (i << 8) | 1)) != 0;
+}
+
+// ================================================================================================
+
+class MapCacheTtlTestCase : public TestCase
+{
+public:
+  MapCacheTtlTestCase (std::string typeId);
+
+private:
+  virtual void DoRun (void);
+  void Check (bool first, bool second, uint32_t expirations);
+
+  std::string m_typeId;
+  Ptr<MapTables> m_mapTables;
+};
+
+MapCacheTtlTestCase::MapCacheTtlTestCase (std::string typeId)
+  : TestCase ("Map-cache entries expire after their Record TTL: " + typeId),
+    m_typeId (typeId)
+{
+}
+
+void
+MapCacheTtlTestCase::Check (bool first, bool second, uint32_t expirations)
+{
+  NS_TEST_EXPECT_MSG_EQ (IsCached (m_mapTables, 1), first, "10.0.1.0/24 at " << Simulator::Now ().GetSeconds ());
+  NS_TEST_EXPECT_MSG_EQ (IsCached (m_mapTables, 2), second, "10.0.2.0/24 at " << Simulator::Now ().GetSeconds ());
+  NS_TEST_EXPECT_MSG_EQ (m_mapTables->GetCacheExpirations (), expirations, "expired entries");
+}
+
+void
+MapCacheTtlTestCase::DoRun (void)
+{
+  m_mapTables = CreateMapTables (m_typeId, 0);
+  AddCacheEntry (m_mapTables, 1, 1);
+  AddCacheEntry (m_mapTables, 2, 0xffffffff);
+
+  Simulator::Schedule (Seconds (30), &MapCacheTtlTestCase::Check, this, true, true, 0);
+  Simulator::Schedule (Seconds (61), &MapCacheTtlTestCase::Check, this, false, true, 1);
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_mapTables->GetNMapEntriesLispCache (), 1, "the expired entry is gone");
+  m_mapTables = 0;
+}
+
+// ================================================================================================
+
+class MapCacheCapacityTestCase : public TestCase
+{
+public:
+  MapCacheCapacityTestCase (std::string typeId);
+
+private:
+  virtual void DoRun (void);
+
+  std::string m_typeId;
+};
+
+MapCacheCapacityTestCase::MapCacheCapacityTestCase (std::string typeId)
+  : TestCase ("Full map-cache evicts with CLOCK: " + typeId),
+    m_typeId (typeId)
+{
+}
+
+void
+MapCacheCapacityTestCase::DoRun (void)
+{
+  Ptr<MapTables> mapTables = CreateMapTables (m_typeId, 3);
+  AddCacheEntry (mapTables, 1, 0xffffffff);
+  AddCacheEntry (mapTables, 2, 0xffffffff);
+  AddCacheEntry (mapTables, 3, 0xffffffff);
+  NS_TEST_ASSERT_MSG_EQ (mapTables->GetNMapEntriesLispCache (), 3, "cache is full");
+
+  // Every entry got a second chance: the hand clears them all and evicts the first one
+  AddCacheEntry (mapTables, 4, 0xffffffff);
+  NS_TEST_ASSERT_MSG_EQ (mapTables->GetNMapEntriesLispCache (), 3, "capacity is honoured");
+  NS_TEST_ASSERT_MSG_EQ (IsCached (mapTables, 1), false, "10.0.1.0/24 evicted");
+
+  // 10.0.2.0/24 is used again, so 10.0.3.0/24 goes next
+  NS_TEST_ASSERT_MSG_EQ (IsCached (mapTables, 2), true, "10.0.2.0/24 is cached");
+  AddCacheEntry (mapTables, 5, 0xffffffff);
+  NS_TEST_ASSERT_MSG_EQ (IsCached (mapTables, 3), false, "10.0.3.0/24 evicted");
+  NS_TEST_ASSERT_MSG_EQ (IsCached (mapTables, 2), true, "10.0.2.0/24 is kept");
+  NS_TEST_ASSERT_MSG_EQ (IsCached (mapTables, 4), true, "10.0.4.0/24 is kept");
+  NS_TEST_ASSERT_MSG_EQ (IsCached (mapTables, 5), true, "10.0.5.0/24 is kept");
+  NS_TEST_ASSERT_MSG_EQ (mapTables->GetCacheEvictions (), 2, "two evictions");
+
+  // Replacing the mapping of a cached EID-prefix evicts nothing
+  AddCacheEntry (mapTables, 5, 0xffffffff);
+  NS_TEST_ASSERT_MSG_EQ (mapTables->GetCacheEvictions (), 2, "no eviction on update");
+  NS_TEST_ASSERT_MSG_EQ (mapTables->GetNMapEntriesLispCache (), 3, "still full");
+
+  mapTables->WipeCache ();
+  AddCacheEntry (mapTables, 1, 0xffffffff);
+  NS_TEST_ASSERT_MSG_EQ (mapTables->GetNMapEntriesLispCache (), 1, "wiped cache");
+  NS_TEST_ASSERT_MSG_EQ (mapTables->GetCacheEvictions (), 2, "no eviction after wipe");
+}
+
+// ================================================================================================
+
+class MapCacheTestSuite : public TestSuite
+{
+public:
+  MapCacheTestSuite ();
+};
+
+MapCacheTestSuite::MapCacheTestSuite ()
+  : TestSuite ("lisp-map-cache", UNIT)
+{
+  AddTestCase (new MapCacheTtlTestCase ("ns3::SimpleMapTables"), TestCase::QUICK);
+  AddTestCase (new MapCacheTtlTestCase ("ns3::TrieMapTables"), TestCase::QUICK);
+  AddTestCase (new MapCacheCapacityTestCase ("ns3::SimpleMapTables"), TestCase::QUICK);
+  AddTestCase (new MapCacheCapacityTestCase ("ns3::TrieMapTables"), TestCase::QUICK);
+}
+
+static MapCacheTestSuite mapCacheTestSuite;
@@ -0,0 +1,188 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/simple-map-tables.h"
+
+#include "ns3/test.h"
+
+using namespace ns3;
+
+static Ptr<Locator>
+AddLocator (Ptr<MapEntry> entry, const char *rloc, uint8_t priority, uint8_t weight)
+{
+  Ptr<Locator> locator = Create<Locator> (Ipv4Address (rloc));
+  locator->SetRlocMetrics (Create<RlocMetrics> (priority, weight, true));
+  entry->InsertLocator (locator);
+  return locator;
+}
+
+/// Number of slots of the lookup table owned by an RLOC.
+static uint32_t
+CountSlots (Ptr<MapEntry> entry, Ptr<Locator> locator)
+{
+  uint32_t count = 0;
+  for (uint32_t hash = 0; hash < RlocLookupTable::SIZE; hash++)
+    {
+      if (entry->RlocSelection (hash) == locator)
+        {
+          count++;
+        }
+    }
+  return count;
+}
+
+// ================================================================================================
+
+class RlocLookupTableWeightTestCase : public TestCase
+{
+public:
+  RlocLookupTableWeightTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+RlocLookupTableWeightTestCase::RlocLookupTableWeightTestCase ()
+  : TestCase ("Flows are split among the best priority RLOCs according to their weight")
+{
+}
+
+void
+RlocLookupTableWeightTestCase::DoRun (void)
+{
+  Ptr<MapEntry> entry = Create<MapEntryImpl> ();
+  Ptr<Locator> a = AddLocator (entry, "192.168.0.1", 1, 75);
+  Ptr<Locator> b = AddLocator (entry, "192.168.0.2", 1, 25);
+  Ptr<Locator> backup = AddLocator (entry, "192.168.0.3", 2, 100);
+
+  uint32_t slotsA = CountSlots (entry, a);
+  uint32_t slotsB = CountSlots (entry, b);
+  NS_TEST_ASSERT_MSG_EQ (slotsA + slotsB, RlocLookupTable::SIZE, "only priority 1 RLOCs are used");
+  NS_TEST_EXPECT_MSG_EQ_TOL (slotsA, 188u, 2u, "75% of the slots");
+  NS_TEST_EXPECT_MSG_EQ_TOL (slotsB, 63u, 2u, "25% of the slots");
+  NS_TEST_ASSERT_MSG_EQ (CountSlots (entry, backup), 0u, "priority 2 RLOC unused");
+
+  // Weight 0 RLOCs receive no traffic, unless all the weights are 0
+  b->GetRlocMetrics ()->SetWeight (0);
+  NS_TEST_ASSERT_MSG_EQ (CountSlots (entry, a), RlocLookupTable::SIZE, "weight 0 RLOC unused");
+  a->GetRlocMetrics ()->SetWeight (0);
+  NS_TEST_EXPECT_MSG_EQ_TOL (CountSlots (entry, a), 126u, 1u, "equal split of weights 0");
+  NS_TEST_EXPECT_MSG_EQ_TOL (CountSlots (entry, b), 125u, 1u, "equal split of weights 0");
+}
+
+// ================================================================================================
+
+class RlocLookupTablePriorityTestCase : public TestCase
+{
+public:
+  RlocLookupTablePriorityTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+RlocLookupTablePriorityTestCase::RlocLookupTablePriorityTestCase ()
+  : TestCase ("RLOCs of the next priority are used when the best ones are down")
+{
+}
+
+void
+RlocLookupTablePriorityTestCase::DoRun (void)
+{
+  Ptr<MapEntry> entry = Create<MapEntryImpl> ();
+  Ptr<Locator> primary = AddLocator (entry, "192.168.0.1", 1, 100);
+  Ptr<Locator> backup = AddLocator (entry, "192.168.0.2", 2, 100);
+  NS_TEST_ASSERT_MSG_EQ (entry->RlocSelection (42), primary, "primary RLOC");
+
+  primary->GetRlocMetrics ()->SetUp (false);
+  NS_TEST_ASSERT_MSG_EQ (entry->RlocSelection (42), backup, "backup RLOC when the primary is down");
+
+  backup->GetRlocMetrics ()->SetPriority (255);
+  NS_TEST_ASSERT_MSG_EQ (entry->RlocSelection (42), Ptr<Locator> (), "priority 255 means do not use");
+
+  primary->GetRlocMetrics ()->SetUp (true);
+  NS_TEST_ASSERT_MSG_EQ (entry->RlocSelection (42), primary, "primary RLOC is up again");
+}
+
+// ================================================================================================
+
+class RlocLookupTableDisruptionTestCase : public TestCase
+{
+public:
+  RlocLookupTableDisruptionTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+RlocLookupTableDisruptionTestCase::RlocLookupTableDisruptionTestCase ()
+  : TestCase ("Flows stick to their RLOC and few move when the RLOC set changes")
+{
+}
+
+void
+RlocLookupTableDisruptionTestCase::DoRun (void)
+{
+  Ptr<MapEntry> entry = Create<MapEntryImpl> ();
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      std::ostringstream rloc;
+      rloc << "192.168.0." << i + 1;
+      AddLocator (entry, rloc.str ().c_str (), 1, 25);
+    }
+  std::vector<Ptr<Locator> > before;
+  for (uint32_t hash = 0; hash < RlocLookupTable::SIZE; hash++)
+    {
+      before.push_back (entry->RlocSelection (hash));
+      NS_TEST_ASSERT_MSG_EQ (entry->RlocSelection (hash), before.back (), "same RLOC for the same flow");
+    }
+
+  // Withdrawing an RLOC only moves its own flows
+  Ptr<Locator> down = entry->GetLocators ()->GetLocatorByIdx (2);
+  down->GetRlocMetrics ()->SetUp (false);
+  uint32_t moved = 0;
+  for (uint32_t hash = 0; hash < RlocLookupTable::SIZE; hash++)
+    {
+      Ptr<Locator> locator = entry->RlocSelection (hash);
+      NS_TEST_ASSERT_MSG_NE (locator, down, "no flow to the RLOC that is down");
+      if (before[hash] != down && locator != before[hash])
+        {
+          moved++;
+        }
+    }
+  // Maglev tables are not perfectly stable, but close to
+  NS_TEST_EXPECT_MSG_LT (moved, RlocLookupTable::SIZE / 10, "few flows of the other RLOCs moved");
+}
+
+// ================================================================================================
+
+class RlocLookupTableTestSuite : public TestSuite
+{
+public:
+  RlocLookupTableTestSuite ();
+};
+
+RlocLookupTableTestSuite::RlocLookupTableTestSuite ()
+  : TestSuite ("lisp-rloc-lookup-table", UNIT)
+{
+  AddTestCase (new RlocLookupTableWeightTestCase, TestCase::QUICK);
+  AddTestCase (new RlocLookupTablePriorityTestCase, TestCase::QUICK);
+  AddTestCase (new RlocLookupTableDisruptionTestCase, TestCase::QUICK);
+}
+
+static RlocLookupTableTestSuite rlocLookupTableTestSuite;
@@ -0,0 +1,328 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <map>
+#include <cstring>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/lpm-trie.h"
+#include "ns3/trie-map-tables.h"
+
+#include "ns3/test.h"
+
+using namespace ns3;
+
+/**
+ * Small deterministic generator, so that the random tables below do not
+ * depend on the global RNG run number.
+ */
+static uint32_t
+NextRandom (uint32_t &state)
+{
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+// ================================================================================================
+
+class Ipv4LpmTrieTestCase : public TestCase
+{
+public:
+  Ipv4LpmTrieTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /// Linear scan of the reference table.
+  static uint32_t Reference (const std::map<std::pair<uint32_t, uint8_t>, uint32_t> &prefixes,
+                             uint32_t address);
+};
+
+Ipv4LpmTrieTestCase::Ipv4LpmTrieTestCase ()
+  : TestCase ("Ipv4LpmTrie: longest prefix match against a linear scan")
+{
+}
+
+uint32_t
+Ipv4LpmTrieTestCase::Reference (const std::map<std::pair<uint32_t, uint8_t>, uint32_t> &prefixes,
+                                uint32_t address)
+{
+  uint32_t best = Ipv4LpmTrie::NO_VALUE;
+  int32_t bestLen = -1;
+  for (std::map<std::pair<uint32_t, uint8_t>, uint32_t>::const_iterator it = prefixes.begin ();
+       it != prefixes.end (); ++it)
+    {
+      uint8_t len = it->first.second;
+      uint32_t mask = len == 0 ? 0 : 0xffffffff << (32 - len);
+      if ((address & mask) == it->first.first && len > bestLen)
+        {
+          best = it->second;
+          bestLen = len;
+        }
+    }
+  return best;
+}
+
+void
+Ipv4LpmTrieTestCase::DoRun (void)
+{
+  Ipv4LpmTrie trie;
+
+  // Nested prefixes, including the default route
+  trie.Insert (0x00000000, 0, 1);
+  trie.Insert (0x0a000000, 8, 2);
+  trie.Insert (0x0a010000, 16, 3);
+  trie.Insert (0x0a010200, 24, 4);
+  trie.Insert (0x0a010203, 32, 5);
+  NS_TEST_ASSERT_MSG_EQ (trie.Lookup (0x0b000000), 1, "default route");
+  NS_TEST_ASSERT_MSG_EQ (trie.Lookup (0x0a020000), 2, "10/8");
+  NS_TEST_ASSERT_MSG_EQ (trie.Lookup (0x0a010300), 3, "10.1/16");
+  NS_TEST_ASSERT_MSG_EQ (trie.Lookup (0x0a010204), 4, "10.1.2/24");
+  NS_TEST_ASSERT_MSG_EQ (trie.Lookup (0x0a010203), 5, "10.1.2.3/32");
+  NS_TEST_ASSERT_MSG_EQ (trie.ExactLookup (0x0a010000, 16), 3, "exact 10.1/16");
+  NS_TEST_ASSERT_MSG_EQ (trie.ExactLookup (0x0a010000, 17), Ipv4LpmTrie::NO_VALUE, "no 10.1/17");
+
+  // Removing a prefix exposes the covering one again
+  NS_TEST_ASSERT_MSG_EQ (trie.Remove (0x0a010200, 24), 4, "remove 10.1.2/24");
+  NS_TEST_ASSERT_MSG_EQ (trie.Lookup (0x0a010204), 3, "falls back to 10.1/16");
+  NS_TEST_ASSERT_MSG_EQ (trie.Lookup (0x0a010203), 5, "10.1.2.3/32 is kept");
+  NS_TEST_ASSERT_MSG_EQ (trie.Remove (0x0a010200, 24), Ipv4LpmTrie::NO_VALUE, "already removed");
+  trie.Remove (0x0a010203, 32);
+  trie.Remove (0x0a010000, 16);
+  trie.Remove (0x0a000000, 8);
+  trie.Remove (0x00000000, 0);
+  NS_TEST_ASSERT_MSG_EQ (trie.Lookup (0x0a010203), Ipv4LpmTrie::NO_VALUE, "empty trie");
+  NS_TEST_ASSERT_MSG_EQ (trie.GetNNodes (), 1, "only the root is left");
+
+  // Random prefixes, insertions and removals
+  std::map<std::pair<uint32_t, uint8_t>, uint32_t> reference;
+  uint32_t state = 0x12345678;
+  for (uint32_t i = 0; i < 2000; i++)
+    {
+      // Keep the prefixes in a few /8 so that they overlap
+      uint8_t len = NextRandom (state) % 33;
+      uint32_t prefix = ((NextRandom (state) % 4) << 24) | (NextRandom (state) & 0x00ffffff);
+      prefix &= len == 0 ? 0 : 0xffffffff << (32 - len);
+      if (NextRandom (state) % 3 == 0 && !reference.empty ())
+        {
+          std::map<std::pair<uint32_t, uint8_t>, uint32_t>::iterator it = reference.begin ();
+          std::advance (it, NextRandom (state) % reference.size ());
+          NS_TEST_ASSERT_MSG_EQ (trie.Remove (it->first.first, it->first.second), it->second,
+                                 "removed value");
+          reference.erase (it);
+        }
+      else
+        {
+          trie.Insert (prefix, len, i);
+          reference[std::make_pair (prefix, len)] = i;
+        }
+      uint32_t address = ((NextRandom (state) % 4) << 24) | (NextRandom (state) & 0x00ffffff);
+      NS_TEST_ASSERT_MSG_EQ (trie.Lookup (address), Reference (reference, address),
+                             "lookup of " << Ipv4Address (address));
+    }
+  NS_TEST_ASSERT_MSG_EQ (trie.GetNPrefixes (), reference.size (), "number of prefixes");
+}
+
+// ================================================================================================
+
+class Ipv6LpmTrieTestCase : public TestCase
+{
+public:
+  Ipv6LpmTrieTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+Ipv6LpmTrieTestCase::Ipv6LpmTrieTestCase ()
+  : TestCase ("Ipv6LpmTrie: longest prefix match against a linear scan")
+{
+}
+
+void
+Ipv6LpmTrieTestCase::DoRun (void)
+{
+  Ipv6LpmTrie trie;
+  uint8_t buf[16];
+
+  Ipv6Address ("2001:db8::").GetBytes (buf);
+  trie.Insert (buf, 32, 1);
+  Ipv6Address ("2001:db8:1::").GetBytes (buf);
+  trie.Insert (buf, 48, 2);
+  Ipv6Address ("2001:db8:1:2::").GetBytes (buf);
+  trie.Insert (buf, 64, 3);
+
+  Ipv6Address ("2001:db8:1:2::1").GetBytes (buf);
+  NS_TEST_ASSERT_MSG_EQ (trie.Lookup (buf), 3, "/64");
+  Ipv6Address ("2001:db8:1:3::1").GetBytes (buf);
+  NS_TEST_ASSERT_MSG_EQ (trie.Lookup (buf), 2, "/48");
+  Ipv6Address ("2001:db8:2::1").GetBytes (buf);
+  NS_TEST_ASSERT_MSG_EQ (trie.Lookup (buf), 1, "/32");
+  Ipv6Address ("2001:db9::1").GetBytes (buf);
+  NS_TEST_ASSERT_MSG_EQ (trie.Lookup (buf), Ipv6LpmTrie::NO_VALUE, "no match");
+
+  Ipv6Address ("2001:db8:1::").GetBytes (buf);
+  NS_TEST_ASSERT_MSG_EQ (trie.Remove (buf, 48), 2, "remove /48");
+  Ipv6Address ("2001:db8:1:3::1").GetBytes (buf);
+  NS_TEST_ASSERT_MSG_EQ (trie.Lookup (buf), 1, "falls back to /32");
+  Ipv6Address ("2001:db8:1:2::1").GetBytes (buf);
+  NS_TEST_ASSERT_MSG_EQ (trie.Lookup (buf), 3, "/64 is kept");
+
+  // Random prefixes, insertions and removals
+  trie.Clear ();
+  std::map<std::pair<std::string, uint8_t>, uint32_t> reference;
+  uint32_t state = 0x9abcdef0;
+  for (uint32_t i = 0; i < 1000; i++)
+    {
+      uint8_t prefix[16];
+      std::memset (prefix, 0, 16);
+      prefix[0] = 0x20;
+      prefix[1] = NextRandom (state) % 2;
+      for (uint32_t j = 2; j < 16; j++)
+        {
+          prefix[j] = NextRandom (state) & 0x03;
+        }
+      uint8_t len = NextRandom (state) % 129;
+      Ipv6Address masked = Ipv6Address (prefix).CombinePrefix (Ipv6Prefix (len));
+      masked.GetBytes (prefix);
+      std::string key (reinterpret_cast<char *> (prefix), 16);
+
+      if (NextRandom (state) % 3 == 0 && !reference.empty ())
+        {
+          std::map<std::pair<std::string, uint8_t>, uint32_t>::iterator it = reference.begin ();
+          std::advance (it, NextRandom (state) % reference.size ());
+          NS_TEST_ASSERT_MSG_EQ (trie.Remove (reinterpret_cast<const uint8_t *> (it->first.first.data ()),
+                                              it->first.second),
+                                 it->second, "removed value");
+          reference.erase (it);
+        }
+      else
+        {
+          trie.Insert (prefix, len, i);
+          reference[std::make_pair (key, len)] = i;
+        }
+
+      uint8_t address[16];
+      address[0] = 0x20;
+      address[1] = NextRandom (state) % 2;
+      for (uint32_t j = 2; j < 16; j++)
+        {
+          address[j] = NextRandom (state) & 0x03;
+        }
+      uint32_t expected = Ipv6LpmTrie::NO_VALUE;
+      int32_t expectedLen = -1;
+      for (std::map<std::pair<std::string, uint8_t>, uint32_t>::const_iterator it = reference.begin ();
+           it != reference.end (); ++it)
+        {
+          uint8_t len = it->first.second;
+          uint8_t netBuf[16];
+          std::memcpy (netBuf, it->first.first.data (), 16);
+          Ipv6Address net (netBuf);
+          if (Ipv6Address (address).CombinePrefix (Ipv6Prefix (len)) == net && len > expectedLen)
+            {
+              expected = it->second;
+              expectedLen = len;
+            }
+        }
+      NS_TEST_ASSERT_MSG_EQ (trie.Lookup (address), expected, "lookup of " << Ipv6Address (address));
+    }
+  NS_TEST_ASSERT_MSG_EQ (trie.GetNPrefixes (), reference.size (), "number of prefixes");
+}
+
+// ================================================================================================
+
+class TrieMapTablesTestCase : public TestCase
+{
+public:
+  TrieMapTablesTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+TrieMapTablesTestCase::TrieMapTablesTestCase ()
+  : TestCase ("TrieMapTables: EID-prefix lookups in the LISP database and cache")
+{
+}
+
+void
+TrieMapTablesTestCase::DoRun (void)
+{
+  Ptr<MapTables> mapTables = CreateObject<TrieMapTables> ();
+  Ipv4Address rloc1 ("192.168.1.1");
+  Ipv4Address rloc2 ("192.168.2.1");
+
+  // InsertLocator adds to the matching entry, so the /24 goes first
+  mapTables->InsertLocator (Ipv4Address ("10.1.2.0"), Ipv4Mask ("255.255.255.0"), rloc2, 200, 30,
+                            MapTables::IN_CACHE, true);
+  mapTables->InsertLocator (Ipv4Address ("10.1.0.0"), Ipv4Mask ("255.255.0.0"), rloc1, 200, 30,
+                            MapTables::IN_CACHE, true);
+  mapTables->InsertLocator (Ipv4Address ("172.16.0.0"), Ipv4Mask ("255.255.255.0"), rloc1, 200, 30,
+                            MapTables::IN_DATABASE, true);
+
+  NS_TEST_ASSERT_MSG_EQ (mapTables->GetNMapEntriesLispCache (), 2, "two cache entries");
+  NS_TEST_ASSERT_MSG_EQ (mapTables->GetNMapEntriesLispDataBase (), 1, "one database entry");
+
+  Ptr<MapEntry> entry = mapTables->CacheLookup (Ipv4Address ("10.1.2.3"));
+  NS_TEST_ASSERT_MSG_NE (entry, 0, "10.1.2.3 is in the cache");
+  NS_TEST_ASSERT_MSG_NE (entry->FindLocator (rloc2), 0, "most specific entry");
+  entry = mapTables->CacheLookup (Ipv4Address ("10.1.3.3"));
+  NS_TEST_ASSERT_MSG_NE (entry, 0, "10.1.3.3 is in the cache");
+  NS_TEST_ASSERT_MSG_NE (entry->FindLocator (rloc1), 0, "covering entry");
+  NS_TEST_ASSERT_MSG_EQ (mapTables->CacheLookup (Ipv4Address ("172.16.0.1")), 0, "not in cache");
+  NS_TEST_ASSERT_MSG_NE (mapTables->DatabaseLookup (Ipv4Address ("172.16.0.1")), 0, "in database");
+
+  // A second locator for an existing EID-prefix goes to the same entry
+  mapTables->InsertLocator (Ipv4Address ("10.1.2.0"), Ipv4Mask ("255.255.255.0"), rloc1, 200, 30,
+                            MapTables::IN_CACHE, true);
+  NS_TEST_ASSERT_MSG_EQ (mapTables->GetNMapEntriesLispCache (), 2, "still two cache entries");
+  entry = mapTables->CacheLookup (Ipv4Address ("10.1.2.3"));
+  NS_TEST_ASSERT_MSG_EQ (uint32_t (entry->GetLocators ()->GetNLocators ()), 2, "two locators");
+
+  std::list<Ptr<MapEntry> > entries;
+  mapTables->GetMapEntryList (MapTables::IN_CACHE, entries);
+  NS_TEST_ASSERT_MSG_EQ (entries.size (), 2u, "entry list");
+
+  mapTables->CacheDelete (Ipv4Address ("10.1.2.3"));
+  entry = mapTables->CacheLookup (Ipv4Address ("10.1.2.3"));
+  NS_TEST_ASSERT_MSG_NE (entry, 0, "covering entry after deletion");
+  NS_TEST_ASSERT_MSG_EQ (entry->FindLocator (rloc2), 0, "the /24 is gone");
+
+  mapTables->WipeCache ();
+  NS_TEST_ASSERT_MSG_EQ (mapTables->GetNMapEntriesLispCache (), 0, "empty cache");
+  NS_TEST_ASSERT_MSG_EQ (mapTables->CacheLookup (Ipv4Address ("10.1.2.3")), 0, "empty cache");
+  NS_TEST_ASSERT_MSG_EQ (mapTables->GetNMapEntriesLispDataBase (), 1, "database is kept");
+}
+
+// ================================================================================================
+
+class TrieMapTablesTestSuite : public TestSuite
+{
+public:
+  TrieMapTablesTestSuite ();
+};
+
+TrieMapTablesTestSuite::TrieMapTablesTestSuite ()
+  : TestSuite ("lisp-trie-map-tables", UNIT)
+{
+  AddTestCase (new Ipv4LpmTrieTestCase, TestCase::QUICK);
+  AddTestCase (new Ipv6LpmTrieTestCase, TestCase::QUICK);
+  AddTestCase (new TrieMapTablesTestCase, TestCase::QUICK);
+}
+
+static TrieMapTablesTestSuite trieMapTablesTestSuite;
@@ -0,0 +1,181 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/miss-queue.h"
+
+#include "ns3/test.h"
+
+using namespace ns3;
+
+static BufferedPacket
+MakePacket (const char *destination, uint32_t size)
+{
+  BufferedPacket packet;
+  packet.packet = Create<Packet> (size);
+  packet.source = Ipv4Address ("10.1.0.1");
+  packet.destination = Ipv4Address (destination);
+  packet.protocol = 6;
+  return packet;
+}
+
+// ================================================================================================
+
+class MissQueueOrderTestCase : public TestCase
+{
+public:
+  MissQueueOrderTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+MissQueueOrderTestCase::MissQueueOrderTestCase ()
+  : TestCase ("Packets covered by a new EID-prefix are dequeued in arrival order")
+{
+}
+
+void
+MissQueueOrderTestCase::DoRun (void)
+{
+  MissQueue queue;
+  queue.Enqueue (MakePacket ("10.2.0.1", 100));
+  queue.Enqueue (MakePacket ("10.3.0.1", 200));
+  queue.Enqueue (MakePacket ("10.2.0.2", 300));
+  queue.Enqueue (MakePacket ("10.2.0.1", 400));
+  NS_TEST_ASSERT_MSG_EQ (queue.GetNPackets (), 4u, "all packets queued");
+  NS_TEST_ASSERT_MSG_EQ (queue.GetNBytes (), 1000u, "all bytes counted");
+
+  std::list<BufferedPacket> packets;
+  queue.Dequeue (Ipv4Address ("10.2.0.0"), Ipv4Mask ("255.255.0.0"), packets);
+  NS_TEST_ASSERT_MSG_EQ (packets.size (), 3u, "10.2.0.0/16 covers three packets");
+  uint32_t expected[] = { 100, 300, 400 };
+  uint32_t i = 0;
+  for (std::list<BufferedPacket>::const_iterator it = packets.begin (); it != packets.end (); ++it, ++i)
+    {
+      NS_TEST_EXPECT_MSG_EQ (it->packet->GetSize (), expected[i], "arrival order of packet " << i);
+    }
+  NS_TEST_ASSERT_MSG_EQ (queue.GetNPackets (), 1u, "10.3.0.1 still waits");
+  NS_TEST_ASSERT_MSG_EQ (queue.GetNBytes (), 200u, "bytes of 10.3.0.1");
+
+  packets.clear ();
+  queue.Dequeue (Ipv4Address ("10.2.0.0"), Ipv4Mask ("255.255.0.0"), packets);
+  NS_TEST_ASSERT_MSG_EQ (packets.size (), 0u, "nothing left for 10.2.0.0/16");
+  queue.Dequeue (Ipv4Address ("0.0.0.0"), Ipv4Mask ("0.0.0.0"), packets);
+  NS_TEST_ASSERT_MSG_EQ (packets.size (), 1u, "the wild card entry covers everything");
+  NS_TEST_ASSERT_MSG_EQ (queue.GetNPackets (), 0u, "empty queue");
+}
+
+// ================================================================================================
+
+class MissQueueLimitTestCase : public TestCase
+{
+public:
+  MissQueueLimitTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+MissQueueLimitTestCase::MissQueueLimitTestCase ()
+  : TestCase ("Per-EID and global byte limits of the miss queue")
+{
+}
+
+void
+MissQueueLimitTestCase::DoRun (void)
+{
+  MissQueue queue;
+  queue.SetMaxEidBytes (1000);
+  queue.SetMaxBytes (1500);
+  NS_TEST_ASSERT_MSG_EQ (queue.Enqueue (MakePacket ("10.2.0.1", 600)), true, "first packet");
+  NS_TEST_ASSERT_MSG_EQ (queue.Enqueue (MakePacket ("10.2.0.1", 600)), false, "per-EID limit");
+  NS_TEST_ASSERT_MSG_EQ (queue.Enqueue (MakePacket ("10.2.0.1", 400)), true, "fits the per-EID limit");
+  NS_TEST_ASSERT_MSG_EQ (queue.Enqueue (MakePacket ("10.3.0.1", 600)), false, "global limit");
+  NS_TEST_ASSERT_MSG_EQ (queue.Enqueue (MakePacket ("10.3.0.1", 500)), true, "fits the global limit");
+  NS_TEST_ASSERT_MSG_EQ (queue.GetNBytes (), 1500u, "queue is full");
+
+  std::list<BufferedPacket> packets;
+  queue.Dequeue (Ipv4Address ("10.2.0.1"), Ipv4Mask ("255.255.255.255"), packets);
+  NS_TEST_ASSERT_MSG_EQ (queue.Enqueue (MakePacket ("10.3.0.1", 500)), true, "room after dequeue");
+}
+
+// ================================================================================================
+
+class MissQueueDelayTestCase : public TestCase
+{
+public:
+  MissQueueDelayTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void Enqueue (const char *destination, uint32_t size);
+  void Check (void);
+
+  MissQueue m_queue;
+};
+
+MissQueueDelayTestCase::MissQueueDelayTestCase ()
+  : TestCase ("Packets waiting longer than the maximum delay are dropped")
+{
+}
+
+void
+MissQueueDelayTestCase::Enqueue (const char *destination, uint32_t size)
+{
+  m_queue.Enqueue (MakePacket (destination, size));
+}
+
+void
+MissQueueDelayTestCase::Check (void)
+{
+  std::list<BufferedPacket> packets;
+  m_queue.Dequeue (Ipv4Address ("10.2.0.0"), Ipv4Mask ("255.255.0.0"), packets);
+  NS_TEST_ASSERT_MSG_EQ (packets.size (), 1u, "only the recent packet is sent");
+  NS_TEST_ASSERT_MSG_EQ (packets.front ().packet->GetSize (), 200u, "recent packet");
+  NS_TEST_ASSERT_MSG_EQ (m_queue.GetNExpired (), 1u, "one expired packet");
+  NS_TEST_ASSERT_MSG_EQ (m_queue.GetNBytes (), 0u, "no byte left");
+}
+
+void
+MissQueueDelayTestCase::DoRun (void)
+{
+  m_queue.SetMaxDelay (Seconds (3));
+  Simulator::Schedule (Seconds (1), &MissQueueDelayTestCase::Enqueue, this, "10.2.0.1", 100);
+  Simulator::Schedule (Seconds (3), &MissQueueDelayTestCase::Enqueue, this, "10.2.0.1", 200);
+  Simulator::Schedule (Seconds (5), &MissQueueDelayTestCase::Check, this);
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+// ================================================================================================
+
+class MissQueueTestSuite : public TestSuite
+{
+public:
+  MissQueueTestSuite ();
+};
+
+MissQueueTestSuite::MissQueueTestSuite ()
+  : TestSuite ("lisp-miss-queue", UNIT)
+{
+  AddTestCase (new MissQueueOrderTestCase, TestCase::QUICK);
+  AddTestCase (new MissQueueLimitTestCase, TestCase::QUICK);
+  AddTestCase (new MissQueueDelayTestCase, TestCase::QUICK);
+}
+
+static MissQueueTestSuite missQueueTestSuite;
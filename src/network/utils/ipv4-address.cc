@@ -261,6 +261,11 @@ Ipv4Address::IsSubnetDirectedBroadcast (Ipv4Mask const &mask) const
       // broadcast for this address.
       return false;
     }
+  if (mask.GetPrefixLength () == 31)
+    {
+      // Nor on a point-to-point /31 (RFC 3021): both addresses are hosts.
+      return false;
+    }
   return ( (Get () | mask.GetInverse ()) == Get () );
 }
 
@@ -0,0 +1,226 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This program measures the per-packet checks of the privacy data plane on
+// a server owning 'n' addresses: finding the destination of a packet among
+// the addresses of the server, and choosing the address a peer is
+// redirected to. It compares walking the Ipv4Interface with GetAddress (i),
+// quadratic in 'n' for a search (skipped above --max-linear addresses),
+// against the AddressPool of the interface.
+// It then counts the peers an RLOC pool of 'n' addresses redirects to
+// another address when one address joins or leaves the pool, with the
+// modulo of the hash (Select) and with rendezvous hashing
+// (SelectConsistent).
+// Sample usage:  ./waf --run 'bench-address-pool --lookups=1000000 --linear-lookups=1000'
+
+#include "ns3/command-line.h"
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/abort.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv4-interface.h"
+#include "ns3/ipv4-interface-address.h"
+#include "ns3/address-hash.h"
+#include "ns3/address-pool.h"
+#include <iostream>
+#include <iomanip>
+
+using namespace ns3;
+
+static const uint32_t BASE = 0x0b000000; // 11.0.0.0
+
+static int32_t
+LinearFind (Ptr<Ipv4Interface> iface, Ipv4Address addr)
+{
+  for (uint32_t i = 0; i < iface->GetNAddresses (); i++)
+    {
+      if (iface->GetAddress (i).GetLocal () == addr)
+        {
+          return i;
+        }
+    }
+  return -1;
+}
+
+static void
+runBench (uint32_t n, uint32_t lookups, uint32_t linearLookups, uint32_t maxLinear)
+{
+  Ptr<Ipv4Interface> iface = CreateObject<Ipv4Interface> ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      iface->AddAddress (Ipv4InterfaceAddress (Ipv4Address (BASE + i), Ipv4Mask ("255.0.0.0")));
+    }
+
+  SystemWallClockMs time;
+  time.Start ();
+  Ptr<AddressPool> pool = AddressPool::GetPool (iface);
+  uint64_t buildMs = time.End ();
+
+  // Half of the destinations belong to the server. The sums compare the
+  // answers of both methods on the first linearLookups packets.
+  int64_t linearSum = 0;
+  int64_t poolSum = 0;
+  double linearFind = -1;
+  double linearSelect = -1;
+  if (n <= maxLinear)
+    {
+      time.Start ();
+      for (uint32_t i = 0; i < linearLookups; i++)
+        {
+          linearSum += LinearFind (iface, Ipv4Address (BASE + (i * 2654435761U) % (2 * n)));
+        }
+      linearFind = time.End () * 1e6 / linearLookups;
+      time.Start ();
+      for (uint32_t i = 0; i < linearLookups; i++)
+        {
+          Ipv4Address peer (0x0a000000 + i);
+          linearSum += iface->GetAddress (AddressHash::Hash32 (peer) % iface->GetNAddresses ()).GetLocal ().Get ();
+        }
+      linearSelect = time.End () * 1e6 / linearLookups;
+      for (uint32_t i = 0; i < linearLookups; i++)
+        {
+          poolSum += pool->Find (Ipv4Address (BASE + (i * 2654435761U) % (2 * n)));
+          poolSum += pool->Select (Ipv4Address (0x0a000000 + i)).Get ();
+        }
+      NS_ABORT_MSG_IF (linearSum != poolSum, "The pool and the interface disagree");
+    }
+  time.Start ();
+  for (uint32_t i = 0; i < lookups; i++)
+    {
+      poolSum += AddressPool::GetPool (iface)->Find (Ipv4Address (BASE + (i * 2654435761U) % (2 * n)));
+    }
+  double poolFind = time.End () * 1e6 / lookups;
+  time.Start ();
+  for (uint32_t i = 0; i < lookups; i++)
+    {
+      poolSum += AddressPool::GetPool (iface)->Select (Ipv4Address (0x0a000000 + i)).Get ();
+    }
+  double poolSelect = time.End () * 1e6 / lookups;
+  time.Start ();
+  pool->SelectConsistent (Ipv4Address (0x0a000000));
+  uint64_t rendezvousMs = time.End ();
+  time.Start ();
+  for (uint32_t i = 0; i < lookups; i++)
+    {
+      poolSum += AddressPool::GetPool (iface)->SelectConsistent (Ipv4Address (0x0a000000 + i)).Get ();
+    }
+  double poolConsistent = time.End () * 1e6 / lookups;
+
+  std::cout << std::setw (8) << n
+            << std::setw (12) << buildMs
+            << std::fixed << std::setprecision (1)
+            << std::setw (16) << linearFind
+            << std::setw (14) << poolFind
+            << std::setw (18) << linearSelect
+            << std::setw (16) << poolSelect
+            << std::setw (16) << rendezvousMs
+            << std::setw (14) << poolConsistent << std::endl;
+}
+
+// Fraction of the peers whose address changes between two pools
+static void
+CountMoves (Ptr<AddressPool> before, Ptr<AddressPool> after, uint32_t peers, double &modulo, double &consistent)
+{
+  uint32_t movedModulo = 0;
+  uint32_t movedConsistent = 0;
+  for (uint32_t i = 0; i < peers; i++)
+    {
+      // One peer per /24, as the xTRs redirect the source /24
+      Ipv4Address peer (0x0a000000 + (i << 8));
+      movedModulo += before->Select (peer) != after->Select (peer);
+      movedConsistent += before->SelectConsistent (peer) != after->SelectConsistent (peer);
+    }
+  modulo = (double) movedModulo / peers;
+  consistent = (double) movedConsistent / peers;
+}
+
+static void
+runRemap (uint32_t n, uint32_t peers)
+{
+  Ptr<Ipv4Interface> iface = CreateObject<Ipv4Interface> ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      iface->AddAddress (Ipv4InterfaceAddress (Ipv4Address (BASE + i), Ipv4Mask ("255.0.0.0")));
+    }
+  Ptr<AddressPool> pool = CreateObject<AddressPool> ();
+  pool->Build (iface);
+
+  iface->AddAddress (Ipv4InterfaceAddress (Ipv4Address (BASE + n), Ipv4Mask ("255.0.0.0")));
+  Ptr<AddressPool> joined = CreateObject<AddressPool> ();
+  joined->Build (iface);
+  iface->RemoveAddress (n);
+
+  // The first address leaves: the following ones change of position
+  iface->RemoveAddress (0);
+  Ptr<AddressPool> left = CreateObject<AddressPool> ();
+  left->Build (iface);
+
+  double joinModulo, joinConsistent, leaveModulo, leaveConsistent;
+  CountMoves (pool, joined, peers, joinModulo, joinConsistent);
+  CountMoves (pool, left, peers, leaveModulo, leaveConsistent);
+  std::cout << std::setw (8) << n
+            << std::fixed << std::setprecision (3)
+            << std::setw (10) << 1.0 / (n + 1)
+            << std::setw (14) << joinModulo
+            << std::setw (14) << joinConsistent
+            << std::setw (10) << 1.0 / n
+            << std::setw (14) << leaveModulo
+            << std::setw (14) << leaveConsistent << std::endl;
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t lookups = 1000000;
+  uint32_t linearLookups = 1000;
+  uint32_t maxLinear = 4096;
+  uint32_t peers = 100000;
+  CommandLine cmd;
+  cmd.Usage ("Benchmark the address checks of a server owning many addresses.");
+  cmd.AddValue ("lookups", "number of packets checked with the pool for each size", lookups);
+  cmd.AddValue ("linear-lookups", "number of packets checked with the interface for each size", linearLookups);
+  cmd.AddValue ("max-linear", "largest server measured with the linear search", maxLinear);
+  cmd.AddValue ("peers", "number of peer /24s redirected in the RLOC pool changes", peers);
+  cmd.Parse (argc, argv);
+  NS_ABORT_MSG_IF (lookups == 0 || linearLookups == 0 || peers == 0, "lookups and peers must be positive");
+
+  std::cout << "Running bench-address-pool with lookups=" << lookups << " linear-lookups=" << linearLookups
+            << " (ns per packet, -1: skipped)" << std::endl;
+  std::cout << std::setw (8) << "n"
+            << std::setw (12) << "build (ms)"
+            << std::setw (16) << "find linear"
+            << std::setw (14) << "find pool"
+            << std::setw (18) << "select linear"
+            << std::setw (16) << "select pool"
+            << std::setw (16) << "rendezvous (ms)"
+            << std::setw (14) << "consistent" << std::endl;
+  for (uint32_t n = 16; n <= 65536; n *= 4)
+    {
+      runBench (n, lookups, linearLookups, maxLinear);
+    }
+
+  std::cout << std::endl << "Peers moved when an RLOC joins or leaves (peers=" << peers << ")" << std::endl;
+  std::cout << std::setw (8) << "n"
+            << std::setw (10) << "1/(n+1)"
+            << std::setw (14) << "join modulo"
+            << std::setw (14) << "join rdv"
+            << std::setw (10) << "1/n"
+            << std::setw (14) << "leave modulo"
+            << std::setw (14) << "leave rdv" << std::endl;
+  for (uint32_t n = 2; n <= 64; n *= 2)
+    {
+      runRemap (n, peers);
+    }
+  return 0;
+}
@@ -0,0 +1,203 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This program measures the cost of the Ipv4Nat hooks per packet as the
+// number of active dynamic translations grows:
+//
+//   10.0.0.0/8 --- NAT --- outside
+//
+// 'n' inside hosts open a UDP or TCP flow each, which creates 'n'
+// translations to the ports of the pool. The program then sends packets of
+// random existing flows out (post-routing) and back in (pre-routing) through
+// the netfilter hooks of the NAT node, and reports the nanoseconds per
+// packet, the headers included. The cost should not depend on 'n'.
+// Sample usage:  ./waf --run 'bench-ipv4-nat --packets=200000'
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/system-wall-clock-ms.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+using namespace ns3;
+
+static const uint32_t INSIDE = 0x0a000000; // 10.0.0.0
+static const uint16_t LOCAL_PORT = 5000;
+static const uint16_t REMOTE_PORT = 80;
+
+// Flow i is UDP if i is even, TCP otherwise
+static Ptr<Packet>
+MakePacket (uint32_t flow, Ipv4Address src, Ipv4Address dst, uint16_t srcPort, uint16_t dstPort)
+{
+  Ptr<Packet> p = Create<Packet> (64);
+  Ipv4Header ip;
+  ip.SetSource (src);
+  ip.SetDestination (dst);
+  if (flow % 2)
+    {
+      TcpHeader tcp;
+      tcp.SetSourcePort (srcPort);
+      tcp.SetDestinationPort (dstPort);
+      p->AddHeader (tcp);
+      ip.SetProtocol (TcpL4Protocol::PROT_NUMBER);
+    }
+  else
+    {
+      UdpHeader udp;
+      udp.SetSourcePort (srcPort);
+      udp.SetDestinationPort (dstPort);
+      p->AddHeader (udp);
+      ip.SetProtocol (UdpL4Protocol::PROT_NUMBER);
+    }
+  ip.SetPayloadSize (p->GetSize ());
+  p->AddHeader (ip);
+  return p;
+}
+
+static uint16_t
+GetSourcePort (Ptr<Packet> p)
+{
+  Ipv4Header ip;
+  p->RemoveHeader (ip);
+  UdpHeader udp;
+  p->PeekHeader (udp);
+  p->AddHeader (ip);
+  // The ports are the first bytes of both headers
+  return udp.GetSourcePort ();
+}
+
+static void
+runBench (uint32_t n, uint32_t packets)
+{
+  NodeContainer nodes;
+  nodes.Create (3);
+  InternetStackHelper internet;
+  internet.Install (nodes);
+  PointToPointHelper p2p;
+  NetDeviceContainer outside = p2p.Install (nodes.Get (0), nodes.Get (1));
+  NetDeviceContainer inside = p2p.Install (nodes.Get (1), nodes.Get (2));
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase ("192.168.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer outsideIfaces = ipv4.Assign (outside);
+  ipv4.SetBase ("10.0.0.0", "255.0.0.0");
+  ipv4.Assign (inside);
+
+  Ptr<Ipv4Nat> nat = Ipv4NatHelper ().Install (nodes.Get (1));
+  nat->SetInside (2);
+  nat->SetOutside (1);
+  Ipv4Address global ("192.168.1.2");
+  nat->AddAddressPool (global, Ipv4Mask ("255.255.255.255"));
+  nat->AddPortPool (1024, 65535);
+  nat->AddDynamicRule (Ipv4DynamicNatRule (Ipv4Address ("10.0.0.0"), Ipv4Mask ("255.0.0.0")));
+
+  Ptr<Ipv4Netfilter> netfilter = nodes.Get (1)->GetObject<Ipv4> ()->GetNetfilter ();
+  Ptr<NetDevice> out = outside.Get (1);
+  // As Ipv4L3Protocol::Send does
+  Callback<uint32_t, Ptr<Packet> > confirm = MakeCallback (&Ipv4Netfilter::NetfilterConntrackConfirm, netfilter);
+  Ipv4Address remote = outsideIfaces.GetAddress (0);
+
+  // Open the flows, and keep the port each of them is translated to
+  std::vector<Ptr<Packet> > batch;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      batch.push_back (MakePacket (i, Ipv4Address (INSIDE + 2 + i / 2), remote, LOCAL_PORT, REMOTE_PORT));
+    }
+  std::vector<uint16_t> globalPorts (n);
+  SystemWallClockMs time;
+  time.Start ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      netfilter->ProcessHook (PF_INET, NF_INET_POST_ROUTING, batch[i], 0, out, confirm);
+    }
+  double open = time.End () * 1e6 / n;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      globalPorts[i] = GetSourcePort (batch[i]);
+    }
+  NS_ABORT_MSG_IF (nat->GetNDynamicTuples () != n, "Missing translations");
+
+  // Packets of random flows, out then in
+  Ptr<UniformRandomVariable> flow = CreateObject<UniformRandomVariable> ();
+  std::vector<uint32_t> flows;
+  for (uint32_t i = 0; i < packets; i++)
+    {
+      flows.push_back (flow->GetInteger (0, n - 1));
+    }
+  batch.clear ();
+  for (uint32_t i = 0; i < packets; i++)
+    {
+      batch.push_back (MakePacket (flows[i], Ipv4Address (INSIDE + 2 + flows[i] / 2), remote, LOCAL_PORT, REMOTE_PORT));
+    }
+  time.Start ();
+  for (uint32_t i = 0; i < packets; i++)
+    {
+      netfilter->ProcessHook (PF_INET, NF_INET_POST_ROUTING, batch[i], 0, out, confirm);
+    }
+  double outbound = time.End () * 1e6 / packets;
+  for (uint32_t i = 0; i < packets; i++)
+    {
+      NS_ABORT_MSG_IF (GetSourcePort (batch[i]) != globalPorts[flows[i]], "Wrong outbound translation");
+    }
+
+  batch.clear ();
+  for (uint32_t i = 0; i < packets; i++)
+    {
+      batch.push_back (MakePacket (flows[i], remote, global, REMOTE_PORT, globalPorts[flows[i]]));
+    }
+  time.Start ();
+  uint32_t accepted = 0;
+  for (uint32_t i = 0; i < packets; i++)
+    {
+      accepted += netfilter->ProcessHook (PF_INET, NF_INET_PRE_ROUTING, batch[i], out, 0) == NF_ACCEPT;
+    }
+  double inbound = time.End () * 1e6 / packets;
+  NS_ABORT_MSG_IF (accepted != packets, "Inbound packets dropped");
+
+  std::cout << std::setw (10) << n
+            << std::fixed << std::setprecision (1)
+            << std::setw (16) << open
+            << std::setw (16) << outbound
+            << std::setw (16) << inbound << std::endl;
+
+  Simulator::Destroy ();
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t packets = 200000;
+  uint32_t maxFlows = 100000;
+  CommandLine cmd;
+  cmd.Usage ("Benchmark the Ipv4Nat hooks with many active translations.");
+  cmd.AddValue ("packets", "number of packets sent each way for each number of flows", packets);
+  cmd.AddValue ("max-flows", "largest number of active translations (at most 129024)", maxFlows);
+  cmd.Parse (argc, argv);
+  NS_ABORT_MSG_IF (packets == 0, "packets must be positive");
+  NS_ABORT_MSG_IF (maxFlows > 2 * 64512, "The port pool holds 64512 translations per protocol");
+
+  std::cout << "Running bench-ipv4-nat with packets=" << packets << " (ns per packet)" << std::endl;
+  std::cout << std::setw (10) << "flows"
+            << std::setw (16) << "new flow"
+            << std::setw (16) << "outbound"
+            << std::setw (16) << "inbound" << std::endl;
+  for (uint32_t n = 100; n <= maxFlows; n *= 10)
+    {
+      runBench (n, packets);
+    }
+  return 0;
+}
@@ -0,0 +1,205 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This program measures the EID resolution latency of a Map-Resolver
+// walking a LISP-DDT hierarchy, as the hierarchy deepens.
+//
+//   client --- R --- MR
+//              |
+//              +--- DDT node 0 (root), .., DDT node depth-1, MS
+//
+// The sites are the /28 prefixes of 10.0.0.0/16. DDT node i is
+// authoritative for 10.0.0.0/(8+i) and delegates 10.0.0.0/(9+i) to node
+// i+1; the deepest node delegates every site to the Map-Server. The client
+// sends Map-Requests for random sites to the MR, which walks the hierarchy
+// from the deepest DDT node its referral cache knows for the EID. The
+// latency reported is the time from the arrival of a Map-Request at the MR
+// to the referral to the Map-Server.
+// Sample usage:  ./waf --run 'bench-lisp-ddt --max-depth=6 --sites=4096'
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/lisp-helper.h"
+#include "ns3/ddt-node.h"
+#include "ns3/ddt-node-helper.h"
+#include "ns3/map-resolver-ddt.h"
+#include "ns3/map-resolver-helper.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+using namespace ns3;
+
+static uint32_t g_resolved;
+static uint32_t g_cold;
+static uint64_t g_referrals;
+static Time g_totalDelay;
+static Time g_coldDelay;
+static uint32_t g_depth;
+
+static void
+Resolved (Time delay, uint32_t referrals)
+{
+  g_resolved++;
+  g_referrals += referrals;
+  g_totalDelay += delay;
+  if (referrals == g_depth)
+    {
+      g_cold++;
+      g_coldDelay += delay;
+    }
+}
+
+static void
+SendLookup (Ptr<Socket> socket, Ipv4Address mr, Ipv4Address itrRloc, Ptr<UniformRandomVariable> site,
+            uint32_t sites, uint64_t nonce)
+{
+  Ptr<MapRequestMsg> request = Create<MapRequestMsg> ();
+  request->SetNonce (nonce);
+  request->SetSourceEidAddr (Ipv4Address ("10.255.0.1"));
+  request->SetItrRlocAddrIp (itrRloc);
+  Ipv4Address eid (Ipv4Address ("10.0.0.0").Get () + site->GetInteger (0, sites - 1) * 16 + 1);
+  request->SetMapRequestRecord (Create<MapRequestRecord> (eid, 32));
+  socket->SendTo (request->ToPacket (), 0, InetSocketAddress (mr, LispOverIp::LISP_SIG_PORT));
+}
+
+static void
+runBench (uint32_t depth, uint32_t sites, uint32_t lookups, Time interval)
+{
+  g_depth = depth;
+  g_resolved = g_cold = 0;
+  g_referrals = 0;
+  g_totalDelay = g_coldDelay = Seconds (0);
+
+  // client, MR, R, MS, then the DDT nodes from the root
+  NodeContainer nodes;
+  nodes.Create (4 + depth);
+  Ptr<Node> client = nodes.Get (0);
+  Ptr<Node> mr = nodes.Get (1);
+  Ptr<Node> router = nodes.Get (2);
+  Ptr<Node> ms = nodes.Get (3);
+  InternetStackHelper internet;
+  internet.Install (nodes);
+
+  PointToPointHelper p2p;
+  p2p.SetDeviceAttribute ("DataRate", StringValue ("1Gbps"));
+  p2p.SetChannelAttribute ("Delay", StringValue ("5ms"));
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase ("192.168.0.0", "255.255.255.252");
+  std::vector<Ipv4Address> addresses;
+  for (uint32_t i = 0; i < nodes.GetN (); i++)
+    {
+      if (nodes.Get (i) == router)
+        {
+          addresses.push_back (Ipv4Address ());
+          continue;
+        }
+      addresses.push_back (ipv4.Assign (p2p.Install (router, nodes.Get (i))).GetAddress (1));
+      ipv4.NewNetwork ();
+    }
+  Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+
+  // The MR is a LISP-speaking device
+  LispHelper lispHelper;
+  lispHelper.AddRlocToSet (addresses[1]);
+  lispHelper.Install (mr);
+  lispHelper.SetMapTablesForEtr (addresses[1], lispHelper.CreateMapTables (), lispHelper.CreateMapTables ());
+  lispHelper.InstallMapTables (NodeContainer (mr));
+
+  DdtNodeHelper ddtHelper;
+  ApplicationContainer ddtApps;
+  for (uint32_t i = 0; i < depth; i++)
+    {
+      Ptr<DdtNode> ddt = DynamicCast<DdtNode> (ddtHelper.Install (nodes.Get (4 + i)).Get (0));
+      ddt->AddAuthoritativePrefix (Ipv4Address ("10.0.0.0"), Ipv4Mask (~((1U << (24 - i)) - 1)));
+      if (i + 1 < depth)
+        {
+          ddt->AddNodeDelegation (Ipv4Address ("10.0.0.0"), Ipv4Mask (~((1U << (23 - i)) - 1)), addresses[5 + i]);
+        }
+      else
+        {
+          for (uint32_t s = 0; s < sites; s++)
+            {
+              ddt->AddMapServerDelegation (Ipv4Address (Ipv4Address ("10.0.0.0").Get () + s * 16),
+                                           Ipv4Mask ("255.255.255.240"), addresses[3]);
+            }
+        }
+      ddtApps.Add (ddt);
+    }
+  ddtApps.Start (Seconds (0.0));
+
+  MapResolverDdtHelper mrHelper;
+  mrHelper.AddDdtRootRloc (Create<Locator> (addresses[4]));
+  ApplicationContainer mrApps = mrHelper.Install (mr);
+  mrApps.Start (Seconds (0.0));
+  mrApps.Get (0)->TraceConnectWithoutContext ("Resolved", MakeCallback (&Resolved));
+
+  Ptr<Socket> socket = Socket::CreateSocket (client, UdpSocketFactory::GetTypeId ());
+  socket->Bind ();
+  Ptr<UniformRandomVariable> site = CreateObject<UniformRandomVariable> ();
+  site->SetStream (1);
+  for (uint32_t i = 0; i < lookups; i++)
+    {
+      Simulator::Schedule (Seconds (1.0) + interval * i, &SendLookup, socket, addresses[1], addresses[0],
+                           site, sites, i + 1);
+    }
+
+  Simulator::Stop (Seconds (5.0) + interval * lookups);
+  Simulator::Run ();
+
+  std::cout << std::setw (6) << depth
+            << std::setw (10) << g_resolved
+            << std::setw (14) << std::fixed << std::setprecision (2)
+            << (g_resolved ? g_totalDelay.GetSeconds () * 1e3 / g_resolved : 0.0)
+            << std::setw (14) << (g_cold ? g_coldDelay.GetSeconds () * 1e3 / g_cold : 0.0)
+            << std::setw (12) << (g_resolved ? (double) g_referrals / g_resolved : 0.0)
+            << std::setw (10) << DynamicCast<MapResolverDdt> (mrApps.Get (0))->GetMapReferralCache ()->GetNEntries ()
+            << std::endl;
+  Simulator::Destroy ();
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t maxDepth = 6;
+  uint32_t sites = 4096;
+  uint32_t lookups = 2000;
+  double interval = 10;
+  CommandLine cmd;
+  cmd.Usage ("Benchmark the EID resolution latency through a LISP-DDT hierarchy.");
+  cmd.AddValue ("max-depth", "deepest DDT hierarchy measured (at most 9)", maxDepth);
+  cmd.AddValue ("sites", "number of /28 sites (at most 4096)", sites);
+  cmd.AddValue ("lookups", "number of Map-Requests sent to the MR", lookups);
+  cmd.AddValue ("interval", "time between two Map-Requests (ms)", interval);
+  cmd.Parse (argc, argv);
+  NS_ABORT_MSG_IF (maxDepth < 1 || maxDepth > 9, "The hierarchy must be 1 to 9 levels deep");
+  NS_ABORT_MSG_IF (sites < 1 || sites > 4096, "The sites must fit in 10.0.0.0/16");
+
+  std::cout << "Running bench-lisp-ddt with sites=" << sites << " lookups=" << lookups
+            << " interval=" << interval << "ms" << std::endl;
+  std::cout << std::setw (6) << "depth"
+            << std::setw (10) << "resolved"
+            << std::setw (14) << "mean (ms)"
+            << std::setw (14) << "cold (ms)"
+            << std::setw (12) << "referrals"
+            << std::setw (10) << "cached" << std::endl;
+  for (uint32_t depth = 1; depth <= maxDepth; depth++)
+    {
+      runBench (depth, sites, lookups, MilliSeconds (interval));
+    }
+  return 0;
+}
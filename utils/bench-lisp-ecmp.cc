@@ -0,0 +1,193 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This program measures how LISP traffic between two xTRs spreads over
+// the parallel links of an ECMP core, with ECMP disabled, random (per
+// packet) ECMP and flow-hash ECMP of Ipv4GlobalRouting.
+//
+//                        +-- C1 --+
+//   host1 --- xTR1 --- R1 +-- .. --+ R2 --- xTR2 --- host2
+//                        +-- Ck --+
+//
+// host1 sends 'flows' UDP flows to host2 (one destination port per flow),
+// encapsulated by xTR1 towards xTR2. The mappings are static, so no control
+// plane is involved. The core links are the bottleneck: the goodput only
+// exceeds the capacity of one of them if R1 spreads the LISP flows, which
+// all have the same outer addresses, according to their outer UDP source
+// port.
+// Sample usage:  ./waf --run 'bench-lisp-ecmp --paths=4 --flows=32'
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/lisp-helper.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <vector>
+#include <string>
+
+using namespace ns3;
+
+/// Bytes sent by R1 on each core link.
+static std::vector<uint64_t> g_coreBytes;
+
+static void
+CoreTx (uint32_t path, Ptr<const Packet> packet)
+{
+  g_coreBytes[path] += packet->GetSize ();
+}
+
+static Ptr<MapTables>
+BuildMapTables (LispHelper &lispHelper, Ipv4Address localEid, Ipv4Address localRloc,
+                Ipv4Address remoteEid, Ipv4Address remoteRloc)
+{
+  Ipv4Mask mask ("255.255.255.0");
+  Ptr<MapTables> mapTables = lispHelper.CreateMapTables ();
+  mapTables->InsertLocator (localEid, mask, localRloc, 1, 100, MapTables::IN_DATABASE, true);
+  mapTables->InsertLocator (remoteEid, mask, remoteRloc, 1, 100, MapTables::IN_CACHE, true);
+  return mapTables;
+}
+
+static void
+runBench (std::string mode, uint32_t paths, uint32_t flows, std::string coreRate,
+          double duration)
+{
+  Config::SetDefault ("ns3::Ipv4GlobalRouting::RandomEcmpRouting", BooleanValue (mode == "random"));
+  Config::SetDefault ("ns3::Ipv4GlobalRouting::FlowEcmpRouting", BooleanValue (mode == "flow"));
+
+  // host1, xTR1, R1, R2, xTR2, host2, then the core routers
+  NodeContainer nodes;
+  nodes.Create (6 + paths);
+  Ptr<Node> host1 = nodes.Get (0);
+  Ptr<Node> xtr1 = nodes.Get (1);
+  Ptr<Node> r1 = nodes.Get (2);
+  Ptr<Node> r2 = nodes.Get (3);
+  Ptr<Node> xtr2 = nodes.Get (4);
+  Ptr<Node> host2 = nodes.Get (5);
+  InternetStackHelper internet;
+  internet.Install (nodes);
+
+  PointToPointHelper access;
+  access.SetDeviceAttribute ("DataRate", StringValue ("1Gbps"));
+  access.SetChannelAttribute ("Delay", StringValue ("1ms"));
+  PointToPointHelper core;
+  core.SetDeviceAttribute ("DataRate", StringValue (coreRate));
+  core.SetChannelAttribute ("Delay", StringValue ("5ms"));
+
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase ("10.1.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer host1Xtr1 = ipv4.Assign (access.Install (host1, xtr1));
+  ipv4.SetBase ("10.1.2.0", "255.255.255.0");
+  Ipv4InterfaceContainer xtr2Host2 = ipv4.Assign (access.Install (xtr2, host2));
+  ipv4.SetBase ("192.168.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer xtr1R1 = ipv4.Assign (access.Install (xtr1, r1));
+  ipv4.SetBase ("192.168.2.0", "255.255.255.0");
+  Ipv4InterfaceContainer r2Xtr2 = ipv4.Assign (access.Install (r2, xtr2));
+
+  g_coreBytes.assign (paths, 0);
+  ipv4.SetBase ("172.16.0.0", "255.255.255.252");
+  for (uint32_t i = 0; i < paths; i++)
+    {
+      NetDeviceContainer r1Core = core.Install (r1, nodes.Get (6 + i));
+      ipv4.Assign (r1Core);
+      ipv4.NewNetwork ();
+      ipv4.Assign (core.Install (nodes.Get (6 + i), r2));
+      ipv4.NewNetwork ();
+      r1Core.Get (0)->TraceConnectWithoutContext ("MacTx", MakeBoundCallback (&CoreTx, i));
+    }
+  Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+
+  // xTRs with static mappings
+  Ipv4Address rloc1 = xtr1R1.GetAddress (0);
+  Ipv4Address rloc2 = r2Xtr2.GetAddress (1);
+  Ipv4Address eid1 ("10.1.1.0");
+  Ipv4Address eid2 ("10.1.2.0");
+  LispHelper lispHelper;
+  lispHelper.AddRlocToSet (rloc1);
+  lispHelper.AddRlocToSet (rloc2);
+  NodeContainer xtrs (xtr1, xtr2);
+  lispHelper.Install (xtrs);
+  lispHelper.SetMapTablesForEtr (rloc1, BuildMapTables (lispHelper, eid1, rloc1, eid2, rloc2),
+                                 lispHelper.CreateMapTables ());
+  lispHelper.SetMapTablesForEtr (rloc2, BuildMapTables (lispHelper, eid2, rloc2, eid1, rloc1),
+                                 lispHelper.CreateMapTables ());
+  lispHelper.InstallMapTables (xtrs);
+
+  // The flows together offer the capacity of all the core links
+  DataRate perFlow (DataRate (coreRate).GetBitRate () * paths / flows);
+  ApplicationContainer sinks;
+  for (uint32_t i = 0; i < flows; i++)
+    {
+      uint16_t port = 10000 + i;
+      OnOffHelper onoff ("ns3::UdpSocketFactory", InetSocketAddress (xtr2Host2.GetAddress (1), port));
+      onoff.SetConstantRate (perFlow, 1000);
+      ApplicationContainer source = onoff.Install (host1);
+      source.Start (Seconds (1.0));
+      source.Stop (Seconds (1.0 + duration));
+      PacketSinkHelper sink ("ns3::UdpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), port));
+      sinks.Add (sink.Install (host2));
+    }
+
+  Simulator::Stop (Seconds (2.0 + duration));
+  Simulator::Run ();
+
+  uint64_t received = 0;
+  for (uint32_t i = 0; i < sinks.GetN (); i++)
+    {
+      received += DynamicCast<PacketSink> (sinks.Get (i))->GetTotalRx ();
+    }
+  uint64_t coreTotal = 0;
+  uint64_t coreMax = 0;
+  for (uint32_t i = 0; i < paths; i++)
+    {
+      coreTotal += g_coreBytes[i];
+      coreMax = std::max (coreMax, g_coreBytes[i]);
+    }
+  std::cout << std::left << std::setw (8) << mode
+            << std::right << std::setw (12) << std::fixed << std::setprecision (2)
+            << received * 8 / duration / 1e6
+            << std::setw (16) << (coreTotal ? 100.0 * coreMax / coreTotal : 0.0)
+            << std::endl;
+  Simulator::Destroy ();
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t paths = 4;
+  uint32_t flows = 32;
+  std::string coreRate = "10Mbps";
+  double duration = 5;
+  CommandLine cmd;
+  cmd.Usage ("Benchmark the spreading of LISP flows over ECMP core links.");
+  cmd.AddValue ("paths", "number of parallel core paths", paths);
+  cmd.AddValue ("flows", "number of UDP flows between the EIDs", flows);
+  cmd.AddValue ("core-rate", "data rate of each core link", coreRate);
+  cmd.AddValue ("duration", "duration of the traffic (s)", duration);
+  cmd.Parse (argc, argv);
+
+  std::cout << "Running bench-lisp-ecmp with paths=" << paths << " flows=" << flows
+            << " core-rate=" << coreRate << std::endl;
+  std::cout << std::left << std::setw (8) << "ECMP"
+            << std::right << std::setw (12) << "Mbit/s"
+            << std::setw (16) << "busiest link %" << std::endl;
+  runBench ("none", paths, flows, coreRate, duration);
+  runBench ("random", paths, flows, coreRate, duration);
+  runBench ("flow", paths, flows, coreRate, duration);
+  return 0;
+}
@@ -0,0 +1,177 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This program compares the EID-prefix lookups of the LISP MapTables
+// implementations, for a cache holding 'n' /24 EID-prefixes.
+// With --capacity, it also replays Zipf-distributed destinations on a
+// map-cache bounded to 'capacity' entries (a miss inserts the prefix, as
+// an ITR does on Map-Reply) and reports the miss rate.
+// Sample usage:  ./waf --run 'bench-lisp-map-tables --n=10000 --lookups=1000000'
+//                ./waf --run 'bench-lisp-map-tables --n=10000 --capacity=1000 --alpha=0.9'
+
+#include "ns3/command-line.h"
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/object-factory.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/uinteger.h"
+#include "ns3/integer.h"
+#include "ns3/double.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/map-tables.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <limits>
+#include <algorithm>
+
+using namespace ns3;
+
+/// Addresses looked up by every implementation, in the same order.
+static std::vector<Ipv4Address> g_addresses;
+
+static uint32_t
+NextRandom (uint32_t &state)
+{
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+static Ptr<MapTables>
+BuildMapTables (std::string typeId, uint32_t n)
+{
+  ObjectFactory factory;
+  factory.SetTypeId (typeId);
+  Ptr<MapTables> mapTables = factory.Create<MapTables> ();
+  Ipv4Mask mask ("255.255.255.0");
+  for (uint32_t i = 0; i < n; i++)
+    {
+      // 10.0.0.0/24, 10.0.1.0/24, ...
+      Ipv4Address eid ((10 << 24) | (i << 8));
+      Ipv4Address rloc ((192 << 24) | (168 << 16) | (i & 0xffff));
+      mapTables->InsertLocator (eid, mask, rloc, 200, 30, MapTables::IN_CACHE, true);
+    }
+  return mapTables;
+}
+
+static void
+runBench (std::string typeId, uint32_t n, uint32_t minIterations)
+{
+  SystemWallClockMs time;
+  time.Start ();
+  Ptr<MapTables> mapTables = BuildMapTables (typeId, n);
+  uint64_t buildMs = time.End ();
+
+  uint64_t minDelay = std::numeric_limits<uint64_t>::max ();
+  uint32_t hits = 0;
+  for (uint32_t i = 0; i < minIterations; i++)
+    {
+      hits = 0;
+      time.Start ();
+      for (std::vector<Ipv4Address>::const_iterator it = g_addresses.begin ();
+           it != g_addresses.end (); ++it)
+        {
+          if (mapTables->CacheLookup (*it))
+            {
+              hits++;
+            }
+        }
+      minDelay = std::min (minDelay, (uint64_t) time.End ());
+    }
+  double ps = g_addresses.size ();
+  ps *= 1000;
+  ps /= std::max (minDelay, (uint64_t) 1);
+  std::cout << ps << " lookups/s"
+            << " (" << minDelay << " ms elapsed, "
+            << hits << " hits, "
+            << buildMs << " ms to insert " << n << " prefixes)\t"
+            << typeId
+            << std::endl;
+}
+
+static void
+runMissRate (std::string typeId, uint32_t n, uint32_t capacity, double alpha, uint32_t lookups)
+{
+  ObjectFactory factory;
+  factory.SetTypeId (typeId);
+  factory.Set ("CacheCapacity", UintegerValue (capacity));
+  Ptr<MapTables> mapTables = factory.Create<MapTables> ();
+
+  Ptr<ZipfRandomVariable> popularity = CreateObject<ZipfRandomVariable> ();
+  popularity->SetAttribute ("N", IntegerValue (n));
+  popularity->SetAttribute ("Alpha", DoubleValue (alpha));
+  popularity->SetStream (1);
+
+  Ipv4Mask mask ("255.255.255.0");
+  Ipv4Address rloc ("192.168.0.1");
+  uint32_t misses = 0;
+  for (uint32_t i = 0; i < lookups; i++)
+    {
+      uint32_t prefix = popularity->GetInteger () - 1;
+      Ipv4Address eid ((10 << 24) | (prefix << 8) | 1);
+      if (!mapTables->CacheLookup (eid))
+        {
+          misses++;
+          mapTables->InsertLocator (eid, mask, rloc, 200, 30, MapTables::IN_CACHE, true);
+        }
+    }
+  std::cout << 100.0 * misses / lookups << " % misses"
+            << " (" << mapTables->GetNMapEntriesLispCache () << " entries, "
+            << mapTables->GetCacheEvictions () << " evictions)\t"
+            << typeId
+            << std::endl;
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t n = 10000;
+  uint32_t lookups = 1000000;
+  uint32_t minIterations = 1;
+  uint32_t capacity = 0;
+  double alpha = 1.0;
+  CommandLine cmd;
+  cmd.Usage ("Benchmark the LISP MapTables implementations.");
+  cmd.AddValue ("n", "number of /24 EID-prefixes in the map-cache", n);
+  cmd.AddValue ("lookups", "number of map-cache lookups", lookups);
+  cmd.AddValue ("min-iterations", "number of iterations for each implementation", minIterations);
+  cmd.AddValue ("capacity", "map-cache capacity for the miss rate measurement (0: skip it)", capacity);
+  cmd.AddValue ("alpha", "Zipf exponent of the destination popularity", alpha);
+  cmd.Parse (argc, argv);
+
+  // One lookup out of four misses the map-cache
+  uint32_t state = 0x2545f491;
+  g_addresses.reserve (lookups);
+  for (uint32_t i = 0; i < lookups; i++)
+    {
+      uint32_t prefix = NextRandom (state) % (n + n / 3 + 1);
+      g_addresses.push_back (Ipv4Address ((10 << 24) | (prefix << 8) | (NextRandom (state) & 0xff)));
+    }
+
+  std::cout << "Running bench-lisp-map-tables with n=" << n
+            << " lookups=" << lookups << std::endl;
+  runBench ("ns3::SimpleMapTables", n, minIterations);
+  runBench ("ns3::TrieMapTables", n, minIterations);
+
+  if (capacity != 0)
+    {
+      std::cout << "Map-cache miss rate with capacity=" << capacity
+                << " alpha=" << alpha << std::endl;
+      runMissRate ("ns3::SimpleMapTables", n, capacity, alpha, lookups);
+      runMissRate ("ns3::TrieMapTables", n, capacity, alpha, lookups);
+    }
+  return 0;
+}
@@ -0,0 +1,238 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This program measures how a pool of Map-Servers shares the load of the
+// mapping system, as the pool grows.
+//
+//   client --- R --- MR
+//              |
+//              +--- MS 0, .., MS n-1
+//
+// The sites are the /24 prefixes of 10.0.0.0/8. Each site registers with the
+// Map-Server owning its shard. The client sends Map-Requests for random
+// sites to the MR, which forwards each of them to the Map-Server of its
+// shard. For each pool size, the program reports the busiest and the mean
+// Map-Server, in registered sites and in Map-Requests received, the
+// Map-Replies received by the client, and the fraction of the sites that
+// moved to the Map-Server added last.
+// Sample usage:  ./waf --run 'bench-lisp-shards --max-map-servers=8 --sites=4096'
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/lisp-helper.h"
+#include "ns3/map-server-shards.h"
+#include "ns3/map-server-helper.h"
+#include "ns3/map-resolver-helper.h"
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <string>
+
+using namespace ns3;
+
+static uint32_t g_replies;
+
+static void
+ReceiveReply (Ptr<Socket> socket)
+{
+  while (socket->Recv ())
+    {
+      g_replies++;
+    }
+}
+
+static void
+ReceiveRequest (uint32_t *requests, const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface)
+{
+  if (header.GetProtocol () == UdpL4Protocol::PROT_NUMBER)
+    {
+      (*requests)++;
+    }
+}
+
+static void
+SendLookup (Ptr<Socket> socket, Ipv4Address mr, Ipv4Address itrRloc, Ptr<UniformRandomVariable> site,
+            uint32_t sites, uint64_t nonce)
+{
+  Ptr<MapRequestMsg> request = Create<MapRequestMsg> ();
+  request->SetNonce (nonce);
+  request->SetSourceEidAddr (Ipv4Address ("11.0.0.1"));
+  request->SetItrRlocAddrIp (itrRloc);
+  Ipv4Address eid (Ipv4Address ("10.0.0.0").Get () + (site->GetInteger (0, sites - 1) << 8) + 1);
+  request->SetMapRequestRecord (Create<MapRequestRecord> (eid, 32));
+  socket->SendTo (request->ToPacket (), 0, InetSocketAddress (mr, LispOverIp::LISP_SIG_PORT));
+}
+
+static void
+runBench (uint32_t nMapServers, uint32_t sites, uint32_t lookups, Time interval)
+{
+  g_replies = 0;
+
+  // client, MR, R, then the Map-Servers
+  NodeContainer nodes;
+  nodes.Create (3 + nMapServers);
+  Ptr<Node> client = nodes.Get (0);
+  Ptr<Node> mr = nodes.Get (1);
+  Ptr<Node> router = nodes.Get (2);
+  InternetStackHelper internet;
+  internet.Install (nodes);
+
+  PointToPointHelper p2p;
+  p2p.SetDeviceAttribute ("DataRate", StringValue ("1Gbps"));
+  p2p.SetChannelAttribute ("Delay", StringValue ("5ms"));
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase ("192.168.0.0", "255.255.255.252");
+  std::vector<Ipv4Address> addresses;
+  for (uint32_t i = 0; i < nodes.GetN (); i++)
+    {
+      if (nodes.Get (i) == router)
+        {
+          addresses.push_back (Ipv4Address ());
+          continue;
+        }
+      addresses.push_back (ipv4.Assign (p2p.Install (router, nodes.Get (i))).GetAddress (1));
+      ipv4.NewNetwork ();
+    }
+  Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+
+  // The MR and the Map-Servers are LISP-speaking devices
+  NodeContainer lispNodes;
+  LispHelper lispHelper;
+  for (uint32_t i = 1; i < nodes.GetN (); i++)
+    {
+      if (nodes.Get (i) != router)
+        {
+          lispHelper.AddRlocToSet (addresses[i]);
+          lispNodes.Add (nodes.Get (i));
+        }
+    }
+  lispHelper.Install (lispNodes);
+  for (uint32_t i = 1; i < nodes.GetN (); i++)
+    {
+      if (nodes.Get (i) != router)
+        {
+          lispHelper.SetMapTablesForEtr (addresses[i], lispHelper.CreateMapTables (), lispHelper.CreateMapTables ());
+        }
+    }
+  lispHelper.InstallMapTables (lispNodes);
+
+  // The pool, and the sites moved by its last Map-Server
+  Ptr<MapServerShards> shards = Create<MapServerShards> ();
+  for (uint32_t i = 0; i + 1 < nMapServers; i++)
+    {
+      shards->AddMapServer (addresses[3 + i]);
+    }
+  std::vector<Address> previousOwners;
+  if (shards->GetNMapServers ())
+    {
+      for (uint32_t s = 0; s < sites; s++)
+        {
+          previousOwners.push_back (shards->GetMapServer (Ipv4Address (Ipv4Address ("10.0.0.0").Get () + (s << 8))));
+        }
+    }
+  shards->AddMapServer (addresses[2 + nMapServers]);
+
+  uint32_t moved = 0;
+  std::map<Address, uint32_t> registered;
+  for (uint32_t s = 0; s < sites; s++)
+    {
+      Address owner = shards->GetMapServer (Ipv4Address (Ipv4Address ("10.0.0.0").Get () + (s << 8)));
+      registered[owner]++;
+      if (!previousOwners.empty () && previousOwners[s] != owner)
+        {
+          moved++;
+        }
+    }
+
+  MapServerDdtHelper msHelper;
+  std::vector<uint32_t> requests (nMapServers, 0);
+  for (uint32_t i = 0; i < nMapServers; i++)
+    {
+      msHelper.Install (nodes.Get (3 + i)).Start (Seconds (0.0));
+      nodes.Get (3 + i)->GetObject<Ipv4L3Protocol> ()->TraceConnectWithoutContext (
+        "LocalDeliver", MakeBoundCallback (&ReceiveRequest, &requests[i]));
+    }
+
+  MapResolverDdtHelper mrHelper;
+  mrHelper.SetMapServerAddress (addresses[3]);
+  mrHelper.SetMapServerShards (shards);
+  mrHelper.Install (mr).Start (Seconds (0.0));
+
+  Ptr<Socket> socket = Socket::CreateSocket (client, UdpSocketFactory::GetTypeId ());
+  socket->Bind (InetSocketAddress (Ipv4Address::GetAny (), LispOverIp::LISP_SIG_PORT));
+  socket->SetRecvCallback (MakeCallback (&ReceiveReply));
+  Ptr<UniformRandomVariable> site = CreateObject<UniformRandomVariable> ();
+  site->SetStream (1);
+  for (uint32_t i = 0; i < lookups; i++)
+    {
+      Simulator::Schedule (Seconds (1.0) + interval * i, &SendLookup, socket, addresses[1], addresses[0],
+                           site, sites, i + 1);
+    }
+
+  Simulator::Stop (Seconds (5.0) + interval * lookups);
+  Simulator::Run ();
+
+  uint32_t maxRegistered = 0;
+  for (std::map<Address, uint32_t>::const_iterator it = registered.begin (); it != registered.end (); ++it)
+    {
+      maxRegistered = std::max (maxRegistered, it->second);
+    }
+  uint32_t maxRequests = *std::max_element (requests.begin (), requests.end ());
+  std::cout << std::setw (6) << nMapServers
+            << std::setw (10) << maxRegistered
+            << std::setw (10) << std::fixed << std::setprecision (1) << (double) sites / nMapServers
+            << std::setw (10) << maxRequests
+            << std::setw (10) << (double) lookups / nMapServers
+            << std::setw (10) << g_replies
+            << std::setw (10) << std::setprecision (3) << (double) moved / sites
+            << std::endl;
+  Simulator::Destroy ();
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t maxMapServers = 8;
+  uint32_t sites = 4096;
+  uint32_t lookups = 2000;
+  double interval = 1;
+  CommandLine cmd;
+  cmd.Usage ("Benchmark the load sharing of a pool of Map-Servers.");
+  cmd.AddValue ("max-map-servers", "largest pool of Map-Servers measured", maxMapServers);
+  cmd.AddValue ("sites", "number of /24 sites (at most 65536)", sites);
+  cmd.AddValue ("lookups", "number of Map-Requests sent to the MR", lookups);
+  cmd.AddValue ("interval", "time between two Map-Requests (ms)", interval);
+  cmd.Parse (argc, argv);
+  NS_ABORT_MSG_IF (maxMapServers < 1, "The pool needs a Map-Server");
+  NS_ABORT_MSG_IF (sites < 1 || sites > 65536, "The sites must fit in 10.0.0.0/8");
+
+  std::cout << "Running bench-lisp-shards with sites=" << sites << " lookups=" << lookups
+            << " interval=" << interval << "ms" << std::endl;
+  std::cout << std::setw (6) << "MSs"
+            << std::setw (10) << "max reg"
+            << std::setw (10) << "mean reg"
+            << std::setw (10) << "max req"
+            << std::setw (10) << "mean req"
+            << std::setw (10) << "replies"
+            << std::setw (10) << "moved" << std::endl;
+  for (uint32_t n = 1; n <= maxMapServers; n++)
+    {
+      runBench (n, sites, lookups, MilliSeconds (interval));
+    }
+  return 0;
+}
@@ -0,0 +1,156 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This program checks the ProcessingQueue against the M/M/k queue, and
+// shows how it can size a device: jobs arrive as a Poisson process of
+// 'rate' jobs/s, each taking an exponential service time of mean 'service'
+// seconds, and are served by k = 1..max-workers workers. For each k, it
+// reports the measured mean waiting time and queue length next to the
+// values of the Erlang C formula (infinite when the load per worker is 1
+// or more).
+// Sample usage:  ./waf --run 'bench-processing-queue --rate=60000 --service=0.00004'
+
+#include "ns3/core-module.h"
+#include "ns3/processing-queue.h"
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <limits>
+
+using namespace ns3;
+
+static uint64_t g_served;
+static double g_totalWait;
+static double g_queueArea;
+static Time g_lastChange;
+static uint32_t g_lastLength;
+
+static void
+Job (void)
+{
+}
+
+static void
+Waited (Time waiting, Time service)
+{
+  g_served++;
+  g_totalWait += waiting.GetSeconds ();
+}
+
+static void
+QueueLength (uint32_t oldValue, uint32_t newValue)
+{
+  g_queueArea += g_lastLength * (Simulator::Now () - g_lastChange).GetSeconds ();
+  g_lastChange = Simulator::Now ();
+  g_lastLength = newValue;
+}
+
+static void
+Arrive (Ptr<ProcessingQueue> queue, Ptr<ExponentialRandomVariable> interArrival, Ptr<ExponentialRandomVariable> service,
+        uint32_t remaining)
+{
+  queue->Submit (MakeEvent (&Job), Seconds (service->GetValue ()));
+  if (remaining > 1)
+    {
+      Simulator::Schedule (Seconds (interArrival->GetValue ()), &Arrive, queue, interArrival, service, remaining - 1);
+    }
+}
+
+// Mean waiting time of the M/M/k queue (Erlang C)
+static double
+ErlangCWait (double rate, double service, uint32_t k)
+{
+  double a = rate * service;
+  if (a >= k)
+    {
+      return std::numeric_limits<double>::infinity ();
+    }
+  double term = 1;
+  double sum = 1;
+  for (uint32_t i = 1; i < k; i++)
+    {
+      term *= a / i;
+      sum += term;
+    }
+  double last = term * a / k * k / (k - a);
+  double probWait = last / (sum + last);
+  return probWait * service / (k - a);
+}
+
+static void
+runBench (uint32_t workers, double rate, double service, uint32_t jobs)
+{
+  g_served = 0;
+  g_totalWait = g_queueArea = 0;
+  g_lastChange = Seconds (0);
+  g_lastLength = 0;
+
+  Ptr<ProcessingQueue> queue = CreateObject<ProcessingQueue> ();
+  queue->SetWorkers (workers);
+  queue->TraceConnectWithoutContext ("WaitingTime", MakeCallback (&Waited));
+  queue->TraceConnectWithoutContext ("QueueLength", MakeCallback (&QueueLength));
+  Ptr<ExponentialRandomVariable> interArrival = CreateObject<ExponentialRandomVariable> ();
+  interArrival->SetAttribute ("Mean", DoubleValue (1.0 / rate));
+  interArrival->SetStream (1);
+  Ptr<ExponentialRandomVariable> serviceTime = CreateObject<ExponentialRandomVariable> ();
+  serviceTime->SetAttribute ("Mean", DoubleValue (service));
+  serviceTime->SetStream (2);
+
+  Simulator::ScheduleNow (&Arrive, queue, interArrival, serviceTime, jobs);
+  Simulator::Run ();
+  double duration = Simulator::Now ().GetSeconds ();
+  queue->Dispose ();
+  Simulator::Destroy ();
+
+  double wait = ErlangCWait (rate, service, workers);
+  std::cout << std::setw (8) << workers
+            << std::fixed << std::setprecision (3)
+            << std::setw (8) << rate * service / workers
+            << std::setw (14) << g_totalWait / g_served * 1e6
+            << std::setw (14) << wait * 1e6
+            << std::setw (14) << g_queueArea / duration
+            << std::setw (14) << rate * wait << std::endl;
+}
+
+int main (int argc, char *argv[])
+{
+  double rate = 60000;
+  double service = 0.00004;
+  uint32_t jobs = 200000;
+  uint32_t maxWorkers = 6;
+  CommandLine cmd;
+  cmd.Usage ("Benchmark the ProcessingQueue against the M/M/k queue.");
+  cmd.AddValue ("rate", "arrival rate of the jobs (jobs/s)", rate);
+  cmd.AddValue ("service", "mean service time of a job (s)", service);
+  cmd.AddValue ("jobs", "number of jobs submitted for each number of workers", jobs);
+  cmd.AddValue ("max-workers", "largest number of workers measured", maxWorkers);
+  cmd.Parse (argc, argv);
+  NS_ABORT_MSG_IF (rate <= 0 || service <= 0 || jobs == 0 || maxWorkers == 0, "Invalid parameters");
+
+  std::cout << "Running bench-processing-queue with rate=" << rate << " service=" << service
+            << " jobs=" << jobs << " (an unstable queue grows without limit)" << std::endl;
+  std::cout << std::setw (8) << "workers"
+            << std::setw (8) << "load"
+            << std::setw (14) << "wait (us)"
+            << std::setw (14) << "Erlang C"
+            << std::setw (14) << "queue"
+            << std::setw (14) << "Erlang C" << std::endl;
+  for (uint32_t k = 1; k <= maxWorkers; k++)
+    {
+      runBench (k, rate, service, jobs);
+    }
+  return 0;
+}